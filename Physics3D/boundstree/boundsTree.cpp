@@ -2,10 +2,66 @@
 
 
 #include "../datastructures/aligned_alloc.h"
+#include "../misc/cpuid.h"
+#include "../threading/threadPool.h"
+
+#include <algorithm>
+#include <atomic>
 
 namespace P3D {
-// naive implementation, to be optimized
+static bool hasAVX2() {
+	return CPUIDCheck::hasTechnology(CPUIDCheck::AVX | CPUIDCheck::AVX2);
+}
+static bool hasAVX512() {
+	return CPUIDCheck::hasTechnology(CPUIDCheck::AVX512_F);
+}
+
 BoundsTemplate<float> TrunkSIMDHelperFallback::getTotalBounds(const TreeTrunk& trunk, int upTo) {
+	if(hasAVX2()) return getTotalBoundsAVX(trunk, upTo);
+	return getTotalBoundsFallback(trunk, upTo);
+}
+BoundsArray<BRANCH_FACTOR> TrunkSIMDHelperFallback::getAllTotalBoundsWithout(const TreeTrunk& trunk, int upTo) {
+	if(hasAVX2()) return getAllTotalBoundsWithoutAVX(trunk, upTo);
+	return getAllTotalBoundsWithoutFallback(trunk, upTo);
+}
+std::array<bool, BRANCH_FACTOR> TrunkSIMDHelperFallback::getAllContainsBounds(const TreeTrunk& trunk, const BoundsTemplate<float>& boundsToContain) {
+	if(hasAVX512()) return getAllContainsBoundsAVX512(trunk, boundsToContain);
+	if(hasAVX2()) return getAllContainsBoundsAVX(trunk, boundsToContain);
+	return getAllContainsBoundsFallback(trunk, boundsToContain);
+}
+std::array<float, BRANCH_FACTOR> TrunkSIMDHelperFallback::computeAllCosts(const TreeTrunk& trunk) {
+	if(hasAVX2()) return computeAllCostsAVX(trunk);
+	return computeAllCostsFallback(trunk);
+}
+std::array<float, BRANCH_FACTOR> TrunkSIMDHelperFallback::computeAllCombinationCosts(const BoundsArray<BRANCH_FACTOR>& boundsArr, const BoundsTemplate<float>& boundsExtention) {
+	if(hasAVX2()) return computeAllCombinationCostsAVX(boundsArr, boundsExtention);
+	return computeAllCombinationCostsFallback(boundsArr, boundsExtention);
+}
+int TrunkSIMDHelperFallback::getLowestCombinationCost(const TreeTrunk& trunk, const BoundsTemplate<float>& boundsExtention, int nodeSize) {
+	if(hasAVX2()) return getLowestCombinationCostAVX(trunk, boundsExtention, nodeSize);
+	return getLowestCombinationCostFallback(trunk, boundsExtention, nodeSize);
+}
+std::array<bool, BRANCH_FACTOR> TrunkSIMDHelperFallback::computeOverlapsWith(const TreeTrunk& trunk, int trunkSize, const BoundsTemplate<float>& bounds) {
+	if(hasAVX512()) return computeOverlapsWithAVX512(trunk, trunkSize, bounds);
+	if(hasAVX2()) return computeOverlapsWithAVX(trunk, trunkSize, bounds);
+	return computeOverlapsWithFallback(trunk, trunkSize, bounds);
+}
+OverlapMatrix TrunkSIMDHelperFallback::computeBoundsOverlapMatrix(const TreeTrunk& trunkA, int trunkASize, const TreeTrunk& trunkB, int trunkBSize) {
+	if(hasAVX512()) return computeBoundsOverlapMatrixAVX512(trunkA, trunkASize, trunkB, trunkBSize);
+	if(hasAVX2()) return computeBoundsOverlapMatrixAVX(trunkA, trunkASize, trunkB, trunkBSize);
+	return computeBoundsOverlapMatrixFallback(trunkA, trunkASize, trunkB, trunkBSize);
+}
+OverlapMatrix TrunkSIMDHelperFallback::computeInternalBoundsOverlapMatrix(const TreeTrunk& trunk, int trunkSize) {
+	if(hasAVX512()) return computeInternalBoundsOverlapMatrixAVX512(trunk, trunkSize);
+	if(hasAVX2()) return computeInternalBoundsOverlapMatrixAVX(trunk, trunkSize);
+	return computeInternalBoundsOverlapMatrixFallback(trunk, trunkSize);
+}
+std::array<float, BRANCH_FACTOR> TrunkSIMDHelperFallback::computeAllExtentionCosts(const TreeTrunk& trunk, int trunkSize, const BoundsTemplate<float>& extraBounds) {
+	if(hasAVX2()) return computeAllExtentionCostsAVX(trunk, extraBounds);
+	return computeAllExtentionCostsFallback(trunk, trunkSize, extraBounds);
+}
+
+BoundsTemplate<float> TrunkSIMDHelperFallback::getTotalBoundsFallback(const TreeTrunk& trunk, int upTo) {
 	assert(upTo >= 1 && upTo <= BRANCH_FACTOR);
 	BoundsTemplate<float> totalBounds = trunk.getBoundsOfSubNode(0);
 	for(int i = 1; i < upTo; i++) {
@@ -33,7 +89,7 @@ BoundsTemplate<float> TrunkSIMDHelperFallback::getTotalBoundsWithout(const TreeT
 	}
 }
 
-BoundsArray<BRANCH_FACTOR> TrunkSIMDHelperFallback::getAllTotalBoundsWithout(const TreeTrunk& trunk, int upTo) {
+BoundsArray<BRANCH_FACTOR> TrunkSIMDHelperFallback::getAllTotalBoundsWithoutFallback(const TreeTrunk& trunk, int upTo) {
 	assert(upTo >= 2 && upTo <= BRANCH_FACTOR); // size must be at least 2, can't compute otherwise
 	BoundsArray<BRANCH_FACTOR> result;
 	{
@@ -45,7 +101,7 @@ BoundsArray<BRANCH_FACTOR> TrunkSIMDHelperFallback::getAllTotalBoundsWithout(con
 	}
 	for(int without = 1; without < upTo; without++) {
 		BoundsTemplate<float> totalBounds = trunk.getBoundsOfSubNode(0);
-		for(int i = 2; i < upTo; i++) {
+		for(int i = 1; i < upTo; i++) {
 			if(i == without) continue;
 			totalBounds = unionOfBounds(totalBounds, trunk.getBoundsOfSubNode(i));
 		}
@@ -55,7 +111,7 @@ BoundsArray<BRANCH_FACTOR> TrunkSIMDHelperFallback::getAllTotalBoundsWithout(con
 	return result;
 }
 
-std::array<bool, BRANCH_FACTOR> TrunkSIMDHelperFallback::getAllContainsBounds(const TreeTrunk& trunk, const BoundsTemplate<float>& boundsToContain) {
+std::array<bool, BRANCH_FACTOR> TrunkSIMDHelperFallback::getAllContainsBoundsFallback(const TreeTrunk& trunk, const BoundsTemplate<float>& boundsToContain) {
 	std::array<bool, BRANCH_FACTOR> contained;
 	for(int i = 0; i < BRANCH_FACTOR; i++) {
 		BoundsTemplate<float> subNodeBounds = trunk.getBoundsOfSubNode(i);
@@ -64,7 +120,7 @@ std::array<bool, BRANCH_FACTOR> TrunkSIMDHelperFallback::getAllContainsBounds(co
 	return contained;
 }
 
-std::array<float, BRANCH_FACTOR> TrunkSIMDHelperFallback::computeAllCosts(const TreeTrunk& trunk) {
+std::array<float, BRANCH_FACTOR> TrunkSIMDHelperFallback::computeAllCostsFallback(const TreeTrunk& trunk) {
 	std::array<float, BRANCH_FACTOR> costs;
 	for(int i = 0; i < BRANCH_FACTOR; i++) {
 		BoundsTemplate<float> subNodeBounds = trunk.getBoundsOfSubNode(i);
@@ -73,7 +129,7 @@ std::array<float, BRANCH_FACTOR> TrunkSIMDHelperFallback::computeAllCosts(const
 	return costs;
 }
 
-std::array<float, BRANCH_FACTOR> TrunkSIMDHelperFallback::computeAllCombinationCosts(const BoundsArray<BRANCH_FACTOR>& boundsArr, const BoundsTemplate<float>& boundsExtention) {
+std::array<float, BRANCH_FACTOR> TrunkSIMDHelperFallback::computeAllCombinationCostsFallback(const BoundsArray<BRANCH_FACTOR>& boundsArr, const BoundsTemplate<float>& boundsExtention) {
 	std::array<float, BRANCH_FACTOR> costs;
 	for(int i = 0; i < BRANCH_FACTOR; i++) {
 		BoundsTemplate<float> subNodeBounds = boundsArr.getBounds(i);
@@ -102,8 +158,8 @@ std::pair<int, int> TrunkSIMDHelperFallback::computeFurthestObjects(const Bounds
 	return furthestObjects;
 }
 
-int TrunkSIMDHelperFallback::getLowestCombinationCost(const TreeTrunk& trunk, const BoundsTemplate<float>& boundsExtention, int nodeSize) {
-	std::array<float, BRANCH_FACTOR> costs = TrunkSIMDHelperFallback::computeAllCombinationCosts(trunk.subNodeBounds, boundsExtention);
+int TrunkSIMDHelperFallback::getLowestCombinationCostFallback(const TreeTrunk& trunk, const BoundsTemplate<float>& boundsExtention, int nodeSize) {
+	std::array<float, BRANCH_FACTOR> costs = TrunkSIMDHelperFallback::computeAllCombinationCostsFallback(trunk.subNodeBounds, boundsExtention);
 	float bestCost = costs[0];
 	int bestIndex = 0;
 	for(int i = 1; i < nodeSize; i++) {
@@ -115,7 +171,7 @@ int TrunkSIMDHelperFallback::getLowestCombinationCost(const TreeTrunk& trunk, co
 	return bestIndex;
 }
 
-std::array<bool, BRANCH_FACTOR> TrunkSIMDHelperFallback::computeOverlapsWith(const TreeTrunk& trunk, int trunkSize, const BoundsTemplate<float>& bounds) {
+std::array<bool, BRANCH_FACTOR> TrunkSIMDHelperFallback::computeOverlapsWithFallback(const TreeTrunk& trunk, int trunkSize, const BoundsTemplate<float>& bounds) {
 	std::array<bool, BRANCH_FACTOR> result;
 
 	for(int i = 0; i < trunkSize; i++) {
@@ -125,7 +181,7 @@ std::array<bool, BRANCH_FACTOR> TrunkSIMDHelperFallback::computeOverlapsWith(con
 	return result;
 }
 
-OverlapMatrix TrunkSIMDHelperFallback::computeBoundsOverlapMatrix(const TreeTrunk& trunkA, int trunkASize, const TreeTrunk& trunkB, int trunkBSize) {
+OverlapMatrix TrunkSIMDHelperFallback::computeBoundsOverlapMatrixFallback(const TreeTrunk& trunkA, int trunkASize, const TreeTrunk& trunkB, int trunkBSize) {
 	OverlapMatrix result;
 	for(int a = 0; a < trunkASize; a++) {
 		BoundsTemplate<float> aBounds = trunkA.getBoundsOfSubNode(a);
@@ -137,7 +193,7 @@ OverlapMatrix TrunkSIMDHelperFallback::computeBoundsOverlapMatrix(const TreeTrun
 	return result;
 }
 
-OverlapMatrix TrunkSIMDHelperFallback::computeInternalBoundsOverlapMatrix(const TreeTrunk& trunk, int trunkSize) {
+OverlapMatrix TrunkSIMDHelperFallback::computeInternalBoundsOverlapMatrixFallback(const TreeTrunk& trunk, int trunkSize) {
 	OverlapMatrix result;
 	for(int a = 0; a < trunkSize; a++) {
 		BoundsTemplate<float> aBounds = trunk.getBoundsOfSubNode(a);
@@ -149,7 +205,7 @@ OverlapMatrix TrunkSIMDHelperFallback::computeInternalBoundsOverlapMatrix(const
 	return result;
 }
 
-std::array<float, BRANCH_FACTOR> TrunkSIMDHelperFallback::computeAllExtentionCosts(const TreeTrunk& trunk, int trunkSize, const BoundsTemplate<float>& extraBounds) {
+std::array<float, BRANCH_FACTOR> TrunkSIMDHelperFallback::computeAllExtentionCostsFallback(const TreeTrunk& trunk, int trunkSize, const BoundsTemplate<float>& extraBounds) {
 	std::array<float, BRANCH_FACTOR> resultingCosts;
 	for(int i = 0; i < trunkSize; i++) {
 		resultingCosts[i] = computeAdditionCost(trunk.getBoundsOfSubNode(i), extraBounds);
@@ -484,6 +540,24 @@ static void freeTrunksRecursive(TrunkAllocator& alloc, TreeTrunk& curTrunk, int
 	alloc.freeTrunk(&curTrunk);
 }
 
+// trunks may only be freed by the allocator they came from, so trunks moving to another tree have to be copied over
+static void moveTrunksToAllocatorRecursive(TrunkAllocator& sourceAlloc, TrunkAllocator& destinationAlloc, TreeNodeRef& node) {
+	if(&sourceAlloc == &destinationAlloc || !node.isTrunkNode()) return;
+
+	TreeTrunk& oldTrunk = node.asTrunk();
+	int trunkSize = node.getTrunkSize();
+	bool isGroupHead = node.isGroupHead();
+
+	TreeTrunk* newTrunk = destinationAlloc.allocTrunk();
+	for(int i = 0; i < trunkSize; i++) {
+		moveTrunksToAllocatorRecursive(sourceAlloc, destinationAlloc, oldTrunk.subNodes[i]);
+		newTrunk->setSubNode(i, std::move(oldTrunk.subNodes[i]), oldTrunk.getBoundsOfSubNode(i));
+	}
+	sourceAlloc.freeTrunk(&oldTrunk);
+
+	node = TreeNodeRef(newTrunk, trunkSize, isGroupHead);
+}
+
 // expects a function of the form void(void* object, const BoundsTemplate<float>& bounds)
 template<typename Func>
 static void forEachRecurseWithBounds(const TreeTrunk& curTrunk, int curTrunkSize, const Func& func) {
@@ -533,27 +607,86 @@ static bool insertGroupIntoGroup(TrunkAllocator& sourceAlloc, TrunkAllocator& de
 }
 
 
-TrunkAllocator::TrunkAllocator() : allocationCount(0) {}
+TrunkAllocator::TrunkAllocator() : slabs(), freeList(nullptr), allocationCount(0), peakAllocationCount(0) {}
 TrunkAllocator::~TrunkAllocator() {
-	assert(this->allocationCount == 0);
+	this->releaseAll();
 }
-TrunkAllocator::TrunkAllocator(TrunkAllocator&& other) noexcept : allocationCount(other.allocationCount) {
+TrunkAllocator::TrunkAllocator(TrunkAllocator&& other) noexcept :
+	slabs(std::move(other.slabs)),
+	freeList(other.freeList),
+	allocationCount(other.allocationCount),
+	peakAllocationCount(other.peakAllocationCount) {
+
+	other.slabs.clear();
+	other.freeList = nullptr;
 	other.allocationCount = 0;
+	other.peakAllocationCount = 0;
 }
 TrunkAllocator& TrunkAllocator::operator=(TrunkAllocator&& other) noexcept {
+	std::swap(this->slabs, other.slabs);
+	std::swap(this->freeList, other.freeList);
 	std::swap(this->allocationCount, other.allocationCount);
+	std::swap(this->peakAllocationCount, other.peakAllocationCount);
 	return *this;
 }
 
+void TrunkAllocator::addSlab() {
+	TreeTrunk* slab = static_cast<TreeTrunk*>(aligned_malloc(sizeof(TreeTrunk) * TRUNKS_PER_SLAB, alignof(TreeTrunk)));
+	this->slabs.push_back(slab);
+	// push in reverse so trunks are handed out in address order
+	for(size_t i = TRUNKS_PER_SLAB; i > 0; i--) {
+		FreeTrunk* freeTrunk = reinterpret_cast<FreeTrunk*>(slab + (i - 1));
+		freeTrunk->next = this->freeList;
+		this->freeList = freeTrunk;
+	}
+}
+
 TreeTrunk* TrunkAllocator::allocTrunk() {
+	if(this->freeList == nullptr) {
+		this->addSlab();
+	}
+	FreeTrunk* result = this->freeList;
+	this->freeList = result->next;
 	this->allocationCount++;
-	std::cout << "allocTrunk " << this->allocationCount << std::endl;
-	return static_cast<TreeTrunk*>(aligned_malloc(sizeof(TreeTrunk), alignof(TreeTrunk)));
+	if(this->allocationCount > this->peakAllocationCount) {
+		this->peakAllocationCount = this->allocationCount;
+	}
+	return reinterpret_cast<TreeTrunk*>(result);
 }
 void TrunkAllocator::freeTrunk(TreeTrunk* trunk) {
+	assert(this->allocationCount > 0);
 	this->allocationCount--;
-	std::cout << "freeTrunk " << this->allocationCount << std::endl;
-	aligned_free(trunk);
+	FreeTrunk* freeTrunk = reinterpret_cast<FreeTrunk*>(trunk);
+	freeTrunk->next = this->freeList;
+	this->freeList = freeTrunk;
+}
+void TrunkAllocator::adopt(TrunkAllocator& other) {
+	if(&other == this) return;
+	if(other.freeList != nullptr) {
+		FreeTrunk* lastOfOther = other.freeList;
+		while(lastOfOther->next != nullptr) lastOfOther = lastOfOther->next;
+		lastOfOther->next = this->freeList;
+		this->freeList = other.freeList;
+	}
+	this->slabs.insert(this->slabs.end(), other.slabs.begin(), other.slabs.end());
+	this->allocationCount += other.allocationCount;
+	if(this->allocationCount > this->peakAllocationCount) {
+		this->peakAllocationCount = this->allocationCount;
+	}
+
+	other.slabs.clear();
+	other.freeList = nullptr;
+	other.allocationCount = 0;
+	other.peakAllocationCount = 0;
+}
+void TrunkAllocator::releaseAll() {
+	for(TreeTrunk* slab : this->slabs) {
+		aligned_free(slab);
+	}
+	this->slabs.clear();
+	this->freeList = nullptr;
+	this->allocationCount = 0;
+	this->peakAllocationCount = 0;
 }
 void TrunkAllocator::freeAllTrunks(TreeTrunk& baseTrunk, int baseTrunkSize) {
 	for(int i = 0; i < baseTrunkSize; i++) {
@@ -564,7 +697,7 @@ void TrunkAllocator::freeAllTrunks(TreeTrunk& baseTrunk, int baseTrunkSize) {
 	}
 }
 
-BoundsTreePrototype::BoundsTreePrototype() : baseTrunk(), baseTrunkSize(0) {}
+BoundsTreePrototype::BoundsTreePrototype() : baseTrunk(), baseTrunkSize(0), improveStructureRotation(0) {}
 BoundsTreePrototype::~BoundsTreePrototype() {
 	this->clear();
 }
@@ -615,8 +748,44 @@ void BoundsTreePrototype::transferGroupTo(const void* groupRep, const BoundsTemp
 	}
 	this->baseTrunkSize = grabbed.resultingGroupSize;
 
-	bool groupBWasFound = addRecursive(destinationTree.allocator, destinationTree.baseTrunk, destinationTree.baseTrunkSize, std::move(grabbed.nodeRef), grabbed.nodeBounds);
-	assert(groupBWasFound);
+	moveTrunksToAllocatorRecursive(this->allocator, destinationTree.allocator, grabbed.nodeRef);
+
+	destinationTree.baseTrunkSize = addRecursive(destinationTree.allocator, destinationTree.baseTrunk, destinationTree.baseTrunkSize, std::move(grabbed.nodeRef), grabbed.nodeBounds);
+}
+// marks the trunks on the path to the group, returns false if the group was not found
+static bool markGroupDirtyRecursive(TreeTrunk& curTrunk, int curTrunkSize, const void* groupRepresentative, const BoundsTemplate<float>& representativeBounds) {
+	assert(curTrunkSize >= 0 && curTrunkSize <= BRANCH_FACTOR);
+	std::array<bool, BRANCH_FACTOR> couldContain = TrunkSIMDHelperFallback::getAllContainsBounds(curTrunk, representativeBounds);
+	for(int i = 0; i < curTrunkSize; i++) {
+		if(!couldContain[i]) continue;
+
+		TreeNodeRef& subNode = curTrunk.subNodes[i];
+		if(subNode.isTrunkNode()) {
+			TreeTrunk& subNodeTrunk = subNode.asTrunk();
+			int subTrunkSize = subNode.getTrunkSize();
+
+			bool found;
+			if(subNode.isGroupHead()) {
+				found = containsObjectRecursive(subNodeTrunk, subTrunkSize, groupRepresentative, representativeBounds);
+			} else {
+				found = markGroupDirtyRecursive(subNodeTrunk, subTrunkSize, groupRepresentative, representativeBounds);
+			}
+			if(found) {
+				subNode.markDirty();
+				return true;
+			}
+		} else {
+			if(subNode.asObject() == groupRepresentative) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+void BoundsTreePrototype::markGroupDirty(const void* groupRep, const BoundsTemplate<float>& groupRepBounds) {
+	if(!markGroupDirtyRecursive(this->baseTrunk, this->baseTrunkSize, groupRep, groupRepBounds)) {
+		throw "Group not found!";
+	}
 }
 void BoundsTreePrototype::remove(const void* objectToRemove, const BoundsTemplate<float>& bounds) {
 	int resultingBaseSize = removeRecursive(allocator, baseTrunk, baseTrunkSize, objectToRemove, bounds);
@@ -760,7 +929,8 @@ size_t BoundsTreePrototype::groupSize(const void* groupRep, const BoundsTemplate
 }
 
 void BoundsTreePrototype::clear() {
-	this->allocator.freeAllTrunks(this->baseTrunk, this->baseTrunkSize);
+	// all trunks of this tree come from it's own allocator, so they can be given back in bulk
+	this->allocator.releaseAll();
 	this->baseTrunkSize = 0;
 }
 
@@ -926,8 +1096,22 @@ static int moveElementsOutOfGroup(TrunkAllocator& alloc, TreeTrunk& trunk, int t
 	return trunkSize;
 }
 
+// improves only the given trunk, its subtrunks are left as they are
+static int improveTrunk(TrunkAllocator& alloc, TreeTrunk& trunk, int trunkSize) {
+	if(isLeafTrunk(trunk, trunkSize)) return trunkSize;
+
+	trunkSize = moveElementsOutOfGroup(alloc, trunk, trunkSize);
+
+	if(trunkSize != BRANCH_FACTOR) return trunkSize;
+	if(isLeafTrunk(trunk, trunkSize)) return trunkSize;
+
+	improveTrunkVertical(trunk); // trunkSize == BRANCH_FACTOR
+	improveTrunkHorizontal(alloc, trunk); // trunkSize == BRANCH_FACTOR
+
+	return trunkSize;
+}
+
 static int improveStructureRecursive(TrunkAllocator& alloc, TreeTrunk& trunk, int trunkSize) {
-	bool givenTrunkIsLeafTrunk = true;
 	for(int i = 0; i < trunkSize; i++) {
 		TreeNodeRef& subNode = trunk.subNodes[i];
 		if(subNode.isTrunkNode()) {
@@ -937,29 +1121,266 @@ static int improveStructureRecursive(TrunkAllocator& alloc, TreeTrunk& trunk, in
 			subTrunkSize = improveStructureRecursive(alloc, subTrunk, subTrunkSize);
 
 			subNode.setTrunkSize(subTrunkSize);
-
-			if(!subNode.isGroupHead()) givenTrunkIsLeafTrunk = false;
 		}
 	}
-	if(givenTrunkIsLeafTrunk) return trunkSize;
-
-	trunkSize = moveElementsOutOfGroup(alloc, trunk, trunkSize);
+	return improveTrunk(alloc, trunk, trunkSize);
+}
 
-	if(trunkSize != BRANCH_FACTOR) return trunkSize;
-	if(isLeafTrunk(trunk, trunkSize)) return trunkSize;
+/*
+	rotation decides which subtrunk is visited first, each level uses the next digit of rotation in base BRANCH_FACTOR
+	such that consecutive rotations start in different branches at every depth
+*/
+static int improveStructureBudgetedRecursive(TrunkAllocator& alloc, TreeTrunk& trunk, int trunkSize, std::size_t rotation, int& trunksLeftToVisit) {
+	trunksLeftToVisit--;
+	int firstSubNode = static_cast<int>(rotation % BRANCH_FACTOR) % trunkSize;
+	for(int i = 0; i < trunkSize && trunksLeftToVisit > 0; i++) {
+		TreeNodeRef& subNode = trunk.subNodes[(firstSubNode + i) % trunkSize];
+		if(subNode.isTrunkNode()) {
+			TreeTrunk& subTrunk = subNode.asTrunk();
+			int subTrunkSize = subNode.getTrunkSize();
 
-	improveTrunkVertical(trunk); // trunkSize == BRANCH_FACTOR
-	improveTrunkHorizontal(alloc, trunk); // trunkSize == BRANCH_FACTOR
+			subTrunkSize = improveStructureBudgetedRecursive(alloc, subTrunk, subTrunkSize, rotation / BRANCH_FACTOR, trunksLeftToVisit);
 
-	return trunkSize;
+			subNode.setTrunkSize(subTrunkSize);
+		}
+	}
+	return improveTrunk(alloc, trunk, trunkSize);
 }
+
 void BoundsTreePrototype::improveStructure() {
-	improveStructureRecursive(this->allocator, this->baseTrunk, this->baseTrunkSize);
+	this->baseTrunkSize = improveStructureRecursive(this->allocator, this->baseTrunk, this->baseTrunkSize);
 }
 void BoundsTreePrototype::maxImproveStructure() {
 	for(int i = 0; i < 5; i++) {
 		this->improveStructure();
 	}
 }
+void BoundsTreePrototype::improveStructureBudgeted(int maxTrunksToVisit) {
+	if(this->baseTrunkSize == 0) return;
+	this->baseTrunkSize = improveStructureBudgetedRecursive(this->allocator, this->baseTrunk, this->baseTrunkSize, this->improveStructureRotation, maxTrunksToVisit);
+	this->improveStructureRotation++;
+}
+
+
+struct BuildItem {
+	TreeNodeRef node;
+	BoundsTemplate<float> bounds;
+	Vec3f center;
+};
+
+static constexpr int SAH_BIN_COUNT = 16;
+// below this many items the tree is built on the calling thread
+static constexpr size_t PARALLEL_BUILD_MIN_ITEMS = 4096;
+
+static Vec3f getBoundsCenter(const BoundsTemplate<float>& bounds) {
+	return Vec3f((bounds.min.x + bounds.max.x) * 0.5f, (bounds.min.y + bounds.max.y) * 0.5f, (bounds.min.z + bounds.max.z) * 0.5f);
+}
+
+// partitions the given items in two using binned SAH, returns the number of items in the first part, which is always between 1 and itemCount-1
+static size_t splitItemsSAH(BuildItem* items, size_t itemCount) {
+	assert(itemCount >= 2);
+	Vec3f centerMin = items[0].center;
+	Vec3f centerMax = items[0].center;
+	for(size_t i = 1; i < itemCount; i++) {
+		for(int axis = 0; axis < 3; axis++) {
+			centerMin[axis] = std::min(centerMin[axis], items[i].center[axis]);
+			centerMax[axis] = std::max(centerMax[axis], items[i].center[axis]);
+		}
+	}
+	Vec3f centerExtent = centerMax - centerMin;
+
+	int bestAxis = -1;
+	int bestSplit = 0;
+	float bestCost = std::numeric_limits<float>::infinity();
+	for(int axis = 0; axis < 3; axis++) {
+		if(centerExtent[axis] <= 0.0f) continue;
+		float binScale = SAH_BIN_COUNT / centerExtent[axis];
+
+		size_t binCounts[SAH_BIN_COUNT]{};
+		BoundsTemplate<float> binBounds[SAH_BIN_COUNT];
+		for(size_t i = 0; i < itemCount; i++) {
+			int bin = std::min(static_cast<int>((items[i].center[axis] - centerMin[axis]) * binScale), SAH_BIN_COUNT - 1);
+			binBounds[bin] = binCounts[bin] == 0 ? items[i].bounds : unionOfBounds(binBounds[bin], items[i].bounds);
+			binCounts[bin]++;
+		}
+
+		// costAbove[b] is the cost of all bins from b upwards
+		float costAbove[SAH_BIN_COUNT];
+		size_t countAbove = 0;
+		BoundsTemplate<float> boundsAbove;
+		for(int b = SAH_BIN_COUNT - 1; b > 0; b--) {
+			if(binCounts[b] != 0) {
+				boundsAbove = countAbove == 0 ? binBounds[b] : unionOfBounds(boundsAbove, binBounds[b]);
+				countAbove += binCounts[b];
+			}
+			costAbove[b] = countAbove == 0 ? 0.0f : computeCost(boundsAbove) * countAbove;
+		}
+
+		size_t countBelow = 0;
+		BoundsTemplate<float> boundsBelow;
+		for(int split = 1; split < SAH_BIN_COUNT; split++) {
+			int b = split - 1;
+			if(binCounts[b] != 0) {
+				boundsBelow = countBelow == 0 ? binBounds[b] : unionOfBounds(boundsBelow, binBounds[b]);
+				countBelow += binCounts[b];
+			}
+			if(countBelow == 0 || countBelow == itemCount) continue;
+			float cost = computeCost(boundsBelow) * countBelow + costAbove[split];
+			if(cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = split;
+			}
+		}
+	}
+
+	if(bestAxis == -1) {
+		// all centers coincide, any split is as good as any other
+		return itemCount / 2;
+	}
+
+	float binScale = SAH_BIN_COUNT / centerExtent[bestAxis];
+	BuildItem* firstAbove = std::partition(items, items + itemCount, [&](const BuildItem& item) {
+		int bin = std::min(static_cast<int>((item.center[bestAxis] - centerMin[bestAxis]) * binScale), SAH_BIN_COUNT - 1);
+		return bin < bestSplit;
+	});
+	return firstAbove - items;
+}
 
+struct BuildRange {
+	size_t begin;
+	size_t end;
+};
+
+// splits the given items into at most BRANCH_FACTOR ranges, always splitting the largest range next
+static int partitionBuildItems(BuildItem* items, size_t itemCount, BuildRange (&ranges)[BRANCH_FACTOR]) {
+	ranges[0] = BuildRange{0, itemCount};
+	int rangeCount = 1;
+	while(rangeCount < BRANCH_FACTOR) {
+		int largest = -1;
+		size_t largestSize = 1;
+		for(int i = 0; i < rangeCount; i++) {
+			size_t size = ranges[i].end - ranges[i].begin;
+			if(size > largestSize) {
+				largest = i;
+				largestSize = size;
+			}
+		}
+		if(largest == -1) break;
+
+		BuildRange& toSplit = ranges[largest];
+		size_t splitPoint = toSplit.begin + splitItemsSAH(items + toSplit.begin, largestSize);
+		ranges[rangeCount++] = BuildRange{splitPoint, toSplit.end};
+		toSplit.end = splitPoint;
+	}
+	return rangeCount;
+}
+
+// fills the given trunk with the given items, returns the resulting trunkSize
+static int buildTrunkRecursive(TrunkAllocator& alloc, TreeTrunk& trunk, BuildItem* items, size_t itemCount) {
+	assert(itemCount >= 1);
+	if(itemCount <= BRANCH_FACTOR) {
+		for(size_t i = 0; i < itemCount; i++) {
+			trunk.setSubNode(static_cast<int>(i), std::move(items[i].node), items[i].bounds);
+		}
+		return static_cast<int>(itemCount);
+	}
+
+	BuildRange ranges[BRANCH_FACTOR];
+	int rangeCount = partitionBuildItems(items, itemCount, ranges);
+	for(int i = 0; i < rangeCount; i++) {
+		BuildItem* rangeItems = items + ranges[i].begin;
+		size_t rangeSize = ranges[i].end - ranges[i].begin;
+		if(rangeSize == 1) {
+			trunk.setSubNode(i, std::move(rangeItems[0].node), rangeItems[0].bounds);
+		} else {
+			TreeTrunk* subTrunk = alloc.allocTrunk();
+			int subTrunkSize = buildTrunkRecursive(alloc, *subTrunk, rangeItems, rangeSize);
+			trunk.setSubNode(i, TreeNodeRef(subTrunk, subTrunkSize, false), TrunkSIMDHelperFallback::getTotalBounds(*subTrunk, subTrunkSize));
+		}
+	}
+	return rangeCount;
+}
+
+// like buildTrunkRecursive, but the subtrees of the given trunk are built on the threads of the pool, each with their own allocator
+static int buildTrunkParallel(TrunkAllocator& alloc, TreeTrunk& trunk, BuildItem* items, size_t itemCount, ThreadPool& threadPool) {
+	if(itemCount < PARALLEL_BUILD_MIN_ITEMS || threadPool.getNumberOfThreads() <= 1) {
+		return buildTrunkRecursive(alloc, trunk, items, itemCount);
+	}
+
+	BuildRange ranges[BRANCH_FACTOR];
+	int rangeCount = partitionBuildItems(items, itemCount, ranges);
+
+	TreeTrunk* subTrunks[BRANCH_FACTOR]{};
+	int subTrunkSizes[BRANCH_FACTOR]{};
+	TrunkAllocator workerAllocators[BRANCH_FACTOR];
+	for(int i = 0; i < rangeCount; i++) {
+		if(ranges[i].end - ranges[i].begin == 1) continue;
+		subTrunks[i] = workerAllocators[i].allocTrunk();
+	}
+	std::atomic<int> nextRange(0);
+	threadPool.doInParallel([&]() {
+		while(true) {
+			int claimedRange = nextRange++;
+			if(claimedRange >= rangeCount) break;
+			if(subTrunks[claimedRange] == nullptr) continue;
+
+			const BuildRange& range = ranges[claimedRange];
+			subTrunkSizes[claimedRange] = buildTrunkRecursive(workerAllocators[claimedRange], *subTrunks[claimedRange], items + range.begin, range.end - range.begin);
+		}
+	});
+
+	for(int i = 0; i < rangeCount; i++) {
+		if(subTrunks[i] == nullptr) {
+			BuildItem& item = items[ranges[i].begin];
+			trunk.setSubNode(i, std::move(item.node), item.bounds);
+		} else {
+			alloc.adopt(workerAllocators[i]);
+			trunk.setSubNode(i, TreeNodeRef(subTrunks[i], subTrunkSizes[i], false), TrunkSIMDHelperFallback::getTotalBounds(*subTrunks[i], subTrunkSizes[i]));
+		}
+	}
+	return rangeCount;
+}
+
+// collects all groups and loose objects as build items, the trunks above them are freed
+static void collectBuildItemsRecursive(TrunkAllocator& alloc, TreeTrunk& trunk, int trunkSize, std::vector<BuildItem>& items) {
+	for(int i = 0; i < trunkSize; i++) {
+		TreeNodeRef& subNode = trunk.subNodes[i];
+		if(subNode.isGroupHeadOrLeaf()) {
+			BoundsTemplate<float> bounds = trunk.getBoundsOfSubNode(i);
+			items.push_back(BuildItem{std::move(subNode), bounds, getBoundsCenter(bounds)});
+		} else {
+			TreeTrunk& subTrunk = subNode.asTrunk();
+			collectBuildItemsRecursive(alloc, subTrunk, subNode.getTrunkSize(), items);
+			alloc.freeTrunk(&subTrunk);
+		}
+	}
+}
+
+// gathers the current contents of the tree and the given objects, the tree is left empty
+static std::vector<BuildItem> collectAllBuildItems(TrunkAllocator& alloc, TreeTrunk& baseTrunk, int baseTrunkSize, const std::vector<std::pair<void*, BoundsTemplate<float>>>& newObjects, size_t curSize) {
+	std::vector<BuildItem> items;
+	items.reserve(newObjects.size() + curSize);
+
+	collectBuildItemsRecursive(alloc, baseTrunk, baseTrunkSize, items);
+	for(const std::pair<void*, BoundsTemplate<float>>& obj : newObjects) {
+		items.push_back(BuildItem{TreeNodeRef(obj.first), obj.second, getBoundsCenter(obj.second)});
+	}
+	return items;
+}
+
+void BoundsTreePrototype::rebuildWith(const std::vector<std::pair<void*, BoundsTemplate<float>>>& newObjects) {
+	std::vector<BuildItem> items = collectAllBuildItems(this->allocator, this->baseTrunk, this->baseTrunkSize, newObjects, this->baseTrunkSize == 0 ? 0 : this->size());
+	this->baseTrunkSize = items.size() == 0 ? 0 : buildTrunkRecursive(this->allocator, this->baseTrunk, items.data(), items.size());
+}
+void BoundsTreePrototype::rebuildWith(const std::vector<std::pair<void*, BoundsTemplate<float>>>& newObjects, ThreadPool& threadPool) {
+	std::vector<BuildItem> items = collectAllBuildItems(this->allocator, this->baseTrunk, this->baseTrunkSize, newObjects, this->baseTrunkSize == 0 ? 0 : this->size());
+	this->baseTrunkSize = items.size() == 0 ? 0 : buildTrunkParallel(this->allocator, this->baseTrunk, items.data(), items.size(), threadPool);
+}
+void BoundsTreePrototype::rebuild() {
+	this->rebuildWith(std::vector<std::pair<void*, BoundsTemplate<float>>>());
+}
+void BoundsTreePrototype::rebuild(ThreadPool& threadPool) {
+	this->rebuildWith(std::vector<std::pair<void*, BoundsTemplate<float>>>(), threadPool);
+}
 };
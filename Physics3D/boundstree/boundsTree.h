@@ -14,12 +14,14 @@
 #include <optional>
 #include <iostream>
 #include <stack>
+#include <vector>
 
 namespace P3D {
 constexpr int BRANCH_FACTOR = 8;
 static_assert((BRANCH_FACTOR & (BRANCH_FACTOR - 1)) == 0, "Branch factor must be power of 2");
 
 struct TreeTrunk;
+class ThreadPool;
 
 inline float computeCost(const BoundsTemplate<float>& bounds) {
 	Vec3f d = bounds.getDiagonal();
@@ -35,17 +37,19 @@ class TreeNodeRef {
 
 	static constexpr std::uintptr_t SIZE_DATA_MASK = BRANCH_FACTOR - 1;
 	static constexpr std::uintptr_t GROUP_HEAD_MASK = BRANCH_FACTOR;
-	static constexpr std::uintptr_t PTR_MASK = ~(SIZE_DATA_MASK | GROUP_HEAD_MASK);
+	static constexpr std::uintptr_t DIRTY_MASK = BRANCH_FACTOR * 2;
+	static constexpr std::uintptr_t PTR_MASK = ~(SIZE_DATA_MASK | GROUP_HEAD_MASK | DIRTY_MASK);
 	static constexpr std::uintptr_t INVALID_REF = 0xADADADADADADADAD;
 
 
 	/* encoding:
-		0b...pppppgsss
+		0b...ppppdgsss
 
 		(this is if BRANCH_FACTOR == 8)
 		Last 3 bits specify type: 
 		0b000: leaf node -> ptr points to object
 		else : trunk node -> ptr points to TreeTrunk
+			d bit specifies 'isDirty', the bounds of objects in this trunk may have changed, see refitDirty
 			g bit specifies 'isGroupHead'
 			s bits specify size of this trunk node - 1. 0b111 is a trunknode of size 8
 	*/
@@ -110,6 +114,18 @@ public:
 		assert(isTrunkNode());
 		return (ptr & GROUP_HEAD_MASK) != 0;
 	}
+	inline void markDirty() {
+		assert(isTrunkNode());
+		this->ptr |= DIRTY_MASK;
+	}
+	inline void clearDirty() {
+		assert(isTrunkNode());
+		this->ptr &= ~DIRTY_MASK;
+	}
+	inline bool isDirty() const {
+		assert(isTrunkNode());
+		return (ptr & DIRTY_MASK) != 0;
+	}
 	inline bool isGroupHeadOrLeaf() const {
 		if(isTrunkNode()) {
 			return (ptr & GROUP_HEAD_MASK) != 0;
@@ -219,6 +235,11 @@ struct OverlapMatrix {
 	inline const bool* operator[](size_t idx) const {return overlapData+BRANCH_FACTOR*idx;}
 };
 
+/*
+	The trunk level operations of the tree
+	The operations that work on all subnodes at once have AVX2 and AVX-512 versions, the public functions pick one through CPUIDCheck
+	The Fallback versions are plain C++ and define the expected results
+*/
 struct TrunkSIMDHelperFallback {
 	static BoundsTemplate<float> getTotalBounds(const TreeTrunk& trunk, int upTo);
 	static BoundsTemplate<float> getTotalBoundsWithout(const TreeTrunk& trunk, int upTo, int without);
@@ -232,13 +253,45 @@ struct TrunkSIMDHelperFallback {
 	static std::array<bool, BRANCH_FACTOR> computeOverlapsWith(const TreeTrunk& trunk, int trunkSize, const BoundsTemplate<float>& bounds);
 	// indexed result[a][b]
 	static OverlapMatrix computeBoundsOverlapMatrix(const TreeTrunk& trunkA, int trunkASize, const TreeTrunk& trunkB, int trunkBSize);
-	static OverlapMatrix computeBoundsOverlapMatrixAVX(const TreeTrunk& trunkA, int trunkASize, const TreeTrunk& trunkB, int trunkBSize);
-	static OverlapMatrix computeBoundsOverlapMatrixSSE(const TreeTrunk& trunkA, int trunkASize, const TreeTrunk& trunkB, int trunkBSize);
 	// indexed result[i][j] with j >= i+1
 	static OverlapMatrix computeInternalBoundsOverlapMatrix(const TreeTrunk& trunk, int trunkSize);
 
 	static std::array<float, BRANCH_FACTOR> computeAllExtentionCosts(const TreeTrunk& trunk, int trunkSize, const BoundsTemplate<float>& extraBounds);
 
+	static BoundsTemplate<float> getTotalBoundsFallback(const TreeTrunk& trunk, int upTo);
+	static BoundsArray<BRANCH_FACTOR> getAllTotalBoundsWithoutFallback(const TreeTrunk& trunk, int upTo);
+	static std::array<bool, BRANCH_FACTOR> getAllContainsBoundsFallback(const TreeTrunk& trunk, const BoundsTemplate<float>& boundsToContain);
+	static std::array<float, BRANCH_FACTOR> computeAllCostsFallback(const TreeTrunk& trunk);
+	static std::array<float, BRANCH_FACTOR> computeAllCombinationCostsFallback(const BoundsArray<BRANCH_FACTOR>& boundsArr, const BoundsTemplate<float>& boundsExtention);
+	static int getLowestCombinationCostFallback(const TreeTrunk& trunk, const BoundsTemplate<float>& boundsExtention, int nodeSize);
+	static std::array<bool, BRANCH_FACTOR> computeOverlapsWithFallback(const TreeTrunk& trunk, int trunkSize, const BoundsTemplate<float>& bounds);
+	static OverlapMatrix computeBoundsOverlapMatrixFallback(const TreeTrunk& trunkA, int trunkASize, const TreeTrunk& trunkB, int trunkBSize);
+	static OverlapMatrix computeInternalBoundsOverlapMatrixFallback(const TreeTrunk& trunk, int trunkSize);
+	static std::array<float, BRANCH_FACTOR> computeAllExtentionCostsFallback(const TreeTrunk& trunk, int trunkSize, const BoundsTemplate<float>& extraBounds);
+
+	// boundsTreeAVX.cpp, requires AVX and AVX2
+	static BoundsTemplate<float> getTotalBoundsAVX(const TreeTrunk& trunk, int upTo);
+	static BoundsArray<BRANCH_FACTOR> getAllTotalBoundsWithoutAVX(const TreeTrunk& trunk, int upTo);
+	static std::array<bool, BRANCH_FACTOR> getAllContainsBoundsAVX(const TreeTrunk& trunk, const BoundsTemplate<float>& boundsToContain);
+	static std::array<float, BRANCH_FACTOR> computeAllCostsAVX(const TreeTrunk& trunk);
+	static std::array<float, BRANCH_FACTOR> computeAllCombinationCostsAVX(const BoundsArray<BRANCH_FACTOR>& boundsArr, const BoundsTemplate<float>& boundsExtention);
+	static int getLowestCombinationCostAVX(const TreeTrunk& trunk, const BoundsTemplate<float>& boundsExtention, int nodeSize);
+	static std::array<bool, BRANCH_FACTOR> computeOverlapsWithAVX(const TreeTrunk& trunk, int trunkSize, const BoundsTemplate<float>& bounds);
+	static OverlapMatrix computeBoundsOverlapMatrixAVX(const TreeTrunk& trunkA, int trunkASize, const TreeTrunk& trunkB, int trunkBSize);
+	static OverlapMatrix computeInternalBoundsOverlapMatrixAVX(const TreeTrunk& trunk, int trunkSize);
+	static std::array<float, BRANCH_FACTOR> computeAllExtentionCostsAVX(const TreeTrunk& trunk, const BoundsTemplate<float>& extraBounds);
+
+	/*
+		boundsTreeAVX512.cpp, requires AVX512_F
+		A trunk only has 8 subnodes, so only the comparisons gain from the 16 lanes, these handle two rows or two coordinates at a time
+	*/
+	static std::array<bool, BRANCH_FACTOR> getAllContainsBoundsAVX512(const TreeTrunk& trunk, const BoundsTemplate<float>& boundsToContain);
+	static std::array<bool, BRANCH_FACTOR> computeOverlapsWithAVX512(const TreeTrunk& trunk, int trunkSize, const BoundsTemplate<float>& bounds);
+	static OverlapMatrix computeBoundsOverlapMatrixAVX512(const TreeTrunk& trunkA, int trunkASize, const TreeTrunk& trunkB, int trunkBSize);
+	static OverlapMatrix computeInternalBoundsOverlapMatrixAVX512(const TreeTrunk& trunk, int trunkSize);
+
+	static OverlapMatrix computeBoundsOverlapMatrixSSE(const TreeTrunk& trunkA, int trunkASize, const TreeTrunk& trunkB, int trunkBSize);
+
 	// returns resulting destTrunk size
 	static int transferNodes(TreeTrunk& srcTrunk, int srcTrunkStart, int srcTrunkEnd, TreeTrunk& destTrunk, int destTrunkSize);
 	
@@ -266,9 +319,25 @@ inline BoundsTemplate<float> TreeNodeRef::recalculateBoundsRecursive(const GetOb
 	}
 }
 
+/*
+	Trunks are allocated from slabs of TRUNKS_PER_SLAB contiguous, cache line aligned trunks
+	Freed trunks are kept in a free list for reuse, slabs are only given back when the allocator is released or destroyed
+	Trunks may only be freed by the allocator that allocated them
+*/
 class TrunkAllocator {
+	struct FreeTrunk {
+		FreeTrunk* next;
+	};
+
+	std::vector<TreeTrunk*> slabs;
+	FreeTrunk* freeList;
 	size_t allocationCount;
+	size_t peakAllocationCount;
+
+	void addSlab();
 public:
+	static constexpr size_t TRUNKS_PER_SLAB = 64;
+
 	TrunkAllocator();
 	~TrunkAllocator();
 	TrunkAllocator(const TrunkAllocator&) = delete;
@@ -278,6 +347,18 @@ public:
 	TreeTrunk* allocTrunk();
 	void freeTrunk(TreeTrunk* trunk);
 	void freeAllTrunks(TreeTrunk& baseTrunk, int baseTrunkSize);
+	// gives back all slabs at once, none of the trunks allocated by this allocator may be used afterwards
+	void releaseAll();
+
+	// the number of trunks currently in use
+	size_t getLiveTrunkCount() const { return allocationCount; }
+	// the highest number of trunks in use at once since the last releaseAll
+	size_t getPeakTrunkCount() const { return peakAllocationCount; }
+	// takes over all slabs and trunks of other, trunks allocated by other must be freed by this allocator afterwards
+	void adopt(TrunkAllocator& other);
+
+	size_t getSlabCount() const { return slabs.size(); }
+	size_t getTrunkCapacity() const { return slabs.size() * TRUNKS_PER_SLAB; }
 };
 
 int addRecursive(TrunkAllocator& allocator, TreeTrunk& curTrunk, int curTrunkSize, TreeNodeRef&& newNode, const BoundsTemplate<float>& bounds);
@@ -542,6 +623,96 @@ void forEachColissionInternalRecursive(const TreeTrunk& curTrunk, int curTrunkSi
 	}
 }
 
+/*
+	An independent piece of a colission query, can be run on any thread
+	trunkB == nullptr means the internal colissions of trunkA
+	else it means the colissions between trunkA and trunkB
+*/
+struct ColissionTask {
+	const TreeTrunk* trunkA;
+	int trunkASize;
+	const TreeTrunk* trunkB;
+	int trunkBSize;
+};
+
+// expects a function of the form void(Boundable*, Boundable*)
+template<typename Boundable, typename SIMDHelper, typename Func>
+void runColissionTask(const ColissionTask& task, const Func& func) {
+	if(task.trunkB == nullptr) {
+		forEachColissionInternalRecursive<Boundable, SIMDHelper, Func>(*task.trunkA, task.trunkASize, func);
+	} else {
+		forEachColissionBetweenRecursive<Boundable, SIMDHelper, Func>(*task.trunkA, task.trunkASize, *task.trunkB, task.trunkBSize, func);
+	}
+}
+
+/*
+	Does one level of the colission recursion of the given task, trunk-trunk pairs are added to subTasks,
+	colissions involving leaf nodes are cheap and are passed to func directly
+	expects a function of the form void(Boundable*, Boundable*)
+*/
+template<typename Boundable, typename SIMDHelper, typename Func>
+void splitColissionTask(const ColissionTask& task, std::vector<ColissionTask>& subTasks, const Func& func) {
+	const TreeTrunk& trunkA = *task.trunkA;
+	bool isInternal = task.trunkB == nullptr;
+	const TreeTrunk& trunkB = isInternal ? trunkA : *task.trunkB;
+	int trunkBSize = isInternal ? task.trunkASize : task.trunkBSize;
+
+	OverlapMatrix overlaps = isInternal ? SIMDHelper::computeInternalBoundsOverlapMatrix(trunkA, task.trunkASize) : SIMDHelper::computeBoundsOverlapMatrix(trunkA, task.trunkASize, trunkB, trunkBSize);
+
+	for(int a = 0; a < task.trunkASize; a++) {
+		const TreeNodeRef& aNode = trunkA.subNodes[a];
+		bool aIsTrunk = aNode.isTrunkNode();
+		for(int b = isInternal ? a + 1 : 0; b < trunkBSize; b++) {
+			if(!overlaps[a][b]) continue;
+
+			const TreeNodeRef& bNode = trunkB.subNodes[b];
+			bool bIsTrunk = bNode.isTrunkNode();
+
+			if(aIsTrunk) {
+				if(bIsTrunk) {
+					subTasks.push_back(ColissionTask{&aNode.asTrunk(), aNode.getTrunkSize(), &bNode.asTrunk(), bNode.getTrunkSize()});
+				} else {
+					forEachColissionWithRecursive<Boundable, SIMDHelper, Func>(aNode.asTrunk(), aNode.getTrunkSize(), static_cast<Boundable*>(bNode.asObject()), trunkB.getBoundsOfSubNode(b), func);
+				}
+			} else {
+				if(bIsTrunk) {
+					forEachColissionWithRecursive<Boundable, SIMDHelper, Func>(static_cast<Boundable*>(aNode.asObject()), trunkA.getBoundsOfSubNode(a), bNode.asTrunk(), bNode.getTrunkSize(), func);
+				} else {
+					func(static_cast<Boundable*>(aNode.asObject()), static_cast<Boundable*>(bNode.asObject()));
+				}
+			}
+		}
+	}
+
+	if(isInternal) {
+		for(int i = 0; i < task.trunkASize; i++) {
+			const TreeNodeRef& subNode = trunkA.subNodes[i];
+
+			if(subNode.isTrunkNode() && !subNode.isGroupHead()) {
+				subTasks.push_back(ColissionTask{&subNode.asTrunk(), subNode.getTrunkSize(), nullptr, 0});
+			}
+		}
+	}
+}
+
+/*
+	Splits the top levels of the colission recursion until there are at least targetTaskCount tasks, or maxDepth levels have been split
+	The resulting tasks are independent and each can be run with runColissionTask
+	The order of the tasks and of the colissions passed to func is deterministic
+	expects a function of the form void(Boundable*, Boundable*)
+*/
+template<typename Boundable, typename SIMDHelper, typename Func>
+void splitColissionTasks(std::vector<ColissionTask>& tasks, std::size_t targetTaskCount, int maxDepth, const Func& func) {
+	std::vector<ColissionTask> nextLevel;
+	for(int depth = 0; depth < maxDepth && tasks.size() != 0 && tasks.size() < targetTaskCount; depth++) {
+		nextLevel.clear();
+		for(const ColissionTask& task : tasks) {
+			splitColissionTask<Boundable, SIMDHelper, Func>(task, nextLevel, func);
+		}
+		tasks.swap(nextLevel);
+	}
+}
+
 class BoundsTreeIteratorPrototype {
 	struct StackElement {
 		const TreeTrunk* trunk;
@@ -672,6 +843,8 @@ class BoundsTreePrototype {
 	TreeTrunk baseTrunk;
 	int baseTrunkSize;
 	TrunkAllocator allocator;
+	// counts the calls to improveStructureBudgeted, decides which part of the tree is improved first
+	std::size_t improveStructureRotation;
 
 	template<typename Boundable>
 	friend class BoundsTree;
@@ -680,13 +853,14 @@ public:
 	BoundsTreePrototype();
 	~BoundsTreePrototype();
 
-	inline BoundsTreePrototype(BoundsTreePrototype&& other) noexcept : baseTrunk(std::move(other.baseTrunk)), baseTrunkSize(other.baseTrunkSize), allocator(std::move(other.allocator)) {
+	inline BoundsTreePrototype(BoundsTreePrototype&& other) noexcept : baseTrunk(std::move(other.baseTrunk)), baseTrunkSize(other.baseTrunkSize), allocator(std::move(other.allocator)), improveStructureRotation(other.improveStructureRotation) {
 		other.baseTrunkSize = 0;
 	}
 	inline BoundsTreePrototype& operator=(BoundsTreePrototype&& other) noexcept {
 		this->baseTrunk = std::move(other.baseTrunk);
 		this->baseTrunkSize = other.baseTrunkSize;
 		this->allocator = std::move(other.allocator);
+		this->improveStructureRotation = other.improveStructureRotation;
 
 		other.baseTrunkSize = 0;
 
@@ -706,6 +880,13 @@ public:
 
 	void disbandGroup(const void* groupRep, const BoundsTemplate<float>& groupRepBounds);
 
+	/*
+		Marks the group and all trunks above it as dirty, the next refitDirty will recalculate their bounds
+		groupRepBounds must still be the bounds the group representative has in the tree, so this must be called before the group is moved
+		Dirty marks may be lost when the structure of the tree is changed, so refitDirty must be called before any other modification
+	*/
+	void markGroupDirty(const void* groupRep, const BoundsTemplate<float>& groupRepBounds);
+
 	bool contains(const void* object, const BoundsTemplate<float>& bounds) const;
 	bool groupContains(const void* groupRep, const BoundsTemplate<float>& groupRepBounds, const void* object, const BoundsTemplate<float>& bounds) const;
 	size_t size() const;
@@ -800,6 +981,48 @@ public:
 
 	void improveStructure();
 	void maxImproveStructure();
+	/*
+		Like improveStructure, but visits at most maxTrunksToVisit trunks
+		Every call starts in a different part of the tree, such that repeated calls eventually improve all of it
+	*/
+	void improveStructureBudgeted(int maxTrunksToVisit);
+
+	/*
+		Throws away the current structure and builds the tree again top-down using binned SAH splits
+		Groups are kept intact, only the trunks above them are rebuilt
+	*/
+	void rebuild();
+	// like rebuild, but large trees are built in parallel on the given pool
+	void rebuild(ThreadPool& threadPool);
+
+	/*
+		Adds all given objects as separate groups and rebuilds the tree, much faster than adding many objects one by one
+		the given iterator should return objects of type std::pair<void*, BoundsTemplate<float>>
+	*/
+	template<typename ObjectIter, typename ObjectIterEnd>
+	void addAll(ObjectIter iter, const ObjectIterEnd& iterEnd) {
+		std::vector<std::pair<void*, BoundsTemplate<float>>> newObjects;
+		while(iter != iterEnd) {
+			std::pair<const void*, BoundsTemplate<float>> obj = *iter;
+			newObjects.emplace_back(const_cast<void*>(obj.first), obj.second);
+			++iter;
+		}
+		this->rebuildWith(newObjects);
+	}
+	// like addAll, but large trees are built in parallel on the given pool
+	template<typename ObjectIter, typename ObjectIterEnd>
+	void addAll(ObjectIter iter, const ObjectIterEnd& iterEnd, ThreadPool& threadPool) {
+		std::vector<std::pair<void*, BoundsTemplate<float>>> newObjects;
+		while(iter != iterEnd) {
+			std::pair<const void*, BoundsTemplate<float>> obj = *iter;
+			newObjects.emplace_back(const_cast<void*>(obj.first), obj.second);
+			++iter;
+		}
+		this->rebuildWith(newObjects, threadPool);
+	}
+
+	void rebuildWith(const std::vector<std::pair<void*, BoundsTemplate<float>>>& newObjects);
+	void rebuildWith(const std::vector<std::pair<void*, BoundsTemplate<float>>>& newObjects, ThreadPool& threadPool);
 
 	BoundsTreeIteratorPrototype begin() const { return BoundsTreeIteratorPrototype(baseTrunk, baseTrunkSize); }
 	IteratorEnd end() const { return IteratorEnd(); }
@@ -836,6 +1059,52 @@ void recalculateBoundsRecursive(TreeTrunk& curTrunk, int curTrunkSize) {
 	}
 }
 
+// expects a function of the form BoundsTemplate<float>(const Boundable& object, const BoundsTemplate<float>& currentBounds)
+template<typename Boundable, typename GetLeafBounds>
+void refitRecursive(TreeTrunk& curTrunk, int curTrunkSize, const GetLeafBounds& getLeafBounds) {
+	for(int i = 0; i < curTrunkSize; i++) {
+		TreeNodeRef& subNode = curTrunk.subNodes[i];
+
+		if(subNode.isTrunkNode()) {
+			TreeTrunk& subTrunk = subNode.asTrunk();
+			int subTrunkSize = subNode.getTrunkSize();
+			refitRecursive<Boundable>(subTrunk, subTrunkSize, getLeafBounds);
+			curTrunk.setBoundsOfSubNode(i, TrunkSIMDHelperFallback::getTotalBounds(subTrunk, subTrunkSize));
+		} else {
+			const Boundable* object = static_cast<const Boundable*>(subNode.asObject());
+			curTrunk.setBoundsOfSubNode(i, getLeafBounds(*object, curTrunk.getBoundsOfSubNode(i)));
+		}
+	}
+}
+
+/*
+	refits all leaves in curTrunk, and all dirty subtrunks, clears the dirty marks
+	expects a function of the form BoundsTemplate<float>(const Boundable& object, const BoundsTemplate<float>& currentBounds)
+*/
+template<typename Boundable, typename GetLeafBounds>
+void refitDirtyRecursive(TreeTrunk& curTrunk, int curTrunkSize, const GetLeafBounds& getLeafBounds) {
+	for(int i = 0; i < curTrunkSize; i++) {
+		TreeNodeRef& subNode = curTrunk.subNodes[i];
+
+		if(subNode.isTrunkNode()) {
+			if(!subNode.isDirty()) continue;
+			subNode.clearDirty();
+			TreeTrunk& subTrunk = subNode.asTrunk();
+			int subTrunkSize = subNode.getTrunkSize();
+			if(subNode.isGroupHead()) {
+				// the whole group has moved
+				refitRecursive<Boundable>(subTrunk, subTrunkSize, getLeafBounds);
+			} else {
+				refitDirtyRecursive<Boundable>(subTrunk, subTrunkSize, getLeafBounds);
+			}
+			curTrunk.setBoundsOfSubNode(i, TrunkSIMDHelperFallback::getTotalBounds(subTrunk, subTrunkSize));
+		} else {
+			const Boundable* object = static_cast<const Boundable*>(subNode.asObject());
+			curTrunk.setBoundsOfSubNode(i, getLeafBounds(*object, curTrunk.getBoundsOfSubNode(i)));
+		}
+	}
+}
+
 template<typename Boundable>
 bool updateGroupBoundsRecursive(TreeTrunk& curTrunk, int curTrunkSize, const Boundable* groupRep, const BoundsTemplate<float>& originalGroupRepBounds) {
 	assert(curTrunkSize >= 0 && curTrunkSize <= BRANCH_FACTOR);
@@ -1012,6 +1281,20 @@ public:
 		tree.splitGroup(BoundableIteratorAdapter<GroupIter>{std::move(iter)}, iterEnd);
 	}
 
+	// the given iterator should return objects of type Boundable*, see BoundsTreePrototype::addAll
+	template<typename BoundableIter, typename BoundableIterEnd>
+	void addAll(BoundableIter iter, const BoundableIterEnd& iterEnd) {
+		tree.addAll(BoundableIteratorAdapter<BoundableIter>{std::move(iter)}, iterEnd);
+	}
+	template<typename BoundableIter, typename BoundableIterEnd>
+	void addAll(BoundableIter iter, const BoundableIterEnd& iterEnd, ThreadPool& threadPool) {
+		tree.addAll(BoundableIteratorAdapter<BoundableIter>{std::move(iter)}, iterEnd, threadPool);
+	}
+
+	// see BoundsTreePrototype::rebuild
+	void rebuild() { tree.rebuild(); }
+	void rebuild(ThreadPool& threadPool) { tree.rebuild(threadPool); }
+
 	// expects a function of the form void(Boundable& object)
 	template<typename Func>
 	void forEach(const Func& func) const {
@@ -1062,12 +1345,76 @@ public:
 		forEachColissionBetweenRecursive<Boundable, TrunkSIMDHelperFallback, Func>(this->tree.baseTrunk, this->tree.baseTrunkSize, other.tree.baseTrunk, other.tree.baseTrunkSize, func);
 	}
 
+	// expects a function of the form void(Boundable* object), called for every object whose bounds overlap the given bounds
+	template<typename Func>
+	void forEachOverlapping(const BoundsTemplate<float>& bounds, const Func& func) const {
+		if(this->tree.baseTrunkSize == 0) return;
+		forEachColissionWithRecursive<Boundable, TrunkSIMDHelperFallback>(static_cast<Boundable*>(nullptr), bounds, this->tree.baseTrunk, this->tree.baseTrunkSize, [&func](Boundable*, Boundable* found) {
+			func(found);
+		});
+	}
+
+	/*
+		Splits forEachColission into independent tasks which can be run on separate threads using runColissionTask
+		The new tasks are appended to tasks
+		Colissions found while splitting are passed to func directly
+		expects a function of the form void(Boundable* a, Boundable* b)
+	*/
+	template<typename Func>
+	void splitColissionTasks(std::vector<ColissionTask>& tasks, std::size_t targetTaskCount, int maxDepth, const Func& func) const {
+		if(this->tree.baseTrunkSize == 0) return;
+		std::vector<ColissionTask> newTasks{ColissionTask{&this->tree.baseTrunk, this->tree.baseTrunkSize, nullptr, 0}};
+		P3D::splitColissionTasks<Boundable, TrunkSIMDHelperFallback, Func>(newTasks, targetTaskCount, maxDepth, func);
+		tasks.insert(tasks.end(), newTasks.begin(), newTasks.end());
+	}
+
+	/*
+		Splits forEachColissionWith into independent tasks which can be run on separate threads using runColissionTask
+		The new tasks are appended to tasks
+		Colissions found while splitting are passed to func directly
+		expects a function of the form void(Boundable* a, Boundable* b)
+	*/
+	template<typename Func>
+	void splitColissionTasksWith(const BoundsTree& other, std::vector<ColissionTask>& tasks, std::size_t targetTaskCount, int maxDepth, const Func& func) const {
+		if(this->tree.baseTrunkSize == 0 || other.tree.baseTrunkSize == 0) return;
+		std::vector<ColissionTask> newTasks{ColissionTask{&this->tree.baseTrunk, this->tree.baseTrunkSize, &other.tree.baseTrunk, other.tree.baseTrunkSize}};
+		P3D::splitColissionTasks<Boundable, TrunkSIMDHelperFallback, Func>(newTasks, targetTaskCount, maxDepth, func);
+		tasks.insert(tasks.end(), newTasks.begin(), newTasks.end());
+	}
+
+	// expects a function of the form void(Boundable* a, Boundable* b)
+	template<typename Func>
+	static void runColissionTask(const ColissionTask& task, const Func& func) {
+		P3D::runColissionTask<Boundable, TrunkSIMDHelperFallback, Func>(task, func);
+	}
+
 	void recalculateBounds() {
 		recalculateBoundsRecursive<Boundable>(this->tree.baseTrunk, this->tree.baseTrunkSize);
 	}
 
+	// must be called before the group is moved, see BoundsTreePrototype::markGroupDirty
+	void markGroupDirty(const Boundable* groupRep) {
+		tree.markGroupDirty(static_cast<const void*>(groupRep), groupRep->getBounds());
+	}
+
+	// recalculates the bounds of only the groups marked with markGroupDirty
+	void refitDirty() {
+		this->refitDirty([](const Boundable& object, const BoundsTemplate<float>&) {return object.getBounds(); });
+	}
+
+	/*
+		Like refitDirty, but the bounds stored for the leaves are given by getLeafBounds, these must contain the bounds of the object
+		This allows the tree to keep enlarged bounds for objects that are expected to move
+		expects a function of the form BoundsTemplate<float>(const Boundable& object, const BoundsTemplate<float>& currentBounds)
+	*/
+	template<typename GetLeafBounds>
+	void refitDirty(const GetLeafBounds& getLeafBounds) {
+		refitDirtyRecursive<Boundable>(this->tree.baseTrunk, this->tree.baseTrunkSize, getLeafBounds);
+	}
+
 	void improveStructure() { tree.improveStructure(); }
 	void maxImproveStructure() { tree.maxImproveStructure(); }
+	void improveStructureBudgeted(int maxTrunksToVisit) { tree.improveStructureBudgeted(maxTrunksToVisit); }
 };
 
 struct BasicBounded {
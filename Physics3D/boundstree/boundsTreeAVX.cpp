@@ -1,93 +1,233 @@
-#include "boundsTree.h" 
+#include "boundsTree.h"
 
-#include "../datastructures/alignedPtr.h"
 #include <immintrin.h>
+#include <limits>
 
+// AVX2 implementation for the TrunkSIMDHelperFallback functions, every lane holds one subnode of the trunk
 namespace P3D {
+static_assert(BRANCH_FACTOR == 8, "the AVX implementation requires a branch factor of 8");
+
+namespace {
+struct TrunkBoundsAVX {
+	__m256 xMin;
+	__m256 yMin;
+	__m256 zMin;
+	__m256 xMax;
+	__m256 yMax;
+	__m256 zMax;
+};
+
+inline TrunkBoundsAVX loadBounds(const BoundsArray<BRANCH_FACTOR>& bounds) {
+	return TrunkBoundsAVX{
+		_mm256_load_ps(bounds.xMin),
+		_mm256_load_ps(bounds.yMin),
+		_mm256_load_ps(bounds.zMin),
+		_mm256_load_ps(bounds.xMax),
+		_mm256_load_ps(bounds.yMax),
+		_mm256_load_ps(bounds.zMax)
+	};
+}
 
-OverlapMatrix TrunkSIMDHelperFallback::computeBoundsOverlapMatrixAVX(const TreeTrunk& trunkA, int trunkASize, const TreeTrunk& trunkB, int trunkBSize) {
-	OverlapMatrix result;
-
-    __m256 rx0 = _mm256_set1_ps(0);
-    __m256 ry0 = _mm256_set1_ps(0);
-    __m256 rz0 = _mm256_set1_ps(0);
-
-    __m256 rx1 = _mm256_set1_ps(0);
-    __m256 ry1 = _mm256_set1_ps(0);
-    __m256 rz1 = _mm256_set1_ps(0);
-    
-    alignas(32) float tempBuff[8];
-
-
-    __m256 bxmin = _mm256_load_ps(trunkB.subNodeBounds.xMin);
-    
-    __m256 bymin = _mm256_load_ps(trunkB.subNodeBounds.yMin);
-    
-    __m256 bzmin = _mm256_load_ps(trunkB.subNodeBounds.zMin);
-    
-    __m256 bxmax = _mm256_load_ps(trunkB.subNodeBounds.xMax);
-    
-    __m256 bymax = _mm256_load_ps(trunkB.subNodeBounds.yMax);
-    
-    __m256 bzmax = _mm256_load_ps(trunkB.subNodeBounds.zMax);
-
-
-
-	for(int a = 0; a < trunkASize; a++) {
-		
-    	BoundsTemplate<float> aBounds0 = trunkA.getBoundsOfSubNode(a);
-     
-        __m256 axmin = _mm256_set1_ps(aBounds0.min.x);
-
-        __m256 aymin = _mm256_set1_ps(aBounds0.min.y);
-
-        __m256 azmin = _mm256_set1_ps(aBounds0.min.z);
-
-        __m256 axmax = _mm256_set1_ps(aBounds0.max.x);
-
-        __m256 aymax = _mm256_set1_ps(aBounds0.max.y);
-
-        __m256 azmax = _mm256_set1_ps(aBounds0.max.z);
+inline std::array<bool, BRANCH_FACTOR> maskToBools(int mask) {
+	std::array<bool, BRANCH_FACTOR> result;
+	for(int i = 0; i < BRANCH_FACTOR; i++) {
+		result[i] = ((mask >> i) & 1) != 0;
+	}
+	return result;
+}
+inline void writeMaskToRow(bool* row, int mask) {
+	for(int i = 0; i < BRANCH_FACTOR; i++) {
+		row[i] = ((mask >> i) & 1) != 0;
+	}
+}
 
+// lanes with an index of size or larger are replaced by value
+inline __m256 replaceUnusedLanes(__m256 v, int size, float value) {
+	__m256i laneIndices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256 usedLanes = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(size), laneIndices));
+	return _mm256_blendv_ps(_mm256_set1_ps(value), v, usedLanes);
+}
 
+inline float horizontalMin(__m256 v) {
+	__m128 m = _mm_min_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+	m = _mm_min_ss(m, _mm_shuffle_ps(m, m, 1));
+	return _mm_cvtss_f32(m);
+}
+inline float horizontalMax(__m256 v) {
+	__m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+	m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+	return _mm_cvtss_f32(m);
+}
 
-            rx0 = _mm256_cmp_ps(axmax, bxmin, _CMP_GE_OQ);
+// result[i] = v[i - N], the first N lanes are filled with fill
+template<int N>
+inline __m256 shiftLanesUp(__m256 v, __m256 fill) {
+	__m256i indices = _mm256_setr_epi32(-N, 1 - N, 2 - N, 3 - N, 4 - N, 5 - N, 6 - N, 7 - N);
+	return _mm256_blend_ps(_mm256_permutevar8x32_ps(v, indices), fill, (1 << N) - 1);
+}
+// result[i] = v[i + N], the last N lanes are filled with fill
+template<int N>
+inline __m256 shiftLanesDown(__m256 v, __m256 fill) {
+	__m256i indices = _mm256_setr_epi32(N, 1 + N, 2 + N, 3 + N, 4 + N, 5 + N, 6 + N, 7 + N);
+	return _mm256_blend_ps(_mm256_permutevar8x32_ps(v, indices), fill, 0xFF & ~((1 << (8 - N)) - 1));
+}
 
-            ry0 = _mm256_cmp_ps(aymax, bymin, _CMP_GE_OQ);
+// result[i] = min of all v[j] with j != i
+inline __m256 minOfOthers(__m256 v) {
+	__m256 inf = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+	__m256 prefix = _mm256_min_ps(v, shiftLanesUp<1>(v, inf));
+	prefix = _mm256_min_ps(prefix, shiftLanesUp<2>(prefix, inf));
+	prefix = _mm256_min_ps(prefix, shiftLanesUp<4>(prefix, inf));
+	__m256 suffix = _mm256_min_ps(v, shiftLanesDown<1>(v, inf));
+	suffix = _mm256_min_ps(suffix, shiftLanesDown<2>(suffix, inf));
+	suffix = _mm256_min_ps(suffix, shiftLanesDown<4>(suffix, inf));
+	return _mm256_min_ps(shiftLanesUp<1>(prefix, inf), shiftLanesDown<1>(suffix, inf));
+}
+// result[i] = max of all v[j] with j != i
+inline __m256 maxOfOthers(__m256 v) {
+	__m256 negInf = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+	__m256 prefix = _mm256_max_ps(v, shiftLanesUp<1>(v, negInf));
+	prefix = _mm256_max_ps(prefix, shiftLanesUp<2>(prefix, negInf));
+	prefix = _mm256_max_ps(prefix, shiftLanesUp<4>(prefix, negInf));
+	__m256 suffix = _mm256_max_ps(v, shiftLanesDown<1>(v, negInf));
+	suffix = _mm256_max_ps(suffix, shiftLanesDown<2>(suffix, negInf));
+	suffix = _mm256_max_ps(suffix, shiftLanesDown<4>(suffix, negInf));
+	return _mm256_max_ps(shiftLanesUp<1>(prefix, negInf), shiftLanesDown<1>(suffix, negInf));
+}
 
-            rz0 = _mm256_cmp_ps(azmax, bzmin, _CMP_GE_OQ);
+// same order of operations as computeCost
+inline __m256 computeCosts(__m256 xMin, __m256 yMin, __m256 zMin, __m256 xMax, __m256 yMax, __m256 zMax) {
+	return _mm256_add_ps(_mm256_add_ps(_mm256_sub_ps(xMax, xMin), _mm256_sub_ps(yMax, yMin)), _mm256_sub_ps(zMax, zMin));
+}
+inline __m256 computeCombinationCosts(const TrunkBoundsAVX& b, const BoundsTemplate<float>& extention) {
+	return computeCosts(
+		_mm256_min_ps(b.xMin, _mm256_set1_ps(extention.min.x)),
+		_mm256_min_ps(b.yMin, _mm256_set1_ps(extention.min.y)),
+		_mm256_min_ps(b.zMin, _mm256_set1_ps(extention.min.z)),
+		_mm256_max_ps(b.xMax, _mm256_set1_ps(extention.max.x)),
+		_mm256_max_ps(b.yMax, _mm256_set1_ps(extention.max.y)),
+		_mm256_max_ps(b.zMax, _mm256_set1_ps(extention.max.z))
+	);
+}
 
-            rx1 = _mm256_cmp_ps(axmin, bxmax, _CMP_LE_OQ);
+// bit i is set if subnode i of b overlaps with the given bounds
+inline int overlapMask(const TrunkBoundsAVX& b, const BoundsTemplate<float>& bounds) {
+	__m256 overlapsMin = _mm256_and_ps(_mm256_and_ps(
+		_mm256_cmp_ps(b.xMax, _mm256_set1_ps(bounds.min.x), _CMP_GE_OQ),
+		_mm256_cmp_ps(b.yMax, _mm256_set1_ps(bounds.min.y), _CMP_GE_OQ)),
+		_mm256_cmp_ps(b.zMax, _mm256_set1_ps(bounds.min.z), _CMP_GE_OQ));
+	__m256 overlapsMax = _mm256_and_ps(_mm256_and_ps(
+		_mm256_cmp_ps(b.xMin, _mm256_set1_ps(bounds.max.x), _CMP_LE_OQ),
+		_mm256_cmp_ps(b.yMin, _mm256_set1_ps(bounds.max.y), _CMP_LE_OQ)),
+		_mm256_cmp_ps(b.zMin, _mm256_set1_ps(bounds.max.z), _CMP_LE_OQ));
+	return _mm256_movemask_ps(_mm256_and_ps(overlapsMin, overlapsMax));
+}
 
-            ry1 = _mm256_cmp_ps(aymin, bymax, _CMP_LE_OQ);
+inline int sizeMask(int size) {
+	return (1 << size) - 1;
+}
+};
+
+BoundsTemplate<float> TrunkSIMDHelperFallback::getTotalBoundsAVX(const TreeTrunk& trunk, int upTo) {
+	assert(upTo >= 1 && upTo <= BRANCH_FACTOR);
+	TrunkBoundsAVX b = loadBounds(trunk.subNodeBounds);
+	constexpr float inf = std::numeric_limits<float>::infinity();
+
+	BoundsTemplate<float> result;
+	result.min.x = horizontalMin(replaceUnusedLanes(b.xMin, upTo, inf));
+	result.min.y = horizontalMin(replaceUnusedLanes(b.yMin, upTo, inf));
+	result.min.z = horizontalMin(replaceUnusedLanes(b.zMin, upTo, inf));
+	result.max.x = horizontalMax(replaceUnusedLanes(b.xMax, upTo, -inf));
+	result.max.y = horizontalMax(replaceUnusedLanes(b.yMax, upTo, -inf));
+	result.max.z = horizontalMax(replaceUnusedLanes(b.zMax, upTo, -inf));
+	return result;
+}
 
-            rz1 = _mm256_cmp_ps(azmin, bzmax, _CMP_LE_OQ);
+BoundsArray<BRANCH_FACTOR> TrunkSIMDHelperFallback::getAllTotalBoundsWithoutAVX(const TreeTrunk& trunk, int upTo) {
+	assert(upTo >= 2 && upTo <= BRANCH_FACTOR); // size must be at least 2, can't compute otherwise
+	TrunkBoundsAVX b = loadBounds(trunk.subNodeBounds);
+	constexpr float inf = std::numeric_limits<float>::infinity();
+
+	BoundsArray<BRANCH_FACTOR> result;
+	_mm256_store_ps(result.xMin, minOfOthers(replaceUnusedLanes(b.xMin, upTo, inf)));
+	_mm256_store_ps(result.yMin, minOfOthers(replaceUnusedLanes(b.yMin, upTo, inf)));
+	_mm256_store_ps(result.zMin, minOfOthers(replaceUnusedLanes(b.zMin, upTo, inf)));
+	_mm256_store_ps(result.xMax, maxOfOthers(replaceUnusedLanes(b.xMax, upTo, -inf)));
+	_mm256_store_ps(result.yMax, maxOfOthers(replaceUnusedLanes(b.yMax, upTo, -inf)));
+	_mm256_store_ps(result.zMax, maxOfOthers(replaceUnusedLanes(b.zMax, upTo, -inf)));
+	return result;
+}
 
+std::array<bool, BRANCH_FACTOR> TrunkSIMDHelperFallback::getAllContainsBoundsAVX(const TreeTrunk& trunk, const BoundsTemplate<float>& boundsToContain) {
+	TrunkBoundsAVX b = loadBounds(trunk.subNodeBounds);
+	__m256 containsMin = _mm256_and_ps(_mm256_and_ps(
+		_mm256_cmp_ps(b.xMin, _mm256_set1_ps(boundsToContain.min.x), _CMP_LE_OQ),
+		_mm256_cmp_ps(b.yMin, _mm256_set1_ps(boundsToContain.min.y), _CMP_LE_OQ)),
+		_mm256_cmp_ps(b.zMin, _mm256_set1_ps(boundsToContain.min.z), _CMP_LE_OQ));
+	__m256 containsMax = _mm256_and_ps(_mm256_and_ps(
+		_mm256_cmp_ps(b.xMax, _mm256_set1_ps(boundsToContain.max.x), _CMP_GE_OQ),
+		_mm256_cmp_ps(b.yMax, _mm256_set1_ps(boundsToContain.max.y), _CMP_GE_OQ)),
+		_mm256_cmp_ps(b.zMax, _mm256_set1_ps(boundsToContain.max.z), _CMP_GE_OQ));
+	return maskToBools(_mm256_movemask_ps(_mm256_and_ps(containsMin, containsMax)));
+}
 
-            __m256 resultBool = _mm256_and_ps(  _mm256_and_ps(_mm256_and_ps(rx0, ry0), rz0),
-                                                _mm256_and_ps( _mm256_and_ps(rx1, ry1), rz1)  );
+std::array<float, BRANCH_FACTOR> TrunkSIMDHelperFallback::computeAllCostsAVX(const TreeTrunk& trunk) {
+	TrunkBoundsAVX b = loadBounds(trunk.subNodeBounds);
+	alignas(32) std::array<float, BRANCH_FACTOR> costs;
+	_mm256_store_ps(costs.data(), computeCosts(b.xMin, b.yMin, b.zMin, b.xMax, b.yMax, b.zMax));
+	return costs;
+}
 
+std::array<float, BRANCH_FACTOR> TrunkSIMDHelperFallback::computeAllCombinationCostsAVX(const BoundsArray<BRANCH_FACTOR>& boundsArr, const BoundsTemplate<float>& boundsExtention) {
+	alignas(32) std::array<float, BRANCH_FACTOR> costs;
+	_mm256_store_ps(costs.data(), computeCombinationCosts(loadBounds(boundsArr), boundsExtention));
+	return costs;
+}
 
-            _mm256_store_ps(tempBuff, resultBool);
+int TrunkSIMDHelperFallback::getLowestCombinationCostAVX(const TreeTrunk& trunk, const BoundsTemplate<float>& boundsExtention, int nodeSize) {
+	__m256 costs = computeCombinationCosts(loadBounds(trunk.subNodeBounds), boundsExtention);
+	costs = replaceUnusedLanes(costs, nodeSize, std::numeric_limits<float>::infinity());
+	float bestCost = horizontalMin(costs);
+	int bestMask = _mm256_movemask_ps(_mm256_cmp_ps(costs, _mm256_set1_ps(bestCost), _CMP_EQ_OQ));
+	if(bestMask == 0) return 0; // only NaN costs
+	// the first of the lowest, like the fallback
+	int bestIndex = 0;
+	while(((bestMask >> bestIndex) & 1) == 0) bestIndex++;
+	return bestIndex;
+}
 
-			
-            result[a][0] =  tempBuff[0];
-            result[a][1] =  tempBuff[1];
-            result[a][2] =  tempBuff[2];
-            result[a][3] =  tempBuff[3];
-            result[a][4] =  tempBuff[4];
-            result[a][5] =  tempBuff[5];
-            result[a][6] =  tempBuff[6];
-            result[a][7] =  tempBuff[7];
+std::array<bool, BRANCH_FACTOR> TrunkSIMDHelperFallback::computeOverlapsWithAVX(const TreeTrunk& trunk, int trunkSize, const BoundsTemplate<float>& bounds) {
+	return maskToBools(overlapMask(loadBounds(trunk.subNodeBounds), bounds) & sizeMask(trunkSize));
+}
 
-		
+OverlapMatrix TrunkSIMDHelperFallback::computeBoundsOverlapMatrixAVX(const TreeTrunk& trunkA, int trunkASize, const TreeTrunk& trunkB, int trunkBSize) {
+	OverlapMatrix result;
+	TrunkBoundsAVX b = loadBounds(trunkB.subNodeBounds);
+	int columnMask = sizeMask(trunkBSize);
+	for(int a = 0; a < trunkASize; a++) {
+		writeMaskToRow(result[a], overlapMask(b, trunkA.getBoundsOfSubNode(a)) & columnMask);
 	}
 	return result;
 }
 
+OverlapMatrix TrunkSIMDHelperFallback::computeInternalBoundsOverlapMatrixAVX(const TreeTrunk& trunk, int trunkSize) {
+	OverlapMatrix result;
+	TrunkBoundsAVX b = loadBounds(trunk.subNodeBounds);
+	int columnMask = sizeMask(trunkSize);
+	for(int a = 0; a < trunkSize; a++) {
+		int aboveDiagonal = 0xFF & (0xFF << (a + 1));
+		writeMaskToRow(result[a], overlapMask(b, trunk.getBoundsOfSubNode(a)) & columnMask & aboveDiagonal);
+	}
+	return result;
+}
 
-
-
-
-
-}
\ No newline at end of file
+std::array<float, BRANCH_FACTOR> TrunkSIMDHelperFallback::computeAllExtentionCostsAVX(const TreeTrunk& trunk, const BoundsTemplate<float>& extraBounds) {
+	TrunkBoundsAVX b = loadBounds(trunk.subNodeBounds);
+	__m256 ownCosts = computeCosts(b.xMin, b.yMin, b.zMin, b.xMax, b.yMax, b.zMax);
+	alignas(32) std::array<float, BRANCH_FACTOR> resultingCosts;
+	_mm256_store_ps(resultingCosts.data(), _mm256_sub_ps(computeCombinationCosts(b, extraBounds), ownCosts));
+	return resultingCosts;
+}
+};
@@ -0,0 +1,144 @@
+#include "boundsTree.h"
+
+#include <immintrin.h>
+
+/*
+	AVX-512 implementation for the comparing TrunkSIMDHelperFallback functions, only requires AVX512_F
+	The six coordinate arrays of a BoundsArray<8> are stored back to back, so they fit in three 16 lane registers:
+	xMin|yMin, zMin|xMax, yMax|zMax
+*/
+namespace P3D {
+static_assert(BRANCH_FACTOR == 8, "the AVX-512 implementation requires a branch factor of 8");
+
+namespace {
+constexpr __mmask16 LOW_HALF = 0x00FF;
+constexpr __mmask16 HIGH_HALF = 0xFF00;
+
+struct PackedTrunkBounds {
+	__m512 xyMin;
+	__m512 zMinXMax;
+	__m512 yzMax;
+};
+
+inline PackedTrunkBounds loadPackedBounds(const BoundsArray<BRANCH_FACTOR>& bounds) {
+	return PackedTrunkBounds{
+		_mm512_load_ps(bounds.xMin),
+		_mm512_load_ps(bounds.zMin),
+		_mm512_load_ps(bounds.yMax)
+	};
+}
+
+// the low half is filled with low, the high half with high
+inline __m512 setHalves(float low, float high) {
+	return _mm512_mask_blend_ps(HIGH_HALF, _mm512_set1_ps(low), _mm512_set1_ps(high));
+}
+inline __m512 setHalves(__m256 low, __m256 high) {
+	return _mm512_castpd_ps(_mm512_maskz_insertf64x4(0xFF, _mm512_castpd256_pd512(_mm256_castps_pd(low)), _mm256_castps_pd(high), 1));
+}
+
+// both halves of the result mask must be set for a subnode to pass
+inline int combineHalves(__mmask16 mask) {
+	return (mask & (mask >> 8)) & 0xFF;
+}
+
+inline void writeMaskToRow(bool* row, int mask) {
+	for(int i = 0; i < BRANCH_FACTOR; i++) {
+		row[i] = ((mask >> i) & 1) != 0;
+	}
+}
+inline std::array<bool, BRANCH_FACTOR> maskToBools(int mask) {
+	std::array<bool, BRANCH_FACTOR> result;
+	writeMaskToRow(result.data(), mask);
+	return result;
+}
+
+// bit i is set if subnode i of b overlaps with the given bounds
+inline int overlapMask(const PackedTrunkBounds& b, const BoundsTemplate<float>& bounds) {
+	__mmask16 minsBelowMax = _mm512_cmp_ps_mask(b.xyMin, setHalves(bounds.max.x, bounds.max.y), _CMP_LE_OQ);
+	__mmask16 zMinBelowXMaxAbove = _mm512_mask_cmp_ps_mask(LOW_HALF, b.zMinXMax, _mm512_set1_ps(bounds.max.z), _CMP_LE_OQ)
+		| _mm512_mask_cmp_ps_mask(HIGH_HALF, b.zMinXMax, _mm512_set1_ps(bounds.min.x), _CMP_GE_OQ);
+	__mmask16 maxesAboveMin = _mm512_cmp_ps_mask(b.yzMax, setHalves(bounds.min.y, bounds.min.z), _CMP_GE_OQ);
+	return combineHalves(minsBelowMax & zMinBelowXMaxAbove & maxesAboveMin);
+}
+
+// every coordinate array of the trunk twice, such that two rows of an overlap matrix can be computed at once
+struct DoubledTrunkBounds {
+	__m512 xMin;
+	__m512 yMin;
+	__m512 zMin;
+	__m512 xMax;
+	__m512 yMax;
+	__m512 zMax;
+};
+inline DoubledTrunkBounds loadDoubledBounds(const BoundsArray<BRANCH_FACTOR>& bounds) {
+	__m256 xMin = _mm256_load_ps(bounds.xMin);
+	__m256 yMin = _mm256_load_ps(bounds.yMin);
+	__m256 zMin = _mm256_load_ps(bounds.zMin);
+	__m256 xMax = _mm256_load_ps(bounds.xMax);
+	__m256 yMax = _mm256_load_ps(bounds.yMax);
+	__m256 zMax = _mm256_load_ps(bounds.zMax);
+	return DoubledTrunkBounds{
+		setHalves(xMin, xMin),
+		setHalves(yMin, yMin),
+		setHalves(zMin, zMin),
+		setHalves(xMax, xMax),
+		setHalves(yMax, yMax),
+		setHalves(zMax, zMax)
+	};
+}
+// the low 8 bits are the overlaps of aBounds0 with the subnodes of b, the high 8 bits those of aBounds1
+inline __mmask16 overlapMaskTwoRows(const DoubledTrunkBounds& b, const BoundsTemplate<float>& aBounds0, const BoundsTemplate<float>& aBounds1) {
+	return _mm512_cmp_ps_mask(b.xMax, setHalves(aBounds0.min.x, aBounds1.min.x), _CMP_GE_OQ)
+		& _mm512_cmp_ps_mask(b.yMax, setHalves(aBounds0.min.y, aBounds1.min.y), _CMP_GE_OQ)
+		& _mm512_cmp_ps_mask(b.zMax, setHalves(aBounds0.min.z, aBounds1.min.z), _CMP_GE_OQ)
+		& _mm512_cmp_ps_mask(b.xMin, setHalves(aBounds0.max.x, aBounds1.max.x), _CMP_LE_OQ)
+		& _mm512_cmp_ps_mask(b.yMin, setHalves(aBounds0.max.y, aBounds1.max.y), _CMP_LE_OQ)
+		& _mm512_cmp_ps_mask(b.zMin, setHalves(aBounds0.max.z, aBounds1.max.z), _CMP_LE_OQ);
+}
+
+inline int sizeMask(int size) {
+	return (1 << size) - 1;
+}
+
+// rowMask(a) is applied to row a
+template<typename RowMask>
+inline OverlapMatrix computeOverlapMatrix(const TreeTrunk& trunkA, int trunkASize, const TreeTrunk& trunkB, const RowMask& rowMask) {
+	OverlapMatrix result;
+	DoubledTrunkBounds b = loadDoubledBounds(trunkB.subNodeBounds);
+	for(int a = 0; a < trunkASize; a += 2) {
+		BoundsTemplate<float> aBounds0 = trunkA.getBoundsOfSubNode(a);
+		// the last row of an odd sized trunk is compared twice, only the first is kept
+		BoundsTemplate<float> aBounds1 = (a + 1 < trunkASize) ? trunkA.getBoundsOfSubNode(a + 1) : aBounds0;
+		__mmask16 mask = overlapMaskTwoRows(b, aBounds0, aBounds1);
+		writeMaskToRow(result[a], (mask & 0xFF) & rowMask(a));
+		if(a + 1 < trunkASize) {
+			writeMaskToRow(result[a + 1], (mask >> 8) & rowMask(a + 1));
+		}
+	}
+	return result;
+}
+};
+
+std::array<bool, BRANCH_FACTOR> TrunkSIMDHelperFallback::getAllContainsBoundsAVX512(const TreeTrunk& trunk, const BoundsTemplate<float>& boundsToContain) {
+	PackedTrunkBounds b = loadPackedBounds(trunk.subNodeBounds);
+	__mmask16 minsBelow = _mm512_cmp_ps_mask(b.xyMin, setHalves(boundsToContain.min.x, boundsToContain.min.y), _CMP_LE_OQ);
+	__mmask16 zMinBelowXMaxAbove = _mm512_mask_cmp_ps_mask(LOW_HALF, b.zMinXMax, _mm512_set1_ps(boundsToContain.min.z), _CMP_LE_OQ)
+		| _mm512_mask_cmp_ps_mask(HIGH_HALF, b.zMinXMax, _mm512_set1_ps(boundsToContain.max.x), _CMP_GE_OQ);
+	__mmask16 maxesAbove = _mm512_cmp_ps_mask(b.yzMax, setHalves(boundsToContain.max.y, boundsToContain.max.z), _CMP_GE_OQ);
+	return maskToBools(combineHalves(minsBelow & zMinBelowXMaxAbove & maxesAbove));
+}
+
+std::array<bool, BRANCH_FACTOR> TrunkSIMDHelperFallback::computeOverlapsWithAVX512(const TreeTrunk& trunk, int trunkSize, const BoundsTemplate<float>& bounds) {
+	return maskToBools(overlapMask(loadPackedBounds(trunk.subNodeBounds), bounds) & sizeMask(trunkSize));
+}
+
+OverlapMatrix TrunkSIMDHelperFallback::computeBoundsOverlapMatrixAVX512(const TreeTrunk& trunkA, int trunkASize, const TreeTrunk& trunkB, int trunkBSize) {
+	int columnMask = sizeMask(trunkBSize);
+	return computeOverlapMatrix(trunkA, trunkASize, trunkB, [columnMask](int) {return columnMask; });
+}
+
+OverlapMatrix TrunkSIMDHelperFallback::computeInternalBoundsOverlapMatrixAVX512(const TreeTrunk& trunk, int trunkSize) {
+	int columnMask = sizeMask(trunkSize);
+	return computeOverlapMatrix(trunk, trunkSize, trunk, [columnMask](int a) {return columnMask & 0xFF & (0xFF << (a + 1)); });
+}
+};
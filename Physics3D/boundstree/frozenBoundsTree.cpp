@@ -0,0 +1,133 @@
+#include "frozenBoundsTree.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace P3D {
+static float decode(float origin, float step, std::uint32_t q) {
+	return origin + q * step;
+}
+
+static float computeStep(float min, float max) {
+	float step = (max - min) / QUANTIZED_MAX;
+	// rounding may leave the top of the frame just below max
+	while(decode(min, step, QUANTIZED_MAX) < max) {
+		step = std::nextafter(step, std::numeric_limits<float>::infinity());
+	}
+	return step;
+}
+
+QuantizationFrame::QuantizationFrame(const BoundsTemplate<float>& bounds) :
+	origin(bounds.min.x, bounds.min.y, bounds.min.z),
+	step(computeStep(bounds.min.x, bounds.max.x), computeStep(bounds.min.y, bounds.max.y), computeStep(bounds.min.z, bounds.max.z)) {}
+
+BoundsArray<BRANCH_FACTOR> QuantizedTrunk::decodeBounds(const QuantizationFrame& frame) const {
+	BoundsArray<BRANCH_FACTOR> result;
+	for(int i = 0; i < BRANCH_FACTOR; i++) {
+		result.xMin[i] = decode(frame.origin.x, frame.step.x, xMin[i]);
+		result.yMin[i] = decode(frame.origin.y, frame.step.y, yMin[i]);
+		result.zMin[i] = decode(frame.origin.z, frame.step.z, zMin[i]);
+		result.xMax[i] = decode(frame.origin.x, frame.step.x, xMax[i]);
+		result.yMax[i] = decode(frame.origin.y, frame.step.y, yMax[i]);
+		result.zMax[i] = decode(frame.origin.z, frame.step.z, zMax[i]);
+	}
+	return result;
+}
+
+// rounds down, the decoded value is never larger than value
+static std::uint16_t quantizeMin(float origin, float step, float value) {
+	if(step <= 0.0f) return 0;
+	float q = std::floor((value - origin) / step);
+	std::uint32_t result = static_cast<std::uint32_t>(std::clamp(q, 0.0f, static_cast<float>(QUANTIZED_MAX)));
+	while(result > 0 && decode(origin, step, result) > value) result--;
+	return static_cast<std::uint16_t>(result);
+}
+// rounds up, the decoded value is never smaller than value
+static std::uint16_t quantizeMax(float origin, float step, float value) {
+	if(step <= 0.0f) return 0;
+	float q = std::ceil((value - origin) / step);
+	std::uint32_t result = static_cast<std::uint32_t>(std::clamp(q, 0.0f, static_cast<float>(QUANTIZED_MAX)));
+	while(result < QUANTIZED_MAX && decode(origin, step, result) < value) result++;
+	return static_cast<std::uint16_t>(result);
+}
+
+std::uint32_t FrozenBoundsTreePrototype::buildRecursive(const TreeTrunk& sourceTrunk, int sourceTrunkSize, const QuantizationFrame& frame, bool isInGroup) {
+	std::size_t trunkIndex = trunks.size();
+	trunks.emplace_back();
+	frames.push_back(frame);
+
+	// trunks may be reallocated by the recursive calls, so the new trunk is filled in separately
+	QuantizedTrunk newTrunk{};
+	for(int i = 0; i < sourceTrunkSize; i++) {
+		BoundsTemplate<float> bounds = sourceTrunk.getBoundsOfSubNode(i);
+		newTrunk.xMin[i] = quantizeMin(frame.origin.x, frame.step.x, bounds.min.x);
+		newTrunk.yMin[i] = quantizeMin(frame.origin.y, frame.step.y, bounds.min.y);
+		newTrunk.zMin[i] = quantizeMin(frame.origin.z, frame.step.z, bounds.min.z);
+		newTrunk.xMax[i] = quantizeMax(frame.origin.x, frame.step.x, bounds.max.x);
+		newTrunk.yMax[i] = quantizeMax(frame.origin.y, frame.step.y, bounds.max.y);
+		newTrunk.zMax[i] = quantizeMax(frame.origin.z, frame.step.z, bounds.max.z);
+		assert(newTrunk.decodeBounds(frame).getBounds(i).contains(bounds));
+
+		const TreeNodeRef& subNode = sourceTrunk.subNodes[i];
+		if(!isInGroup && subNode.isGroupHeadOrLeaf()) {
+			groupStarts.push_back(static_cast<std::uint32_t>(leaves.size()));
+		}
+		if(subNode.isTrunkNode()) {
+			// the children of the subnode are quantized relative to the decoded bounds, which is what queries will see
+			QuantizationFrame subFrame(newTrunk.decodeBounds(frame).getBounds(i));
+			std::uint32_t subTrunkIndex = buildRecursive(subNode.asTrunk(), subNode.getTrunkSize(), subFrame, isInGroup || subNode.isGroupHead());
+			newTrunk.subNodes[i] = FrozenNodeRef::makeTrunk(subTrunkIndex, subNode.getTrunkSize());
+		} else {
+			newTrunk.subNodes[i] = FrozenNodeRef::makeLeaf(leaves.size());
+			leaves.push_back(FrozenLeaf{subNode.asObject(), bounds});
+		}
+	}
+	trunks[trunkIndex] = newTrunk;
+	return static_cast<std::uint32_t>(trunkIndex);
+}
+
+void FrozenBoundsTreePrototype::build(const BoundsTreePrototype& source) {
+	clear();
+	std::pair<const TreeTrunk&, int> sourceBase = source.getBaseTrunk();
+	baseTrunkSize = sourceBase.second;
+	if(baseTrunkSize != 0) {
+		buildRecursive(sourceBase.first, baseTrunkSize, QuantizationFrame(TrunkSIMDHelperFallback::getTotalBounds(sourceBase.first, baseTrunkSize)), false);
+	}
+	trunks.shrink_to_fit();
+	frames.shrink_to_fit();
+	leaves.shrink_to_fit();
+	groupStarts.shrink_to_fit();
+	built = true;
+}
+
+void FrozenBoundsTreePrototype::clear() {
+	trunks.clear();
+	frames.clear();
+	leaves.clear();
+	groupStarts.clear();
+	baseTrunkSize = 0;
+	built = false;
+}
+
+void FrozenBoundsTreePrototype::addAllTo(BoundsTreePrototype& target) const {
+	// the stored bounds are used, so that the objects can still be found by the bounds they had when this was built
+	std::vector<std::pair<void*, BoundsTemplate<float>>> groupHeads;
+	groupHeads.reserve(groupStarts.size());
+	for(std::uint32_t groupStart : groupStarts) {
+		groupHeads.emplace_back(leaves[groupStart].object, leaves[groupStart].bounds);
+	}
+	target.rebuildWith(groupHeads);
+
+	for(std::size_t group = 0; group < groupStarts.size(); group++) {
+		const FrozenLeaf& head = leaves[groupStarts[group]];
+		std::size_t groupEnd = group + 1 < groupStarts.size() ? groupStarts[group + 1] : leaves.size();
+		for(std::size_t i = groupStarts[group] + 1; i < groupEnd; i++) {
+			target.addToGroup(leaves[i].object, leaves[i].bounds, head.object, head.bounds);
+		}
+	}
+}
+
+std::size_t FrozenBoundsTreePrototype::getMemoryUsage() const {
+	return trunks.capacity() * sizeof(QuantizedTrunk) + frames.capacity() * sizeof(QuantizationFrame) + leaves.capacity() * sizeof(FrozenLeaf) + groupStarts.capacity() * sizeof(std::uint32_t);
+}
+};
@@ -0,0 +1,316 @@
+#pragma once
+
+#include "boundsTree.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace P3D {
+constexpr std::uint32_t QUANTIZED_MAX = 0xFFFF;
+
+/*
+	The bounds of one trunk of a FrozenBoundsTree that its subnodes are quantized relative to
+	decoded value = origin + q * step, for q in [0, QUANTIZED_MAX]
+*/
+struct QuantizationFrame {
+	Vec3f origin;
+	Vec3f step;
+
+	QuantizationFrame() = default;
+	// the decoded frame always contains the given bounds
+	explicit QuantizationFrame(const BoundsTemplate<float>& bounds);
+};
+
+/*
+	A trunk of a FrozenBoundsTree, 128 bytes instead of the 256 of a TreeTrunk
+
+	The bounds of the subnodes are stored as 16 bit offsets within the QuantizationFrame of the trunk,
+	rounded outward, such that the decoded bounds always contain the actual bounds
+	subNodes are indices into the trunks or leaves of the tree, see FrozenNodeRef
+*/
+struct alignas(64) QuantizedTrunk {
+	std::uint16_t xMin[BRANCH_FACTOR];
+	std::uint16_t yMin[BRANCH_FACTOR];
+	std::uint16_t zMin[BRANCH_FACTOR];
+	std::uint16_t xMax[BRANCH_FACTOR];
+	std::uint16_t yMax[BRANCH_FACTOR];
+	std::uint16_t zMax[BRANCH_FACTOR];
+	std::uint32_t subNodes[BRANCH_FACTOR];
+
+	/*
+		Not inline, so the build and all queries decode with exactly the same instructions,
+		a fused multiply add in one place but not another could break the outward rounding
+	*/
+	BoundsArray<BRANCH_FACTOR> decodeBounds(const QuantizationFrame& frame) const;
+};
+static_assert(sizeof(QuantizedTrunk) == 128, "QuantizedTrunk should be two cache lines");
+
+/*
+	encoding:
+	0b1iii...iii: leaf, i is the index into leaves
+	0b0iii...sss: trunk, i is the index into trunks, s is the size of the trunk - 1
+*/
+namespace FrozenNodeRef {
+constexpr std::uint32_t LEAF_MASK = 0x80000000;
+constexpr std::uint32_t SIZE_DATA_MASK = BRANCH_FACTOR - 1;
+constexpr int INDEX_SHIFT = 3;
+
+inline std::uint32_t makeLeaf(std::size_t leafIndex) { return LEAF_MASK | static_cast<std::uint32_t>(leafIndex); }
+inline std::uint32_t makeTrunk(std::size_t trunkIndex, int trunkSize) { return (static_cast<std::uint32_t>(trunkIndex) << INDEX_SHIFT) | static_cast<std::uint32_t>(trunkSize - 1); }
+inline bool isLeaf(std::uint32_t ref) { return (ref & LEAF_MASK) != 0; }
+inline std::size_t getLeafIndex(std::uint32_t ref) { return ref & ~LEAF_MASK; }
+inline std::size_t getTrunkIndex(std::uint32_t ref) { return ref >> INDEX_SHIFT; }
+inline int getTrunkSize(std::uint32_t ref) { return static_cast<int>(ref & SIZE_DATA_MASK) + 1; }
+};
+
+struct FrozenLeaf {
+	void* object;
+	// the exact bounds, so that queries report the same pairs as the BoundsTree the frozen tree was built from
+	BoundsTemplate<float> bounds;
+};
+
+inline bool overlapsSubNode(const BoundsArray<BRANCH_FACTOR>& subNodeBounds, int subNode, const BoundsTemplate<float>& bounds) {
+	return subNodeBounds.xMin[subNode] <= bounds.max.x && subNodeBounds.xMax[subNode] >= bounds.min.x
+		&& subNodeBounds.yMin[subNode] <= bounds.max.y && subNodeBounds.yMax[subNode] >= bounds.min.y
+		&& subNodeBounds.zMin[subNode] <= bounds.max.z && subNodeBounds.zMax[subNode] >= bounds.min.z;
+}
+
+/*
+	A read-only copy of a BoundsTree for objects that never move, such as terrain
+	Trunks are stored in one flat array in depth first order, with 16 bit bounds, which halves their size compared to a BoundsTree
+	Any change to the source tree requires a rebuild
+*/
+class FrozenBoundsTreePrototype {
+	std::vector<QuantizedTrunk> trunks;
+	// frames[i] is the frame of trunks[i], computed once while building, such that queries only decode
+	std::vector<QuantizationFrame> frames;
+	std::vector<FrozenLeaf> leaves;
+	// the leaves of a group of the source tree are consecutive, this is the index of the first leaf of every group
+	std::vector<std::uint32_t> groupStarts;
+	int baseTrunkSize = 0;
+	bool built = false;
+
+	std::uint32_t buildRecursive(const TreeTrunk& sourceTrunk, int sourceTrunkSize, const QuantizationFrame& frame, bool isInGroup);
+
+	template<typename Boundable>
+	friend class FrozenBoundsTree;
+
+public:
+	void build(const BoundsTreePrototype& source);
+	void clear();
+	// adds all objects back into the given tree, with the groups of the tree this was built from
+	void addAllTo(BoundsTreePrototype& target) const;
+
+	// false after clear, until the next build
+	bool isBuilt() const { return built; }
+	std::size_t getTrunkCount() const { return trunks.size(); }
+	std::size_t getLeafCount() const { return leaves.size(); }
+	std::size_t getGroupCount() const { return groupStarts.size(); }
+	std::size_t getMemoryUsage() const;
+
+	const QuantizedTrunk& getTrunk(std::size_t index) const { return trunks[index]; }
+	const QuantizationFrame& getFrame(std::size_t trunkIndex) const { return frames[trunkIndex]; }
+	const FrozenLeaf& getLeaf(std::size_t index) const { return leaves[index]; }
+	int getBaseTrunkSize() const { return baseTrunkSize; }
+};
+
+// expects a function of the form void(void* frozenObject)
+template<typename Func>
+void forEachOverlappingFrozenRecursive(const FrozenBoundsTreePrototype& tree, std::size_t trunkIndex, int trunkSize, const BoundsTemplate<float>& bounds, const Func& func) {
+	const QuantizedTrunk& trunk = tree.getTrunk(trunkIndex);
+	BoundsArray<BRANCH_FACTOR> subNodeBounds = trunk.decodeBounds(tree.getFrame(trunkIndex));
+	for(int i = 0; i < trunkSize; i++) {
+		if(!overlapsSubNode(subNodeBounds, i, bounds)) continue;
+		std::uint32_t subNode = trunk.subNodes[i];
+		if(FrozenNodeRef::isLeaf(subNode)) {
+			const FrozenLeaf& leaf = tree.getLeaf(FrozenNodeRef::getLeafIndex(subNode));
+			if(intersects(leaf.bounds, bounds)) func(leaf.object);
+		} else {
+			forEachOverlappingFrozenRecursive(tree, FrozenNodeRef::getTrunkIndex(subNode), FrozenNodeRef::getTrunkSize(subNode), bounds, func);
+		}
+	}
+}
+
+/*
+	filter is the same kind of filter as for forEachFilteredRecurse, it is given a trunk with the decoded bounds of the frozen trunk
+	leaves are filtered using their exact bounds
+	expects a function of the form void(void* frozenObject)
+*/
+template<typename Filter, typename Func>
+void forEachFilteredFrozenRecursive(const FrozenBoundsTreePrototype& tree, std::size_t trunkIndex, int trunkSize, const Filter& filter, const Func& func) {
+	const QuantizedTrunk& trunk = tree.getTrunk(trunkIndex);
+	// filters only look at the bounds of the subnodes
+	TreeTrunk boundsView;
+	boundsView.subNodeBounds = trunk.decodeBounds(tree.getFrame(trunkIndex));
+	for(int i = 0; i < trunkSize; i++) {
+		if(FrozenNodeRef::isLeaf(trunk.subNodes[i])) {
+			boundsView.subNodeBounds.setBounds(i, tree.getLeaf(FrozenNodeRef::getLeafIndex(trunk.subNodes[i])).bounds);
+		}
+	}
+	std::array<bool, BRANCH_FACTOR> passes = filter(boundsView, trunkSize);
+	for(int i = 0; i < trunkSize; i++) {
+		if(!passes[i]) continue;
+		std::uint32_t subNode = trunk.subNodes[i];
+		if(FrozenNodeRef::isLeaf(subNode)) {
+			func(tree.getLeaf(FrozenNodeRef::getLeafIndex(subNode)).object);
+		} else {
+			forEachFilteredFrozenRecursive(tree, FrozenNodeRef::getTrunkIndex(subNode), FrozenNodeRef::getTrunkSize(subNode), filter, func);
+		}
+	}
+}
+
+// a pair of a dynamic and a frozen trunk of which the colissions are still to be found, see FrozenBoundsTree::splitColissionTasksWith
+struct FrozenColissionTask {
+	const TreeTrunk* dynamicTrunk;
+	int dynamicTrunkSize;
+	std::uint32_t frozenTrunkIndex;
+	int frozenTrunkSize;
+};
+
+/*
+	Does one level of forEachColissionWithFrozenRecursive, pairs of two trunks are passed to onTrunkPair instead of being recursed into
+	expects a function of the form void(const FrozenColissionTask& trunkPair)
+	and a function of the form void(Boundable* dynamicObject, Boundable* frozenObject)
+*/
+template<typename Boundable, typename SIMDHelper, typename TrunkPairFunc, typename Func>
+void forEachColissionWithFrozenStep(const FrozenColissionTask& task, const FrozenBoundsTreePrototype& tree, const TrunkPairFunc& onTrunkPair, const Func& func) {
+	const TreeTrunk& trunkA = *task.dynamicTrunk;
+	const QuantizedTrunk& trunkB = tree.getTrunk(task.frozenTrunkIndex);
+	BoundsArray<BRANCH_FACTOR> boundsB = trunkB.decodeBounds(tree.getFrame(task.frozenTrunkIndex));
+
+	for(int a = 0; a < task.dynamicTrunkSize; a++) {
+		const TreeNodeRef& aNode = trunkA.subNodes[a];
+		BoundsTemplate<float> aBounds = trunkA.getBoundsOfSubNode(a);
+		for(int b = 0; b < task.frozenTrunkSize; b++) {
+			if(!overlapsSubNode(boundsB, b, aBounds)) continue;
+
+			std::uint32_t bNode = trunkB.subNodes[b];
+			if(FrozenNodeRef::isLeaf(bNode)) {
+				const FrozenLeaf& leaf = tree.getLeaf(FrozenNodeRef::getLeafIndex(bNode));
+				Boundable* frozenObject = static_cast<Boundable*>(leaf.object);
+				if(aNode.isTrunkNode()) {
+					forEachColissionWithRecursive<Boundable, SIMDHelper>(aNode.asTrunk(), aNode.getTrunkSize(), frozenObject, leaf.bounds, func);
+				} else if(intersects(aBounds, leaf.bounds)) {
+					func(static_cast<Boundable*>(aNode.asObject()), frozenObject);
+				}
+			} else if(aNode.isTrunkNode()) {
+				onTrunkPair(FrozenColissionTask{&aNode.asTrunk(), aNode.getTrunkSize(), static_cast<std::uint32_t>(FrozenNodeRef::getTrunkIndex(bNode)), FrozenNodeRef::getTrunkSize(bNode)});
+			} else {
+				Boundable* dynamicObject = static_cast<Boundable*>(aNode.asObject());
+				forEachOverlappingFrozenRecursive(tree, FrozenNodeRef::getTrunkIndex(bNode), FrozenNodeRef::getTrunkSize(bNode), aBounds, [&func, dynamicObject](void* frozenObject) {
+					func(dynamicObject, static_cast<Boundable*>(frozenObject));
+				});
+			}
+		}
+	}
+}
+
+/*
+	Same as forEachColissionBetweenRecursive, with a frozen trunk as the second trunk
+	expects a function of the form void(Boundable* dynamicObject, Boundable* frozenObject)
+*/
+template<typename Boundable, typename SIMDHelper, typename Func>
+void forEachColissionWithFrozenRecursive(const FrozenColissionTask& task, const FrozenBoundsTreePrototype& tree, const Func& func) {
+	forEachColissionWithFrozenStep<Boundable, SIMDHelper>(task, tree, [&tree, &func](const FrozenColissionTask& subTask) {
+		forEachColissionWithFrozenRecursive<Boundable, SIMDHelper>(subTask, tree, func);
+	}, func);
+}
+
+template<typename Boundable>
+class FrozenBoundsTree {
+	FrozenBoundsTreePrototype tree;
+
+public:
+	inline const FrozenBoundsTreePrototype& getPrototype() const { return tree; }
+
+	void build(const BoundsTree<Boundable>& source) {
+		tree.build(source.getPrototype());
+	}
+	void clear() {
+		tree.clear();
+	}
+	// see FrozenBoundsTreePrototype::addAllTo
+	void addAllTo(BoundsTree<Boundable>& target) const {
+		tree.addAllTo(target.getPrototype());
+	}
+	bool isBuilt() const { return tree.isBuilt(); }
+	std::size_t size() const { return tree.getLeafCount(); }
+	std::size_t getMemoryUsage() const { return tree.getMemoryUsage(); }
+
+	// expects a function of the form void(Boundable& object)
+	template<typename Func>
+	void forEach(const Func& func) const {
+		for(const FrozenLeaf& leaf : tree.leaves) {
+			func(*static_cast<Boundable*>(leaf.object));
+		}
+	}
+
+	// see BoundsTree::forEachFiltered, expects a function of the form void(Boundable& object)
+	template<typename Filter, typename Func>
+	void forEachFiltered(const Filter& filter, const Func& func) const {
+		if(tree.baseTrunkSize == 0) return;
+		forEachFilteredFrozenRecursive(tree, 0, tree.baseTrunkSize, filter, [&func](void* object) {
+			func(*static_cast<Boundable*>(object));
+		});
+	}
+
+	// expects a function of the form void(Boundable* object)
+	template<typename Func>
+	void forEachOverlapping(const BoundsTemplate<float>& bounds, const Func& func) const {
+		if(tree.baseTrunkSize == 0) return;
+		forEachOverlappingFrozenRecursive(tree, 0, tree.baseTrunkSize, bounds, [&func](void* object) {
+			func(static_cast<Boundable*>(object));
+		});
+	}
+
+	bool contains(const Boundable* object) const {
+		bool found = false;
+		forEachOverlapping(object->getBounds(), [object, &found](Boundable* candidate) {
+			if(candidate == object) found = true;
+		});
+		return found;
+	}
+
+	/*
+		Finds the same pairs as dynamicTree.forEachColissionWith(sourceTree)
+		expects a function of the form void(Boundable* dynamicObject, Boundable* frozenObject)
+	*/
+	template<typename Func>
+	void forEachColissionWith(const BoundsTree<Boundable>& dynamicTree, const Func& func) const {
+		std::pair<const TreeTrunk&, int> dynamicBase = dynamicTree.getPrototype().getBaseTrunk();
+		if(tree.baseTrunkSize == 0 || dynamicBase.second == 0) return;
+		forEachColissionWithFrozenRecursive<Boundable, TrunkSIMDHelperFallback>(FrozenColissionTask{&dynamicBase.first, dynamicBase.second, 0, tree.baseTrunkSize}, tree, func);
+	}
+
+	/*
+		Splits forEachColissionWith into independent tasks which can be run on separate threads using runColissionTask
+		The new tasks are appended to tasks, see BoundsTree::splitColissionTasksWith
+		Colissions found while splitting are passed to func directly
+		expects a function of the form void(Boundable* dynamicObject, Boundable* frozenObject)
+	*/
+	template<typename Func>
+	void splitColissionTasksWith(const BoundsTree<Boundable>& dynamicTree, std::vector<FrozenColissionTask>& tasks, std::size_t targetTaskCount, int maxDepth, const Func& func) const {
+		std::pair<const TreeTrunk&, int> dynamicBase = dynamicTree.getPrototype().getBaseTrunk();
+		if(tree.baseTrunkSize == 0 || dynamicBase.second == 0) return;
+		std::vector<FrozenColissionTask> newTasks{FrozenColissionTask{&dynamicBase.first, dynamicBase.second, 0, tree.baseTrunkSize}};
+		std::vector<FrozenColissionTask> nextLevel;
+		for(int depth = 0; depth < maxDepth && newTasks.size() != 0 && newTasks.size() < targetTaskCount; depth++) {
+			nextLevel.clear();
+			for(const FrozenColissionTask& task : newTasks) {
+				forEachColissionWithFrozenStep<Boundable, TrunkSIMDHelperFallback>(task, tree, [&nextLevel](const FrozenColissionTask& subTask) {
+					nextLevel.push_back(subTask);
+				}, func);
+			}
+			newTasks.swap(nextLevel);
+		}
+		tasks.insert(tasks.end(), newTasks.begin(), newTasks.end());
+	}
+
+	// expects a function of the form void(Boundable* dynamicObject, Boundable* frozenObject)
+	template<typename Func>
+	void runColissionTask(const FrozenColissionTask& task, const Func& func) const {
+		forEachColissionWithFrozenRecursive<Boundable, TrunkSIMDHelperFallback>(task, tree, func);
+	}
+};
+};
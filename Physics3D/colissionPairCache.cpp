@@ -0,0 +1,242 @@
+#include "colissionPairCache.h"
+
+#include "physical.h"
+#include "layer.h"
+
+#include <functional>
+#include <algorithm>
+
+namespace P3D {
+// how far a part may move outside of its bounds before it has to be requeried, relative to the size of the part
+static constexpr float FAT_BOUNDS_MARGIN_FACTOR = 0.2f;
+
+static BoundsTemplate<float> computeFatBounds(const Part& part, const BoundsTemplate<float>& bounds) {
+	return bounds.expanded(static_cast<float>(part.maxRadius) * FAT_BOUNDS_MARGIN_FACTOR);
+}
+
+bool ColissionPairCache::ProxyPairSet::add(FatProxy* a, FatProxy* b) {
+	ProxyPair p{a, b};
+	if(indices.find(p) != indices.end()) return false;
+	indices.emplace(p, pairs.size());
+	pairs.push_back(p);
+	return true;
+}
+
+void ColissionPairCache::ProxyPairSet::removeAt(std::size_t index) {
+	indices.erase(pairs[index]);
+	if(index != pairs.size() - 1) {
+		pairs[index] = pairs.back();
+		indices[pairs[index]] = index;
+	}
+	pairs.pop_back();
+}
+
+void ColissionPairCache::ProxyPairSet::clear() {
+	pairs.clear();
+	indices.clear();
+}
+
+void ColissionPairCache::addFreePair(FatProxy* a, FatProxy* b) {
+	if(a == b) return;
+	// left proxies stay in the proxyTree until the end of the update
+	if(a->hasLeft || b->hasLeft) return;
+	if(a->part->getMainPhysical() == b->part->getMainPhysical()) return;
+	if(std::less<FatProxy*>()(b, a)) std::swap(a, b);
+	if(freePairs.add(a, b)) {
+		addedPairs.push_back(PartPair{a->part, b->part});
+	}
+}
+
+void ColissionPairCache::addTerrainPair(FatProxy* freeProxy, FatProxy* terrainProxy) {
+	if(terrainPairs.add(freeProxy, terrainProxy)) {
+		addedPairs.push_back(PartPair{freeProxy->part, terrainProxy->part});
+	}
+}
+
+void ColissionPairCache::markDirty(Part* part) {
+	auto found = proxies.find(part);
+	if(found == proxies.end()) {
+		BoundsTemplate<float> bounds = part->getBounds();
+		FatProxy& newProxy = proxies.emplace(part, FatProxy{part, bounds, computeFatBounds(*part, bounds), part->getMainPhysical(), updateCount, updateCount, false, true, true}).first->second;
+		proxyTree.add(&newProxy);
+		dirtyProxies.push_back(&newProxy);
+		return;
+	}
+	FatProxy& proxy = found->second;
+	if(proxy.hasLeft) {
+		// removed and added back before the update, the proxy is kept but requeried
+		proxy.hasLeft = false;
+		proxy.isNew = true;
+		leftProxies.erase(std::find(leftProxies.begin(), leftProxies.end(), &proxy));
+	}
+	if(!proxy.isDirty) {
+		proxy.isDirty = true;
+		dirtyProxies.push_back(&proxy);
+	}
+}
+
+void ColissionPairCache::markAllDirty(const BoundsTree<Part>& freeParts) {
+	freeParts.forEach([this](Part& part) {
+		markDirty(&part);
+	});
+}
+
+void ColissionPairCache::removePart(const Part* part) {
+	auto found = proxies.find(part);
+	if(found == proxies.end() || found->second.hasLeft) return;
+	found->second.hasLeft = true;
+	leftProxies.push_back(&found->second);
+}
+
+void ColissionPairCache::updateDirtyProxies() {
+	for(FatProxy* proxy : dirtyProxies) {
+		proxy->isDirty = false;
+		// the part may already have been deleted
+		if(proxy->hasLeft) continue;
+
+		Part& part = *proxy->part;
+		proxy->bounds = part.getBounds();
+		const MotorizedPhysical* mainPhysical = part.getMainPhysical();
+		bool leftFatBounds = !proxy->fatBounds.contains(proxy->bounds);
+		if(leftFatBounds) {
+			BoundsTemplate<float> oldFatBounds = proxy->fatBounds;
+			proxy->fatBounds = computeFatBounds(part, proxy->bounds);
+			proxyTree.updateObjectBounds(proxy, oldFatBounds);
+		}
+		if(leftFatBounds || proxy->isNew || mainPhysical != proxy->mainPhysical) {
+			proxy->mainPhysical = mainPhysical;
+			proxy->isNew = false;
+			proxy->lastMovedUpdate = updateCount;
+			movedProxies.push_back(proxy);
+		}
+	}
+	dirtyProxies.clear();
+}
+
+void ColissionPairCache::updateTerrainProxies(const WorldLayer& terrainParts) {
+	terrainParts.forEach([this](Part& part) {
+		BoundsTemplate<float> bounds = part.getBounds();
+		auto found = terrainProxies.find(&part);
+		if(found == terrainProxies.end()) {
+			FatProxy& newProxy = terrainProxies.emplace(&part, FatProxy{&part, bounds, bounds, nullptr, updateCount, updateCount, false, false, false}).first->second;
+			movedTerrainProxies.push_back(&newProxy);
+		} else {
+			FatProxy& proxy = found->second;
+			proxy.lastSeenUpdate = updateCount;
+			if(proxy.bounds != bounds) {
+				proxy.bounds = bounds;
+				proxy.fatBounds = bounds;
+				proxy.lastMovedUpdate = updateCount;
+				movedTerrainProxies.push_back(&proxy);
+			}
+		}
+	});
+
+	for(auto& entry : terrainProxies) {
+		FatProxy& proxy = entry.second;
+		if(proxy.lastSeenUpdate != updateCount) {
+			proxy.hasLeft = true;
+			leftTerrainProxies.push_back(&proxy);
+		}
+	}
+}
+
+void ColissionPairCache::removeOutdatedPairs(ProxyPairSet& pairSet) {
+	for(std::size_t i = 0; i < pairSet.pairs.size();) {
+		const ProxyPair& p = pairSet.pairs[i];
+		bool isOutdated = p.a->hasLeft || p.b->hasLeft;
+		if(!isOutdated && (p.a->lastMovedUpdate == updateCount || p.b->lastMovedUpdate == updateCount)) {
+			isOutdated = !intersects(p.a->fatBounds, p.b->fatBounds);
+		}
+		if(isOutdated) {
+			removedPairs.push_back(PartPair{p.a->part, p.b->part});
+			pairSet.removeAt(i);
+		} else {
+			i++;
+		}
+	}
+}
+
+void ColissionPairCache::eraseLeftProxies() {
+	for(FatProxy* proxy : leftProxies) {
+		proxyTree.remove(proxy);
+		proxies.erase(proxy->part);
+	}
+	for(FatProxy* proxy : leftTerrainProxies) {
+		terrainProxies.erase(proxy->part);
+	}
+	leftProxies.clear();
+	leftTerrainProxies.clear();
+}
+
+void ColissionPairCache::update(const WorldLayer& terrainParts) {
+	updateCount++;
+	addedPairs.clear();
+	removedPairs.clear();
+	movedProxies.clear();
+	movedTerrainProxies.clear();
+
+	updateDirtyProxies();
+
+	// terrain rarely changes, so it is only looked at after invalidateTerrain
+	if(terrainChanged) {
+		updateTerrainProxies(terrainParts);
+		terrainChanged = false;
+	}
+
+	bool anythingChanged = !movedProxies.empty() || !leftProxies.empty() || !movedTerrainProxies.empty() || !leftTerrainProxies.empty();
+	if(!anythingChanged) return;
+
+	removeOutdatedPairs(freePairs);
+	removeOutdatedPairs(terrainPairs);
+	eraseLeftProxies();
+
+	for(FatProxy* proxy : movedProxies) {
+		proxyTree.forEachOverlapping(proxy->fatBounds, [this, proxy](FatProxy* other) {
+			addFreePair(proxy, other);
+		});
+		terrainParts.forEachOverlapping(proxy->fatBounds, [this, proxy](Part* terrainPart) {
+			auto found = terrainProxies.find(terrainPart);
+			if(found != terrainProxies.end()) {
+				addTerrainPair(proxy, &found->second);
+			}
+		});
+	}
+	for(FatProxy* terrainProxy : movedTerrainProxies) {
+		proxyTree.forEachOverlapping(terrainProxy->bounds, [this, terrainProxy](FatProxy* freeProxy) {
+			addTerrainPair(freeProxy, terrainProxy);
+		});
+	}
+}
+
+void ColissionPairCache::getColissions(ColissionBuffer& curColissions) const {
+	for(const ProxyPair& p : freePairs.pairs) {
+		// parts may have been attached to eachother after the pair was found, splitting them again requeries them
+		if(p.a->part->getMainPhysical() == p.b->part->getMainPhysical()) continue;
+		if(intersects(p.a->bounds, p.b->bounds)) {
+			curColissions.freePartColissions.push_back(Colission{p.a->part, p.b->part});
+		}
+	}
+	for(const ProxyPair& p : terrainPairs.pairs) {
+		if(intersects(p.a->bounds, p.b->bounds)) {
+			curColissions.freeTerrainColissions.push_back(Colission{p.a->part, p.b->part});
+		}
+	}
+}
+
+void ColissionPairCache::clear() {
+	proxies.clear();
+	proxyTree.clear();
+	terrainProxies.clear();
+	dirtyProxies.clear();
+	freePairs.clear();
+	terrainPairs.clear();
+	movedProxies.clear();
+	movedTerrainProxies.clear();
+	leftProxies.clear();
+	leftTerrainProxies.clear();
+	addedPairs.clear();
+	removedPairs.clear();
+	terrainChanged = true;
+}
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+
+#include "boundstree/boundsTree.h"
+#include "part.h"
+#include "colissionBuffer.h"
+#include "partPairMap.h"
+
+namespace P3D {
+class WorldLayer;
+
+struct PartPair {
+	Part* p1;
+	Part* p2;
+};
+
+/*
+	Keeps the overlapping part pairs of a ColissionLayer alive between ticks
+
+	Every free part gets a proxy with a fattened copy of its bounds. The layer tells the cache which parts may have moved, been added or removed,
+	update only looks at those. As long as a part stays within its fat bounds nothing has to be recomputed for it,
+	only parts that left their fat bounds or changed main physical are reinserted and requeried.
+	A pair is kept as long as the fat bounds of both parts overlap, getColissions then does the exact bounds check,
+	so the colissions it finds are the same as those of a full tree traversal, the cost of keeping them up to date
+	depends on how much moves, not on how many parts there are.
+*/
+class ColissionPairCache {
+	struct FatProxy {
+		Part* part;
+		// the actual bounds of the part when it was last seen
+		BoundsTemplate<float> bounds;
+		BoundsTemplate<float> fatBounds;
+		// pairs within one physical are not kept, when the part is split off it has to be requeried
+		const MotorizedPhysical* mainPhysical;
+		std::size_t lastSeenUpdate;
+		std::size_t lastMovedUpdate;
+		// set when the part is no longer in the layer, the proxy is erased in the next update
+		bool hasLeft;
+		// set while the proxy is in dirtyProxies
+		bool isDirty;
+		// set for proxies that have not been queried yet
+		bool isNew;
+
+		BoundsTemplate<float> getBounds() const { return fatBounds; }
+	};
+
+	using ProxyPair = PointerPair<FatProxy>;
+	using ProxyPairHash = PointerPairHash<FatProxy>;
+	struct ProxyPairSet {
+		// pairs are kept in a vector such that iteration order is deterministic
+		std::vector<ProxyPair> pairs;
+		std::unordered_map<ProxyPair, std::size_t, ProxyPairHash> indices;
+
+		bool add(FatProxy* a, FatProxy* b);
+		void removeAt(std::size_t index);
+		void clear();
+	};
+
+	// proxies of free parts, their bounds are fattened
+	std::unordered_map<const Part*, FatProxy> proxies;
+	BoundsTree<FatProxy> proxyTree;
+	// proxies of terrain parts, terrain does not move so these are not fattened
+	std::unordered_map<const Part*, FatProxy> terrainProxies;
+
+	ProxyPairSet freePairs;
+	// a is the free part, b the terrain part
+	ProxyPairSet terrainPairs;
+
+	// proxies of the parts the layer marked since the last update
+	std::vector<FatProxy*> dirtyProxies;
+	std::vector<FatProxy*> movedProxies;
+	std::vector<FatProxy*> movedTerrainProxies;
+	std::vector<FatProxy*> leftProxies;
+	std::vector<FatProxy*> leftTerrainProxies;
+
+	std::vector<PartPair> addedPairs;
+	std::vector<PartPair> removedPairs;
+
+	std::size_t updateCount = 0;
+	bool terrainChanged = true;
+
+	void updateDirtyProxies();
+	void updateTerrainProxies(const WorldLayer& terrainParts);
+	void removeOutdatedPairs(ProxyPairSet& pairSet);
+	void eraseLeftProxies();
+	void addFreePair(FatProxy* a, FatProxy* b);
+	void addTerrainPair(FatProxy* freeProxy, FatProxy* terrainProxy);
+
+public:
+	ColissionPairCache() = default;
+	ColissionPairCache(const ColissionPairCache&) = delete;
+	ColissionPairCache& operator=(const ColissionPairCache&) = delete;
+
+	/*
+		Brings the cached pairs up to date, must be called once before every getColissions
+		Only the free parts marked since the last update are looked at, terrain only after invalidateTerrain
+	*/
+	void update(const WorldLayer& terrainParts);
+
+	// the free part may have moved, been added to the layer or changed main physical
+	void markDirty(Part* part);
+	void markAllDirty(const BoundsTree<Part>& freeParts);
+	// the free part has left the layer, it may be deleted before the next update
+	void removePart(const Part* part);
+
+	// adds all cached pairs whose actual bounds overlap to the colission buffer
+	void getColissions(ColissionBuffer& curColissions) const;
+
+	// must be called when terrain parts are added, removed or moved
+	void invalidateTerrain() { terrainChanged = true; }
+	void clear();
+
+	// pairs whose fat bounds started overlapping in the last update
+	const std::vector<PartPair>& getAddedPairs() const { return addedPairs; }
+	/*
+		pairs whose fat bounds stopped overlapping in the last update
+		parts that left the layer may already have been deleted, so these pointers may only be used for lookup
+	*/
+	const std::vector<PartPair>& getRemovedPairs() const { return removedPairs; }
+
+	std::size_t getFreePairCount() const { return freePairs.pairs.size(); }
+	std::size_t getTerrainPairCount() const { return terrainPairs.pairs.size(); }
+	std::size_t getProxyCount() const { return proxies.size(); }
+	// the number of parts that were requeried in the last update
+	std::size_t getMovedProxyCount() const { return movedProxies.size(); }
+};
+};
@@ -0,0 +1,64 @@
+#include "colissionPreTests.h"
+
+#include "part.h"
+#include "misc/cpuid.h"
+
+#include <cmath>
+
+namespace P3D {
+// relative to the size of a pair, far larger than the rounding error of the float computations
+static constexpr double PRE_TEST_MARGIN_FACTOR = 1E-5;
+
+ColissionPreTestBatch::ColissionPreTestBatch() : offset{}, rotationFirst{}, rotationSecond{}, scaleFirst{}, scaleSecond{}, maxRadiusFirst{}, maxRadiusSecond{}, margin{} {}
+
+void ColissionPreTestBatch::setLane(std::size_t lane, const Part& first, const Part& second) {
+	Vec3 relativePosition(second.getPosition() - first.getPosition());
+	Mat3 rotFirst = first.getCFrame().getRotation().asRotationMatrix();
+	Mat3 rotSecond = second.getCFrame().getRotation().asRotationMatrix();
+	double size = first.maxRadius + second.maxRadius;
+	for(int i = 0; i < 3; i++) {
+		offset[i][lane] = static_cast<float>(relativePosition[i]);
+		for(int j = 0; j < 3; j++) {
+			rotationFirst[i][j][lane] = static_cast<float>(rotFirst(i, j));
+			rotationSecond[i][j][lane] = static_cast<float>(rotSecond(i, j));
+		}
+		scaleFirst[i][lane] = static_cast<float>(first.hitbox.scale[i]);
+		scaleSecond[i][lane] = static_cast<float>(second.hitbox.scale[i]);
+		size += std::abs(relativePosition[i]);
+	}
+	maxRadiusFirst[lane] = static_cast<float>(first.maxRadius);
+	maxRadiusSecond[lane] = static_cast<float>(second.maxRadius);
+	margin[lane] = static_cast<float>(size * PRE_TEST_MARGIN_FACTOR);
+}
+
+PreTestBatchResult runColissionPreTestBatchFallback(const ColissionPreTestBatch& b) {
+	PreTestBatchResult result{0, 0};
+	for(std::size_t lane = 0; lane < PRE_TEST_BATCH_LANES; lane++) {
+		const float t[3]{b.offset[0][lane], b.offset[1][lane], b.offset[2][lane]};
+		float radiusFirst = b.maxRadiusFirst[lane] + b.margin[lane];
+		float radiusSecond = b.maxRadiusSecond[lane] + b.margin[lane];
+
+		float combinedRadius = b.maxRadiusFirst[lane] + radiusSecond;
+		if(t[0] * t[0] + t[1] * t[1] + t[2] * t[2] > combinedRadius * combinedRadius) {
+			result.distanceRejects |= 1 << lane;
+			continue;
+		}
+
+		// the center of the second part in the local space of the first, and the other way around, the sign does not matter
+		bool outsideBounds = false;
+		for(int j = 0; j < 3; j++) {
+			float inFirst = t[0] * b.rotationFirst[0][j][lane] + t[1] * b.rotationFirst[1][j][lane] + t[2] * b.rotationFirst[2][j][lane];
+			float inSecond = t[0] * b.rotationSecond[0][j][lane] + t[1] * b.rotationSecond[1][j][lane] + t[2] * b.rotationSecond[2][j][lane];
+			outsideBounds |= std::abs(inFirst) > b.scaleFirst[j][lane] + radiusSecond;
+			outsideBounds |= std::abs(inSecond) > b.scaleSecond[j][lane] + radiusFirst;
+		}
+		if(outsideBounds) result.boundsRejects |= 1 << lane;
+	}
+	return result;
+}
+
+PreTestBatchResult runColissionPreTestBatch(const ColissionPreTestBatch& batch) {
+	if(CPUIDCheck::hasTechnology(CPUIDCheck::AVX | CPUIDCheck::AVX2)) return runColissionPreTestBatchAVX(batch);
+	return runColissionPreTestBatchFallback(batch);
+}
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+
+namespace P3D {
+class Part;
+
+static constexpr std::size_t PRE_TEST_BATCH_LANES = 8;
+
+/*
+	Structure of arrays form of up to 8 broadphase candidates, such that the cheap rejection tests that run before GJK can be done in lockstep
+	All values are relative to the position of the first part, converted to float
+	Lanes that were never set are zero, these are never rejected
+*/
+struct alignas(32) ColissionPreTestBatch {
+	// position of the second part minus the position of the first
+	float offset[3][PRE_TEST_BATCH_LANES];
+	// rotationFirst[i][j] is component i of axis j of the first part
+	float rotationFirst[3][3][PRE_TEST_BATCH_LANES];
+	float rotationSecond[3][3][PRE_TEST_BATCH_LANES];
+	float scaleFirst[3][PRE_TEST_BATCH_LANES];
+	float scaleSecond[3][PRE_TEST_BATCH_LANES];
+	float maxRadiusFirst[PRE_TEST_BATCH_LANES];
+	float maxRadiusSecond[PRE_TEST_BATCH_LANES];
+	// added to every radius, such that the rounding to float can only make a test more conservative
+	float margin[PRE_TEST_BATCH_LANES];
+
+	ColissionPreTestBatch();
+	void setLane(std::size_t lane, const Part& first, const Part& second);
+};
+
+/*
+	Bit i of distanceRejects is set if the bounding spheres of lane i don't overlap
+	Bit i of boundsRejects is set if lane i is not in distanceRejects, but the bounding sphere of one part lies outside of the hitbox bounds of the other
+	This way every rejected pair is counted once, in the same category as the pair by pair tests did
+*/
+struct PreTestBatchResult {
+	int distanceRejects;
+	int boundsRejects;
+};
+
+PreTestBatchResult runColissionPreTestBatch(const ColissionPreTestBatch& batch);
+PreTestBatchResult runColissionPreTestBatchFallback(const ColissionPreTestBatch& batch);
+PreTestBatchResult runColissionPreTestBatchAVX(const ColissionPreTestBatch& batch);
+};
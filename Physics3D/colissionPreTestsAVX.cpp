@@ -0,0 +1,42 @@
+#include "colissionPreTests.h"
+
+#include <immintrin.h>
+
+// AVX implementation of runColissionPreTestBatch, every lane holds one candidate pair
+namespace P3D {
+static_assert(PRE_TEST_BATCH_LANES == 8, "the AVX implementation requires 8 lanes");
+
+namespace {
+inline __m256 abs(__m256 v) {
+	return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v);
+}
+inline __m256 dot(const __m256 (&t)[3], const float (&axes)[3][3][PRE_TEST_BATCH_LANES], int axis) {
+	return _mm256_add_ps(_mm256_mul_ps(t[0], _mm256_load_ps(axes[0][axis])), _mm256_add_ps(_mm256_mul_ps(t[1], _mm256_load_ps(axes[1][axis])), _mm256_mul_ps(t[2], _mm256_load_ps(axes[2][axis]))));
+}
+};
+
+PreTestBatchResult runColissionPreTestBatchAVX(const ColissionPreTestBatch& b) {
+	__m256 t[3];
+	for(int i = 0; i < 3; i++) {
+		t[i] = _mm256_load_ps(b.offset[i]);
+	}
+	__m256 margin = _mm256_load_ps(b.margin);
+	__m256 radiusFirst = _mm256_add_ps(_mm256_load_ps(b.maxRadiusFirst), margin);
+	__m256 radiusSecond = _mm256_add_ps(_mm256_load_ps(b.maxRadiusSecond), margin);
+
+	__m256 combinedRadius = _mm256_add_ps(_mm256_load_ps(b.maxRadiusFirst), radiusSecond);
+	__m256 distanceSquared = _mm256_add_ps(_mm256_mul_ps(t[0], t[0]), _mm256_add_ps(_mm256_mul_ps(t[1], t[1]), _mm256_mul_ps(t[2], t[2])));
+	__m256 distanceRejected = _mm256_cmp_ps(distanceSquared, _mm256_mul_ps(combinedRadius, combinedRadius), _CMP_GT_OQ);
+
+	__m256 outsideBounds = _mm256_setzero_ps();
+	for(int j = 0; j < 3; j++) {
+		__m256 limitFirst = _mm256_add_ps(_mm256_load_ps(b.scaleFirst[j]), radiusSecond);
+		__m256 limitSecond = _mm256_add_ps(_mm256_load_ps(b.scaleSecond[j]), radiusFirst);
+		outsideBounds = _mm256_or_ps(outsideBounds, _mm256_cmp_ps(abs(dot(t, b.rotationFirst, j)), limitFirst, _CMP_GT_OQ));
+		outsideBounds = _mm256_or_ps(outsideBounds, _mm256_cmp_ps(abs(dot(t, b.rotationSecond, j)), limitSecond, _CMP_GT_OQ));
+	}
+
+	int distanceMask = _mm256_movemask_ps(distanceRejected);
+	return PreTestBatchResult{distanceMask, _mm256_movemask_ps(outsideBounds) & ~distanceMask};
+}
+};
@@ -4,6 +4,7 @@
 
 #include "../math/linalg/largeMatrix.h"
 #include "../math/linalg/largeMatrixAlgorithms.h"
+#include "../math/linalg/sparseBlockMatrix.h"
 #include "../math/linalg/mat.h"
 #include "../physical.h"
 
@@ -15,6 +16,8 @@
 #include <cstddef>
 
 #include <map>
+#include <vector>
+#include <algorithm>
 
 namespace P3D {
 int PhysicalConstraint::maxNumberOfParameters() const {
@@ -34,83 +37,132 @@ ConstraintMatrixPack PhysicalConstraint::getMatrices(double* matrixBuf, double*
 
 void ConstraintGroup::add(Physical* first, Physical* second, Constraint* constraint) {
 	this->constraints.push_back(PhysicalConstraint(first, second, constraint));
+	this->blocks.clear();
 }
 void ConstraintGroup::add(Part* first, Part* second, Constraint* constraint) {
 	this->constraints.push_back(PhysicalConstraint(first->ensureHasPhysical(), second->ensureHasPhysical(), constraint));
+	this->blocks.clear();
+}
+
+// the pairs of constraints that act on a common MotorizedPhysical, only these give nonzero blocks outside the diagonal
+static std::vector<std::pair<std::size_t, std::size_t>> getConstraintsSharingPhysicals(const std::vector<PhysicalConstraint>& constraints) {
+	std::map<MotorizedPhysical*, std::vector<std::size_t>> constraintsOfPhysical;
+	for(std::size_t i = 0; i < constraints.size(); i++) {
+		MotorizedPhysical* mainA = constraints[i].physA->mainPhysical;
+		MotorizedPhysical* mainB = constraints[i].physB->mainPhysical;
+		constraintsOfPhysical[mainA].push_back(i);
+		if(mainB != mainA) constraintsOfPhysical[mainB].push_back(i);
+	}
+	std::vector<std::pair<std::size_t, std::size_t>> pairs;
+	for(const std::pair<MotorizedPhysical* const, std::vector<std::size_t>>& found : constraintsOfPhysical) {
+		const std::vector<std::size_t>& sharing = found.second;
+		for(std::size_t i = 0; i < sharing.size(); i++) {
+			for(std::size_t j = i + 1; j < sharing.size(); j++) {
+				pairs.emplace_back(std::min(sharing[i], sharing[j]), std::max(sharing[i], sharing[j]));
+			}
+		}
+	}
+	// constraints between the same two physicals share both
+	std::sort(pairs.begin(), pairs.end());
+	pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+	return pairs;
+}
+
+/*
+	The effect of the parameters of constraint blockCol on the equations of constraint blockRow, through the physicals they share
+	block is a blockRow size x blockCol size row major matrix
+*/
+static void fillSystemBlock(const std::vector<PhysicalConstraint>& constraints, const ConstraintMatrixPack* constraintMatrices, std::size_t blockRow, std::size_t blockCol, double* block) {
+	int rowSize = constraintMatrices[blockRow].getSize();
+	int colSize = constraintMatrices[blockCol].getSize();
+
+	MotorizedPhysical* mPhysA = constraints[blockRow].physA->mainPhysical;
+	MotorizedPhysical* mPhysB = constraints[blockRow].physB->mainPhysical;
+	MotorizedPhysical* cPhysA = constraints[blockCol].physA->mainPhysical;
+	MotorizedPhysical* cPhysB = constraints[blockCol].physB->mainPhysical;
+
+	const UnmanagedHorizontalFixedMatrix<double, 6> motionToEq1 = constraintMatrices[blockRow].getMotionToEquationMatrixA();
+	const UnmanagedHorizontalFixedMatrix<double, 6> motionToEq2 = constraintMatrices[blockRow].getMotionToEquationMatrixB();
+	const UnmanagedVerticalFixedMatrix<double, 6> paramToMotion1 = constraintMatrices[blockCol].getParameterToMotionMatrixA();
+	const UnmanagedVerticalFixedMatrix<double, 6> paramToMotion2 = constraintMatrices[blockCol].getParameterToMotionMatrixB();
+
+	UnmanagedLargeMatrix<double> resultMat1(block, colSize, rowSize);
+	for(double& d : resultMat1) d = 0.0;
+	double resultBuf2[6 * 6]; UnmanagedLargeMatrix<double> resultMat2(resultBuf2, colSize, rowSize);
+	for(double& d : resultMat2) d = 0.0;
+	if(mPhysA == cPhysA) {
+		inMemoryMatrixMultiply(motionToEq1, paramToMotion1, resultMat1);
+	} else if(mPhysA == cPhysB) {
+		inMemoryMatrixMultiply(motionToEq1, paramToMotion2, resultMat1);
+		inMemoryMatrixNegate(resultMat1);
+	}
+	if(mPhysB == cPhysA) {
+		inMemoryMatrixMultiply(motionToEq2, paramToMotion1, resultMat2);
+		inMemoryMatrixNegate(resultMat2);
+	} else if(mPhysB == cPhysB) {
+		inMemoryMatrixMultiply(motionToEq2, paramToMotion2, resultMat2);
+	}
+
+	resultMat1 += resultMat2;
+}
+
+// also catches constraints pushed into constraints directly, and physicals that were merged into or split from others
+bool ConstraintGroup::isPatternUpToDate() const {
+	if(blocks.size() != constraints.size()) return false;
+	for(std::size_t i = 0; i < constraints.size(); i++) {
+		const ConstraintBlock& block = blocks[i];
+		if(block.mainA != constraints[i].physA->mainPhysical || block.mainB != constraints[i].physB->mainPhysical || block.size != constraintMatrices[i].getSize()) return false;
+	}
+	return true;
+}
+
+void ConstraintGroup::updatePattern() const {
+	blocks.resize(constraints.size());
+	std::vector<std::size_t> blockSizes(constraints.size());
+	for(std::size_t i = 0; i < constraints.size(); i++) {
+		blocks[i] = ConstraintBlock{constraints[i].physA->mainPhysical, constraints[i].physB->mainPhysical, constraintMatrices[i].getSize()};
+		blockSizes[i] = constraintMatrices[i].getSize();
+	}
+	sharingConstraints = getConstraintsSharingPhysicals(constraints);
+	systemToSolve.setPattern(blockSizes, sharingConstraints);
 }
 
 void ConstraintGroup::apply() const {
 	std::size_t maxNumberOfParameters = 0;
-	ConstraintMatrixPack* constraintMatrices = new ConstraintMatrixPack[constraints.size()];
-
 	for(std::size_t i = 0; i < constraints.size(); i++) {
 		maxNumberOfParameters += constraints[i].constraint->maxNumberOfParameters();
 	}
 
-	double* matrixBuffer = new double[std::size_t(24) * maxNumberOfParameters];
-	double* errorBuffer = new double[std::size_t(NUMBER_OF_ERROR_DERIVATIVES) * maxNumberOfParameters];
+	// vectors keep their capacity, so once the sizes have settled nothing is allocated anymore
+	constraintMatrices.resize(constraints.size());
+	matrixBuffer.resize(std::size_t(24) * maxNumberOfParameters);
+	errorBuffer.resize(std::size_t(NUMBER_OF_ERROR_DERIVATIVES) * maxNumberOfParameters);
 
 	std::size_t numberOfParams = 0;
 	for(std::size_t i = 0; i < constraints.size(); i++) {
-		constraintMatrices[i] = constraints[i].getMatrices(matrixBuffer + std::size_t(24) * numberOfParams, errorBuffer + std::size_t(NUMBER_OF_ERROR_DERIVATIVES) * numberOfParams);
+		constraintMatrices[i] = constraints[i].getMatrices(matrixBuffer.data() + std::size_t(24) * numberOfParams, errorBuffer.data() + std::size_t(NUMBER_OF_ERROR_DERIVATIVES) * numberOfParams);
 
 		numberOfParams += constraintMatrices[i].getSize();
 	}
 
-	UnmanagedHorizontalFixedMatrix<double, NUMBER_OF_ERROR_DERIVATIVES> vectorToSolve(errorBuffer, maxNumberOfParameters);
+	UnmanagedHorizontalFixedMatrix<double, NUMBER_OF_ERROR_DERIVATIVES> vectorToSolve(errorBuffer.data(), numberOfParams);
 
-	LargeMatrix<double> systemToSolve(numberOfParams, numberOfParams);
-	{
-		std::size_t curColIndex = 0;
-		for(std::size_t blockCol = 0; blockCol < constraints.size(); blockCol++) {
-			int colSize = constraintMatrices[blockCol].getSize();
-
-			MotorizedPhysical* mPhysA = constraints[blockCol].physA->mainPhysical;
-			MotorizedPhysical* mPhysB = constraints[blockCol].physB->mainPhysical;
-
-			const UnmanagedHorizontalFixedMatrix<double, 6> motionToEq1 = constraintMatrices[blockCol].getMotionToEquationMatrixA();
-			const UnmanagedHorizontalFixedMatrix<double, 6> motionToEq2 = constraintMatrices[blockCol].getMotionToEquationMatrixB();
-
-			std::size_t curRowIndex = 0;
-			for(std::size_t blockRow = 0; blockRow < constraints.size(); blockRow++) {
-				int rowSize = constraintMatrices[blockRow].getSize();
-
-				MotorizedPhysical* cPhysA = constraints[blockRow].physA->mainPhysical;
-				MotorizedPhysical* cPhysB = constraints[blockRow].physB->mainPhysical;
-
-				const UnmanagedVerticalFixedMatrix<double, 6> paramToMotion1 = constraintMatrices[blockRow].getParameterToMotionMatrixA();
-				const UnmanagedVerticalFixedMatrix<double, 6> paramToMotion2 = constraintMatrices[blockRow].getParameterToMotionMatrixB();
-
-				double resultBuf1[6 * 6]; UnmanagedLargeMatrix<double> resultMat1(resultBuf1, rowSize, colSize);
-				for(double& d : resultMat1) d = 0.0;
-				double resultBuf2[6 * 6]; UnmanagedLargeMatrix<double> resultMat2(resultBuf2, rowSize, colSize);
-				for(double& d : resultMat2) d = 0.0;
-				if(mPhysA == cPhysA) {
-					inMemoryMatrixMultiply(motionToEq1, paramToMotion1, resultMat1);
-				} else if(mPhysA == cPhysB) {
-					inMemoryMatrixMultiply(motionToEq1, paramToMotion2, resultMat1);
-					inMemoryMatrixNegate(resultMat1);
-				}
-				if(mPhysB == cPhysA) {
-					inMemoryMatrixMultiply(motionToEq2, paramToMotion1, resultMat2);
-					inMemoryMatrixNegate(resultMat2);
-				} else if(mPhysB == cPhysB) {
-					inMemoryMatrixMultiply(motionToEq2, paramToMotion2, resultMat2);
-				}
-
-				resultMat1 += resultMat2;
-
-				systemToSolve.setSubMatrix(curColIndex, curRowIndex, resultMat1);
-
-				curRowIndex += rowSize;
-			}
-			curColIndex += colSize;
-		}
+	if(!isPatternUpToDate()) updatePattern();
+
+	// blocks filled in by the previous factorization are not overwritten by fillSystemBlock
+	systemToSolve.clearValues();
+	for(std::size_t i = 0; i < constraints.size(); i++) {
+		fillSystemBlock(constraints, constraintMatrices.data(), i, i, systemToSolve.getBlock(i, i));
+	}
+	for(const std::pair<std::size_t, std::size_t>& sharing : sharingConstraints) {
+		fillSystemBlock(constraints, constraintMatrices.data(), sharing.first, sharing.second, systemToSolve.getBlock(sharing.first, sharing.second));
+		fillSystemBlock(constraints, constraintMatrices.data(), sharing.second, sharing.first, systemToSolve.getBlock(sharing.second, sharing.first));
 	}
 
 	assert(isMatValid(vectorToSolve));
 
-	destructiveSolve(systemToSolve, vectorToSolve);
+	systemToSolve.factorize();
+	systemToSolve.solve(vectorToSolve.data, NUMBER_OF_ERROR_DERIVATIVES);
 
 	assert(isMatValid(vectorToSolve));
 
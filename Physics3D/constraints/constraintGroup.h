@@ -1,10 +1,15 @@
 #pragma once
 
 #include <vector>
+#include <utility>
+#include <cstddef>
 #include "constraint.h"
+#include "constraintImpl.h"
+#include "../math/linalg/sparseBlockMatrix.h"
 
 namespace P3D {
 class Physical;
+class MotorizedPhysical;
 class Part;
 
 class PhysicalConstraint {
@@ -21,6 +26,27 @@ public:
 };
 
 class ConstraintGroup {
+	// what the sparsity pattern of the system depends on, per constraint
+	struct ConstraintBlock {
+		MotorizedPhysical* mainA;
+		MotorizedPhysical* mainB;
+		int size;
+	};
+
+	/*
+		Kept between calls to apply, such that it doesn't allocate as long as the constraints and the physicals they act on stay the same
+		The pattern and elimination order of systemToSolve are only recomputed when blocks no longer matches the constraints
+	*/
+	mutable std::vector<ConstraintBlock> blocks;
+	mutable std::vector<std::pair<std::size_t, std::size_t>> sharingConstraints;
+	mutable SparseBlockMatrix systemToSolve;
+	mutable std::vector<ConstraintMatrixPack> constraintMatrices;
+	mutable std::vector<double> matrixBuffer;
+	mutable std::vector<double> errorBuffer;
+
+	bool isPatternUpToDate() const;
+	void updatePattern() const;
+
 public:
 	std::vector<PhysicalConstraint> constraints;
 	//std::vector<MotorizedPhysical*> physicals;
@@ -0,0 +1,116 @@
+#include "contactIslands.h"
+
+#include "physical.h"
+#include "constraints/constraintGroup.h"
+
+#include <unordered_map>
+#include <algorithm>
+
+namespace P3D {
+namespace {
+// disjoint sets of physicals, a set is identified by its lowest index, such that it doesn't depend on the order of joining
+class PhysicalUnionFind {
+	std::unordered_map<const MotorizedPhysical*, std::size_t> indices;
+	std::vector<std::size_t> parents;
+
+public:
+	std::size_t getIndex(const MotorizedPhysical* phys) {
+		auto found = indices.find(phys);
+		if(found != indices.end()) return found->second;
+		std::size_t index = parents.size();
+		indices.emplace(phys, index);
+		parents.push_back(index);
+		return index;
+	}
+
+	std::size_t getRoot(std::size_t index) {
+		while(parents[index] != index) {
+			// path halving
+			parents[index] = parents[parents[index]];
+			index = parents[index];
+		}
+		return index;
+	}
+
+	void join(std::size_t a, std::size_t b) {
+		a = getRoot(a);
+		b = getRoot(b);
+		if(a != b) parents[std::max(a, b)] = std::min(a, b);
+	}
+};
+};
+
+// joins the physicals of every constraint and contact, returns the set of the first physical of each contact
+static std::vector<std::size_t> joinPhysicals(PhysicalUnionFind& sets, const std::vector<IslandContact>& contacts, const std::vector<ConstraintGroup>& constraints) {
+	for(const ConstraintGroup& group : constraints) {
+		for(const PhysicalConstraint& constraint : group.constraints) {
+			sets.join(sets.getIndex(constraint.physA->mainPhysical), sets.getIndex(constraint.physB->mainPhysical));
+		}
+	}
+
+	std::vector<std::size_t> contactSets(contacts.size());
+	for(std::size_t i = 0; i < contacts.size(); i++) {
+		std::size_t first = sets.getIndex(contacts[i].first);
+		if(contacts[i].second != nullptr) sets.join(first, sets.getIndex(contacts[i].second));
+		contactSets[i] = first;
+	}
+	return contactSets;
+}
+
+std::vector<std::vector<std::size_t>> findContactIslands(const std::vector<IslandContact>& contacts, const std::vector<ConstraintGroup>& constraints) {
+	PhysicalUnionFind sets;
+	std::vector<std::size_t> contactSets = joinPhysicals(sets, contacts, constraints);
+
+	std::vector<std::vector<std::size_t>> islands;
+	std::unordered_map<std::size_t, std::size_t> islandOfRoot;
+	for(std::size_t i = 0; i < contacts.size(); i++) {
+		std::size_t root = sets.getRoot(contactSets[i]);
+		auto found = islandOfRoot.find(root);
+		if(found == islandOfRoot.end()) {
+			found = islandOfRoot.emplace(root, islands.size()).first;
+			islands.emplace_back();
+		}
+		islands[found->second].push_back(i);
+	}
+	return islands;
+}
+
+std::vector<std::vector<MotorizedPhysical*>> findPhysicalIslands(const std::vector<MotorizedPhysical*>& physicals, const std::vector<IslandContact>& contacts, const std::vector<ConstraintGroup>& constraints) {
+	PhysicalUnionFind sets;
+	// the physicals get the first indices, such that an island is identified by its first physical
+	for(MotorizedPhysical* phys : physicals) {
+		sets.getIndex(phys);
+	}
+	joinPhysicals(sets, contacts, constraints);
+
+	std::vector<std::vector<MotorizedPhysical*>> islands;
+	std::vector<std::size_t> islandOfRoot(physicals.size(), physicals.size());
+	for(std::size_t i = 0; i < physicals.size(); i++) {
+		std::size_t root = sets.getRoot(i);
+		if(islandOfRoot[root] == physicals.size()) {
+			islandOfRoot[root] = islands.size();
+			islands.emplace_back();
+		}
+		islands[islandOfRoot[root]].push_back(physicals[i]);
+	}
+	return islands;
+}
+
+std::vector<std::vector<std::size_t>> colorIslandContacts(const std::vector<IslandContact>& contacts, const std::vector<std::size_t>& island) {
+	std::vector<std::vector<std::size_t>> colors;
+	// the lowest color the next contact on the physical may get
+	std::unordered_map<const MotorizedPhysical*, std::size_t> nextColor;
+	for(std::size_t contactIndex : island) {
+		const IslandContact& contact = contacts[contactIndex];
+		std::size_t color = nextColor[contact.first];
+		if(contact.second != nullptr) color = std::max(color, nextColor[contact.second]);
+
+		if(color == colors.size()) colors.emplace_back();
+		colors[color].push_back(contactIndex);
+
+		nextColor[contact.first] = color + 1;
+		if(contact.second != nullptr) nextColor[contact.second] = color + 1;
+	}
+	return colors;
+}
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace P3D {
+class MotorizedPhysical;
+class ConstraintGroup;
+
+// the physicals one contact applies forces to, second is nullptr for a contact with terrain
+struct IslandContact {
+	MotorizedPhysical* first;
+	MotorizedPhysical* second;
+};
+
+/*
+	Splits contacts into islands, physicals joined by a contact or by a constraint of constraints share an island
+	Contacts of different islands never touch the same physical, so islands may be resolved in parallel
+	Every island lists the indices of its contacts in increasing order, islands are ordered by their first contact
+*/
+std::vector<std::vector<std::size_t>> findContactIslands(const std::vector<IslandContact>& contacts, const std::vector<ConstraintGroup>& constraints);
+
+/*
+	The physicals of every island, joined like those of findContactIslands, physicals without contacts or constraints form an island of their own
+	Islands are ordered by their first physical in physicals
+*/
+std::vector<std::vector<MotorizedPhysical*>> findPhysicalIslands(const std::vector<MotorizedPhysical*>& physicals, const std::vector<IslandContact>& contacts, const std::vector<ConstraintGroup>& constraints);
+
+/*
+	Colors the contacts of one island, such that contacts of the same color share no physical
+	Each contact gets the color after the highest color of the earlier contacts on its physicals, so every physical sees its contacts in the original order
+	Resolving the colors one after the other, and the contacts of a color in any order, gives the same result as resolving the island in order
+*/
+std::vector<std::vector<std::size_t>> colorIslandContacts(const std::vector<IslandContact>& contacts, const std::vector<std::size_t>& island);
+};
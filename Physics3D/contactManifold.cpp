@@ -0,0 +1,120 @@
+#include "contactManifold.h"
+
+#include "part.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace P3D {
+// relative to the size of the smallest part, how far a contact may slide along the surface before it is dropped
+static constexpr double CONTACT_BREAKING_FACTOR = 0.05;
+// relative to the size of the smallest part, new contacts closer than this to an existing one replace it
+static constexpr double CONTACT_MATCHING_FACTOR = 0.05;
+
+void ContactManifold::refreshPoints(const Part& first, const Part& second, Vec3 normal) {
+	double breakingDistance = std::min(first.maxRadius, second.maxRadius) * CONTACT_BREAKING_FACTOR;
+	for(int i = 0; i < pointCount;) {
+		ContactPoint& p = points[i];
+		Position onFirst = first.getCFrame().localToGlobal(p.localOnFirst);
+		Position onSecond = second.getCFrame().localToGlobal(p.localOnSecond);
+		Vec3 delta = onFirst - onSecond;
+		double depth = delta * normal;
+		Vec3 tangentialDrift = delta - normal * depth;
+
+		if(depth <= 0.0 || lengthSquared(tangentialDrift) > breakingDistance * breakingDistance) {
+			points[i] = points[pointCount - 1];
+			pointCount--;
+		} else {
+			p.intersection = onSecond + delta * 0.5;
+			p.exitVector = normal * depth;
+			i++;
+		}
+	}
+}
+
+static double quadArea(Vec3 a, Vec3 b, Vec3 c, Vec3 d) {
+	double ab = lengthSquared((a - b) % (c - d));
+	double ac = lengthSquared((a - c) % (b - d));
+	double ad = lengthSquared((a - d) % (b - c));
+	return std::max(ab, std::max(ac, ad));
+}
+
+void ContactManifold::addPoint(const ContactPoint& newPoint, double matchingDistance) {
+	for(int i = 0; i < pointCount; i++) {
+		if(lengthSquared(Vec3(points[i].intersection - newPoint.intersection)) < matchingDistance * matchingDistance) {
+			// the same contact found again, which keeps its accumulated impulses
+			double normalImpulse = points[i].normalImpulse;
+			Vec3 tangentImpulse = points[i].tangentImpulse;
+			points[i] = newPoint;
+			points[i].normalImpulse = normalImpulse;
+			points[i].tangentImpulse = tangentImpulse;
+			return;
+		}
+	}
+	if(pointCount < MAX_POINTS) {
+		points[pointCount++] = newPoint;
+		return;
+	}
+
+	// five candidates, the deepest is always kept, of the others the one whose removal leaves the largest area is dropped
+	ContactPoint candidates[MAX_POINTS + 1];
+	for(int i = 0; i < MAX_POINTS; i++) candidates[i] = points[i];
+	candidates[MAX_POINTS] = newPoint;
+
+	int deepest = 0;
+	for(int i = 1; i < MAX_POINTS + 1; i++) {
+		if(lengthSquared(candidates[i].exitVector) > lengthSquared(candidates[deepest].exitVector)) deepest = i;
+	}
+	Position origin = candidates[deepest].intersection;
+	int toDrop = -1;
+	double bestArea = -1.0;
+	for(int drop = 0; drop < MAX_POINTS + 1; drop++) {
+		if(drop == deepest) continue;
+		Vec3 kept[MAX_POINTS];
+		int keptCount = 0;
+		for(int i = 0; i < MAX_POINTS + 1; i++) {
+			if(i != drop) kept[keptCount++] = candidates[i].intersection - origin;
+		}
+		double area = quadArea(kept[0], kept[1], kept[2], kept[3]);
+		if(area > bestArea) {
+			bestArea = area;
+			toDrop = drop;
+		}
+	}
+	int keptCount = 0;
+	for(int i = 0; i < MAX_POINTS + 1; i++) {
+		if(i != toDrop) points[keptCount++] = candidates[i];
+	}
+}
+
+void ContactManifold::update(const Part& first, const Part& second, Position intersection, Vec3 exitVector) {
+	double depth = length(exitVector);
+	if(depth == 0.0) return;
+	Vec3 normal = exitVector / depth;
+
+	refreshPoints(first, second, normal);
+
+	Position onFirst = intersection + exitVector * 0.5;
+	Position onSecond = intersection - exitVector * 0.5;
+	ContactPoint newPoint{first.getCFrame().globalToLocal(onFirst), second.getCFrame().globalToLocal(onSecond), intersection, exitVector};
+	addPoint(newPoint, std::min(first.maxRadius, second.maxRadius) * CONTACT_MATCHING_FACTOR);
+}
+
+ContactManifold& ContactManifoldCache::update(const Part& first, const Part& second, Position intersection, Vec3 exitVector) {
+	ContactManifold& manifold = manifolds.getOrAdd(&first, &second, ContactManifold());
+	manifold.update(first, second, intersection, exitVector);
+	return manifold;
+}
+
+const ContactManifold* ContactManifoldCache::getManifold(const Part* first, const Part* second) const {
+	return manifolds.find(first, second);
+}
+
+void ContactManifoldCache::removeStaleEntries() {
+	manifolds.removeStaleEntries();
+}
+
+void ContactManifoldCache::clear() {
+	manifolds.clear();
+}
+};
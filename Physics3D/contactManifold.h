@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+
+#include "math/linalg/vec.h"
+#include "math/position.h"
+#include "partPairMap.h"
+
+namespace P3D {
+class Part;
+
+struct ContactPoint {
+	// the deepest point of each part, local to that part, used to follow the contact as the parts move
+	Vec3 localOnFirst = Vec3(0.0, 0.0, 0.0);
+	Vec3 localOnSecond = Vec3(0.0, 0.0, 0.0);
+	// global, halfway between the two deepest points
+	Position intersection = Position(0.0, 0.0, 0.0);
+	// global, same convention as Colission::exitVector
+	Vec3 exitVector = Vec3(0.0, 0.0, 0.0);
+	// the impulses the contact solver ended with, used to warm start it on the next tick
+	double normalImpulse = 0.0;
+	Vec3 tangentImpulse = Vec3(0.0, 0.0, 0.0);
+
+	ContactPoint() = default;
+	// a new contact, the solver has not given it any impulse yet
+	ContactPoint(const Vec3& localOnFirst, const Vec3& localOnSecond, const Position& intersection, const Vec3& exitVector) :
+		localOnFirst(localOnFirst),
+		localOnSecond(localOnSecond),
+		intersection(intersection),
+		exitVector(exitVector),
+		normalImpulse(0.0),
+		tangentImpulse(0.0, 0.0, 0.0) {}
+};
+
+/*
+	Up to MAX_POINTS contact points between two parts, kept across ticks
+
+	The narrowphase only finds a single point per tick, so resting objects would only be supported at one point at a time.
+	Each tick the points of previous ticks are moved along with the parts, points that separated or slid away are dropped,
+	and the new point is added. When there are too many points the ones spanning the largest area are kept.
+*/
+class ContactManifold {
+public:
+	static constexpr int MAX_POINTS = 4;
+
+	ContactPoint points[MAX_POINTS];
+	int pointCount = 0;
+
+	void update(const Part& first, const Part& second, Position intersection, Vec3 exitVector);
+
+private:
+	void refreshPoints(const Part& first, const Part& second, Vec3 normal);
+	void addPoint(const ContactPoint& newPoint, double matchingDistance);
+};
+
+// the ContactManifolds of every colliding part pair, colissions are handled through these when a world enables them
+class ContactManifoldCache {
+	PartPairMap<ContactManifold> manifolds;
+
+public:
+	ContactManifoldCache() = default;
+	ContactManifoldCache(const ContactManifoldCache&) = delete;
+	ContactManifoldCache& operator=(const ContactManifoldCache&) = delete;
+
+	// adds the colission found this tick to the manifold of the pair
+	ContactManifold& update(const Part& first, const Part& second, Position intersection, Vec3 exitVector);
+	// nullptr if the pair has no manifold
+	const ContactManifold* getManifold(const Part* first, const Part* second) const;
+
+	// removes the manifolds of pairs that did not collide since the previous call, should be called once per tick
+	void removeStaleEntries();
+	void clear();
+
+	std::size_t size() const { return manifolds.size(); }
+};
+};
@@ -0,0 +1,147 @@
+#include "contactSolver.h"
+
+#include "part.h"
+#include "physical.h"
+#include "contactManifold.h"
+#include "misc/debug.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace P3D {
+static Vec3 getPerpendicular(const Vec3& normal) {
+	// crossing with the axis the normal is least aligned with keeps the result well conditioned
+	Vec3 axis = (std::abs(normal.x) < 0.57) ? Vec3(1.0, 0.0, 0.0) : (std::abs(normal.y) < 0.57 ? Vec3(0.0, 1.0, 0.0) : Vec3(0.0, 0.0, 1.0));
+	return normalize(normal % axis);
+}
+
+static SymmetricMat3 getGlobalMomentResponse(const MotorizedPhysical& phys) {
+	return phys.getCFrame().getRotation().localToGlobal(phys.momentResponse);
+}
+
+static Vec3 getVelocityOfPoint(const MotorizedPhysical* phys, const Vec3& relativePoint) {
+	if(phys == nullptr) return Vec3();
+	return phys->motionOfCenterOfMass.getVelocityOfPoint(relativePoint);
+}
+
+// the velocity of the surface of part at point, beyond the rigid motion of its main physical
+static Vec3 getExtraSurfaceVelocity(const Part& part, const MotorizedPhysical* phys, Position point) {
+	if(phys == nullptr) return Vec3();
+	return part.getMotion().getVelocityOfPoint(point - part.getPosition()) - phys->motionOfCenterOfMass.getVelocityOfPoint(point - phys->getCenterOfMass());
+}
+
+SolverContact createSolverContact(const Part& first, const Part& second, bool secondIsTerrain, ContactPoint& point, const ContactSolverSettings& settings, double deltaT) {
+	Debug::logPoint(point.intersection, Debug::INTERSECTION);
+
+	SolverContact contact;
+	MotorizedPhysical* firstPhys = first.getPhysical()->mainPhysical;
+	MotorizedPhysical* secondPhys = secondIsTerrain ? nullptr : second.getPhysical()->mainPhysical;
+	// a sleeping physical holds still like terrain, until updateSleepStates decides whether its island wakes up
+	contact.first = firstPhys->isAsleep ? nullptr : firstPhys;
+	contact.second = (secondPhys != nullptr && secondPhys->isAsleep) ? nullptr : secondPhys;
+	contact.point = &point;
+
+	double depth = length(point.exitVector);
+	contact.normal = point.exitVector / depth;
+	contact.tangents[0] = getPerpendicular(contact.normal);
+	contact.tangents[1] = contact.normal % contact.tangents[0];
+	contact.relativeToFirst = point.intersection - firstPhys->getCenterOfMass();
+	contact.relativeToSecond = (secondPhys != nullptr) ? Vec3(point.intersection - secondPhys->getCenterOfMass()) : Vec3();
+
+	Vec3 directions[3]{contact.normal, contact.tangents[0], contact.tangents[1]};
+	SymmetricMat3 momentResponseFirst = (contact.first != nullptr) ? getGlobalMomentResponse(*contact.first) : SymmetricMat3();
+	SymmetricMat3 momentResponseSecond = (contact.second != nullptr) ? getGlobalMomentResponse(*contact.second) : SymmetricMat3();
+	for(int i = 0; i < 3; i++) {
+		Vec3 d = directions[i];
+		double inverseMass = 0.0;
+		contact.angularResponseFirst[i] = Vec3();
+		contact.angularResponseSecond[i] = Vec3();
+		if(contact.first != nullptr) {
+			Vec3 momentArm = contact.relativeToFirst % d;
+			contact.angularResponseFirst[i] = momentResponseFirst * momentArm;
+			inverseMass += d * (contact.first->forceResponse * d) + momentArm * contact.angularResponseFirst[i];
+		}
+		if(contact.second != nullptr) {
+			Vec3 momentArm = contact.relativeToSecond % d;
+			contact.angularResponseSecond[i] = momentResponseSecond * momentArm;
+			inverseMass += d * (contact.second->forceResponse * d) + momentArm * contact.angularResponseSecond[i];
+		}
+		contact.effectiveMass[i] = (inverseMass > 0.0) ? 1.0 / inverseMass : 0.0;
+	}
+
+	// same conveyor conventions as handleCollision and handleTerrainCollision
+	Vec3 secondConveyor = secondIsTerrain ? second.getCFrame().localToRelative(second.properties.conveyorEffect) : second.properties.conveyorEffect;
+	Vec3 surfaceVelocity = (getExtraSurfaceVelocity(second, contact.second, point.intersection) - secondConveyor) - (getExtraSurfaceVelocity(first, contact.first, point.intersection) - first.properties.conveyorEffect);
+	contact.surfaceVelocity = surfaceVelocity;
+
+	Vec3 relativeVelocity = getVelocityOfPoint(contact.second, contact.relativeToSecond) - getVelocityOfPoint(contact.first, contact.relativeToFirst) + surfaceVelocity;
+	double closingSpeed = -(relativeVelocity * contact.normal);
+	double bouncyness = first.properties.bouncyness * second.properties.bouncyness;
+	double bounceVelocity = (closingSpeed > settings.restitutionThreshold) ? closingSpeed * bouncyness : 0.0;
+	double correctionVelocity = settings.baumgarteFactor / deltaT * std::max(0.0, depth - settings.allowedPenetration);
+	contact.targetNormalVelocity = std::max(bounceVelocity, correctionVelocity);
+	contact.friction = first.properties.friction * second.properties.friction;
+
+	if(settings.usesWarmStarting) {
+		contact.normalImpulse = point.normalImpulse;
+		contact.tangentImpulses[0] = point.tangentImpulse * contact.tangents[0];
+		contact.tangentImpulses[1] = point.tangentImpulse * contact.tangents[1];
+	} else {
+		contact.normalImpulse = 0.0;
+		contact.tangentImpulses[0] = 0.0;
+		contact.tangentImpulses[1] = 0.0;
+	}
+	return contact;
+}
+
+// pushes first by -impulse * direction and second by +impulse * direction
+static void applyImpulse(const SolverContact& contact, int directionIndex, const Vec3& direction, double impulse) {
+	if(contact.first != nullptr) {
+		contact.first->motionOfCenterOfMass.translation.translation[0] -= contact.first->forceResponse * direction * impulse;
+		contact.first->motionOfCenterOfMass.rotation.rotation[0] -= contact.angularResponseFirst[directionIndex] * impulse;
+	}
+	if(contact.second != nullptr) {
+		contact.second->motionOfCenterOfMass.translation.translation[0] += contact.second->forceResponse * direction * impulse;
+		contact.second->motionOfCenterOfMass.rotation.rotation[0] += contact.angularResponseSecond[directionIndex] * impulse;
+	}
+}
+
+static Vec3 getRelativeVelocity(const SolverContact& contact) {
+	return getVelocityOfPoint(contact.second, contact.relativeToSecond) - getVelocityOfPoint(contact.first, contact.relativeToFirst) + contact.surfaceVelocity;
+}
+
+static void solveContact(SolverContact& contact) {
+	// friction first, such that the normal impulse which matters most for stacking is solved last
+	double maxFriction = contact.friction * contact.normalImpulse;
+	for(int i = 0; i < 2; i++) {
+		double tangentVelocity = getRelativeVelocity(contact) * contact.tangents[i];
+		double oldImpulse = contact.tangentImpulses[i];
+		contact.tangentImpulses[i] = std::clamp(oldImpulse - tangentVelocity * contact.effectiveMass[i + 1], -maxFriction, maxFriction);
+		applyImpulse(contact, i + 1, contact.tangents[i], contact.tangentImpulses[i] - oldImpulse);
+	}
+
+	double normalVelocity = getRelativeVelocity(contact) * contact.normal;
+	double oldImpulse = contact.normalImpulse;
+	contact.normalImpulse = std::max(0.0, oldImpulse + (contact.targetNormalVelocity - normalVelocity) * contact.effectiveMass[0]);
+	applyImpulse(contact, 0, contact.normal, contact.normalImpulse - oldImpulse);
+}
+
+void solveContactIsland(std::vector<SolverContact>& contacts, const std::vector<std::size_t>& island, const ContactSolverSettings& settings) {
+	for(std::size_t contactIndex : island) {
+		SolverContact& contact = contacts[contactIndex];
+		applyImpulse(contact, 0, contact.normal, contact.normalImpulse);
+		applyImpulse(contact, 1, contact.tangents[0], contact.tangentImpulses[0]);
+		applyImpulse(contact, 2, contact.tangents[1], contact.tangentImpulses[1]);
+	}
+	for(int iteration = 0; iteration < settings.iterations; iteration++) {
+		for(std::size_t contactIndex : island) {
+			solveContact(contacts[contactIndex]);
+		}
+	}
+	for(std::size_t contactIndex : island) {
+		const SolverContact& contact = contacts[contactIndex];
+		contact.point->normalImpulse = contact.normalImpulse;
+		contact.point->tangentImpulse = contact.tangents[0] * contact.tangentImpulses[0] + contact.tangents[1] * contact.tangentImpulses[1];
+	}
+}
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "math/linalg/vec.h"
+#include "math/linalg/mat.h"
+
+namespace P3D {
+class Part;
+class MotorizedPhysical;
+struct ContactPoint;
+
+// when a world uses sequential impulses, these tune how contacts are resolved, see solveContactIsland
+struct ContactSolverSettings {
+	// passes over every contact of an island per tick, more passes let impulses travel further through stacks
+	int iterations = 10;
+	// the fraction of the penetration beyond allowedPenetration that is pushed out per tick (Baumgarte stabilization)
+	double baumgarteFactor = 0.2;
+	// penetration that is left alone, such that resting parts keep touching and keep their contacts
+	double allowedPenetration = 0.005;
+	// parts that hit each other slower than this don't bounce, such that resting parts don't jitter
+	double restitutionThreshold = 0.5;
+	// apply the impulses the contact points ended with last tick before iterating
+	bool usesWarmStarting = true;
+};
+
+/*
+	A contact point between two physicals prepared for solving
+	first or second is nullptr when that side doesn't move, for terrain and sleeping physicals
+	All vectors are global, normal is the direction in which second is pushed out of first
+*/
+struct SolverContact {
+	MotorizedPhysical* first;
+	MotorizedPhysical* second;
+	ContactPoint* point;
+
+	Vec3 relativeToFirst;
+	Vec3 relativeToSecond;
+	Vec3 normal;
+	Vec3 tangents[2];
+
+	// the change in angular velocity per unit of impulse along normal, tangents[0] and tangents[1]
+	Vec3 angularResponseFirst[3];
+	Vec3 angularResponseSecond[3];
+	// the impulse needed for a unit change in relative velocity along normal, tangents[0] and tangents[1]
+	double effectiveMass[3];
+
+	// velocity of the surface of second relative to that of first that doesn't come from their motion, from conveyors and attached physicals
+	Vec3 surfaceVelocity;
+	double targetNormalVelocity;
+	double friction;
+
+	// accumulated this tick, clamped to stay pushing and within the friction cone
+	double normalImpulse;
+	double tangentImpulses[2];
+};
+
+// second is terrain when secondIsTerrain, point keeps the accumulated impulses across ticks
+SolverContact createSolverContact(const Part& first, const Part& second, bool secondIsTerrain, ContactPoint& point, const ContactSolverSettings& settings, double deltaT);
+
+/*
+	Projected Gauss-Seidel over the given contacts, which must not share moving physicals with contacts outside the island
+	Applies the warm start impulses, iterates, and stores the accumulated impulses back in the contact points for the next tick
+*/
+void solveContactIsland(std::vector<SolverContact>& contacts, const std::vector<std::size_t>& island, const ContactSolverSettings& settings);
+};
@@ -0,0 +1,116 @@
+#include "batchedIntersection.h"
+
+#include "shape.h"
+#include "shapeClass.h"
+#include "builtinShapeClasses.h"
+#include "../misc/cpuid.h"
+
+#include <cmath>
+#include <cassert>
+
+namespace P3D {
+// relative to the size of a pair, far larger than the rounding error of the float computations
+static constexpr float BATCH_MARGIN_FACTOR = 1E-5f;
+
+BoxPairBatch::BoxPairBatch() : rotation{}, position{}, halfExtentsFirst{}, halfExtentsSecond{}, margin{} {}
+
+void BoxPairBatch::setLane(std::size_t lane, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond) {
+	Mat3 rot = relativeTransform.rotation.asRotationMatrix();
+	double size = 0.0;
+	for(int i = 0; i < 3; i++) {
+		for(int j = 0; j < 3; j++) {
+			rotation[i][j][lane] = static_cast<float>(rot(i, j));
+		}
+		position[i][lane] = static_cast<float>(relativeTransform.position[i]);
+		halfExtentsFirst[i][lane] = static_cast<float>(scaleFirst[i]);
+		halfExtentsSecond[i][lane] = static_cast<float>(scaleSecond[i]);
+		size += std::abs(relativeTransform.position[i]) + scaleFirst[i] + scaleSecond[i];
+	}
+	margin[lane] = static_cast<float>(size) * BATCH_MARGIN_FACTOR;
+}
+
+int findSeparatedBoxPairsFallback(const BoxPairBatch& b) {
+	int result = 0;
+	for(std::size_t lane = 0; lane < INTERSECTION_BATCH_LANES; lane++) {
+		float r[3][3];
+		float absR[3][3];
+		for(int i = 0; i < 3; i++) {
+			for(int j = 0; j < 3; j++) {
+				r[i][j] = b.rotation[i][j][lane];
+				absR[i][j] = std::abs(r[i][j]);
+			}
+		}
+		const float t[3]{b.position[0][lane], b.position[1][lane], b.position[2][lane]};
+		const float h1[3]{b.halfExtentsFirst[0][lane], b.halfExtentsFirst[1][lane], b.halfExtentsFirst[2][lane]};
+		const float h2[3]{b.halfExtentsSecond[0][lane], b.halfExtentsSecond[1][lane], b.halfExtentsSecond[2][lane]};
+		float margin = b.margin[lane];
+
+		bool separated = false;
+		for(int i = 0; i < 3; i++) {
+			float radius = h1[i] + h2[0] * absR[i][0] + h2[1] * absR[i][1] + h2[2] * absR[i][2];
+			separated |= std::abs(t[i]) > radius + margin;
+		}
+		for(int j = 0; j < 3; j++) {
+			float radius = h2[j] + h1[0] * absR[0][j] + h1[1] * absR[1][j] + h1[2] * absR[2][j];
+			float dist = t[0] * r[0][j] + t[1] * r[1][j] + t[2] * r[2][j];
+			separated |= std::abs(dist) > radius + margin;
+		}
+		for(int i = 0; i < 3; i++) {
+			int i1 = (i + 1) % 3;
+			int i2 = (i + 2) % 3;
+			for(int j = 0; j < 3; j++) {
+				int j1 = (j + 1) % 3;
+				int j2 = (j + 2) % 3;
+				float radius = h1[i1] * absR[i2][j] + h1[i2] * absR[i1][j] + h2[j1] * absR[i][j2] + h2[j2] * absR[i][j1];
+				float dist = t[i2] * r[i1][j] - t[i1] * r[i2][j];
+				separated |= std::abs(dist) > radius + margin;
+			}
+		}
+		if(separated) result |= 1 << lane;
+	}
+	return result;
+}
+
+int findSeparatedBoxPairs(const BoxPairBatch& batch) {
+	if(CPUIDCheck::hasTechnology(CPUIDCheck::AVX | CPUIDCheck::AVX2)) return findSeparatedBoxPairsAVX(batch);
+	return findSeparatedBoxPairsFallback(batch);
+}
+
+static void intersectBoxPairsBatched(const Shape* const* first, const Shape* const* second, const CFrame* relativeTransforms, std::size_t count, std::optional<Intersection>* results) {
+	for(std::size_t batchStart = 0; batchStart < count; batchStart += INTERSECTION_BATCH_LANES) {
+		std::size_t batchSize = std::min(INTERSECTION_BATCH_LANES, count - batchStart);
+		BoxPairBatch batch;
+		for(std::size_t lane = 0; lane < batchSize; lane++) {
+			std::size_t i = batchStart + lane;
+			batch.setLane(lane, relativeTransforms[i], first[i]->scale, second[i]->scale);
+		}
+		int separated = findSeparatedBoxPairs(batch);
+		for(std::size_t lane = 0; lane < batchSize; lane++) {
+			std::size_t i = batchStart + lane;
+			if(separated & (1 << lane)) {
+				results[i] = std::optional<Intersection>();
+			} else {
+				results[i] = intersectsTransformed(*first[i], *second[i], relativeTransforms[i]);
+			}
+		}
+	}
+}
+
+void intersectsTransformedBatch(const Shape* const* first, const Shape* const* second, const CFrame* relativeTransforms, std::size_t count, std::optional<Intersection>* results) {
+	if(count == 0) return;
+	std::size_t firstClassID = first[0]->baseShape->intersectionClassID;
+	std::size_t secondClassID = second[0]->baseShape->intersectionClassID;
+	for(std::size_t i = 1; i < count; i++) {
+		assert(first[i]->baseShape->intersectionClassID == firstClassID);
+		assert(second[i]->baseShape->intersectionClassID == secondClassID);
+	}
+
+	if(firstClassID == CUBE_CLASS_ID && secondClassID == CUBE_CLASS_ID) {
+		intersectBoxPairsBatched(first, second, relativeTransforms, count, results);
+	} else {
+		for(std::size_t i = 0; i < count; i++) {
+			results[i] = intersectsTransformed(*first[i], *second[i], relativeTransforms[i]);
+		}
+	}
+}
+};
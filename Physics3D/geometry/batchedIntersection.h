@@ -0,0 +1,43 @@
+#pragma once
+
+#include <optional>
+#include <cstddef>
+
+#include "intersection.h"
+
+namespace P3D {
+class Shape;
+
+static constexpr std::size_t INTERSECTION_BATCH_LANES = 8;
+
+/*
+	Structure of arrays form of up to 8 box-box pairs, such that the separating axis tests of all of them can run in lockstep
+	Everything is local to the first box of each pair, converted to float
+	Unused lanes must be zero, they are never reported as separated
+*/
+struct alignas(32) BoxPairBatch {
+	// rotation[i][j] is component i of axis j of the second box
+	float rotation[3][3][INTERSECTION_BATCH_LANES];
+	float position[3][INTERSECTION_BATCH_LANES];
+	float halfExtentsFirst[3][INTERSECTION_BATCH_LANES];
+	float halfExtentsSecond[3][INTERSECTION_BATCH_LANES];
+	// added to the projected radii of every axis, such that the rounding to float can only make a test more conservative
+	float margin[INTERSECTION_BATCH_LANES];
+
+	BoxPairBatch();
+	void setLane(std::size_t lane, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond);
+};
+
+// bit i of the result is set if the boxes of lane i are certainly separated, pairs that are not may still be separated by a small margin
+int findSeparatedBoxPairs(const BoxPairBatch& batch);
+int findSeparatedBoxPairsFallback(const BoxPairBatch& batch);
+int findSeparatedBoxPairsAVX(const BoxPairBatch& batch);
+
+/*
+	Same results as intersectsTransformed(*first[i], *second[i], relativeTransforms[i]) for every i
+	All pairs must have the same combination of intersectionClassIDs
+	Box pairs are first run through the batched separating axis test, only the pairs it can't reject are intersected one by one
+	Other combinations are intersected one by one, GJK's support queries are per shape, so there is little to gain from running it in lockstep
+*/
+void intersectsTransformedBatch(const Shape* const* first, const Shape* const* second, const CFrame* relativeTransforms, std::size_t count, std::optional<Intersection>* results);
+};
@@ -0,0 +1,65 @@
+#include "batchedIntersection.h"
+
+#include <immintrin.h>
+
+// AVX implementation of findSeparatedBoxPairs, every lane holds one pair
+namespace P3D {
+static_assert(INTERSECTION_BATCH_LANES == 8, "the AVX implementation requires 8 lanes");
+
+namespace {
+inline __m256 abs(__m256 v) {
+	return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v);
+}
+inline __m256 isFurtherThan(__m256 dist, __m256 radius) {
+	return _mm256_cmp_ps(abs(dist), radius, _CMP_GT_OQ);
+}
+};
+
+int findSeparatedBoxPairsAVX(const BoxPairBatch& b) {
+	__m256 r[3][3];
+	__m256 absR[3][3];
+	for(int i = 0; i < 3; i++) {
+		for(int j = 0; j < 3; j++) {
+			r[i][j] = _mm256_load_ps(b.rotation[i][j]);
+			absR[i][j] = abs(r[i][j]);
+		}
+	}
+	__m256 t[3];
+	__m256 h1[3];
+	__m256 h2[3];
+	for(int i = 0; i < 3; i++) {
+		t[i] = _mm256_load_ps(b.position[i]);
+		h1[i] = _mm256_load_ps(b.halfExtentsFirst[i]);
+		h2[i] = _mm256_load_ps(b.halfExtentsSecond[i]);
+	}
+	__m256 margin = _mm256_load_ps(b.margin);
+
+	__m256 separated = _mm256_setzero_ps();
+	// faces of the first box
+	for(int i = 0; i < 3; i++) {
+		__m256 radius = _mm256_add_ps(_mm256_add_ps(h1[i], margin), _mm256_add_ps(_mm256_mul_ps(h2[0], absR[i][0]), _mm256_add_ps(_mm256_mul_ps(h2[1], absR[i][1]), _mm256_mul_ps(h2[2], absR[i][2]))));
+		separated = _mm256_or_ps(separated, isFurtherThan(t[i], radius));
+	}
+	// faces of the second box
+	for(int j = 0; j < 3; j++) {
+		__m256 radius = _mm256_add_ps(_mm256_add_ps(h2[j], margin), _mm256_add_ps(_mm256_mul_ps(h1[0], absR[0][j]), _mm256_add_ps(_mm256_mul_ps(h1[1], absR[1][j]), _mm256_mul_ps(h1[2], absR[2][j]))));
+		__m256 dist = _mm256_add_ps(_mm256_mul_ps(t[0], r[0][j]), _mm256_add_ps(_mm256_mul_ps(t[1], r[1][j]), _mm256_mul_ps(t[2], r[2][j])));
+		separated = _mm256_or_ps(separated, isFurtherThan(dist, radius));
+	}
+	// edge pairs, the axes are not normalized, which does not change the outcome
+	for(int i = 0; i < 3; i++) {
+		int i1 = (i + 1) % 3;
+		int i2 = (i + 2) % 3;
+		for(int j = 0; j < 3; j++) {
+			int j1 = (j + 1) % 3;
+			int j2 = (j + 2) % 3;
+			__m256 radiusFirst = _mm256_add_ps(_mm256_mul_ps(h1[i1], absR[i2][j]), _mm256_mul_ps(h1[i2], absR[i1][j]));
+			__m256 radiusSecond = _mm256_add_ps(_mm256_mul_ps(h2[j1], absR[i][j2]), _mm256_mul_ps(h2[j2], absR[i][j1]));
+			__m256 radius = _mm256_add_ps(_mm256_add_ps(radiusFirst, radiusSecond), margin);
+			__m256 dist = _mm256_sub_ps(_mm256_mul_ps(t[i2], r[i1][j]), _mm256_mul_ps(t[i1], r[i2][j]));
+			separated = _mm256_or_ps(separated, isFurtherThan(dist, radius));
+		}
+	}
+	return _mm256_movemask_ps(separated);
+}
+};
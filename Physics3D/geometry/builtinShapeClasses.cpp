@@ -4,6 +4,13 @@
 #include "shapeLibrary.h"
 #include "../math/constants.h"
 
+#include <limits>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <array>
+#include <utility>
+
 
 namespace P3D {
 #pragma region CubeClass
@@ -496,6 +503,154 @@ Vec3f PolyhedronShapeClassFallback::furthestInDirection(const Vec3f& direction)
 }
 #pragma endregion
 
+#pragma region PolyhedronShapeClassHillClimbing
+PolyhedronShapeClassHillClimbing::PolyhedronShapeClassHillClimbing(Polyhedron&& poly) : PolyhedronShapeClass(std::move(poly)), canWalk(this->poly.isConvex()), startVertex(0) {
+	int vertexCount = this->poly.vertexCount;
+
+	// meshes often repeat a vertex for every face it is part of, the walk must be able to cross between those faces
+	std::vector<int> weldedIndex(vertexCount);
+	std::map<std::array<float, 3>, int> firstAtPosition;
+	for(int i = 0; i < vertexCount; i++) {
+		Vec3f v = this->poly.getVertex(i);
+		weldedIndex[i] = firstAtPosition.try_emplace(std::array<float, 3>{v.x, v.y, v.z}, i).first->second;
+	}
+
+	std::vector<std::vector<int>> neighbors(vertexCount);
+	std::set<std::pair<int, int>> edges;
+	for(int i = 0; i < this->poly.triangleCount; i++) {
+		Triangle t = this->poly.getTriangle(i);
+		for(int side = 0; side < 3; side++) {
+			int a = weldedIndex[t[side]];
+			int b = weldedIndex[t[(side + 1) % 3]];
+			if(a == b) continue;
+			// every edge of a closed mesh is shared by two triangles, in opposite directions, so only storing a->b still links both ways
+			neighbors[a].push_back(b);
+			edges.emplace(a, b);
+		}
+	}
+	for(const std::pair<int, int>& edge : edges) {
+		if(edges.count(std::make_pair(edge.second, edge.first)) == 0) {
+			canWalk = false;
+			break;
+		}
+	}
+
+	adjacencyStart.reserve(vertexCount + 1);
+	adjacencyStart.push_back(0);
+	for(const std::vector<int>& n : neighbors) {
+		adjacentVertices.insert(adjacentVertices.end(), n.begin(), n.end());
+		adjacencyStart.push_back(static_cast<int>(adjacentVertices.size()));
+	}
+	// vertices that are not part of any triangle can't be walked away from
+	if(this->poly.triangleCount > 0) startVertex = weldedIndex[this->poly.getTriangle(0)[0]];
+}
+
+int PolyhedronShapeClassHillClimbing::furthestIndexInDirection(const Vec3f& direction) const {
+	return furthestIndexInDirection(direction, startVertex);
+}
+
+int PolyhedronShapeClassHillClimbing::furthestIndexInDirection(const Vec3f& direction, int startHint) const {
+	if(!canWalk) return poly.furthestIndexInDirection(direction);
+	// unwelded copies and loose vertices have no neighbors, a walk from those would end right away
+	bool hasNeighbors = startHint >= 0 && startHint < poly.vertexCount && adjacencyStart[startHint] != adjacencyStart[startHint + 1];
+	int current = hasNeighbors ? startHint : startVertex;
+	float currentDist = poly.getVertex(current) * direction;
+	while(true) {
+		int best = current;
+		float bestDist = currentDist;
+		for(int i = adjacencyStart[current]; i < adjacencyStart[current + 1]; i++) {
+			int neighbor = adjacentVertices[i];
+			float dist = poly.getVertex(neighbor) * direction;
+			if(dist > bestDist) {
+				best = neighbor;
+				bestDist = dist;
+			}
+		}
+		if(best == current) break;
+		current = best;
+		currentDist = bestDist;
+	}
+	return current;
+}
+
+Vec3f PolyhedronShapeClassHillClimbing::furthestInDirection(const Vec3f& direction) const {
+	return poly.getVertex(furthestIndexInDirection(direction));
+}
+#pragma endregion
+
+#pragma region TriangleMeshShapeClass
+TriangleMeshShapeClass::TriangleMeshShapeClass(TriangleMesh&& mesh) : ShapeClass(8, Vec3(0, 0, 0), ScalableInertialMatrix(Vec3(8.0 / 3.0, 8.0 / 3.0, 8.0 / 3.0), Vec3(0, 0, 0)), TRIANGLE_MESH_CLASS_ID), mesh(std::move(mesh)), bvh(this->mesh) {}
+
+bool TriangleMeshShapeClass::containsPoint(Vec3) const {
+	return false;
+}
+
+// Möller-Trumbore, the same test as TriangleMesh::getIntersectionDistance
+static double rayTriangleDistance(const Vec3& origin, const Vec3& direction, const Vec3& v0, const Vec3& v1, const Vec3& v2) {
+	const double EPSILON = 0.0000001;
+	Vec3 edge1 = v1 - v0;
+	Vec3 edge2 = v2 - v0;
+	Vec3 h = direction % edge2;
+	double a = edge1 * h;
+	if(a > -EPSILON && a < EPSILON) return std::numeric_limits<double>::max();
+
+	Vec3 s = origin - v0;
+	double f = 1.0 / a;
+	double u = f * (s * h);
+	if(u < 0.0 || u > 1.0) return std::numeric_limits<double>::max();
+
+	Vec3 q = s % edge1;
+	double v = direction * f * q;
+	if(v < 0.0 || u + v > 1.0) return std::numeric_limits<double>::max();
+
+	double r = edge2 * f * q;
+	return (r > EPSILON) ? r : std::numeric_limits<double>::max();
+}
+
+double TriangleMeshShapeClass::getIntersectionDistance(Vec3 origin, Vec3 direction) const {
+	double best = std::numeric_limits<double>::max();
+	bvh.forEachAlongRay(Vec3f(origin), Vec3f(direction), [&](int triangleIndex) {
+		Triangle t = mesh.getTriangle(triangleIndex);
+		best = std::min(best, rayTriangleDistance(origin, direction, Vec3(mesh.getVertex(t.firstIndex)), Vec3(mesh.getVertex(t.secondIndex)), Vec3(mesh.getVertex(t.thirdIndex))));
+	});
+	return best;
+}
+BoundingBox TriangleMeshShapeClass::getBounds(const Rotation& rotation, const DiagonalMat3& scale) const {
+	return mesh.getBounds(Mat3f(rotation.asRotationMatrix() * scale));
+}
+double TriangleMeshShapeClass::getScaledMaxRadius(DiagonalMat3 scale) const {
+	return mesh.getScaledMaxRadius(scale);
+}
+double TriangleMeshShapeClass::getScaledMaxRadiusSq(DiagonalMat3 scale) const {
+	return mesh.getScaledMaxRadiusSq(scale);
+}
+Vec3f TriangleMeshShapeClass::furthestInDirection(const Vec3f& direction) const {
+	return mesh.furthestInDirection(direction);
+}
+Polyhedron TriangleMeshShapeClass::asPolyhedron() const {
+	return Polyhedron(mesh);
+}
+
+TriangleCollidable::TriangleCollidable(const TriangleMesh& mesh, int triangleIndex) {
+	Triangle t = mesh.getTriangle(triangleIndex);
+	vertices[0] = mesh.getVertex(t.firstIndex);
+	vertices[1] = mesh.getVertex(t.secondIndex);
+	vertices[2] = mesh.getVertex(t.thirdIndex);
+}
+
+Vec3f TriangleCollidable::getNormal() const {
+	return normalize((vertices[1] - vertices[0]) % (vertices[2] - vertices[0]));
+}
+
+Vec3f TriangleCollidable::furthestInDirection(const Vec3f& direction) const {
+	float d0 = vertices[0] * direction;
+	float d1 = vertices[1] * direction;
+	float d2 = vertices[2] * direction;
+	if(d0 >= d1 && d0 >= d2) return vertices[0];
+	return (d1 >= d2) ? vertices[1] : vertices[2];
+}
+#pragma endregion
+
 const CubeClass CubeClass::instance;
 const SphereClass SphereClass::instance;
 const CylinderClass CylinderClass::instance;
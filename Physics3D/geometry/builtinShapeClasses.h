@@ -1,7 +1,10 @@
 #pragma once
 
+#include <vector>
+
 #include "polyhedron.h"
 #include "shapeClass.h"
+#include "triangleBVH.h"
 
 namespace P3D {
 #define CUBE_CLASS_ID 0
@@ -10,6 +13,7 @@ namespace P3D {
 #define WEDGE_CLASS_ID 3
 #define CORNER_CLASS_ID 4
 #define CONVEX_POLYHEDRON_CLASS_ID 10
+#define TRIANGLE_MESH_CLASS_ID 11
 
 
 class CubeClass : public ShapeClass {
@@ -135,4 +139,71 @@ public:
 	virtual BoundingBox getBounds(const Rotation& rotation, const DiagonalMat3& scale) const override;
 	virtual Vec3f furthestInDirection(const Vec3f& direction) const override;
 };
-};
\ No newline at end of file
+
+// below this many vertices a SIMD scan over all vertices beats hill climbing, measured with supportMappingBenchmark
+#define HILL_CLIMBING_MIN_VERTEX_COUNT 1024
+
+/*
+	Answers furthestInDirection by walking from vertex to neighboring vertex for as long as that brings it further in the direction
+	On a convex polyhedron this always ends at the furthest vertex, and it only visits the vertices along the way
+	Coincident vertices are welded for the walk, concave meshes and meshes that are still not closed after that are scanned instead
+	polyhedronShape only picks this class for convex polyhedra of at least HILL_CLIMBING_MIN_VERTEX_COUNT vertices
+*/
+class PolyhedronShapeClassHillClimbing : public PolyhedronShapeClass {
+	// the neighbors of vertex i are adjacentVertices[adjacencyStart[i] .. adjacencyStart[i + 1]]
+	std::vector<int> adjacencyStart;
+	std::vector<int> adjacentVertices;
+	// false when the mesh is concave or the welded mesh has edges that belong to only one triangle, a walk could get stuck at those
+	bool canWalk;
+	// walks without a hint all start here, so the result never depends on earlier queries
+	int startVertex;
+
+public:
+	PolyhedronShapeClassHillClimbing(Polyhedron&& poly);
+
+	int furthestIndexInDirection(const Vec3f& direction) const;
+	/*
+		Starts the walk at startHint, usually the result of the previous query in a similar direction, such as in consecutive GJK iterations
+		Hints that are not the result of an earlier query on this shape are replaced by the default start
+	*/
+	int furthestIndexInDirection(const Vec3f& direction, int startHint) const;
+	virtual Vec3f furthestInDirection(const Vec3f& direction) const override;
+};
+
+/*
+	A static, possibly concave soup of triangles, meant for large terrain geometry that would otherwise take many convex parts
+	Triangles are one sided, their front is given by their winding order like the faces of a polyhedron
+	The narrowphase only tests the triangles whose bounds overlap the other shape, see intersectsTriangleMesh
+	A soup has no interior, so the mass properties are those of its bounding box, parts of this shape belong in the terrain
+*/
+class TriangleMeshShapeClass : public ShapeClass {
+	TriangleMesh mesh;
+	TriangleBVH bvh;
+
+public:
+	TriangleMeshShapeClass(TriangleMesh&& mesh);
+
+	const TriangleMesh& getMesh() const { return mesh; }
+	const TriangleBVH& getBVH() const { return bvh; }
+
+	// always false, a soup has no inside
+	virtual bool containsPoint(Vec3 point) const override;
+	virtual double getIntersectionDistance(Vec3 origin, Vec3 direction) const override;
+	virtual BoundingBox getBounds(const Rotation& rotation, const DiagonalMat3& scale) const override;
+	virtual double getScaledMaxRadius(DiagonalMat3 scale) const override;
+	virtual double getScaledMaxRadiusSq(DiagonalMat3 scale) const override;
+	// the support of the convex hull, only used by the generic intersection code, which the narrowphase bypasses for this class
+	virtual Vec3f furthestInDirection(const Vec3f& direction) const override;
+	virtual Polyhedron asPolyhedron() const override;
+};
+
+// one triangle of a TriangleMeshShapeClass as a convex shape for GJK
+struct TriangleCollidable : public GenericCollidable {
+	Vec3f vertices[3];
+
+	TriangleCollidable(const TriangleMesh& mesh, int triangleIndex);
+
+	Vec3f getNormal() const;
+	virtual Vec3f furthestInDirection(const Vec3f& direction) const override;
+};
+};
@@ -3,9 +3,38 @@
 #include "../misc/debug.h"
 #include "genericIntersection.h"
 
+#include <limits>
+#include <algorithm>
+
 namespace P3D {
+static int histogramBucket(int iterations) {
+	int bucket = 0;
+	while(iterations > 0 && bucket < EPAStatistics::HISTOGRAM_BUCKETS - 1) {
+		iterations >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+void EPAStatistics::addRun(int iterations, int vertexCount, int triangleCount) {
+	highestVertexCount = std::max(highestVertexCount, vertexCount);
+	highestTriangleCount = std::max(highestTriangleCount, triangleCount);
+	iterationHistogram[histogramBucket(iterations)]++;
+}
+
+void EPAStatistics::add(const EPAStatistics& other) {
+	highestVertexCount = std::max(highestVertexCount, other.highestVertexCount);
+	highestTriangleCount = std::max(highestTriangleCount, other.highestTriangleCount);
+	growthCount += other.growthCount;
+	limitReachedCount += other.limitReachedCount;
+	for(int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+		iterationHistogram[i] += other.iterationHistogram[i];
+	}
+}
+
 ComputationBuffers::ComputationBuffers(int initialVertCount, int initialTriangleCount) :
-	vertexCapacity(initialVertCount), triangleCapacity(initialTriangleCount) {
+	vertexCapacity(initialVertCount), triangleCapacity(initialTriangleCount),
+	vertexCapacityLimit(std::numeric_limits<int>::max()), triangleCapacityLimit(std::numeric_limits<int>::max()) {
 	createVertexBuffersUnsafe(initialVertCount);
 	createTriangleBuffersUnsafe(initialTriangleCount);
 }
@@ -15,12 +44,57 @@ void ComputationBuffers::ensureCapacity(int vertCapacity, int triangleCapacity)
 		Debug::log("Increasing vertex buffer capacity from %d to %d", this->vertexCapacity, vertCapacity);
 		deleteVertexBuffers();
 		createVertexBuffersUnsafe(vertCapacity);
+		statistics.growthCount++;
 	}
 	if(this->triangleCapacity < triangleCapacity) {
 		Debug::log("Increasing vertex buffer capacity from %d to %d", this->triangleCapacity, triangleCapacity);
 		deleteTriangleBuffers();
 		createTriangleBuffersUnsafe(triangleCapacity);
+		statistics.growthCount++;
+	}
+}
+
+template<typename T>
+static void copyInto(T*& buffer, int count, int newCapacity) {
+	T* newBuffer = new T[newCapacity];
+	std::copy(buffer, buffer + count, newBuffer);
+	delete[] buffer;
+	buffer = newBuffer;
+}
+
+static int grownCapacity(int capacity, int needed, int limit) {
+	return std::min(limit, std::max(needed, capacity * 2));
+}
+
+bool ComputationBuffers::ensureRoomForPoint(int vertexCount, int triangleCount) {
+	// adding a point to a closed convex shape adds two triangles, the temporary buffers never hold more than the triangle count
+	int neededVertices = vertexCount + 1;
+	int neededTriangles = triangleCount + 2;
+	if(neededVertices > vertexCapacityLimit || neededTriangles > triangleCapacityLimit) {
+		statistics.limitReachedCount++;
+		return false;
+	}
+	if(neededVertices <= this->vertexCapacity && neededTriangles <= this->triangleCapacity) return true;
+
+	if(neededVertices > this->vertexCapacity) {
+		int newCapacity = grownCapacity(this->vertexCapacity, neededVertices, vertexCapacityLimit);
+		Debug::log("Increasing vertex buffer capacity from %d to %d", this->vertexCapacity, newCapacity);
+		copyInto(vertBuf, vertexCount, newCapacity);
+		copyInto(knownVecs, vertexCount, newCapacity);
+		this->vertexCapacity = newCapacity;
+		statistics.growthCount++;
+	}
+	if(neededTriangles > this->triangleCapacity) {
+		int newCapacity = grownCapacity(this->triangleCapacity, neededTriangles, triangleCapacityLimit);
+		Debug::log("Increasing triangle buffer capacity from %d to %d", this->triangleCapacity, newCapacity);
+		copyInto(triangleBuf, triangleCount, newCapacity);
+		copyInto(neighborBuf, triangleCount, newCapacity);
+		copyInto(edgeBuf, 0, newCapacity);
+		copyInto(removalBuf, 0, newCapacity);
+		this->triangleCapacity = newCapacity;
+		statistics.growthCount++;
 	}
+	return true;
 }
 
 ComputationBuffers::~ComputationBuffers() {
@@ -53,4 +127,59 @@ void ComputationBuffers::deleteTriangleBuffers() {
 	delete[] edgeBuf;
 	delete[] removalBuf;
 }
-};
\ No newline at end of file
+
+static thread_local ComputationBuffers* activeBuffers = nullptr;
+
+ComputationBuffers& getThreadComputationBuffers() {
+	if(activeBuffers != nullptr) return *activeBuffers;
+	// only allocated on threads that intersect without buffers of their own
+	static thread_local ComputationBuffers defaultBuffers(DEFAULT_EPA_VERTEX_CAPACITY, DEFAULT_EPA_TRIANGLE_CAPACITY);
+	return defaultBuffers;
+}
+
+UseComputationBuffers::UseComputationBuffers(ComputationBuffers& buffers) : previous(activeBuffers) {
+	activeBuffers = &buffers;
+}
+UseComputationBuffers::~UseComputationBuffers() {
+	activeBuffers = previous;
+}
+
+EPAArenas::EPAArenas() : EPAArenas(DEFAULT_EPA_VERTEX_CAPACITY, DEFAULT_EPA_TRIANGLE_CAPACITY) {}
+EPAArenas::EPAArenas(int initialVertexCapacity, int initialTriangleCapacity) :
+	initialVertexCapacity(initialVertexCapacity),
+	initialTriangleCapacity(initialTriangleCapacity),
+	vertexCapacityLimit(std::numeric_limits<int>::max()),
+	triangleCapacityLimit(std::numeric_limits<int>::max()) {}
+
+void EPAArenas::reserveSlots(std::size_t slotCount) {
+	while(slots.size() < slotCount) {
+		std::unique_ptr<ComputationBuffers> newSlot = std::make_unique<ComputationBuffers>(initialVertexCapacity, initialTriangleCapacity);
+		newSlot->vertexCapacityLimit = vertexCapacityLimit;
+		newSlot->triangleCapacityLimit = triangleCapacityLimit;
+		slots.push_back(std::move(newSlot));
+	}
+}
+
+void EPAArenas::setCapacityLimit(int vertexCapacityLimit, int triangleCapacityLimit) {
+	this->vertexCapacityLimit = vertexCapacityLimit;
+	this->triangleCapacityLimit = triangleCapacityLimit;
+	for(std::unique_ptr<ComputationBuffers>& slot : slots) {
+		slot->vertexCapacityLimit = vertexCapacityLimit;
+		slot->triangleCapacityLimit = triangleCapacityLimit;
+	}
+}
+
+EPAStatistics EPAArenas::getStatistics() const {
+	EPAStatistics result;
+	for(const std::unique_ptr<ComputationBuffers>& slot : slots) {
+		result.add(slot->statistics);
+	}
+	return result;
+}
+
+void EPAArenas::resetStatistics() {
+	for(std::unique_ptr<ComputationBuffers>& slot : slots) {
+		slot->statistics = EPAStatistics();
+	}
+}
+};
@@ -3,9 +3,35 @@
 #include "../math/linalg/vec.h"
 #include "convexShapeBuilder.h"
 
+#include <vector>
+#include <memory>
+#include <cstddef>
+
 namespace P3D {
 struct MinkowskiPointIndices;
 
+#define DEFAULT_EPA_VERTEX_CAPACITY 1000
+#define DEFAULT_EPA_TRIANGLE_CAPACITY 2000
+
+// kept per buffer, such that threads never share the counters
+struct EPAStatistics {
+	static constexpr int HISTOGRAM_BUCKETS = 9;
+
+	int highestVertexCount = 0;
+	int highestTriangleCount = 0;
+	long long growthCount = 0;
+	// the number of EPA runs that were cut short because the buffers could not grow past their limit
+	long long limitReachedCount = 0;
+	/*
+		iterationHistogram[0] counts the EPA runs that finished in their first iteration, iterationHistogram[i] those that took [2^(i-1), 2^i) iterations
+		Every iteration but the last adds a vertex, so this is also the histogram of the number of vertices added to the starting tetrahedron
+	*/
+	long long iterationHistogram[HISTOGRAM_BUCKETS]{};
+
+	void addRun(int iterations, int vertexCount, int triangleCount);
+	void add(const EPAStatistics& other);
+};
+
 struct ComputationBuffers {
 	Vec3f* vertBuf;
 	Triangle* triangleBuf;
@@ -17,8 +43,19 @@ struct ComputationBuffers {
 	int vertexCapacity;
 	int triangleCapacity;
 
+	// ensureRoomForPoint refuses shapes larger than these
+	int vertexCapacityLimit;
+	int triangleCapacityLimit;
+
+	EPAStatistics statistics;
+
 	ComputationBuffers(int initialVertCount, int initialTriangleCount);
 	void ensureCapacity(int vertCapacity, int triangleCapacity);
+	/*
+		Grows the buffers such that a point can be added to a shape of vertexCount vertices and triangleCount triangles, the used part of the buffers is kept
+		Returns false if the shape would exceed the capacity limits, even if the buffers happen to be large enough
+	*/
+	bool ensureRoomForPoint(int vertexCount, int triangleCount);
 
 	~ComputationBuffers();
 
@@ -33,4 +70,46 @@ private:
 	void deleteVertexBuffers();
 	void deleteTriangleBuffers();
 };
-};
\ No newline at end of file
+
+// the buffers set by the innermost UseComputationBuffers on this thread, or a thread local default when there is none
+ComputationBuffers& getThreadComputationBuffers();
+
+// makes the intersection functions on this thread use the given buffers for as long as it exists
+class UseComputationBuffers {
+	ComputationBuffers* previous;
+public:
+	explicit UseComputationBuffers(ComputationBuffers& buffers);
+	~UseComputationBuffers();
+
+	UseComputationBuffers(const UseComputationBuffers&) = delete;
+	UseComputationBuffers& operator=(const UseComputationBuffers&) = delete;
+};
+
+/*
+	One set of ComputationBuffers per worker slot of a ThreadPool
+	These are kept when the pool is recreated, so the buffers are only allocated once and keep the size they grew to
+*/
+class EPAArenas {
+	std::vector<std::unique_ptr<ComputationBuffers>> slots;
+	int initialVertexCapacity;
+	int initialTriangleCapacity;
+	int vertexCapacityLimit;
+	int triangleCapacityLimit;
+
+public:
+	EPAArenas();
+	EPAArenas(int initialVertexCapacity, int initialTriangleCapacity);
+
+	// allocates the buffers of the first slotCount slots, may not be called while the slots are in use
+	void reserveSlots(std::size_t slotCount);
+	std::size_t getSlotCount() const { return slots.size(); }
+	ComputationBuffers& getSlot(std::size_t slot) { return *slots[slot]; }
+
+	// EPA runs that would need more are cut short, their result is the best estimate found so far
+	void setCapacityLimit(int vertexCapacityLimit, int triangleCapacityLimit);
+
+	// the combined statistics of all slots
+	EPAStatistics getStatistics() const;
+	void resetStatistics();
+};
+};
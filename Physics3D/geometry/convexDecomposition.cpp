@@ -0,0 +1,601 @@
+#include "convexDecomposition.h"
+
+#include "convexShapeBuilder.h"
+#include "shapeCreation.h"
+#include "../math/boundingBox.h"
+#include "../math/utils.h"
+#include "../misc/serialization/serializeBasicTypes.h"
+#include "../misc/serialization/serialization.h"
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+
+namespace P3D {
+// bump when the algorithm changes, such that stale cache files are no longer found
+#define CONVEX_DECOMPOSITION_VERSION 1
+#define CONVEX_DECOMPOSITION_FILE_MAGIC 0x48443350 // "P3DH"
+
+// a fixed pseudo random offset in [-1, 1] for every point
+static float jitter(int index, int axis) {
+	std::uint32_t x = static_cast<std::uint32_t>(index) * 3u + static_cast<std::uint32_t>(axis) + 1u;
+	x *= 2654435761u;
+	x ^= x >> 16;
+	x *= 2246822519u;
+	x ^= x >> 13;
+	return static_cast<float>(x & 0xFFFF) / 32767.5f - 1.0f;
+}
+
+Polyhedron convexHull(const Vec3f* originalPoints, int pointCount, float epsilon) {
+	if(pointCount < 4) throw "A convex hull needs at least 4 points";
+
+	// points on a grid are often exactly coplanar, which makes the visibility tests of ConvexShapeBuilder depend on rounding
+	std::vector<Vec3f> jitteredPoints(pointCount);
+	for(int i = 0; i < pointCount; i++) {
+		jitteredPoints[i] = originalPoints[i] + Vec3f(jitter(i, 0), jitter(i, 1), jitter(i, 2)) * (epsilon * 0.25f);
+	}
+	const Vec3f* points = jitteredPoints.data();
+
+	// the starting tetrahedron is made of points that are far apart, such that few points end up above it
+	int a = 0;
+	for(int i = 1; i < pointCount; i++) {
+		if(points[i].x < points[a].x) a = i;
+	}
+	int b = a;
+	for(int i = 0; i < pointCount; i++) {
+		if(lengthSquared(points[i] - points[a]) > lengthSquared(points[b] - points[a])) b = i;
+	}
+	Vec3f ab = points[b] - points[a];
+	// ties are common for points on a grid, preferring the point furthest from a keeps the tetrahedron on the corners
+	int c = a;
+	float bestC = 0.0f;
+	for(int i = 0; i < pointCount; i++) {
+		float dist = lengthSquared(ab % (points[i] - points[a]));
+		if(dist > bestC || (dist == bestC && lengthSquared(points[i] - points[a]) > lengthSquared(points[c] - points[a]))) {
+			bestC = dist;
+			c = i;
+		}
+	}
+	Vec3f planeNormal = normalize(ab % (points[c] - points[a]));
+	int d = a;
+	float bestD = 0.0f;
+	for(int i = 0; i < pointCount; i++) {
+		float dist = std::abs(planeNormal * (points[i] - points[a]));
+		if(dist > bestD || (dist == bestD && lengthSquared(points[i] - points[a]) > lengthSquared(points[d] - points[a]))) {
+			bestD = dist;
+			d = i;
+		}
+	}
+	if(bestC == 0.0f || bestD <= epsilon) throw "Can't build the convex hull of a flat set of points";
+
+	int triangleCapacity = 2 * pointCount;
+	std::vector<Vec3f> vertexBuf(pointCount);
+	std::vector<Triangle> triangleBuf(triangleCapacity);
+	std::vector<TriangleNeighbors> neighborBuf(triangleCapacity);
+	std::vector<int> removalBuf(triangleCapacity);
+	std::vector<EdgePiece> edgeBuf(triangleCapacity);
+
+	vertexBuf[0] = points[a];
+	vertexBuf[1] = points[b];
+	vertexBuf[2] = points[c];
+	vertexBuf[3] = points[d];
+	// the triangles must face away from the opposite vertex
+	if((vertexBuf[1] - vertexBuf[0]) % (vertexBuf[2] - vertexBuf[0]) * (vertexBuf[3] - vertexBuf[0]) > 0) {
+		std::swap(vertexBuf[1], vertexBuf[2]);
+	}
+	triangleBuf[0] = Triangle{0, 1, 2};
+	triangleBuf[1] = Triangle{0, 2, 3};
+	triangleBuf[2] = Triangle{0, 3, 1};
+	triangleBuf[3] = Triangle{3, 2, 1};
+
+	ConvexShapeBuilder builder(vertexBuf.data(), triangleBuf.data(), 4, 4, neighborBuf.data(), removalBuf.data(), edgeBuf.data());
+
+	// adding the outermost points first leaves the fewest triangles to be replaced later
+	Vec3f center = (vertexBuf[0] + vertexBuf[1] + vertexBuf[2] + vertexBuf[3]) / 4.0f;
+	std::vector<int> order;
+	order.reserve(pointCount);
+	for(int i = 0; i < pointCount; i++) {
+		if(i != a && i != b && i != c && i != d) order.push_back(i);
+	}
+	std::sort(order.begin(), order.end(), [&](int first, int second) {
+		return lengthSquared(points[first] - center) > lengthSquared(points[second] - center);
+	});
+
+	for(int i : order) {
+		const Vec3f& point = points[i];
+		int bestTriangle = -1;
+		float bestDistance = epsilon;
+		for(int t = 0; t < builder.triangleCount; t++) {
+			Triangle tri = builder.triangleBuf[t];
+			Vec3f v0 = builder.vertexBuf[tri[0]];
+			Vec3f normalVec = (builder.vertexBuf[tri[1]] - v0) % (builder.vertexBuf[tri[2]] - v0);
+			float normalLength = length(normalVec);
+			if(normalLength == 0.0f) continue;
+			float distance = (point - v0) * normalVec / normalLength;
+			if(distance > bestDistance) {
+				bestDistance = distance;
+				bestTriangle = t;
+			}
+		}
+		if(bestTriangle != -1) builder.addPoint(point, bestTriangle);
+	}
+
+	return builder.toPolyhedron();
+}
+
+namespace {
+struct VoxelGrid {
+	Vec3 origin;
+	double voxelSize;
+	int size[3];
+	BoundingBox clampBox;
+	// the piece each voxel belongs to, -1 for voxels outside of the mesh
+	std::vector<int> piece;
+
+	int index(int x, int y, int z) const { return x + size[0] * (y + size[1] * z); }
+	void coordinates(int index, int(&result)[3]) const {
+		result[0] = index % size[0];
+		result[1] = (index / size[0]) % size[1];
+		result[2] = index / (size[0] * size[1]);
+	}
+	Vec3f corner(int x, int y, int z) const {
+		Vec3 p = origin + Vec3(x, y, z) * voxelSize;
+		return Vec3f(
+			static_cast<float>(std::clamp(p.x, clampBox.min.x, clampBox.max.x)),
+			static_cast<float>(std::clamp(p.y, clampBox.min.y, clampBox.max.y)),
+			static_cast<float>(std::clamp(p.z, clampBox.min.z, clampBox.max.z))
+		);
+	}
+};
+
+/*
+	The cuts are axis aligned planes between voxels, so every piece is the part of the mesh within a box of voxels
+	low is the first voxel of the box along every axis, high the one past the last
+*/
+struct Piece {
+	std::vector<int> voxels;
+	Polyhedron hull;
+	double concavity;
+	int low[3];
+	int high[3];
+};
+
+// the sorted x coordinates at which the line along x through (y, z) crosses the surface of the mesh
+void lineCrossings(const TriangleMesh& mesh, double py, double pz, std::vector<double>& crossings) {
+	crossings.clear();
+	for(const Triangle& tri : mesh.iterTriangles()) {
+		Vec3 v0(mesh.getVertex(tri.firstIndex));
+		Vec3 v1(mesh.getVertex(tri.secondIndex));
+		Vec3 v2(mesh.getVertex(tri.thirdIndex));
+		if(std::max(v0.y, std::max(v1.y, v2.y)) < py || std::min(v0.y, std::min(v1.y, v2.y)) > py) continue;
+		if(std::max(v0.z, std::max(v1.z, v2.z)) < pz || std::min(v0.z, std::min(v1.z, v2.z)) > pz) continue;
+
+		// barycentric coordinates of the line in the projection of the triangle on the yz plane
+		double det = (v1.y - v0.y) * (v2.z - v0.z) - (v2.y - v0.y) * (v1.z - v0.z);
+		if(det == 0.0) continue;
+		double u = ((py - v0.y) * (v2.z - v0.z) - (v2.y - v0.y) * (pz - v0.z)) / det;
+		double v = ((v1.y - v0.y) * (pz - v0.z) - (py - v0.y) * (v1.z - v0.z)) / det;
+		if(u < 0.0 || v < 0.0 || u + v > 1.0) continue;
+		crossings.push_back(v0.x + u * (v1.x - v0.x) + v * (v2.x - v0.x));
+	}
+	std::sort(crossings.begin(), crossings.end());
+}
+
+/*
+	Marks the voxels whose center lies inside the mesh by counting the crossings of a ray through every row of voxel centers
+	The rays are offset by a fraction of a voxel, such that they don't pass exactly through the edges of axis aligned meshes
+*/
+VoxelGrid voxelize(const TriangleMesh& mesh, int resolution) {
+	BoundingBox bounds = mesh.getBounds();
+	Vec3 extent = bounds.max - bounds.min;
+	double longest = std::max(extent.x, std::max(extent.y, extent.z));
+
+	VoxelGrid grid;
+	grid.origin = bounds.min;
+	grid.voxelSize = longest / resolution;
+	grid.clampBox = bounds;
+	for(int i = 0; i < 3; i++) {
+		grid.size[i] = std::max(1, static_cast<int>(std::ceil(extent[i] / grid.voxelSize - 1E-6)));
+	}
+	grid.piece.assign(static_cast<std::size_t>(grid.size[0]) * grid.size[1] * grid.size[2], -1);
+
+	std::vector<double> crossings;
+	for(int z = 0; z < grid.size[2]; z++) {
+		for(int y = 0; y < grid.size[1]; y++) {
+			double py = grid.origin.y + (y + 0.5 + 0.0123) * grid.voxelSize;
+			double pz = grid.origin.z + (z + 0.5 + 0.0071) * grid.voxelSize;
+			lineCrossings(mesh, py, pz, crossings);
+
+			std::size_t crossed = 0;
+			for(int x = 0; x < grid.size[0]; x++) {
+				double px = grid.origin.x + (x + 0.5) * grid.voxelSize;
+				while(crossed < crossings.size() && crossings[crossed] < px) crossed++;
+				if(crossed % 2 == 1) grid.piece[grid.index(x, y, z)] = 0;
+			}
+		}
+	}
+	return grid;
+}
+
+// a piece, optionally restricted to one side of up to two cuts, such that cuts can be tried without changing the grid
+struct Region {
+	int pieceIndex;
+	int cutCount = 0;
+	int cutAxis[2]{};
+	int cutPosition[2]{};
+	bool cutBelow[2]{};
+
+	bool contains(const VoxelGrid& grid, const int(&c)[3]) const {
+		if(grid.piece[grid.index(c[0], c[1], c[2])] != pieceIndex) return false;
+		for(int i = 0; i < cutCount; i++) {
+			if((c[cutAxis[i]] < cutPosition[i]) != cutBelow[i]) return false;
+		}
+		return true;
+	}
+	Region restricted(int axis, int position, bool below) const {
+		Region result = *this;
+		result.cutAxis[cutCount] = axis;
+		result.cutPosition[cutCount] = position;
+		result.cutBelow[cutCount] = below;
+		result.cutCount++;
+		return result;
+	}
+};
+
+/*
+	The hull of the voxels of a region
+	The point of a set of voxels furthest along a direction is a corner of a voxel that has no neighbor in that direction along every axis,
+	so only those corners are given to the hull
+*/
+Polyhedron voxelHull(const VoxelGrid& grid, const std::vector<int>& voxels, const Region& region) {
+	std::vector<Vec3f> points;
+	for(int voxel : voxels) {
+		int c[3];
+		grid.coordinates(voxel, c);
+		bool openSide[3][2];
+		bool isExtreme = true;
+		for(int axis = 0; axis < 3; axis++) {
+			int below[3]{c[0], c[1], c[2]};
+			int above[3]{c[0], c[1], c[2]};
+			below[axis]--;
+			above[axis]++;
+			openSide[axis][0] = below[axis] < 0 || !region.contains(grid, below);
+			openSide[axis][1] = above[axis] >= grid.size[axis] || !region.contains(grid, above);
+			if(!openSide[axis][0] && !openSide[axis][1]) {
+				isExtreme = false;
+				break;
+			}
+		}
+		if(!isExtreme) continue;
+		for(int corner = 0; corner < 8; corner++) {
+			int side[3]{corner & 1, (corner >> 1) & 1, (corner >> 2) & 1};
+			if(openSide[0][side[0]] && openSide[1][side[1]] && openSide[2][side[2]]) {
+				points.push_back(grid.corner(c[0] + side[0], c[1] + side[1], c[2] + side[2]));
+			}
+		}
+	}
+	return convexHull(points.data(), static_cast<int>(points.size()), static_cast<float>(grid.voxelSize * 1E-3));
+}
+
+double concavityOf(const VoxelGrid& grid, const Polyhedron& hull, std::size_t voxelCount) {
+	double voxelVolume = grid.voxelSize * grid.voxelSize * grid.voxelSize;
+	return std::max(0.0, hull.getVolume() - voxelCount * voxelVolume);
+}
+
+Piece makePiece(const VoxelGrid& grid, std::vector<int>&& voxels, int pieceIndex) {
+	Polyhedron hull = voxelHull(grid, voxels, Region{pieceIndex});
+	double concavity = concavityOf(grid, hull, voxels.size());
+	return Piece{std::move(voxels), std::move(hull), concavity, {0, 0, 0}, {grid.size[0], grid.size[1], grid.size[2]}};
+}
+
+struct Split {
+	int axis = -1;
+	int cut = 0;
+	double cost = std::numeric_limits<double>::infinity();
+	std::vector<int> halves[2];
+	Polyhedron hulls[2];
+	double concavities[2]{};
+};
+
+// the cut along axis that leaves the least concavity, axis is -1 if the voxels are a single layer thick along axis
+Split bestSplitAlong(const VoxelGrid& grid, const std::vector<int>& voxels, const Region& region, int axis, int planes) {
+	int low = std::numeric_limits<int>::max();
+	int high = -1;
+	for(int voxel : voxels) {
+		int c[3];
+		grid.coordinates(voxel, c);
+		low = std::min(low, c[axis]);
+		high = std::max(high, c[axis]);
+	}
+
+	Split best;
+	int previousCut = -1;
+	for(int k = 0; k < planes && high > low; k++) {
+		// voxels below cut go to the first half, every cut in (low, high] leaves both halves non empty
+		int cut = std::clamp(low + 1 + static_cast<int>((high - low) * (k + 0.5) / planes), low + 1, high);
+		if(cut == previousCut) continue;
+		previousCut = cut;
+
+		Split split;
+		split.axis = axis;
+		split.cut = cut;
+		for(int voxel : voxels) {
+			int c[3];
+			grid.coordinates(voxel, c);
+			split.halves[c[axis] < cut ? 0 : 1].push_back(voxel);
+		}
+		split.cost = 0.0;
+		for(int side = 0; side < 2; side++) {
+			split.hulls[side] = voxelHull(grid, split.halves[side], region.restricted(axis, cut, side == 0));
+			split.concavities[side] = concavityOf(grid, split.hulls[side], split.halves[side].size());
+			split.cost += split.concavities[side];
+		}
+		if(split.cost < best.cost) best = std::move(split);
+	}
+	return best;
+}
+
+bool isInside(const TriangleMesh& mesh, Vec3 point, double offset) {
+	std::vector<double> crossings;
+	lineCrossings(mesh, point.y + offset * 0.123, point.z + offset * 0.071, crossings);
+	return (std::lower_bound(crossings.begin(), crossings.end(), point.x) - crossings.begin()) % 2 == 1;
+}
+
+/*
+	The exact hull of the part of the mesh within the box of the piece
+	Its vertices are among the mesh vertices in the box, the crossings of mesh edges with the sides of the box,
+	the crossings of box edges with mesh triangles and the box corners inside the mesh
+	The voxel hull is kept if these are too few to span a volume
+*/
+Polyhedron clippedHull(const VoxelGrid& grid, const TriangleMesh& mesh, const Piece& piece) {
+	Vec3 boxMin = grid.origin + Vec3(piece.low[0], piece.low[1], piece.low[2]) * grid.voxelSize;
+	Vec3 boxMax = grid.origin + Vec3(piece.high[0], piece.high[1], piece.high[2]) * grid.voxelSize;
+	double tolerance = grid.voxelSize * 1E-6;
+	auto inBox = [&](const Vec3& p) {
+		for(int axis = 0; axis < 3; axis++) {
+			if(p[axis] < boxMin[axis] - tolerance || p[axis] > boxMax[axis] + tolerance) return false;
+		}
+		return true;
+	};
+
+	std::vector<Vec3f> points;
+	for(int i = 0; i < mesh.vertexCount; i++) {
+		Vec3 vertex(mesh.getVertex(i));
+		if(inBox(vertex)) points.push_back(mesh.getVertex(i));
+	}
+	for(const Triangle& tri : mesh.iterTriangles()) {
+		Vec3 v[3]{Vec3(mesh.getVertex(tri.firstIndex)), Vec3(mesh.getVertex(tri.secondIndex)), Vec3(mesh.getVertex(tri.thirdIndex))};
+		bool overlapsBox = true;
+		for(int axis = 0; axis < 3; axis++) {
+			overlapsBox &= std::max(v[0][axis], std::max(v[1][axis], v[2][axis])) >= boxMin[axis] && std::min(v[0][axis], std::min(v[1][axis], v[2][axis])) <= boxMax[axis];
+		}
+		if(!overlapsBox) continue;
+
+		// every edge of a closed mesh is shared by two triangles, only one of them handles it
+		for(int edge = 0; edge < 3; edge++) {
+			if(tri[edge] > tri[(edge + 1) % 3]) continue;
+			Vec3 a = v[edge];
+			Vec3 b = v[(edge + 1) % 3];
+			for(int axis = 0; axis < 3; axis++) {
+				for(double plane : {boxMin[axis], boxMax[axis]}) {
+					double da = a[axis] - plane;
+					double db = b[axis] - plane;
+					if((da < 0.0) == (db < 0.0)) continue;
+					Vec3 crossing = a + (b - a) * (da / (da - db));
+					crossing[axis] = plane;
+					if(inBox(crossing)) points.push_back(Vec3f(crossing));
+				}
+			}
+		}
+
+		for(int axis = 0; axis < 3; axis++) {
+			Vec3 ray(0.0, 0.0, 0.0);
+			ray[axis] = boxMax[axis] - boxMin[axis];
+			for(int corner = 0; corner < 4; corner++) {
+				Vec3 start = boxMin;
+				start[(axis + 1) % 3] = (corner & 1) ? boxMax[(axis + 1) % 3] : boxMin[(axis + 1) % 3];
+				start[(axis + 2) % 3] = (corner & 2) ? boxMax[(axis + 2) % 3] : boxMin[(axis + 2) % 3];
+				RayIntersection<double> hit = rayTriangleIntersection(start, ray, v[0], v[1], v[2]);
+				if(hit.d >= 0.0 && hit.d <= 1.0 && hit.lineIntersectsTriangle()) points.push_back(Vec3f(start + ray * hit.d));
+			}
+		}
+	}
+	for(int corner = 0; corner < 8; corner++) {
+		Vec3 p((corner & 1) ? boxMax.x : boxMin.x, (corner & 2) ? boxMax.y : boxMin.y, (corner & 4) ? boxMax.z : boxMin.z);
+		if(isInside(mesh, p, grid.voxelSize * 1E-4)) points.push_back(Vec3f(p));
+	}
+
+	if(points.size() < 4) return piece.hull;
+	try {
+		return convexHull(points.data(), static_cast<int>(points.size()), static_cast<float>(grid.voxelSize * 1E-3));
+	} catch(const char*) {
+		return piece.hull;
+	}
+}
+
+/*
+	Splits piece pieceIndex in two, returns false if it consists of a single voxel
+	A single cut through a ring leaves two hulls that still cover the hole, so every axis is judged by the concavity that remains after one more cut of its halves
+*/
+bool splitPiece(VoxelGrid& grid, std::vector<Piece>& pieces, int pieceIndex, int planesPerAxis) {
+	Region region{pieceIndex};
+	int probePlanes = (planesPerAxis + 1) / 2;
+
+	Split best;
+	double bestRemaining = std::numeric_limits<double>::infinity();
+	for(int axis = 0; axis < 3; axis++) {
+		Split split = bestSplitAlong(grid, pieces[pieceIndex].voxels, region, axis, planesPerAxis);
+		if(split.axis == -1) continue;
+
+		double remaining = 0.0;
+		for(int side = 0; side < 2; side++) {
+			Region half = region.restricted(split.axis, split.cut, side == 0);
+			double bestHalf = split.concavities[side];
+			for(int probeAxis = 0; probeAxis < 3; probeAxis++) {
+				bestHalf = std::min(bestHalf, bestSplitAlong(grid, split.halves[side], half, probeAxis, probePlanes).cost);
+			}
+			remaining += bestHalf;
+		}
+		if(remaining < bestRemaining) {
+			bestRemaining = remaining;
+			best = std::move(split);
+		}
+	}
+	if(best.axis == -1) return false;
+
+	int newIndex = static_cast<int>(pieces.size());
+	for(int voxel : best.halves[1]) {
+		grid.piece[voxel] = newIndex;
+	}
+	Piece& original = pieces[pieceIndex];
+	Piece second{std::move(best.halves[1]), std::move(best.hulls[1]), best.concavities[1], {original.low[0], original.low[1], original.low[2]}, {original.high[0], original.high[1], original.high[2]}};
+	second.low[best.axis] = best.cut;
+	original.voxels = std::move(best.halves[0]);
+	original.hull = std::move(best.hulls[0]);
+	original.concavity = best.concavities[0];
+	original.high[best.axis] = best.cut;
+	pieces.push_back(std::move(second));
+	return true;
+}
+};
+
+std::vector<Polyhedron> decomposeConvex(const TriangleMesh& mesh, const ConvexDecompositionSettings& settings) {
+	VoxelGrid grid = voxelize(mesh, settings.resolution);
+
+	std::vector<int> allVoxels;
+	for(std::size_t i = 0; i < grid.piece.size(); i++) {
+		if(grid.piece[i] == 0) allVoxels.push_back(static_cast<int>(i));
+	}
+	if(allVoxels.empty()) throw "Can't decompose a mesh without an interior";
+
+	std::vector<Piece> pieces;
+	pieces.push_back(makePiece(grid, std::move(allVoxels), 0));
+	double maxConcavity = settings.maxConcavity * pieces[0].hull.getVolume();
+
+	std::vector<bool> splittable{true};
+	while(static_cast<int>(pieces.size()) < settings.maxPieces) {
+		int worst = -1;
+		for(int i = 0; i < static_cast<int>(pieces.size()); i++) {
+			if(splittable[i] && pieces[i].concavity > maxConcavity && (worst == -1 || pieces[i].concavity > pieces[worst].concavity)) worst = i;
+		}
+		if(worst == -1) break;
+		if(splitPiece(grid, pieces, worst, settings.planesPerAxis)) {
+			splittable.push_back(true);
+		} else {
+			splittable[worst] = false;
+		}
+	}
+
+	std::vector<Polyhedron> result;
+	result.reserve(pieces.size());
+	for(const Piece& piece : pieces) {
+		result.push_back(clippedHull(grid, mesh, piece));
+	}
+	return result;
+}
+
+// FNV-1a
+static void hashBytes(std::uint64_t& hash, const void* data, std::size_t size) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for(std::size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+}
+
+std::uint64_t hashConvexDecomposition(const TriangleMesh& mesh, const ConvexDecompositionSettings& settings) {
+	std::uint64_t hash = 14695981039346656037ULL;
+	int header[3]{CONVEX_DECOMPOSITION_VERSION, mesh.vertexCount, mesh.triangleCount};
+	hashBytes(hash, header, sizeof(header));
+	for(int i = 0; i < mesh.vertexCount; i++) {
+		Vec3f vertex = mesh.getVertex(i);
+		hashBytes(hash, &vertex, sizeof(vertex));
+	}
+	for(int i = 0; i < mesh.triangleCount; i++) {
+		Triangle triangle = mesh.getTriangle(i);
+		hashBytes(hash, &triangle, sizeof(triangle));
+	}
+	hashBytes(hash, &settings.resolution, sizeof(settings.resolution));
+	hashBytes(hash, &settings.maxConcavity, sizeof(settings.maxConcavity));
+	hashBytes(hash, &settings.maxPieces, sizeof(settings.maxPieces));
+	hashBytes(hash, &settings.planesPerAxis, sizeof(settings.planesPerAxis));
+	return hash;
+}
+
+ConvexDecompositionCache::ConvexDecompositionCache(std::string directory) : directory(std::move(directory)) {}
+
+std::string ConvexDecompositionCache::getCacheFile(std::uint64_t hash) const {
+	std::ostringstream name;
+	name << directory << '/' << std::hex << std::setw(16) << std::setfill('0') << hash << ".hulls";
+	return name.str();
+}
+
+/*
+	Cache file layout: magic, version, piece count, byte size of the pieces, followed by the serialized pieces
+	The byte size guards against truncated files, which would otherwise make deserializePolyhedron read garbage counts
+*/
+static bool readCacheFile(const std::string& path, std::vector<Polyhedron>& pieces) {
+	std::ifstream file(path, std::ios::binary);
+	if(!file) return false;
+
+	std::int32_t magic = deserializeBasicTypes<std::int32_t>(file);
+	std::int32_t version = deserializeBasicTypes<std::int32_t>(file);
+	std::int32_t pieceCount = deserializeBasicTypes<std::int32_t>(file);
+	std::uint64_t byteSize = deserializeBasicTypes<std::uint64_t>(file);
+	if(!file || magic != CONVEX_DECOMPOSITION_FILE_MAGIC || version != CONVEX_DECOMPOSITION_VERSION || pieceCount <= 0) return false;
+
+	std::streampos start = file.tellg();
+	file.seekg(0, std::ios::end);
+	if(static_cast<std::uint64_t>(file.tellg() - start) != byteSize) return false;
+	file.seekg(start);
+
+	for(std::int32_t i = 0; i < pieceCount; i++) {
+		pieces.push_back(deserializePolyhedron(file));
+	}
+	return static_cast<bool>(file);
+}
+
+static void writeCacheFile(const std::string& directory, const std::string& path, const std::vector<Polyhedron>& pieces) {
+	std::ostringstream body(std::ios::binary);
+	for(const Polyhedron& piece : pieces) {
+		serializePolyhedron(piece, body);
+	}
+	std::string bodyBytes = body.str();
+
+	// the cache is only an optimization, failing to write it is not an error
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if(!file) return;
+	serializeBasicTypes<std::int32_t>(CONVEX_DECOMPOSITION_FILE_MAGIC, file);
+	serializeBasicTypes<std::int32_t>(CONVEX_DECOMPOSITION_VERSION, file);
+	serializeBasicTypes<std::int32_t>(static_cast<std::int32_t>(pieces.size()), file);
+	serializeBasicTypes<std::uint64_t>(bodyBytes.size(), file);
+	file.write(bodyBytes.data(), bodyBytes.size());
+}
+
+std::vector<Polyhedron> ConvexDecompositionCache::getDecomposition(const TriangleMesh& mesh, const ConvexDecompositionSettings& settings) {
+	std::string path = getCacheFile(hashConvexDecomposition(mesh, settings));
+
+	std::vector<Polyhedron> pieces;
+	if(readCacheFile(path, pieces)) return pieces;
+
+	pieces = decomposeConvex(mesh, settings);
+	writeCacheFile(directory, path, pieces);
+	return pieces;
+}
+
+std::vector<ConvexPiece> createConvexPieces(const std::vector<Polyhedron>& pieces) {
+	std::vector<ConvexPiece> result;
+	result.reserve(pieces.size());
+	for(const Polyhedron& piece : pieces) {
+		// polyhedronShape centers the piece on its bounds
+		result.push_back(ConvexPiece{polyhedronShape(piece), CFrame(piece.getBounds().getCenter())});
+	}
+	return result;
+}
+};
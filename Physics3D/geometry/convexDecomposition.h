@@ -0,0 +1,57 @@
+#pragma once
+
+#include "polyhedron.h"
+#include "shape.h"
+#include "../math/cframe.h"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace P3D {
+struct ConvexDecompositionSettings {
+	// the number of voxels along the longest axis of the mesh
+	int resolution = 24;
+	// pieces are split until their hull volume minus their voxel volume is below this fraction of the hull volume of the whole mesh
+	double maxConcavity = 0.05;
+	int maxPieces = 16;
+	// the number of split planes tried per axis when splitting a piece
+	int planesPerAxis = 6;
+};
+
+/*
+	Approximately splits a closed, possibly concave mesh into convex pieces, in the same space as the mesh
+	The interior of the mesh is voxelized, after which the piece with the largest concavity is repeatedly cut by the axis aligned plane that reduces the concavity the most
+	Every piece is the exact convex hull of the mesh clipped to the box of the piece, so it does not stick out of the mesh where the mesh is convex
+	Only when that clipped hull can't be built, for example because it is flat, the piece is the hull of its voxels, which may stick out of the mesh by up to one voxel
+*/
+std::vector<Polyhedron> decomposeConvex(const TriangleMesh& mesh, const ConvexDecompositionSettings& settings = ConvexDecompositionSettings());
+
+// the convex hull of the given points, built with ConvexShapeBuilder. Points within epsilon of the hull are ignored
+Polyhedron convexHull(const Vec3f* points, int pointCount, float epsilon);
+
+// identifies a decomposition, used as the name of its cache file
+std::uint64_t hashConvexDecomposition(const TriangleMesh& mesh, const ConvexDecompositionSettings& settings);
+
+/*
+	Keeps decompositions on disk, one file per mesh hash, such that a mesh is only decomposed the first time it is loaded
+	Files that can't be read are recomputed and overwritten
+*/
+class ConvexDecompositionCache {
+	std::string directory;
+
+public:
+	explicit ConvexDecompositionCache(std::string directory);
+
+	std::string getCacheFile(std::uint64_t hash) const;
+	std::vector<Polyhedron> getDecomposition(const TriangleMesh& mesh, const ConvexDecompositionSettings& settings = ConvexDecompositionSettings());
+};
+
+// the shape of one piece of a compound, attach it at offset relative to the mesh
+struct ConvexPiece {
+	Shape shape;
+	CFrame offset;
+};
+
+std::vector<ConvexPiece> createConvexPieces(const std::vector<Polyhedron>& pieces);
+};
@@ -13,6 +13,7 @@
 #include "../misc/catchable_assert.h"
 
 #include <stdexcept>
+#include <algorithm>
 
 
 #define GJK_MAX_ITER 200
@@ -78,10 +79,21 @@ static MinkPoint getSupport(const ColissionPair& info, const Vec3f& searchDirect
 	return MinkPoint{ furthest1 - secondVertex, furthest1, secondVertex };  // local to first
 }
 
-std::optional<Tetrahedron> runGJKTransformed(const ColissionPair& info, Vec3f searchDirection) {
+std::optional<Tetrahedron> runGJKTransformed(const ColissionPair& info, Vec3f initialSearchDirection) {
+	return runGJKTransformed(info, initialSearchDirection, initialSearchDirection);
+}
+
+std::optional<Tetrahedron> runGJKTransformed(const ColissionPair& info, Vec3f initialSearchDirection, Vec3f& searchDirection) {
+	searchDirection = initialSearchDirection;
 	MinkPoint A(getSupport(info, searchDirection));
 	MinkPoint B, C, D;
 
+	// the search direction is a separating axis, this is the common case when it was taken from the previous tick
+	if(A.p * searchDirection < 0) {
+		incDebugTally(GJKNoCollidesIterationStatistics, 0);
+		return std::optional<Tetrahedron>();
+	}
+
 	// set new searchdirection to be straight at the origin
 	searchDirection = -A.p;
 
@@ -204,7 +216,36 @@ std::optional<Tetrahedron> runGJKTransformed(const ColissionPair& info, Vec3f se
 	return std::optional<Tetrahedron>();
 }
 
+#define SEPARATION_MAX_ITER 32
+
+float getSeparationLowerBound(const ColissionPair& info, Vec3f& direction, float tolerance) {
+	// x is a point of the minkowski difference, which moves towards the origin one segment at a time
+	Vec3f x = getSupport(info, direction).p;
+	float bestGap = -(x * normalize(direction));
+	for(int iter = 0; iter < SEPARATION_MAX_ITER; iter++) {
+		float distance = length(x);
+		if(distance == 0.0f) break;
+		Vec3f s = getSupport(info, -x).p;
+		// every point of the minkowski difference lies at least this far from the origin in the direction of x
+		float gap = (s * x) / distance;
+		if(gap > bestGap) {
+			bestGap = gap;
+			direction = -x;
+		}
+		if(distance - gap <= tolerance) break;
+
+		// the closest point to the origin on the segment from x to s
+		Vec3f segment = s - x;
+		float segmentLengthSq = lengthSquared(segment);
+		if(segmentLengthSq == 0.0f) break;
+		float f = std::clamp(-(x * segment) / segmentLengthSq, 0.0f, 1.0f);
+		x = x + segment * f;
+	}
+	return bestGap;
+}
+
 void initializeBuffer(const Tetrahedron& s, ComputationBuffers& b) {
+	b.ensureCapacity(4, 4);
 	b.vertBuf[0] = s.A.p;
 	b.vertBuf[1] = s.B.p;
 	b.vertBuf[2] = s.C.p;
@@ -252,7 +293,19 @@ bool runEPATransformed(const ColissionPair& info, const Tetrahedron& s, Vec3f& i
 		MinkowskiPointIndices curIndices{point.originFirst, point.originSecond};
 
 		// Do not remove! The inversion catches NaN as well!
-		if(!(newPointDistSq <= distSq * 1.01)) {
+		bool isPastTriangle = !(newPointDistSq <= distSq * 1.01);
+		if(isPastTriangle && !bufs.ensureRoomForPoint(builder.vertexCount, builder.triangleCount)) {
+			// the buffers may not grow any further, the closest triangle so far is the best estimate
+			isPastTriangle = false;
+		}
+		// growing may have moved the buffers
+		builder.vertexBuf = bufs.vertBuf;
+		builder.triangleBuf = bufs.triangleBuf;
+		builder.neighborBuf = bufs.neighborBuf;
+		builder.removalBuffer = bufs.removalBuf;
+		builder.newTriangleBuffer = bufs.edgeBuf;
+
+		if(isPastTriangle) {
 			bufs.knownVecs[builder.vertexCount] = curIndices;
 			builder.addPoint(point.p, closestTriangleIndex);
 		} else {
@@ -287,12 +340,14 @@ bool runEPATransformed(const ColissionPair& info, const Tetrahedron& s, Vec3f& i
 			// intersection = (avgFirst + relativeCFrame.localToGlobal(avgSecond)) / 2;
 			intersection = (avgFirst + avgSecond) * 0.5f;
 			incDebugTally(EPAIterationStatistics, iter);
+			bufs.statistics.addRun(iter, builder.vertexCount, builder.triangleCount);
 			return true;
 		}
 	}
 
 	Debug::logWarn("EPA iteration limit exceeded! ");
 	incDebugTally(EPAIterationStatistics, EPA_MAX_ITER);
+	bufs.statistics.addRun(EPA_MAX_ITER, builder.vertexCount, builder.triangleCount);
 	return false;
 }
 };
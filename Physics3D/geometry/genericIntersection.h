@@ -57,5 +57,13 @@ struct ColissionPair {
 };
 
 std::optional<Tetrahedron> runGJKTransformed(const ColissionPair& colissionPair, Vec3f initialSearchDirection);
+// lastSearchDirection is set to the direction GJK ended on, for separated shapes this is a separating axis
+std::optional<Tetrahedron> runGJKTransformed(const ColissionPair& colissionPair, Vec3f initialSearchDirection, Vec3f& lastSearchDirection);
+/*
+	For shapes which GJK found to be separated along direction, walks direction towards the axis through the closest points of the shapes
+	Returns the widest gap between the shapes along any of the axes tried, which is a lower bound for their distance, direction is set to that axis
+	The result is negative if direction did not separate the shapes
+*/
+float getSeparationLowerBound(const ColissionPair& colissionPair, Vec3f& direction, float tolerance);
 bool runEPATransformed(const ColissionPair& colissionPair, const Tetrahedron& s, Vec3f& intersection, Vec3f& exitVector, ComputationBuffers& bufs);
 };
\ No newline at end of file
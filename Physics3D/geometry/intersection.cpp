@@ -1,6 +1,7 @@
 #include "intersection.h"
 
 #include "genericIntersection.h"
+#include "specializedIntersection.h"
 #include "../misc/physicsProfiler.h"
 #include "../misc/profiling.h"
 #include "computationBuffer.h"
@@ -10,6 +11,7 @@
 
 #include "../misc/validityHelper.h"
 #include "shapeClass.h"
+#include "builtinShapeClasses.h"
 
 #include "../misc/catchable_assert.h"
 
@@ -17,15 +19,31 @@
 
 namespace P3D {
 std::optional<Intersection> intersectsTransformed(const Shape& first, const Shape& second, const CFrame& relativeTransform) {
+	IntersectionFunction specialized = getSpecializedIntersection(first.baseShape->intersectionClassID, second.baseShape->intersectionClassID);
+	if(specialized != nullptr) {
+		return specialized(*first.baseShape, *second.baseShape, relativeTransform, first.scale, second.scale);
+	}
 	return intersectsTransformed(*first.baseShape, *second.baseShape, relativeTransform, first.scale, second.scale);
 }
 
-thread_local ComputationBuffers buffers(1000, 2000);
+std::optional<Intersection> intersectsTransformed(const Shape& first, const Shape& second, const CFrame& relativeTransform, Vec3f& searchDirection) {
+	IntersectionFunction specialized = getSpecializedIntersection(first.baseShape->intersectionClassID, second.baseShape->intersectionClassID);
+	if(specialized != nullptr) {
+		return specialized(*first.baseShape, *second.baseShape, relativeTransform, first.scale, second.scale);
+	}
+	return intersectsTransformed(*first.baseShape, *second.baseShape, relativeTransform, first.scale, second.scale, searchDirection);
+}
 
 std::optional<Intersection> intersectsTransformed(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond) {
+	Vec3f searchDirection(0.0f, 0.0f, 0.0f);
+	return intersectsTransformed(first, second, relativeTransform, scaleFirst, scaleSecond, searchDirection);
+}
+
+std::optional<Intersection> intersectsTransformed(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond, Vec3f& searchDirection) {
 	ColissionPair info{first, second, relativeTransform, scaleFirst, scaleSecond};
 	physicsMeasure.mark(PhysicsProcess::GJK_COL);
-	std::optional collides = runGJKTransformed(info, -relativeTransform.position);
+	Vec3f initialSearchDirection = (lengthSquared(searchDirection) == 0.0f) ? Vec3f(-relativeTransform.position) : searchDirection;
+	std::optional collides = runGJKTransformed(info, initialSearchDirection, searchDirection);
 
 	if(collides) {
 		Tetrahedron& result = collides.value();
@@ -55,7 +73,7 @@ std::optional<Intersection> intersectsTransformed(const GenericCollidable& first
 		catchable_assert(isVecValid(result.D.originFirst));
 		catchable_assert(isVecValid(result.D.originSecond));
 
-		bool epaResult = runEPATransformed(info, result, intersection, exitVector, buffers);
+		bool epaResult = runEPATransformed(info, result, intersection, exitVector, getThreadComputationBuffers());
 
 		catchable_assert(isVecValid(exitVector));
 		if(!epaResult) {
@@ -68,4 +86,76 @@ std::optional<Intersection> intersectsTransformed(const GenericCollidable& first
 		return std::optional<Intersection>();
 	}
 }
+
+// when the advancement has not converged after this many steps, the pair is left to the discrete colission tests
+#define TIME_OF_IMPACT_MAX_ITER 32
+
+static std::optional<double> timeOfImpactTransformed(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond, const Vec3& translation, double tolerance, Vec3& normal) {
+	Vec3f searchDirection(-relativeTransform.position);
+	double t = 0.0;
+	for(int iter = 0; iter < TIME_OF_IMPACT_MAX_ITER; iter++) {
+		// moving first by translation * t is the same as moving second by -translation * t
+		CFrame currentTransform(relativeTransform.position - translation * t, relativeTransform.rotation);
+		ColissionPair info{first, second, currentTransform, scaleFirst, scaleSecond};
+		// the advancement stops short of contact, so this only happens for shapes that started out intersecting
+		if(runGJKTransformed(info, searchDirection, searchDirection)) return std::optional<double>();
+
+		// the gap along any separating axis is a lower bound for the distance between the shapes
+		double gap = getSeparationLowerBound(info, searchDirection, float(tolerance * 0.1));
+		// GJK gave up without finding a separating axis
+		if(gap < 0.0) return std::optional<double>();
+		Vec3 axis = normalize(Vec3(searchDirection));
+		double approachSpeed = translation * axis;
+		// a plane separates the shapes and first moves away from it, so they never meet
+		if(approachSpeed <= 0.0) return std::optional<double>();
+		if(gap <= tolerance) {
+			normal = axis;
+			return t;
+		}
+
+		// aim for half the tolerance, such that the shapes never touch
+		t += (gap - tolerance * 0.5) / approachSpeed;
+		if(t >= 1.0) return std::optional<double>();
+	}
+	return std::optional<double>();
+}
+
+// only the triangles near the path of first can be hit, the earliest hit among them is the time of impact
+static std::optional<double> timeOfImpactWithMesh(const Shape& first, const Shape& second, const CFrame& relativeTransform, const Vec3& translation, double tolerance, Vec3& normal) {
+	const TriangleMeshShapeClass& mesh = static_cast<const TriangleMeshShapeClass&>(*second.baseShape);
+	CFrame firstInMesh = ~relativeTransform;
+	BoundingBox startBounds = first.baseShape->getBounds(firstInMesh.getRotation(), first.scale);
+	Vec3 localTranslation = relativeTransform.relativeToLocal(translation);
+	BoundingBox sweptBounds(startBounds.min + firstInMesh.position, startBounds.max + firstInMesh.position);
+	sweptBounds = sweptBounds.expanded(BoundingBox(sweptBounds.min + localTranslation, sweptBounds.max + localTranslation));
+	DiagonalMat3 inverseScale = ~second.scale;
+	Vec3 margin(tolerance, tolerance, tolerance);
+	BoundingBoxTemplate<float> query(Vec3f(inverseScale * (sweptBounds.min - margin)), Vec3f(inverseScale * (sweptBounds.max + margin)));
+
+	std::optional<double> earliest;
+	mesh.getBVH().forEachOverlapping(query, [&](int triangleIndex) {
+		TriangleCollidable triangle(mesh.getMesh(), triangleIndex);
+		Vec3 triangleNormal;
+		std::optional<double> t = timeOfImpactTransformed(*first.baseShape, triangle, relativeTransform, first.scale, second.scale, translation, tolerance, triangleNormal);
+		if(t && (!earliest || *t < *earliest)) {
+			earliest = t;
+			normal = triangleNormal;
+		}
+	});
+	return earliest;
+}
+
+std::optional<double> timeOfImpactTransformed(const Shape& first, const Shape& second, const CFrame& relativeTransform, const Vec3& translation, double tolerance, Vec3& normal) {
+	if(second.baseShape->intersectionClassID == TRIANGLE_MESH_CLASS_ID) {
+		return timeOfImpactWithMesh(first, second, relativeTransform, translation, tolerance, normal);
+	}
+	if(first.baseShape->intersectionClassID == TRIANGLE_MESH_CLASS_ID) {
+		// the same as second moving along -translation towards the mesh, the normal is converted back to the frame of first
+		Vec3 swappedNormal;
+		std::optional<double> t = timeOfImpactWithMesh(second, first, ~relativeTransform, -relativeTransform.relativeToLocal(translation), tolerance, swappedNormal);
+		if(t) normal = -relativeTransform.localToRelative(swappedNormal);
+		return t;
+	}
+	return timeOfImpactTransformed(*first.baseShape, *second.baseShape, relativeTransform, first.scale, second.scale, translation, tolerance, normal);
+}
 };
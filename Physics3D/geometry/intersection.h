@@ -23,4 +23,20 @@ struct Intersection {
 
 std::optional<Intersection> intersectsTransformed(const Shape& first, const Shape& second, const CFrame& relativeTransform);
 std::optional<Intersection> intersectsTransformed(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond);
+/*
+	Same as above, but GJK is seeded with searchDirection, which is local to first and is overwritten with the direction GJK ended on
+	Passing the result back in for the same pair in the next tick lets GJK skip most iterations, a zero searchDirection means no seed is known
+	Pairs handled by a specialized routine leave searchDirection untouched
+*/
+std::optional<Intersection> intersectsTransformed(const Shape& first, const Shape& second, const CFrame& relativeTransform, Vec3f& searchDirection);
+std::optional<Intersection> intersectsTransformed(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond, Vec3f& searchDirection);
+
+/*
+	Conservative advancement of first along translation, which is local to first, while second stays in place
+	Returns the fraction of translation after which the gap between the shapes is smaller than tolerance, or nothing if they don't meet
+	Shapes that already intersect don't meet either, these are left to intersectsTransformed
+	normal is set to the separating axis at the time of impact, local to first and pointing from first towards second
+	Rotation is not taken into account
+*/
+std::optional<double> timeOfImpactTransformed(const Shape& first, const Shape& second, const CFrame& relativeTransform, const Vec3& translation, double tolerance, Vec3& normal);
 };
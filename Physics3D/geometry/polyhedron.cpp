@@ -56,6 +56,23 @@ bool Polyhedron::containsPoint(Vec3f point) const {
 	return isExiting;
 }
 
+bool Polyhedron::isConvex() const {
+	BoundingBox bounds = getBounds();
+	// vertices of flat faces are rarely exactly coplanar after rounding to floats
+	float tolerance = static_cast<float>(length(bounds.max - bounds.min)) * 0.0001f;
+	for(Triangle triangle : iterTriangles()) {
+		Vec3f normal = getNormalVecOfTriangle(triangle);
+		float normalLength = length(normal);
+		if(normalLength == 0.0f) continue;
+		normal = normal / normalLength;
+		Vec3f origin = getVertex(triangle.firstIndex);
+		for(int i = 0; i < vertexCount; i++) {
+			if((getVertex(i) - origin) * normal > tolerance) return false;
+		}
+	}
+	return true;
+}
+
 double Polyhedron::getVolume() const {
 	double total = 0;
 	for(Triangle triangle : iterTriangles()) {
@@ -27,6 +27,8 @@ public:
 	Polyhedron translatedAndScaled(Vec3f translation, DiagonalMat3f scale) const;
 
 	bool containsPoint(Vec3f point) const;
+	// true if no vertex lies in front of any of the faces, up to a small tolerance relative to the size
+	bool isConvex() const;
 
 	double getVolume() const;
 	Vec3 getCenterOfMass() const;
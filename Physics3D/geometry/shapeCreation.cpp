@@ -8,6 +8,8 @@
 
 #include "../datastructures/smartPointers.h"
 
+#include <algorithm>
+
 namespace P3D {
 Shape boxShape(double width, double height, double depth) {
 	return Shape(intrusive_ptr<const ShapeClass>(&CubeClass::instance), width, height, depth);
@@ -37,7 +39,10 @@ Shape polyhedronShape(const Polyhedron& poly) {
 
 	PolyhedronShapeClass* shapeClass;
 
-	if(CPUIDCheck::hasTechnology(CPUIDCheck::AVX | CPUIDCheck::AVX2 | CPUIDCheck::FMA)) {
+	// a walk can get stuck on a concave mesh, those are scanned like small polyhedra
+	if(poly.vertexCount >= HILL_CLIMBING_MIN_VERTEX_COUNT && poly.isConvex()) {
+		shapeClass = new PolyhedronShapeClassHillClimbing(poly.translatedAndScaled(-center, scale));
+	} else if(CPUIDCheck::hasTechnology(CPUIDCheck::AVX | CPUIDCheck::AVX2 | CPUIDCheck::FMA)) {
 		shapeClass = new PolyhedronShapeClassAVX(poly.translatedAndScaled(-center, scale));
 	} else if(CPUIDCheck::hasTechnology(CPUIDCheck::SSE | CPUIDCheck::SSE2)) {
 		if(CPUIDCheck::hasTechnology(CPUIDCheck::SSE4_1)) {
@@ -51,4 +56,21 @@ Shape polyhedronShape(const Polyhedron& poly) {
 
 	return Shape(intrusive_ptr<const ShapeClass>(shapeClass), bounds.getWidth(), bounds.getHeight(), bounds.getDepth());
 }
-};
\ No newline at end of file
+
+// a flat mesh, such as a floor, gets a small thickness along its flat axes, such that the scale stays invertible
+Shape triangleMeshShape(const TriangleMesh& mesh) {
+	BoundingBox bounds = mesh.getBounds();
+	Vec3 center = bounds.getCenter();
+	double largestExtent = std::max(std::max(bounds.getWidth(), bounds.getHeight()), bounds.getDepth());
+	if(largestExtent <= 0.0) throw "Cannot create a triangle mesh shape from an empty mesh";
+	double minExtent = largestExtent * 0.001;
+	double width = std::max(bounds.getWidth(), minExtent);
+	double height = std::max(bounds.getHeight(), minExtent);
+	double depth = std::max(bounds.getDepth(), minExtent);
+	DiagonalMat3 scale{2 / width, 2 / height, 2 / depth};
+
+	TriangleMeshShapeClass* shapeClass = new TriangleMeshShapeClass(mesh.translatedAndScaled(-center, scale));
+
+	return Shape(intrusive_ptr<const ShapeClass>(shapeClass), width, height, depth);
+}
+};
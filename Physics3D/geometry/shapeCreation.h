@@ -4,6 +4,7 @@
 
 namespace P3D {
 class Polyhedron;
+class TriangleMesh;
 
 Shape boxShape(double width, double height, double depth);
 Shape wedgeShape(double width, double height, double depth);
@@ -11,4 +12,6 @@ Shape cornerShape(double width, double height, double depth);
 Shape sphereShape(double radius);
 Shape cylinderShape(double radius, double height);
 Shape polyhedronShape(const Polyhedron& poly);
+// static, possibly concave terrain, see TriangleMeshShapeClass
+Shape triangleMeshShape(const TriangleMesh& mesh);
 }
\ No newline at end of file
@@ -0,0 +1,312 @@
+#include "specializedIntersection.h"
+
+#include "builtinShapeClasses.h"
+#include "genericIntersection.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace P3D {
+// below this, directions are considered degenerate
+static constexpr double DIRECTION_EPSILON = 1E-9;
+// a box-box edge axis is only used if it separates this much better than the best face axis, face contacts are more stable
+static constexpr double EDGE_AXIS_BIAS = 0.95;
+
+static bool isUniformScale(const DiagonalMat3& scale) {
+	return scale[0] == scale[1] && scale[1] == scale[2];
+}
+
+// the point halfway between the deepest points of both shapes, the same point EPA converges to
+static Intersection makeIntersection(const Vec3& deepestOfFirst, const Vec3& deepestOfSecond, const Vec3& normal, double depth) {
+	return Intersection((deepestOfFirst + deepestOfSecond) * 0.5, normal * depth);
+}
+
+/*
+	Runs func with first and second swapped, and converts the result back to the frame of first
+	expects func to be one of the intersection routines
+*/
+template<IntersectionFunction func>
+static std::optional<Intersection> swapped(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond) {
+	std::optional<Intersection> result = func(second, first, ~relativeTransform, scaleSecond, scaleFirst);
+	if(!result) return result;
+	// the swapped exitVector moves first away from second
+	return Intersection(relativeTransform.localToGlobal(result->intersection), -relativeTransform.localToRelative(result->exitVector));
+}
+
+std::optional<Intersection> intersectsSphereSphere(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond) {
+	if(!isUniformScale(scaleFirst) || !isUniformScale(scaleSecond)) return intersectsTransformed(first, second, relativeTransform, scaleFirst, scaleSecond);
+
+	double radiusFirst = scaleFirst[0];
+	double radiusSecond = scaleSecond[0];
+	Vec3 center = relativeTransform.position;
+	double radiusSum = radiusFirst + radiusSecond;
+	double distSq = lengthSquared(center);
+	if(distSq > radiusSum * radiusSum) return std::optional<Intersection>();
+
+	double dist = std::sqrt(distSq);
+	Vec3 normal = (dist > DIRECTION_EPSILON) ? center / dist : Vec3(1.0, 0.0, 0.0);
+	return makeIntersection(normal * radiusFirst, center - normal * radiusSecond, normal, radiusSum - dist);
+}
+
+// first is a box with half extents scaleFirst, second is a sphere
+std::optional<Intersection> intersectsBoxSphere(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond) {
+	if(!isUniformScale(scaleSecond)) return intersectsTransformed(first, second, relativeTransform, scaleFirst, scaleSecond);
+
+	double radius = scaleSecond[0];
+	Vec3 center = relativeTransform.position;
+	Vec3 closest(std::clamp(center.x, -scaleFirst[0], scaleFirst[0]), std::clamp(center.y, -scaleFirst[1], scaleFirst[1]), std::clamp(center.z, -scaleFirst[2], scaleFirst[2]));
+	Vec3 delta = center - closest;
+	double distSq = lengthSquared(delta);
+
+	if(distSq > 0.0) {
+		if(distSq > radius * radius) return std::optional<Intersection>();
+		double dist = std::sqrt(distSq);
+		Vec3 normal = delta / dist;
+		return makeIntersection(closest, center - normal * radius, normal, radius - dist);
+	}
+
+	// the center of the sphere is inside the box, push it out through the nearest face
+	int nearestAxis = 0;
+	double nearestFaceDist = scaleFirst[0] - std::abs(center.x);
+	for(int axis = 1; axis < 3; axis++) {
+		double faceDist = scaleFirst[axis] - std::abs(center[axis]);
+		if(faceDist < nearestFaceDist) {
+			nearestAxis = axis;
+			nearestFaceDist = faceDist;
+		}
+	}
+	Vec3 normal(0.0, 0.0, 0.0);
+	normal[nearestAxis] = center[nearestAxis] < 0.0 ? -1.0 : 1.0;
+	Vec3 facePoint = center;
+	facePoint[nearestAxis] = normal[nearestAxis] * scaleFirst[nearestAxis];
+	return makeIntersection(facePoint, center - normal * radius, normal, nearestFaceDist + radius);
+}
+
+// the center of the feature of the box that lies furthest in the given direction, a face, edge or vertex depending on the direction
+static Vec3 deepestFeatureCenter(const Vec3& center, const Vec3 axes[3], const DiagonalMat3& halfExtents, const Vec3& direction) {
+	Vec3 result = center;
+	for(int i = 0; i < 3; i++) {
+		double d = axes[i] * direction;
+		if(std::abs(d) > DIRECTION_EPSILON) {
+			result += axes[i] * (d > 0.0 ? halfExtents[i] : -halfExtents[i]);
+		}
+	}
+	return result;
+}
+
+// the points on the lines p1 + t*d1 and p2 + s*d2 closest to eachother, t and s are clamped to the given half lengths
+static void closestPointsOnSegments(const Vec3& p1, const Vec3& d1, double halfLength1, const Vec3& p2, const Vec3& d2, double halfLength2, Vec3& closest1, Vec3& closest2) {
+	Vec3 r = p1 - p2;
+	double b = d1 * d2;
+	double c = d1 * r;
+	double f = d2 * r;
+	double denom = 1.0 - b * b;
+	double t = (denom > DIRECTION_EPSILON) ? (b * f - c) / denom : 0.0;
+	t = std::clamp(t, -halfLength1, halfLength1);
+	double s = std::clamp(b * t + f, -halfLength2, halfLength2);
+	t = std::clamp(b * s - c, -halfLength1, halfLength1);
+	closest1 = p1 + d1 * t;
+	closest2 = p2 + d2 * s;
+}
+
+// separating axis test between two oriented boxes, first is axis aligned
+std::optional<Intersection> intersectsBoxBox(const GenericCollidable&, const GenericCollidable&, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond) {
+	const Vec3 axesFirst[3]{Vec3(1.0, 0.0, 0.0), Vec3(0.0, 1.0, 0.0), Vec3(0.0, 0.0, 1.0)};
+	const Vec3 axesSecond[3]{relativeTransform.rotation.getX(), relativeTransform.rotation.getY(), relativeTransform.rotation.getZ()};
+	Vec3 center = relativeTransform.position;
+
+	auto projectedOverlap = [&](const Vec3& axis) {
+		double radiusFirst = 0.0;
+		double radiusSecond = 0.0;
+		for(int i = 0; i < 3; i++) {
+			radiusFirst += scaleFirst[i] * std::abs(axesFirst[i] * axis);
+			radiusSecond += scaleSecond[i] * std::abs(axesSecond[i] * axis);
+		}
+		return radiusFirst + radiusSecond - std::abs(center * axis);
+	};
+
+	// 0-2 faces of first, 3-5 faces of second, 6-14 edge pairs
+	double bestOverlap = std::numeric_limits<double>::infinity();
+	Vec3 bestAxis;
+	int bestAxisIndex = -1;
+	for(int i = 0; i < 6; i++) {
+		const Vec3& axis = (i < 3) ? axesFirst[i] : axesSecond[i - 3];
+		double overlap = projectedOverlap(axis);
+		if(overlap < 0.0) return std::optional<Intersection>();
+		if(overlap < bestOverlap) {
+			bestOverlap = overlap;
+			bestAxis = axis;
+			bestAxisIndex = i;
+		}
+	}
+	double bestFaceOverlap = bestOverlap;
+	for(int i = 0; i < 3; i++) {
+		for(int j = 0; j < 3; j++) {
+			Vec3 axis = axesFirst[i] % axesSecond[j];
+			double axisLength = length(axis);
+			// parallel edges, already covered by the face axes
+			if(axisLength < DIRECTION_EPSILON) continue;
+			axis /= axisLength;
+			double overlap = projectedOverlap(axis);
+			if(overlap < 0.0) return std::optional<Intersection>();
+			if(overlap < bestOverlap && overlap < bestFaceOverlap * EDGE_AXIS_BIAS) {
+				bestOverlap = overlap;
+				bestAxis = axis;
+				bestAxisIndex = 6 + i * 3 + j;
+			}
+		}
+	}
+
+	Vec3 normal = (center * bestAxis < 0.0) ? -bestAxis : bestAxis;
+	Vec3 origin(0.0, 0.0, 0.0);
+	if(bestAxisIndex < 3) {
+		// face of first, the deepest feature of second is clamped onto that face
+		Vec3 deepestOfSecond = deepestFeatureCenter(center, axesSecond, scaleSecond, -normal);
+		Vec3 deepestOfFirst = deepestOfSecond + normal * bestOverlap;
+		for(int i = 0; i < 3; i++) {
+			if(i == bestAxisIndex) continue;
+			deepestOfSecond[i] = std::clamp(deepestOfSecond[i], -scaleFirst[i], scaleFirst[i]);
+			deepestOfFirst[i] = deepestOfSecond[i];
+		}
+		return makeIntersection(deepestOfFirst, deepestOfSecond, normal, bestOverlap);
+	} else if(bestAxisIndex < 6) {
+		// face of second, the deepest feature of first is clamped onto that face
+		Vec3 deepestOfFirst = deepestFeatureCenter(origin, axesFirst, scaleFirst, normal);
+		Vec3 localToSecond = relativeTransform.globalToLocal(deepestOfFirst);
+		int faceAxis = bestAxisIndex - 3;
+		for(int i = 0; i < 3; i++) {
+			if(i == faceAxis) continue;
+			localToSecond[i] = std::clamp(localToSecond[i], -scaleSecond[i], scaleSecond[i]);
+		}
+		deepestOfFirst = relativeTransform.localToGlobal(localToSecond);
+		return makeIntersection(deepestOfFirst, deepestOfFirst - normal * bestOverlap, normal, bestOverlap);
+	} else {
+		// edge-edge, the contact is between the closest points of the two edges
+		int edgeFirst = (bestAxisIndex - 6) / 3;
+		int edgeSecond = (bestAxisIndex - 6) % 3;
+		Vec3 edgeCenterFirst = deepestFeatureCenter(origin, axesFirst, scaleFirst, normal);
+		edgeCenterFirst -= axesFirst[edgeFirst] * (axesFirst[edgeFirst] * edgeCenterFirst);
+		Vec3 edgeCenterSecond = deepestFeatureCenter(center, axesSecond, scaleSecond, -normal);
+		edgeCenterSecond -= axesSecond[edgeSecond] * (axesSecond[edgeSecond] * (edgeCenterSecond - center));
+		Vec3 closestFirst;
+		Vec3 closestSecond;
+		closestPointsOnSegments(edgeCenterFirst, axesFirst[edgeFirst], scaleFirst[edgeFirst], edgeCenterSecond, axesSecond[edgeSecond], scaleSecond[edgeSecond], closestFirst, closestSecond);
+		return makeIntersection(closestFirst, closestSecond, normal, bestOverlap);
+	}
+}
+
+// first is a cylinder along z with radius scaleFirst[0] and half height scaleFirst[2], second is a sphere
+std::optional<Intersection> intersectsCylinderSphere(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond) {
+	if(scaleFirst[0] != scaleFirst[1] || !isUniformScale(scaleSecond)) return intersectsTransformed(first, second, relativeTransform, scaleFirst, scaleSecond);
+
+	double cylinderRadius = scaleFirst[0];
+	double halfHeight = scaleFirst[2];
+	double radius = scaleSecond[0];
+	Vec3 center = relativeTransform.position;
+
+	double radialDist = std::sqrt(center.x * center.x + center.y * center.y);
+	Vec3 radialDir = (radialDist > DIRECTION_EPSILON) ? Vec3(center.x / radialDist, center.y / radialDist, 0.0) : Vec3(1.0, 0.0, 0.0);
+
+	Vec3 closest = center;
+	if(radialDist > cylinderRadius) {
+		closest.x = radialDir.x * cylinderRadius;
+		closest.y = radialDir.y * cylinderRadius;
+	}
+	closest.z = std::clamp(center.z, -halfHeight, halfHeight);
+	Vec3 delta = center - closest;
+	double distSq = lengthSquared(delta);
+
+	if(distSq > 0.0) {
+		if(distSq > radius * radius) return std::optional<Intersection>();
+		double dist = std::sqrt(distSq);
+		Vec3 normal = delta / dist;
+		return makeIntersection(closest, center - normal * radius, normal, radius - dist);
+	}
+
+	// the center of the sphere is inside the cylinder, push it out through the nearest side or cap
+	double sideDist = cylinderRadius - radialDist;
+	double capDist = halfHeight - std::abs(center.z);
+	Vec3 normal;
+	Vec3 surfacePoint = center;
+	double surfaceDist;
+	if(sideDist < capDist) {
+		normal = radialDir;
+		surfacePoint.x = radialDir.x * cylinderRadius;
+		surfacePoint.y = radialDir.y * cylinderRadius;
+		surfaceDist = sideDist;
+	} else {
+		normal = Vec3(0.0, 0.0, center.z < 0.0 ? -1.0 : 1.0);
+		surfacePoint.z = normal.z * halfHeight;
+		surfaceDist = capDist;
+	}
+	return makeIntersection(surfacePoint, center - normal * radius, normal, surfaceDist + radius);
+}
+
+/*
+	Terrain triangles always push second out of their front, by how deep the furthest point of second behind the triangle plane lies
+	EPA on a lone triangle would often slide second out sideways past its edge, or out through the back into the terrain
+*/
+static std::optional<Intersection> pushOutOfFront(const Vec3& normal, const Vec3& pointOnTriangle, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleSecond) {
+	Vec3f localDirection(scaleSecond * relativeTransform.relativeToLocal(-normal));
+	Vec3 deepestPoint = relativeTransform.localToGlobal(scaleSecond * Vec3(second.furthestInDirection(localDirection)));
+	double depth = (pointOnTriangle - deepestPoint) * normal;
+	if(depth <= 0.0) return std::optional<Intersection>();
+	return Intersection(deepestPoint + normal * (depth * 0.5), normal * depth);
+}
+
+std::optional<Intersection> intersectsTriangleMesh(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond) {
+	const TriangleMeshShapeClass& mesh = static_cast<const TriangleMeshShapeClass&>(first);
+	const ShapeClass& other = static_cast<const ShapeClass&>(second);
+	// meshes are terrain, terrain never collides with terrain
+	if(other.intersectionClassID == TRIANGLE_MESH_CLASS_ID) return std::optional<Intersection>();
+
+	BoundingBox otherBounds = other.getBounds(relativeTransform.getRotation(), scaleSecond);
+	DiagonalMat3 inverseScale = ~scaleFirst;
+	BoundingBoxTemplate<float> query(Vec3f(inverseScale * (otherBounds.min + relativeTransform.position)), Vec3f(inverseScale * (otherBounds.max + relativeTransform.position)));
+
+	std::optional<Intersection> deepest;
+	double deepestDepthSq = -1.0;
+	mesh.getBVH().forEachOverlapping(query, [&](int triangleIndex) {
+		TriangleCollidable triangle(mesh.getMesh(), triangleIndex);
+		Vec3 v0 = scaleFirst * Vec3(triangle.vertices[0]);
+		Vec3 normalVec = (scaleFirst * Vec3(triangle.vertices[1]) - v0) % (scaleFirst * Vec3(triangle.vertices[2]) - v0);
+		double normalLengthSq = lengthSquared(normalVec);
+		if(normalLengthSq == 0.0) return;
+
+		// GJK only decides whether second touches the triangle, the exit vector always comes from the triangle normal
+		ColissionPair info{triangle, second, relativeTransform, scaleFirst, scaleSecond};
+		if(!runGJKTransformed(info, Vec3f(-relativeTransform.position))) return;
+		std::optional<Intersection> result = pushOutOfFront(normalVec / std::sqrt(normalLengthSq), v0, second, relativeTransform, scaleSecond);
+		if(!result) return;
+
+		double depthSq = lengthSquared(result->exitVector);
+		if(depthSq > deepestDepthSq) {
+			deepestDepthSq = depthSq;
+			deepest = result;
+		}
+	});
+	return deepest;
+}
+
+static constexpr std::size_t SPECIALIZED_CLASS_COUNT = CORNER_CLASS_ID + 1;
+
+/*
+	Indexed by [first.intersectionClassID][second.intersectionClassID]
+	Wedges, corners and polyhedra are left to GJK + EPA, as are classes added outside of the builtin ones
+*/
+static const IntersectionFunction specializedIntersections[SPECIALIZED_CLASS_COUNT][SPECIALIZED_CLASS_COUNT]{
+	/*                   CUBE                          SPHERE                             CYLINDER  WEDGE    CORNER */
+	/* CUBE     */ {intersectsBoxBox,               intersectsBoxSphere,                nullptr,  nullptr, nullptr},
+	/* SPHERE   */ {swapped<intersectsBoxSphere>,   intersectsSphereSphere,             swapped<intersectsCylinderSphere>, nullptr, nullptr},
+	/* CYLINDER */ {nullptr,                        intersectsCylinderSphere,           nullptr,  nullptr, nullptr},
+	/* WEDGE    */ {nullptr,                        nullptr,                            nullptr,  nullptr, nullptr},
+	/* CORNER   */ {nullptr,                        nullptr,                            nullptr,  nullptr, nullptr}
+};
+
+IntersectionFunction getSpecializedIntersection(std::size_t firstClassID, std::size_t secondClassID) {
+	if(firstClassID == TRIANGLE_MESH_CLASS_ID) return intersectsTriangleMesh;
+	if(secondClassID == TRIANGLE_MESH_CLASS_ID) return swapped<intersectsTriangleMesh>;
+	if(firstClassID >= SPECIALIZED_CLASS_COUNT || secondClassID >= SPECIALIZED_CLASS_COUNT) return nullptr;
+	return specializedIntersections[firstClassID][secondClassID];
+}
+};
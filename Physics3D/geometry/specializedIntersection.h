@@ -0,0 +1,29 @@
+#pragma once
+
+#include <optional>
+#include <cstddef>
+
+#include "intersection.h"
+
+namespace P3D {
+/*
+	Closed form intersection routines for pairs of builtin ShapeClasses, these follow the same contract as the generic GJK + EPA path:
+	relativeTransform is the transform of second relative to first, the resulting intersection and exitVector are local to first,
+	exitVector is how far second must move to no longer intersect first
+*/
+typedef std::optional<Intersection>(*IntersectionFunction)(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond);
+
+// the routine for the given pair of ShapeClass::intersectionClassIDs, or nullptr if the pair should use GJK + EPA
+IntersectionFunction getSpecializedIntersection(std::size_t firstClassID, std::size_t secondClassID);
+
+std::optional<Intersection> intersectsSphereSphere(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond);
+std::optional<Intersection> intersectsBoxSphere(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond);
+std::optional<Intersection> intersectsBoxBox(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond);
+std::optional<Intersection> intersectsCylinderSphere(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond);
+
+/*
+	first is a TriangleMeshShapeClass, only the triangles whose bounds overlap second are tested, the deepest result is kept
+	Triangles only push second out of their front, a pair with the mesh as second is handled by swapping
+*/
+std::optional<Intersection> intersectsTriangleMesh(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond);
+};
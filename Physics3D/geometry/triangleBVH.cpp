@@ -0,0 +1,81 @@
+#include "triangleBVH.h"
+
+#include "triangleMesh.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace P3D {
+static BoundingBoxTemplate<float> emptyBounds() {
+	float inf = std::numeric_limits<float>::infinity();
+	return BoundingBoxTemplate<float>(inf, inf, inf, -inf, -inf, -inf);
+}
+
+TriangleBVH::TriangleBVH(const TriangleMesh& mesh) {
+	int triangleCount = mesh.triangleCount;
+	if(triangleCount == 0) return;
+
+	std::vector<BoundingBoxTemplate<float>> triangleBounds(triangleCount);
+	std::vector<Vec3f> centers(triangleCount);
+	triangleOrder.resize(triangleCount);
+	for(int i = 0; i < triangleCount; i++) {
+		Triangle triangle = mesh.getTriangle(i);
+		Vec3f a = mesh.getVertex(triangle.firstIndex);
+		Vec3f b = mesh.getVertex(triangle.secondIndex);
+		Vec3f c = mesh.getVertex(triangle.thirdIndex);
+		triangleBounds[i] = BoundingBoxTemplate<float>(a, a).expanded(b).expanded(c);
+		centers[i] = (a + b + c) / 3.0f;
+		triangleOrder[i] = i;
+	}
+
+	// a binary tree with at least one triangle per leaf never has more than 2n - 1 nodes
+	nodes.reserve(2 * triangleCount);
+	build(triangleBounds, centers, 0, triangleCount);
+
+	orderedBounds.resize(triangleCount);
+	for(int i = 0; i < triangleCount; i++) {
+		orderedBounds[i] = triangleBounds[triangleOrder[i]];
+	}
+}
+
+int TriangleBVH::build(const std::vector<BoundingBoxTemplate<float>>& triangleBounds, const std::vector<Vec3f>& centers, int first, int last) {
+	int nodeIndex = static_cast<int>(nodes.size());
+	nodes.push_back(TriangleBVHNode{emptyBounds(), first, last - first});
+
+	BoundingBoxTemplate<float> bounds = emptyBounds();
+	BoundingBoxTemplate<float> centerBounds = emptyBounds();
+	for(int i = first; i < last; i++) {
+		bounds = bounds.expanded(triangleBounds[triangleOrder[i]]);
+		centerBounds = centerBounds.expanded(centers[triangleOrder[i]]);
+	}
+	nodes[nodeIndex].bounds = bounds;
+	if(last - first <= TRIANGLE_BVH_LEAF_SIZE) return nodeIndex;
+
+	Vec3f extent = centerBounds.max - centerBounds.min;
+	int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+	int middle = first + (last - first) / 2;
+	std::nth_element(triangleOrder.begin() + first, triangleOrder.begin() + middle, triangleOrder.begin() + last, [&](int a, int b) {
+		return centers[a][axis] < centers[b][axis];
+	});
+
+	build(triangleBounds, centers, first, middle);
+	int secondChild = build(triangleBounds, centers, middle, last);
+	nodes[nodeIndex].start = secondChild;
+	nodes[nodeIndex].triangleCount = 0;
+	return nodeIndex;
+}
+
+bool TriangleBVH::rayHitsBox(const Vec3f& origin, const Vec3f& inverseDirection, const BoundingBoxTemplate<float>& box) {
+	float entry = 0.0f;
+	float exit = std::numeric_limits<float>::infinity();
+	for(int axis = 0; axis < 3; axis++) {
+		float t1 = (box.min[axis] - origin[axis]) * inverseDirection[axis];
+		float t2 = (box.max[axis] - origin[axis]) * inverseDirection[axis];
+		// a ray parallel to a slab gives +-infinity for both, or NaN when it lies exactly on a side, which is kept as a hit
+		if(t1 != t1 || t2 != t2) continue;
+		entry = std::max(entry, std::min(t1, t2));
+		exit = std::min(exit, std::max(t1, t2));
+	}
+	return entry <= exit;
+}
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "../math/linalg/vec.h"
+#include "../math/boundingBox.h"
+
+#include <vector>
+
+namespace P3D {
+class TriangleMesh;
+
+// at most this many triangles are kept in one leaf
+#define TRIANGLE_BVH_LEAF_SIZE 4
+
+/*
+	Inner nodes have triangleCount 0, their first child directly follows them, their second child is at index start
+	Leaves hold triangleOrder[start .. start + triangleCount]
+*/
+struct TriangleBVHNode {
+	BoundingBoxTemplate<float> bounds;
+	int start;
+	int triangleCount;
+};
+
+/*
+	A flat, static bounding volume hierarchy over the triangles of one mesh
+	Built once by splitting the triangles at the median of their centers along the longest axis, such that the depth is logarithmic in the triangle count
+*/
+class TriangleBVH {
+	std::vector<TriangleBVHNode> nodes;
+	std::vector<int> triangleOrder;
+	// the bounds of triangleOrder[i], such that leaves can skip their triangles without reading the mesh
+	std::vector<BoundingBoxTemplate<float>> orderedBounds;
+
+	int build(const std::vector<BoundingBoxTemplate<float>>& triangleBounds, const std::vector<Vec3f>& centers, int first, int last);
+
+public:
+	TriangleBVH() = default;
+	explicit TriangleBVH(const TriangleMesh& mesh);
+
+	std::size_t getNodeCount() const { return nodes.size(); }
+	const TriangleBVHNode& getNode(std::size_t index) const { return nodes[index]; }
+
+	// calls func(int triangleIndex) for every triangle whose bounds overlap box
+	template<typename Func>
+	void forEachOverlapping(const BoundingBoxTemplate<float>& box, const Func& func) const {
+		if(nodes.empty()) return;
+		int stack[64];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+		while(stackSize > 0) {
+			int nodeIndex = stack[--stackSize];
+			const TriangleBVHNode& node = nodes[nodeIndex];
+			if(!node.bounds.intersects(box)) continue;
+			if(node.triangleCount != 0) {
+				for(int i = node.start; i < node.start + node.triangleCount; i++) {
+					if(orderedBounds[i].intersects(box)) func(triangleOrder[i]);
+				}
+			} else {
+				stack[stackSize++] = node.start;
+				stack[stackSize++] = nodeIndex + 1;
+			}
+		}
+	}
+
+	// calls func(int triangleIndex) for every triangle in a leaf that the ray origin + t * direction with t >= 0 passes through
+	template<typename Func>
+	void forEachAlongRay(const Vec3f& origin, const Vec3f& direction, const Func& func) const {
+		if(nodes.empty()) return;
+		Vec3f inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+		int stack[64];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+		while(stackSize > 0) {
+			int nodeIndex = stack[--stackSize];
+			const TriangleBVHNode& node = nodes[nodeIndex];
+			if(!rayHitsBox(origin, inverseDirection, node.bounds)) continue;
+			if(node.triangleCount != 0) {
+				for(int i = node.start; i < node.start + node.triangleCount; i++) {
+					func(triangleOrder[i]);
+				}
+			} else {
+				stack[stackSize++] = node.start;
+				stack[stackSize++] = nodeIndex + 1;
+			}
+		}
+	}
+
+	static bool rayHitsBox(const Vec3f& origin, const Vec3f& inverseDirection, const BoundingBoxTemplate<float>& box);
+};
+};
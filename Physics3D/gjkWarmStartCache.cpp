@@ -0,0 +1,32 @@
+#include "gjkWarmStartCache.h"
+
+namespace P3D {
+Vec3f& GJKWarmStartCache::getSearchDirection(const Part* p1, const Part* p2) {
+	Shard& shard = shards[PartPairKeyHash()(PartPairKey{p1, p2}) % SHARD_COUNT];
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	// unordered_map never moves its elements, so the reference outlives the lock
+	return shard.searchDirections.getOrAdd(p1, p2, Vec3f(0.0f, 0.0f, 0.0f));
+}
+
+void GJKWarmStartCache::removeStaleEntries() {
+	for(Shard& shard : shards) {
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.searchDirections.removeStaleEntries();
+	}
+}
+
+void GJKWarmStartCache::clear() {
+	for(Shard& shard : shards) {
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.searchDirections.clear();
+	}
+}
+
+std::size_t GJKWarmStartCache::size() const {
+	std::size_t total = 0;
+	for(const Shard& shard : shards) {
+		total += shard.searchDirections.size();
+	}
+	return total;
+}
+};
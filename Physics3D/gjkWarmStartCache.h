@@ -0,0 +1,49 @@
+#pragma once
+
+#include <mutex>
+#include <cstddef>
+
+#include "math/linalg/vec.h"
+#include "partPairMap.h"
+
+namespace P3D {
+class Part;
+
+/*
+	Remembers the last GJK search direction of every part pair that was narrowphased, local to the first part of the pair
+
+	Parts barely move between ticks, so the direction that separated a pair last tick usually still does,
+	GJK then rejects the pair with a single support query. Colliding pairs get the direction GJK ended on as their seed.
+	The directions are only used as seeds, so a stale or reused entry costs iterations, never correctness.
+
+	Entries are spread over a number of shards with their own lock, such that pairs can be refined on multiple threads
+*/
+class GJKWarmStartCache {
+	struct Shard {
+		std::mutex mutex;
+		// zero when GJK has not run for the pair yet
+		PartPairMap<Vec3f> searchDirections;
+	};
+
+	static constexpr std::size_t SHARD_COUNT = 16;
+	Shard shards[SHARD_COUNT];
+
+public:
+	GJKWarmStartCache() = default;
+	GJKWarmStartCache(const GJKWarmStartCache&) = delete;
+	GJKWarmStartCache& operator=(const GJKWarmStartCache&) = delete;
+
+	/*
+		The search direction stored for the given pair, to be passed to and updated by intersectsTransformed
+		The returned reference remains valid until the next removeStaleEntries or clear
+		Safe to call from multiple threads, as long as every pair is only queried by one thread at a time
+	*/
+	Vec3f& getSearchDirection(const Part* p1, const Part* p2);
+
+	// removes the pairs that were not queried since the previous call, should be called once per tick
+	void removeStaleEntries();
+	void clear();
+
+	std::size_t size() const;
+};
+};
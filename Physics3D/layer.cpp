@@ -1,14 +1,19 @@
 #include "layer.h"
 #include "world.h"
+#include "colissionPreTests.h"
 
 #include "misc/validityHelper.h"
 #include "misc/debug.h"
 #include "misc/physicsProfiler.h"
+#include "threading/threadPool.h"
 
 #include <assert.h>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
 
 namespace P3D {
-WorldLayer::WorldLayer(ColissionLayer* parent) : parent(parent) {}
+WorldLayer::WorldLayer(ColissionLayer* parent) : parent(parent), usesFatBounds(false) {}
 
 WorldLayer::~WorldLayer() {
 	tree.forEach([](Part& p) {
@@ -18,7 +23,8 @@ WorldLayer::~WorldLayer() {
 
 WorldLayer::WorldLayer(WorldLayer&& other) noexcept :
 	tree(std::move(other.tree)),
-	parent(other.parent) {
+	parent(other.parent),
+	usesFatBounds(other.usesFatBounds) {
 
 	tree.forEach([this, &other](Part& p) {
 		assert(p.layer = &other);
@@ -28,6 +34,7 @@ WorldLayer::WorldLayer(WorldLayer&& other) noexcept :
 WorldLayer& WorldLayer::operator=(WorldLayer&& other) noexcept {
 	std::swap(tree, other.tree);
 	std::swap(parent, other.parent);
+	std::swap(usesFatBounds, other.usesFatBounds);
 
 	tree.forEach([this, &other](Part& p) {
 		assert(p.layer = &other);
@@ -40,15 +47,59 @@ WorldLayer& WorldLayer::operator=(WorldLayer&& other) noexcept {
 	return *this;
 }
 
+// the number of trunks improveStructureBudgeted may visit per refresh, this is a trunk count instead of a time limit to keep the simulation deterministic
+static constexpr int IMPROVE_STRUCTURE_TRUNKS_PER_REFRESH = 256;
+
+// fat bounds are large enough to contain the part for this many ticks at its current velocity
+static constexpr double FAT_BOUNDS_VELOCITY_TICKS = 4.0;
+// extra margin for parts that change direction or rotate, relative to the size of the part
+static constexpr double FAT_BOUNDS_MARGIN_FACTOR = 0.1;
+
+static BoundsTemplate<float> computeFatBounds(const Part& part, const BoundsTemplate<float>& currentBounds, double deltaT) {
+	BoundsTemplate<float> exactBounds = part.getBounds();
+	if(currentBounds.contains(exactBounds)) return currentBounds;
+
+	Vec3 expectedMovement = part.getVelocity() * (deltaT * FAT_BOUNDS_VELOCITY_TICKS);
+	BoundsTemplate<float> fatBounds = exactBounds.expanded(static_cast<float>(part.maxRadius * FAT_BOUNDS_MARGIN_FACTOR));
+	// only extend the bounds in the direction the part is moving in
+	Vec3f extendMin(static_cast<float>(std::min(expectedMovement.x, 0.0)), static_cast<float>(std::min(expectedMovement.y, 0.0)), static_cast<float>(std::min(expectedMovement.z, 0.0)));
+	Vec3f extendMax(static_cast<float>(std::max(expectedMovement.x, 0.0)), static_cast<float>(std::max(expectedMovement.y, 0.0)), static_cast<float>(std::max(expectedMovement.z, 0.0)));
+	return BoundsTemplate<float>(fatBounds.min + extendMin, fatBounds.max + extendMax);
+}
+
 void WorldLayer::refresh() {
 	physicsMeasure.mark(PhysicsProcess::UPDATE_TREE_BOUNDS);
-	tree.recalculateBounds();
+	refreshBounds();
 	physicsMeasure.mark(PhysicsProcess::UPDATE_TREE_STRUCTURE);
-	tree.improveStructure();
+	refreshStructure();
+}
+
+void WorldLayer::refreshBounds() {
+	if(usesFatBounds) {
+		double deltaT = parent->world->deltaT;
+		tree.refitDirty([deltaT](const Part& part, const BoundsTemplate<float>& currentBounds) {
+			return computeFatBounds(part, currentBounds, deltaT);
+		});
+	} else {
+		tree.refitDirty();
+	}
+}
+
+void WorldLayer::refreshStructure() {
+	tree.improveStructureBudgeted(IMPROVE_STRUCTURE_TRUNKS_PER_REFRESH);
+}
+
+void WorldLayer::markGroupDirty(const Part* groupRep) {
+	unfreeze();
+	tree.markGroupDirty(groupRep);
+	notifyGroupChanged(groupRep);
 }
 
 void WorldLayer::addPart(Part* newPart) {
+	unfreeze();
 	tree.add(newPart);
+	notifyTerrainChanged();
+	notifyPairCacheOfPart(newPart);
 }
 
 static void addMotorPhysToGroup(BoundsTree<Part>& tree, MotorizedPhysical* phys, Part* group) {
@@ -78,6 +129,7 @@ void WorldLayer::addIntoGroup(Part* newPart, Part* group) {
 	assert(newPart->layer == nullptr);
 	assert(group->layer == this);
 
+	unfreeze();
 	Physical* partPhys = newPart->getPhysical();
 	if(partPhys != nullptr) {
 		MotorizedPhysical* mainPhys = partPhys->mainPhysical;
@@ -87,41 +139,113 @@ void WorldLayer::addIntoGroup(Part* newPart, Part* group) {
 		tree.addToGroup(newPart, group);
 		newPart->layer = this;
 	}
+	notifyTerrainChanged();
+	notifyGroupChanged(group);
 }
 
 void WorldLayer::moveOutOfGroup(Part* part) {
+	unfreeze();
 	this->tree.moveOutOfGroup(part);
+	notifyPairCacheOfPart(part);
 }
 
 void WorldLayer::removePart(Part* partToRemove) {
 	assert(partToRemove->layer == this);
+	unfreeze();
 	tree.remove(partToRemove);
+	notifyTerrainChanged();
+	if(parent->pairCache != nullptr && !isTerrainLayer()) {
+		parent->pairCache->removePart(partToRemove);
+	}
 	parent->world->onPartRemoved(partToRemove);
 	partToRemove->layer = nullptr;
 }
 
 void WorldLayer::notifyPartBoundsUpdated(const Part* updatedPart, const Bounds& oldBounds) {
+	unfreeze();
 	tree.updateObjectBounds(updatedPart, oldBounds);
+	notifyTerrainChanged();
+	notifyGroupChanged(updatedPart);
 }
 void WorldLayer::notifyPartGroupBoundsUpdated(const Part* mainPart, const Bounds& oldMainPartBounds) {
+	unfreeze();
 	tree.updateObjectGroupBounds(mainPart, oldMainPartBounds);
+	notifyTerrainChanged();
+	notifyGroupChanged(mainPart);
 }
 
 void WorldLayer::notifyPartStdMoved(Part* oldPartPtr, Part* newPartPtr) noexcept {
+	unfreeze();
 	tree.findAndReplaceObject(oldPartPtr, newPartPtr, newPartPtr->getBounds());
+	notifyTerrainChanged();
+	if(parent->pairCache != nullptr && !isTerrainLayer()) {
+		parent->pairCache->removePart(oldPartPtr);
+		parent->pairCache->markDirty(newPartPtr);
+	}
+}
+
+void WorldLayer::notifyGroupChanged(const Part* groupRep) {
+	if(parent->pairCache == nullptr || isTerrainLayer()) return;
+	// free parts always have a physical
+	MotorizedPhysical* mainPhys = groupRep->getMainPhysical();
+	mainPhys->forEachPart([this](Part& part) {
+		if(part.layer == this) parent->pairCache->markDirty(&part);
+	});
+}
+
+void WorldLayer::unfreeze() {
+	if(!isTerrainLayer() || parent->frozenTerrain == nullptr || !parent->frozenTerrain->isBuilt()) return;
+	// the frozen terrain is stale from here on, it is built again in the next refresh
+	parent->frozenTerrain->addAllTo(tree);
+	parent->frozenTerrain->clear();
+}
+
+const FrozenBoundsTree<Part>* WorldLayer::getFrozenParts() const {
+	if(!isTerrainLayer()) return nullptr;
+	return parent->getFrozenTerrain();
+}
+
+bool WorldLayer::contains(const Part* part) const {
+	if(const FrozenBoundsTree<Part>* frozen = getFrozenParts()) return frozen->contains(part);
+	return tree.contains(part);
 }
 
+void WorldLayer::notifyPairCacheOfPart(Part* part) {
+	if(parent->pairCache != nullptr && !isTerrainLayer()) {
+		parent->pairCache->markDirty(part);
+	}
+}
+
+bool WorldLayer::isTerrainLayer() const {
+	return this == &parent->subLayers[ColissionLayer::TERRAIN_PARTS_LAYER];
+}
+
+// free parts are checked by the pair cache every tick, terrain is only rechecked when it is known to have changed
+// the frozen terrain has already been cleared by unfreeze
+void WorldLayer::notifyTerrainChanged() {
+	if(parent->pairCache != nullptr && isTerrainLayer()) {
+		parent->pairCache->invalidateTerrain();
+	}
+	if(parent->sweepAndPrune != nullptr && isTerrainLayer()) {
+		parent->sweepAndPrune->invalidateTerrain();
+	}
+}
+
+// pairs between parts of the same physical are skipped by the pair cache anyway, so merging groups doesn't concern it
 void WorldLayer::mergeGroups(Part* first, Part* second) {
+	unfreeze();
 	this->tree.mergeGroups(first, second);
 }
 
 // TODO can be optimized, this only needs to move the single partToMove node
 void WorldLayer::moveIntoGroup(Part* partToMove, Part* group) {
+	unfreeze();
 	this->tree.mergeGroups(partToMove, group);
 }
 
 // TODO can be optimized, this only needs to move the single part nodes
 void WorldLayer::joinPartsIntoNewGroup(Part* p1, Part* p2) {
+	unfreeze();
 	this->tree.mergeGroups(p1, p2);
 }
 
@@ -142,20 +266,25 @@ int ColissionLayer::getID() const {
 	return static_cast<int>(this - &world->layers[0]);
 }
 
-ColissionLayer::ColissionLayer() : world(nullptr), collidesInternally(true), subLayers{WorldLayer(this), WorldLayer(this)} {}
-ColissionLayer::ColissionLayer(WorldPrototype* world, bool collidesInternally) : world(world), collidesInternally(collidesInternally), subLayers{WorldLayer(this), WorldLayer(this)} {}
+ColissionLayer::ColissionLayer() : subLayers{WorldLayer(this), WorldLayer(this)}, world(nullptr), collidesInternally(true), usesContinuousColission(false) {}
+ColissionLayer::ColissionLayer(WorldPrototype* world, bool collidesInternally) : subLayers{WorldLayer(this), WorldLayer(this)}, world(world), collidesInternally(collidesInternally), usesContinuousColission(false) {}
 
-ColissionLayer::ColissionLayer(ColissionLayer&& other) noexcept : world(other.world), collidesInternally(other.collidesInternally), subLayers{std::move(other.subLayers[0]), std::move(other.subLayers[1])} {
+ColissionLayer::ColissionLayer(ColissionLayer&& other) noexcept : subLayers{std::move(other.subLayers[0]), std::move(other.subLayers[1])}, world(other.world), collidesInternally(other.collidesInternally), usesContinuousColission(other.usesContinuousColission), pairCache(std::move(other.pairCache)), sweepAndPrune(std::move(other.sweepAndPrune)), frozenTerrain(std::move(other.frozenTerrain)) {
 	other.world = nullptr;
 
 	for(WorldLayer& l : subLayers) {
 		l.parent = this;
 	}
+	setLayerOfFrozenParts(&subLayers[TERRAIN_PARTS_LAYER]);
 }
 ColissionLayer& ColissionLayer::operator=(ColissionLayer&& other) noexcept {
 	std::swap(this->world, other.world);
 	std::swap(this->subLayers, other.subLayers);
 	std::swap(this->collidesInternally, other.collidesInternally);
+	std::swap(this->usesContinuousColission, other.usesContinuousColission);
+	std::swap(this->pairCache, other.pairCache);
+	std::swap(this->sweepAndPrune, other.sweepAndPrune);
+	std::swap(this->frozenTerrain, other.frozenTerrain);
 
 	for(WorldLayer& l : subLayers) {
 		l.parent = this;
@@ -163,35 +292,140 @@ ColissionLayer& ColissionLayer::operator=(ColissionLayer&& other) noexcept {
 	for(WorldLayer& l : other.subLayers) {
 		l.parent = &other;
 	}
+	setLayerOfFrozenParts(&subLayers[TERRAIN_PARTS_LAYER]);
+	other.setLayerOfFrozenParts(&other.subLayers[TERRAIN_PARTS_LAYER]);
 	return *this;
 }
+ColissionLayer::~ColissionLayer() {
+	setLayerOfFrozenParts(nullptr);
+}
+
+void ColissionLayer::setLayerOfFrozenParts(WorldLayer* newLayer) {
+	if(const FrozenBoundsTree<Part>* frozen = getFrozenTerrain()) {
+		frozen->forEach([newLayer](Part& p) {
+			p.layer = newLayer;
+		});
+	}
+}
 
 void ColissionLayer::refresh() {
+	rebuildFrozenTerrainIfNeeded();
 	subLayers[FREE_PARTS_LAYER].refresh();
 }
+void ColissionLayer::refreshBounds() {
+	rebuildFrozenTerrainIfNeeded();
+	subLayers[FREE_PARTS_LAYER].refreshBounds();
+}
+void ColissionLayer::refreshStructure() {
+	subLayers[FREE_PARTS_LAYER].refreshStructure();
+}
+
+void ColissionLayer::setUsesPairCache(bool usesPairCache) {
+	if(usesPairCache) {
+		if(pairCache == nullptr) {
+			pairCache = std::make_unique<ColissionPairCache>();
+			pairCache->markAllDirty(subLayers[FREE_PARTS_LAYER].tree);
+		}
+	} else {
+		pairCache = nullptr;
+	}
+}
 
+void ColissionLayer::setUsesFrozenTerrain(bool usesFrozenTerrain) {
+	if(usesFrozenTerrain) {
+		if(frozenTerrain == nullptr) {
+			frozenTerrain = std::make_unique<FrozenBoundsTree<Part>>();
+			rebuildFrozenTerrainIfNeeded();
+		}
+	} else {
+		subLayers[TERRAIN_PARTS_LAYER].unfreeze();
+		frozenTerrain = nullptr;
+	}
+}
 
+void ColissionLayer::rebuildFrozenTerrainIfNeeded() {
+	if(frozenTerrain != nullptr && !frozenTerrain->isBuilt()) {
+		frozenTerrain->build(subLayers[TERRAIN_PARTS_LAYER].tree);
+		// all queries go through the frozen terrain now, see WorldLayer::unfreeze
+		subLayers[TERRAIN_PARTS_LAYER].tree.clear();
+	}
+}
 
-static bool boundsSphereEarlyEnd(const DiagonalMat3& scale, const Vec3& sphereCenter, double sphereRadius) {
-	return std::abs(sphereCenter.x) > scale[0] + sphereRadius || std::abs(sphereCenter.y) > scale[1] + sphereRadius || std::abs(sphereCenter.z) > scale[2] + sphereRadius;
+const FrozenBoundsTree<Part>* ColissionLayer::getFrozenTerrain() const {
+	if(frozenTerrain != nullptr && frozenTerrain->isBuilt()) return frozenTerrain.get();
+	return nullptr;
 }
 
-static bool runColissionPreTests(const Part& p1, const Part& p2) {
-	Vec3 offset = p1.getPosition() - p2.getPosition();
-	if(isLongerThan(offset, p1.maxRadius + p2.maxRadius)) {
-		intersectionStatistics.addToTally(IntersectionResult::PART_DISTANCE_REJECT, 1);
-		return false;
+void ColissionLayer::setBroadphaseBackend(BroadphaseBackend backend) {
+	if(backend == BroadphaseBackend::SWEEP_AND_PRUNE) {
+		if(sweepAndPrune == nullptr) sweepAndPrune = std::make_unique<SweepAndPrune>();
+	} else {
+		sweepAndPrune = nullptr;
 	}
-	if(boundsSphereEarlyEnd(p1.hitbox.scale, p1.getCFrame().globalToLocal(p2.getPosition()), p2.maxRadius)) {
-		intersectionStatistics.addToTally(IntersectionResult::PART_BOUNDS_REJECT, 1);
-		return false;
+}
+
+
+void ColissionLayer::setUsesFatBounds(bool usesFatBounds) {
+	WorldLayer& freeLayer = subLayers[FREE_PARTS_LAYER];
+	if(freeLayer.usesFatBounds && !usesFatBounds) {
+		freeLayer.tree.recalculateBounds();
 	}
-	if(boundsSphereEarlyEnd(p2.hitbox.scale, p2.getCFrame().globalToLocal(p1.getPosition()), p1.maxRadius)) {
-		intersectionStatistics.addToTally(IntersectionResult::PART_BOUNDS_REJECT, 1);
-		return false;
+	freeLayer.usesFatBounds = usesFatBounds;
+}
+
+// counts the rejects locally, the shared statistics are only touched once per filter call
+struct PreTestRejects {
+	long long boundsRejects = 0;
+	long long distanceRejects = 0;
+};
+
+// layers may be queried on separate threads
+static std::mutex preTestStatisticsMutex;
+
+/*
+	removes the colissions from firstColission onward which fail the pre tests, the order of the others is kept
+	The bounds test is done per pair, as trees with fat bounds report pairs whose actual bounds may not overlap
+	The pairs that pass it are gathered into batches for the sphere distance and hitbox bounds tests
+*/
+static void filterColissionsWithPreTests(std::vector<Colission>& colissions, std::size_t firstColission) {
+	PreTestRejects rejects;
+	std::size_t keptCount = firstColission;
+
+	ColissionPreTestBatch batch;
+	Colission batchColissions[PRE_TEST_BATCH_LANES];
+	std::size_t lanesUsed = 0;
+	auto runBatch = [&]() {
+		// lanes past lanesUsed may still hold pairs of the previous batch, their results are ignored
+		PreTestBatchResult result = runColissionPreTestBatch(batch);
+		for(std::size_t lane = 0; lane < lanesUsed; lane++) {
+			if((result.distanceRejects >> lane) & 1) {
+				rejects.distanceRejects++;
+			} else if((result.boundsRejects >> lane) & 1) {
+				rejects.boundsRejects++;
+			} else {
+				colissions[keptCount++] = batchColissions[lane];
+			}
+		}
+		lanesUsed = 0;
+	};
+
+	for(std::size_t i = firstColission; i < colissions.size(); i++) {
+		const Colission& col = colissions[i];
+		if(!intersects(col.p1->getBounds(), col.p2->getBounds())) {
+			rejects.boundsRejects++;
+			continue;
+		}
+		batchColissions[lanesUsed] = col;
+		batch.setLane(lanesUsed, *col.p1, *col.p2);
+		lanesUsed++;
+		if(lanesUsed == PRE_TEST_BATCH_LANES) runBatch();
 	}
+	if(lanesUsed != 0) runBatch();
+	colissions.erase(colissions.begin() + keptCount, colissions.end());
 
-	return true;
+	std::lock_guard<std::mutex> lock(preTestStatisticsMutex);
+	intersectionStatistics.addToTally(IntersectionResult::PART_BOUNDS_REJECT, rejects.boundsRejects);
+	intersectionStatistics.addToTally(IntersectionResult::PART_DISTANCE_REJECT, rejects.distanceRejects);
 }
 
 static void findColissionsBetween(std::vector<Colission>& colissions, const BoundsTree<Part>& treeA, const BoundsTree<Part>& treeB) {
@@ -205,13 +439,156 @@ static void findColissionsInternal(std::vector<Colission>& colissions, const Bou
 	});
 }
 
+
+// aim for a few tasks per thread, so that threads that get cheap subtrees can pick up more work
+static constexpr std::size_t COLISSION_TASKS_PER_THREAD = 4;
+static constexpr int MAX_COLISSION_TASK_SPLIT_DEPTH = 3;
+
+/*
+	Runs the given tasks on all threads of the pool
+	Every task writes to its own output vector, these are appended to colissions in task order,
+	such that the result does not depend on which thread ran which task
+	expects a function of the form void(const Task& task, std::vector<Colission>& output)
+*/
+template<typename Task, typename RunTask>
+static void runColissionTasksParallel(std::vector<Colission>& colissions, const std::vector<Task>& tasks, ThreadPool& threadPool, const RunTask& runTask) {
+	if(tasks.size() == 0) return;
+
+	std::vector<std::vector<Colission>> taskColissions(tasks.size());
+	std::atomic<std::size_t> nextTask(0);
+
+	threadPool.doInParallel([&]() {
+		while(true) {
+			std::size_t claimedTask = nextTask++;
+			if(claimedTask >= tasks.size()) break;
+
+			runTask(tasks[claimedTask], taskColissions[claimedTask]);
+		}
+	});
+
+	std::size_t totalColissions = colissions.size();
+	for(const std::vector<Colission>& output : taskColissions) {
+		totalColissions += output.size();
+	}
+	colissions.reserve(totalColissions);
+	for(const std::vector<Colission>& output : taskColissions) {
+		colissions.insert(colissions.end(), output.begin(), output.end());
+	}
+}
+static void runTreeColissionTask(const ColissionTask& task, std::vector<Colission>& output) {
+	BoundsTree<Part>::runColissionTask(task, [&output](Part* a, Part* b) {
+		output.push_back(Colission{a, b});
+	});
+}
+static void findColissionsBetweenParallel(std::vector<Colission>& colissions, const BoundsTree<Part>& treeA, const BoundsTree<Part>& treeB, ThreadPool& threadPool) {
+	if(threadPool.getNumberOfThreads() <= 1) {
+		findColissionsBetween(colissions, treeA, treeB);
+		return;
+	}
+	std::vector<ColissionTask> tasks;
+	treeA.splitColissionTasksWith(treeB, tasks, threadPool.getNumberOfThreads() * COLISSION_TASKS_PER_THREAD, MAX_COLISSION_TASK_SPLIT_DEPTH, [&colissions](Part* a, Part* b) {
+		colissions.push_back(Colission{a, b});
+	});
+	runColissionTasksParallel(colissions, tasks, threadPool, runTreeColissionTask);
+}
+static void findColissionsInternalParallel(std::vector<Colission>& colissions, const BoundsTree<Part>& tree, ThreadPool& threadPool) {
+	if(threadPool.getNumberOfThreads() <= 1) {
+		findColissionsInternal(colissions, tree);
+		return;
+	}
+	std::vector<ColissionTask> tasks;
+	tree.splitColissionTasks(tasks, threadPool.getNumberOfThreads() * COLISSION_TASKS_PER_THREAD, MAX_COLISSION_TASK_SPLIT_DEPTH, [&colissions](Part* a, Part* b) {
+		colissions.push_back(Colission{a, b});
+	});
+	runColissionTasksParallel(colissions, tasks, threadPool, runTreeColissionTask);
+}
+
+// the free parts of freeLayer against the terrain of terrainLayer, through the frozen terrain when it is available
+static void findTerrainColissions(std::vector<Colission>& colissions, const ColissionLayer& freeLayer, const ColissionLayer& terrainLayer) {
+	const BoundsTree<Part>& freeTree = freeLayer.subLayers[ColissionLayer::FREE_PARTS_LAYER].tree;
+	if(const FrozenBoundsTree<Part>* frozenTerrain = terrainLayer.getFrozenTerrain()) {
+		frozenTerrain->forEachColissionWith(freeTree, [&colissions](Part* freePart, Part* terrainPart) {
+			colissions.push_back(Colission{freePart, terrainPart});
+		});
+	} else {
+		findColissionsBetween(colissions, freeTree, terrainLayer.subLayers[ColissionLayer::TERRAIN_PARTS_LAYER].tree);
+	}
+}
+static void findTerrainColissionsParallel(std::vector<Colission>& colissions, const ColissionLayer& freeLayer, const ColissionLayer& terrainLayer, ThreadPool& threadPool) {
+	const BoundsTree<Part>& freeTree = freeLayer.subLayers[ColissionLayer::FREE_PARTS_LAYER].tree;
+	const FrozenBoundsTree<Part>* frozenTerrain = terrainLayer.getFrozenTerrain();
+	if(frozenTerrain == nullptr) {
+		findColissionsBetweenParallel(colissions, freeTree, terrainLayer.subLayers[ColissionLayer::TERRAIN_PARTS_LAYER].tree, threadPool);
+		return;
+	}
+	if(threadPool.getNumberOfThreads() <= 1) {
+		findTerrainColissions(colissions, freeLayer, terrainLayer);
+		return;
+	}
+	std::vector<FrozenColissionTask> tasks;
+	frozenTerrain->splitColissionTasksWith(freeTree, tasks, threadPool.getNumberOfThreads() * COLISSION_TASKS_PER_THREAD, MAX_COLISSION_TASK_SPLIT_DEPTH, [&colissions](Part* freePart, Part* terrainPart) {
+		colissions.push_back(Colission{freePart, terrainPart});
+	});
+	runColissionTasksParallel(colissions, tasks, threadPool, [frozenTerrain](const FrozenColissionTask& task, std::vector<Colission>& output) {
+		frozenTerrain->runColissionTask(task, [&output](Part* freePart, Part* terrainPart) {
+			output.push_back(Colission{freePart, terrainPart});
+		});
+	});
+}
+
+/*
+	The broadphase only compares bounds, the pre tests reject most of the remaining pairs before they reach GJK
+	colissions found in layers with fat bounds have only been checked against the enlarged bounds, these are rejected here as well
+*/
+static void filterNewColissionsWithPreTests(ColissionBuffer& curColissions, std::size_t firstFreePartColission, std::size_t firstFreeTerrainColission) {
+	filterColissionsWithPreTests(curColissions.freePartColissions, firstFreePartColission);
+	filterColissionsWithPreTests(curColissions.freeTerrainColissions, firstFreeTerrainColission);
+}
+
 void ColissionLayer::getInternalColissions(ColissionBuffer& curColissions) const {
+	std::size_t firstFreePartColission = curColissions.freePartColissions.size();
+	std::size_t firstFreeTerrainColission = curColissions.freeTerrainColissions.size();
+	if(sweepAndPrune != nullptr) {
+		sweepAndPrune->update(subLayers[FREE_PARTS_LAYER], subLayers[TERRAIN_PARTS_LAYER]);
+		sweepAndPrune->getColissions(curColissions);
+		filterNewColissionsWithPreTests(curColissions, firstFreePartColission, firstFreeTerrainColission);
+		return;
+	}
+	if(pairCache != nullptr) {
+		pairCache->update(subLayers[TERRAIN_PARTS_LAYER]);
+		pairCache->getColissions(curColissions);
+		filterNewColissionsWithPreTests(curColissions, firstFreePartColission, firstFreeTerrainColission);
+		return;
+	}
 	findColissionsInternal(curColissions.freePartColissions, subLayers[0].tree);
-	findColissionsBetween(curColissions.freeTerrainColissions, subLayers[0].tree, subLayers[1].tree);
+	findTerrainColissions(curColissions.freeTerrainColissions, *this, *this);
+	filterNewColissionsWithPreTests(curColissions, firstFreePartColission, firstFreeTerrainColission);
+}
+void ColissionLayer::getInternalColissionsParallel(ColissionBuffer& curColissions, ThreadPool& threadPool) const {
+	if(sweepAndPrune != nullptr || pairCache != nullptr) {
+		getInternalColissions(curColissions);
+		return;
+	}
+	std::size_t firstFreePartColission = curColissions.freePartColissions.size();
+	std::size_t firstFreeTerrainColission = curColissions.freeTerrainColissions.size();
+	findColissionsInternalParallel(curColissions.freePartColissions, subLayers[0].tree, threadPool);
+	findTerrainColissionsParallel(curColissions.freeTerrainColissions, *this, *this, threadPool);
+	filterNewColissionsWithPreTests(curColissions, firstFreePartColission, firstFreeTerrainColission);
 }
 void getColissionsBetween(const ColissionLayer& a, const ColissionLayer& b, ColissionBuffer& curColissions) {
+	std::size_t firstFreePartColission = curColissions.freePartColissions.size();
+	std::size_t firstFreeTerrainColission = curColissions.freeTerrainColissions.size();
 	findColissionsBetween(curColissions.freePartColissions, a.subLayers[0].tree, b.subLayers[0].tree);
-	findColissionsBetween(curColissions.freeTerrainColissions, a.subLayers[0].tree, b.subLayers[1].tree);
-	findColissionsBetween(curColissions.freeTerrainColissions, b.subLayers[0].tree, a.subLayers[1].tree);
+	findTerrainColissions(curColissions.freeTerrainColissions, a, b);
+	findTerrainColissions(curColissions.freeTerrainColissions, b, a);
+	filterNewColissionsWithPreTests(curColissions, firstFreePartColission, firstFreeTerrainColission);
+}
+void getColissionsBetweenParallel(const ColissionLayer& a, const ColissionLayer& b, ColissionBuffer& curColissions, ThreadPool& threadPool) {
+	std::size_t firstFreePartColission = curColissions.freePartColissions.size();
+	std::size_t firstFreeTerrainColission = curColissions.freeTerrainColissions.size();
+	findColissionsBetweenParallel(curColissions.freePartColissions, a.subLayers[0].tree, b.subLayers[0].tree, threadPool);
+	findTerrainColissionsParallel(curColissions.freeTerrainColissions, a, b, threadPool);
+	findTerrainColissionsParallel(curColissions.freeTerrainColissions, b, a, threadPool);
+	filterNewColissionsWithPreTests(curColissions, firstFreePartColission, firstFreeTerrainColission);
 }
-};
\ No newline at end of file
+};
@@ -1,19 +1,29 @@
 #pragma once
 
 #include <vector>
+#include <memory>
 
 #include "boundstree/boundsTree.h"
+#include "boundstree/frozenBoundsTree.h"
 #include "part.h"
 #include "colissionBuffer.h"
+#include "colissionPairCache.h"
+#include "sweepAndPrune.h"
 
 namespace P3D {
 class WorldPrototype;
 class ColissionLayer;
+class ThreadPool;
 
 class WorldLayer {
 public:
 	BoundsTree<Part> tree;
 	ColissionLayer* parent;
+	/*
+		When set, the leaves of moving parts store enlarged bounds, which are only refit once the part leaves them
+		Colissions found in such a layer must be filtered using the exact bounds of the parts
+	*/
+	bool usesFatBounds;
 
 	explicit WorldLayer(ColissionLayer* parent);
 
@@ -25,16 +35,29 @@ public:
 	~WorldLayer();
 
 	void refresh();
+	// the two phases of refresh, these do not touch the profiler, so layers can be refreshed on separate threads
+	void refreshBounds();
+	void refreshStructure();
 
 	void addPart(Part* newPart);
 	void removePart(Part* partToRemove);
 	void addIntoGroup(Part* newPart, Part* group);
 	template<typename PartIterBegin, typename PartIterEnd>
 	void addAllToGroup(PartIterBegin begin, PartIterEnd end, Part* group) {
+		unfreeze();
 		tree.addAllToGroup(begin, end, group);
+		for(PartIterBegin iter = begin; iter != end; ++iter) {
+			notifyPairCacheOfPart(*iter);
+		}
 	}
 	//void addIntoGroup(MotorizedPhysical* newPhys, Part* group);
 
+	/*
+		Marks the group of the given part as moved, its bounds are recalculated in the next refresh
+		Must be called before the parts of the group are moved
+	*/
+	void markGroupDirty(const Part* groupRep);
+
 	void notifyPartBoundsUpdated(const Part* updatedPart, const Bounds& oldBounds);
 	void notifyPartGroupBoundsUpdated(const Part* mainPart, const Bounds& oldMainPartBounds);
 	/*
@@ -42,6 +65,13 @@ public:
 		This is something that in general should not be performed when the part is already in a world, but this function is provided for completeness
 	*/
 	void notifyPartStdMoved(Part* oldPartPtr, Part* newPartPtr) noexcept;
+	// must be called after the parts of a group were added to or regrouped in the tree directly, instead of through this layer
+	void notifyGroupChanged(const Part* groupRep);
+	/*
+		The tree of a terrain layer is released while the terrain is frozen, see ColissionLayer::setUsesFrozenTerrain
+		This rebuilds it from the frozen terrain, it must be called before the tree is read or changed directly, instead of through this layer
+	*/
+	void unfreeze();
 
 	void mergeGroups(Part* first, Part* second);
 	void moveIntoGroup(Part* partToMove, Part* group);
@@ -50,29 +80,73 @@ public:
 
 	template<typename PartIterBegin, typename PartIterEnd>
 	void splitGroup(PartIterBegin begin, PartIterEnd end) {
+		unfreeze();
 		tree.splitGroup(begin, end);
+		// the split off parts share their new main physical, their pairs with the old group have to be found again
+		if(begin != end) notifyGroupChanged(*begin);
 	}
 	void optimize() {
-		tree.maxImproveStructure();
+		unfreeze();
+		tree.rebuild();
+	}
+	// like optimize, but large trees are rebuilt in parallel on the given pool
+	void optimize(ThreadPool& threadPool) {
+		unfreeze();
+		tree.rebuild(threadPool);
 	}
 
+	// these also see the parts of a frozen terrain layer
 	template<typename Func>
 	void forEach(const Func& funcToRun) const {
-		tree.forEach(funcToRun);
+		if(const FrozenBoundsTree<Part>* frozen = getFrozenParts()) {
+			frozen->forEach(funcToRun);
+		} else {
+			tree.forEach(funcToRun);
+		}
 	}
 
 	template<typename Filter, typename Func>
 	void forEachFiltered(const Filter& filter, const Func& funcToRun) const {
-		tree.forEachFiltered(filter, funcToRun);
+		if(const FrozenBoundsTree<Part>* frozen = getFrozenParts()) {
+			frozen->forEachFiltered(filter, funcToRun);
+		} else {
+			tree.forEachFiltered(filter, funcToRun);
+		}
+	}
+
+	// expects a function of the form void(Part* part)
+	template<typename Func>
+	void forEachOverlapping(const BoundsTemplate<float>& bounds, const Func& funcToRun) const {
+		if(const FrozenBoundsTree<Part>* frozen = getFrozenParts()) {
+			frozen->forEachOverlapping(bounds, funcToRun);
+		} else {
+			tree.forEachOverlapping(bounds, funcToRun);
+		}
 	}
 
+	bool contains(const Part* part) const;
+
 	int getID() const;
+
+private:
+	bool isTerrainLayer() const;
+	// the frozen terrain of the parent if this is its terrain layer and the tree has been released, else nullptr
+	const FrozenBoundsTree<Part>* getFrozenParts() const;
+	void notifyTerrainChanged();
+	// the pair cache of the parent only looks at the free parts it is told about
+	void notifyPairCacheOfPart(Part* part);
 };
 
 WorldLayer* getLayerByID(std::vector<ColissionLayer>& knownLayers, int id);
 const WorldLayer* getLayerByID(const std::vector<ColissionLayer>& knownLayers, int id);
 int getMaxLayerID(const std::vector<ColissionLayer>& knownLayers);
 
+// the structure used to find the internal colissions of a ColissionLayer, the BoundsTree is always kept for all other queries
+enum class BroadphaseBackend {
+	BOUNDS_TREE,
+	SWEEP_AND_PRUNE
+};
+
 class ColissionLayer {
 public:
 	static constexpr int FREE_PARTS_LAYER = 0;
@@ -84,16 +158,54 @@ public:
 	// terrainLayer
 	WorldPrototype* world;
 	bool collidesInternally;
+	/*
+		When set, fast moving free parts of this layer are swept against the terrain they collide with before they are moved
+		such that they can't pass through thin terrain in a single tick, see handleContinuousColissions
+		Only terrain is swept against, free parts can still pass through eachother. Off by default, it is enabled per layer
+	*/
+	bool usesContinuousColission;
+	// optional, when set the internal colissions of this layer are taken from the cache instead of from a full tree traversal
+	std::unique_ptr<ColissionPairCache> pairCache;
+	// set when the layer uses the SWEEP_AND_PRUNE backend, this takes precedence over the pairCache
+	std::unique_ptr<SweepAndPrune> sweepAndPrune;
+	/*
+		optional, a compact read-only copy of the terrain tree used for the free-terrain colissions
+		Once it is built the trunks of the terrain tree are released, the terrain tree is only rebuilt from it when the terrain changes
+		it is rebuilt in refresh after the terrain changed, until then the terrain tree itself is used
+	*/
+	std::unique_ptr<FrozenBoundsTree<Part>> frozenTerrain;
 
 	ColissionLayer();
 	ColissionLayer(WorldPrototype* world, bool collidesInternally);
 
 	ColissionLayer(ColissionLayer&& other) noexcept;
 	ColissionLayer& operator=(ColissionLayer&& other) noexcept;
+	~ColissionLayer();
 
 	void refresh();
+	void refreshBounds();
+	void refreshStructure();
+
+	void setUsesPairCache(bool usesPairCache);
+	bool usesPairCache() const { return pairCache != nullptr; }
+
+	void setBroadphaseBackend(BroadphaseBackend backend);
+	// meant for large static maps, any change to the terrain of this layer causes a full rebuild
+	void setUsesFrozenTerrain(bool usesFrozenTerrain);
+	bool usesFrozenTerrain() const { return frozenTerrain != nullptr; }
+	// the frozen terrain if it is up to date, else nullptr
+	const FrozenBoundsTree<Part>* getFrozenTerrain() const;
 
+	BroadphaseBackend getBroadphaseBackend() const { return sweepAndPrune != nullptr ? BroadphaseBackend::SWEEP_AND_PRUNE : BroadphaseBackend::BOUNDS_TREE; }
+
+	// only applies to the free parts, terrain does not move
+	void setUsesFatBounds(bool usesFatBounds);
+	bool usesFatBounds() const { return subLayers[FREE_PARTS_LAYER].usesFatBounds; }
+
+	// pairs that fail the bounds, sphere distance or hitbox bounds pre tests are left out, whichever structure found them
 	void getInternalColissions(ColissionBuffer& curColissions) const;
+	// same result as getInternalColissions, but the tree traversal is spread over the threads of the given pool
+	void getInternalColissionsParallel(ColissionBuffer& curColissions, ThreadPool& threadPool) const;
 
 	template<typename Func>
 	void forEach(const Func& funcToRun) const {
@@ -110,6 +222,12 @@ public:
 	}
 
 	int getID() const;
+
+private:
+	void rebuildFrozenTerrainIfNeeded();
+	// the parts of a frozen terrain are not in the terrain tree, so they don't get their layer updated by the WorldLayer
+	void setLayerOfFrozenParts(WorldLayer* newLayer);
 };
 void getColissionsBetween(const ColissionLayer& a, const ColissionLayer& b, ColissionBuffer& curColissions);
+void getColissionsBetweenParallel(const ColissionLayer& a, const ColissionLayer& b, ColissionBuffer& curColissions, ThreadPool& threadPool);
 };
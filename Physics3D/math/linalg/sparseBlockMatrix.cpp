@@ -0,0 +1,222 @@
+#include "sparseBlockMatrix.h"
+
+#include <algorithm>
+#include <cmath>
+#include <assert.h>
+
+namespace P3D {
+// result = a * b, a is rows x inner, b is inner x cols, all row major
+static void multiply(const double* a, const double* b, double* result, std::size_t rows, std::size_t inner, std::size_t cols) {
+	for(std::size_t r = 0; r < rows; r++) {
+		for(std::size_t c = 0; c < cols; c++) {
+			double total = 0.0;
+			for(std::size_t i = 0; i < inner; i++) total += a[r * inner + i] * b[i * cols + c];
+			result[r * cols + c] = total;
+		}
+	}
+}
+
+// target -= a * b
+static void subtractProduct(double* target, const double* a, const double* b, std::size_t rows, std::size_t inner, std::size_t cols) {
+	for(std::size_t r = 0; r < rows; r++) {
+		for(std::size_t c = 0; c < cols; c++) {
+			double total = 0.0;
+			for(std::size_t i = 0; i < inner; i++) total += a[r * inner + i] * b[i * cols + c];
+			target[r * cols + c] -= total;
+		}
+	}
+}
+
+// Gauss-Jordan elimination with partial pivoting, work must hold n * n values
+static void invertInPlace(double* m, std::size_t n, double* work) {
+	for(std::size_t i = 0; i < n * n; i++) work[i] = 0.0;
+	for(std::size_t i = 0; i < n; i++) work[i * n + i] = 1.0;
+
+	for(std::size_t col = 0; col < n; col++) {
+		std::size_t bestPivot = col;
+		for(std::size_t row = col + 1; row < n; row++) {
+			if(std::abs(m[row * n + col]) > std::abs(m[bestPivot * n + col])) bestPivot = row;
+		}
+		if(bestPivot != col) {
+			for(std::size_t i = 0; i < n; i++) {
+				std::swap(m[bestPivot * n + i], m[col * n + i]);
+				std::swap(work[bestPivot * n + i], work[col * n + i]);
+			}
+		}
+
+		double inversePivot = 1.0 / m[col * n + col];
+		for(std::size_t i = 0; i < n; i++) {
+			m[col * n + i] *= inversePivot;
+			work[col * n + i] *= inversePivot;
+		}
+		for(std::size_t row = 0; row < n; row++) {
+			if(row == col) continue;
+			double factor = m[row * n + col];
+			if(factor == 0.0) continue;
+			for(std::size_t i = 0; i < n; i++) {
+				m[row * n + i] -= m[col * n + i] * factor;
+				work[row * n + i] -= work[col * n + i] * factor;
+			}
+		}
+	}
+	for(std::size_t i = 0; i < n * n; i++) m[i] = work[i];
+}
+
+static void insertSorted(std::vector<std::size_t>& list, std::size_t value) {
+	auto found = std::lower_bound(list.begin(), list.end(), value);
+	if(found == list.end() || *found != value) list.insert(found, value);
+}
+
+void SparseBlockMatrix::setPattern(const std::vector<std::size_t>& blockSizes, const std::vector<std::pair<std::size_t, std::size_t>>& nonZeroBlocks) {
+	std::size_t blockCount = blockSizes.size();
+	this->blockSizes = blockSizes;
+	blockOffsets.resize(blockCount);
+	maxBlockSize = 0;
+	std::size_t offset = 0;
+	for(std::size_t i = 0; i < blockCount; i++) {
+		blockOffsets[i] = offset;
+		offset += blockSizes[i];
+		maxBlockSize = std::max(maxBlockSize, blockSizes[i]);
+	}
+
+	std::vector<std::vector<std::size_t>> neighbors(blockCount);
+	for(const std::pair<std::size_t, std::size_t>& pair : nonZeroBlocks) {
+		assert(pair.first < blockCount && pair.second < blockCount);
+		if(pair.first == pair.second) continue;
+		insertSorted(neighbors[pair.first], pair.second);
+		insertSorted(neighbors[pair.second], pair.first);
+	}
+
+	// minimum degree ordering, eliminating a block connects all its remaining neighbors, which is where fill in comes from
+	eliminationOrder.clear();
+	eliminationOrder.reserve(blockCount);
+	laterNeighbors.assign(blockCount, std::vector<std::size_t>());
+	std::vector<bool> isEliminated(blockCount, false);
+	for(std::size_t step = 0; step < blockCount; step++) {
+		std::size_t best = blockCount;
+		for(std::size_t i = 0; i < blockCount; i++) {
+			if(isEliminated[i]) continue;
+			if(best == blockCount || neighbors[i].size() < neighbors[best].size()) best = i;
+		}
+		isEliminated[best] = true;
+		eliminationOrder.push_back(best);
+		laterNeighbors[best] = neighbors[best];
+		for(std::size_t neighbor : neighbors[best]) {
+			std::vector<std::size_t>& neighborsOfNeighbor = neighbors[neighbor];
+			neighborsOfNeighbor.erase(std::lower_bound(neighborsOfNeighbor.begin(), neighborsOfNeighbor.end(), best));
+			for(std::size_t other : neighbors[best]) {
+				if(other != neighbor) insertSorted(neighborsOfNeighbor, other);
+			}
+		}
+		neighbors[best].clear();
+	}
+
+	eliminationPosition.resize(blockCount);
+	for(std::size_t i = 0; i < blockCount; i++) {
+		eliminationPosition[eliminationOrder[i]] = i;
+	}
+
+	std::vector<std::vector<std::size_t>> storedColumns(blockCount);
+	for(std::size_t block = 0; block < blockCount; block++) {
+		std::vector<std::size_t>& later = laterNeighbors[block];
+		std::sort(later.begin(), later.end(), [this](std::size_t a, std::size_t b) {
+			return eliminationPosition[a] < eliminationPosition[b];
+		});
+		storedColumns[block].push_back(block);
+		for(std::size_t other : later) {
+			storedColumns[block].push_back(other);
+			storedColumns[other].push_back(block);
+		}
+	}
+
+	rowBlocks.assign(blockCount, std::vector<std::pair<std::size_t, std::size_t>>());
+	std::size_t valueCount = 0;
+	for(std::size_t row = 0; row < blockCount; row++) {
+		std::vector<std::size_t>& columns = storedColumns[row];
+		std::sort(columns.begin(), columns.end());
+		rowBlocks[row].reserve(columns.size());
+		for(std::size_t col : columns) {
+			rowBlocks[row].emplace_back(col, valueCount);
+			valueCount += blockSizes[row] * blockSizes[col];
+		}
+	}
+	values.assign(valueCount, 0.0);
+	scratch.resize(2 * maxBlockSize * maxBlockSize);
+}
+
+std::size_t SparseBlockMatrix::size() const {
+	if(blockSizes.empty()) return 0;
+	return blockOffsets.back() + blockSizes.back();
+}
+
+std::size_t SparseBlockMatrix::getStoredBlockCount() const {
+	std::size_t total = 0;
+	for(const std::vector<std::pair<std::size_t, std::size_t>>& row : rowBlocks) total += row.size();
+	return total;
+}
+
+std::size_t SparseBlockMatrix::findBlockOffset(std::size_t row, std::size_t col) const {
+	const std::vector<std::pair<std::size_t, std::size_t>>& blocks = rowBlocks[row];
+	auto found = std::lower_bound(blocks.begin(), blocks.end(), col, [](const std::pair<std::size_t, std::size_t>& block, std::size_t col) {
+		return block.first < col;
+	});
+	assert(found != blocks.end() && found->first == col);
+	return found->second;
+}
+
+void SparseBlockMatrix::clearValues() {
+	std::fill(values.begin(), values.end(), 0.0);
+}
+
+double* SparseBlockMatrix::getBlock(std::size_t row, std::size_t col) {
+	return values.data() + findBlockOffset(row, col);
+}
+
+const double* SparseBlockMatrix::getBlock(std::size_t row, std::size_t col) const {
+	return values.data() + findBlockOffset(row, col);
+}
+
+/*
+	Block Gaussian elimination in elimination order, afterwards
+	the diagonal blocks hold their inverted pivots, the blocks below the diagonal hold L, the blocks above hold U
+*/
+void SparseBlockMatrix::factorize() {
+	for(std::size_t k : eliminationOrder) {
+		std::size_t sizeK = blockSizes[k];
+		double* pivot = getBlock(k, k);
+		invertInPlace(pivot, sizeK, scratch.data());
+
+		for(std::size_t i : laterNeighbors[k]) {
+			double* lower = getBlock(i, k);
+			multiply(lower, pivot, scratch.data(), blockSizes[i], sizeK, sizeK);
+			std::copy(scratch.data(), scratch.data() + blockSizes[i] * sizeK, lower);
+		}
+		for(std::size_t i : laterNeighbors[k]) {
+			const double* lower = getBlock(i, k);
+			for(std::size_t j : laterNeighbors[k]) {
+				subtractProduct(getBlock(i, j), lower, getBlock(k, j), blockSizes[i], sizeK, blockSizes[j]);
+			}
+		}
+	}
+}
+
+void SparseBlockMatrix::solve(double* rhs, std::size_t columns) {
+	for(std::size_t k : eliminationOrder) {
+		const double* rhsK = rhs + blockOffsets[k] * columns;
+		for(std::size_t i : laterNeighbors[k]) {
+			subtractProduct(rhs + blockOffsets[i] * columns, getBlock(i, k), rhsK, blockSizes[i], blockSizes[k], columns);
+		}
+	}
+
+	if(scratch.size() < maxBlockSize * columns) scratch.resize(maxBlockSize * columns);
+	for(auto iter = eliminationOrder.rbegin(); iter != eliminationOrder.rend(); ++iter) {
+		std::size_t k = *iter;
+		double* rhsK = rhs + blockOffsets[k] * columns;
+		for(std::size_t j : laterNeighbors[k]) {
+			subtractProduct(rhsK, getBlock(k, j), rhs + blockOffsets[j] * columns, blockSizes[k], blockSizes[j], columns);
+		}
+		multiply(getBlock(k, k), rhsK, scratch.data(), blockSizes[k], blockSizes[k], columns);
+		std::copy(scratch.data(), scratch.data() + blockSizes[k] * columns, rhsK);
+	}
+}
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+namespace P3D {
+/*
+	A square matrix made of dense blocks, of which only the blocks in a symmetric pattern may be nonzero
+	Block i spans blockSizes[i] rows and columns, blocks are stored row major
+
+	Solved by block LU factorization without pivoting between blocks, only within the diagonal blocks.
+	The blocks are eliminated in minimum degree order, the blocks this fills in are part of the pattern from the start,
+	so that factorizing and solving only touch the blocks that are needed. A chain or tree of blocks gets no fill in at all.
+
+	Usage: setPattern once, then for every new set of values: clearValues, fill the blocks through getBlock, factorize, solve
+*/
+class SparseBlockMatrix {
+	std::vector<std::size_t> blockSizes;
+	// the first row of every block in the full matrix
+	std::vector<std::size_t> blockOffsets;
+	std::size_t maxBlockSize = 0;
+
+	// the blocks in elimination order, and the position of every block in that order
+	std::vector<std::size_t> eliminationOrder;
+	std::vector<std::size_t> eliminationPosition;
+
+	// the (column, value offset) of every stored block in each block row, sorted by column
+	std::vector<std::vector<std::pair<std::size_t, std::size_t>>> rowBlocks;
+
+	// for every block, the blocks eliminated after it that it shares a stored block with, in elimination order
+	std::vector<std::vector<std::size_t>> laterNeighbors;
+
+	std::vector<double> values;
+	std::vector<double> scratch;
+
+	std::size_t findBlockOffset(std::size_t row, std::size_t col) const;
+
+public:
+	SparseBlockMatrix() = default;
+
+	/*
+		nonZeroBlocks lists the pairs of blocks whose off diagonal blocks may be nonzero, (i, j) also allows block (j, i)
+		The diagonal blocks are always part of the pattern
+	*/
+	void setPattern(const std::vector<std::size_t>& blockSizes, const std::vector<std::pair<std::size_t, std::size_t>>& nonZeroBlocks);
+
+	std::size_t getBlockCount() const { return blockSizes.size(); }
+	std::size_t getBlockSize(std::size_t block) const { return blockSizes[block]; }
+	std::size_t getBlockOffset(std::size_t block) const { return blockOffsets[block]; }
+	// the number of rows of the full matrix
+	std::size_t size() const;
+	// the number of stored blocks, including the blocks filled in by the factorization
+	std::size_t getStoredBlockCount() const;
+
+	void clearValues();
+	// blockSizes[row] x blockSizes[col] values, row major, the block must be part of the pattern
+	double* getBlock(std::size_t row, std::size_t col);
+	const double* getBlock(std::size_t row, std::size_t col) const;
+
+	// replaces the values with the LU factorization, the values of the blocks in the pattern must be set beforehand
+	void factorize();
+
+	// solves this * x = rhs for every column of rhs, a row major size() x columns matrix, which is replaced by x, factorize must have been called
+	void solve(double* rhs, std::size_t columns);
+};
+};
@@ -9,6 +9,7 @@
 #include <fstream>
 #include <chrono>
 #include <sstream>
+#include <mutex>
 
 namespace P3D {
 namespace Debug {
@@ -20,10 +21,13 @@ void(*logAction)(const char*, std::va_list) = [](const char* format, std::va_lis
 void(*logWarnAction)(const char*, std::va_list) = [](const char* format, std::va_list args) { std::cout << "WARN: ";  vprintf(format, args); };
 void(*logErrorAction)(const char*, std::va_list) = [](const char* format, std::va_list args) { std::cout << "ERROR: ";  vprintf(format, args); };
 
-void logVector(Position origin, Vec3 vec, VectorType type) { logVecAction(origin, vec, type); };
-void logPoint(Position point, PointType type) { logPointAction(point, type); }
-void logCFrame(CFrame frame, CFrameType type) { logCFrameAction(frame, type); };
-void logShape(const Polyhedron& shape, const GlobalCFrame& location) { logShapeAction(shape, location); };
+// colissions are resolved on several threads, the actions need not be thread safe
+static std::mutex logMutex;
+
+void logVector(Position origin, Vec3 vec, VectorType type) { std::lock_guard<std::mutex> lock(logMutex); logVecAction(origin, vec, type); };
+void logPoint(Position point, PointType type) { std::lock_guard<std::mutex> lock(logMutex); logPointAction(point, type); }
+void logCFrame(CFrame frame, CFrameType type) { std::lock_guard<std::mutex> lock(logMutex); logCFrameAction(frame, type); };
+void logShape(const Polyhedron& shape, const GlobalCFrame& location) { std::lock_guard<std::mutex> lock(logMutex); logShapeAction(shape, location); };
 void log(const char* format, ...) {
 	std::va_list args;
 	va_start(args, format);
@@ -24,6 +24,11 @@ const char * intersectionLabels[]{
 	"Part Bound Reject"
 };
 
+const char* sleepLabels[]{
+	"Awake",
+	"Asleep"
+};
+
 const char* iterationLabels[]{
 	"0",
 	"1",
@@ -46,6 +51,7 @@ const char* iterationLabels[]{
 
 BreakdownAverageProfiler<PhysicsProcess> physicsMeasure(physicsLabels, 100);
 HistoricTally<long long, IntersectionResult> intersectionStatistics(intersectionLabels, 1);
+HistoricTally<long long, SleepState> sleepStatistics(sleepLabels, 1);
 CircularBuffer<int> gjkCollideIterStats(1);
 CircularBuffer<int> gjkNoCollideIterStats(1);
 
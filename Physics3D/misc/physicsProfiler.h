@@ -28,6 +28,12 @@ enum class IntersectionResult {
 	COUNT
 };
 
+enum class SleepState {
+	AWAKE,
+	ASLEEP,
+	COUNT
+};
+
 enum class IterationTime {
 	INSTANT_QUIT = 0,
 	ONE_ITER = 1,
@@ -38,6 +44,8 @@ enum class IterationTime {
 
 extern BreakdownAverageProfiler<PhysicsProcess> physicsMeasure;
 extern HistoricTally<long long, IntersectionResult> intersectionStatistics;
+// the number of physicals that were awake and asleep at the end of each tick
+extern HistoricTally<long long, SleepState> sleepStatistics;
 extern CircularBuffer<int> gjkCollideIterStats;
 extern CircularBuffer<int> gjkNoCollideIterStats;
 extern HistoricTally<long long, IterationTime> GJKCollidesIterationStatistics;
@@ -373,14 +373,14 @@ static void assertVersionCorrect(std::istream& istream) {
 
 void SerializationSessionPrototype::serializeWorldLayer(const WorldLayer& layer, std::ostream& ostream) {
 	uint32_t numberOfUnPhysicaledPartsInLayer = 0;
-	layer.tree.forEach([&numberOfUnPhysicaledPartsInLayer](const Part& p) {
+	layer.forEach([&numberOfUnPhysicaledPartsInLayer](const Part& p) {
 		if(p.getPhysical() == nullptr) {
 			numberOfUnPhysicaledPartsInLayer++;
 		}
 	});
 
 	serializeBasicTypes<uint32_t>(numberOfUnPhysicaledPartsInLayer, ostream);
-	layer.tree.forEach([this, &ostream](const Part& p) {
+	layer.forEach([this, &ostream](const Part& p) {
 		if(p.getPhysical() == nullptr) {
 			serializeBasicTypes<GlobalCFrame>(p.getCFrame(), ostream);
 			this->serializePartData(p, ostream);
@@ -394,7 +394,7 @@ void SerializationSessionPrototype::serializeWorld(const WorldPrototype& world,
 	}
 	for(const ColissionLayer& clayer : world.layers) {
 		for(const WorldLayer& layer : clayer.subLayers) {
-			layer.tree.forEach([this](const Part& p) {
+			layer.forEach([this](const Part& p) {
 				if(p.getPhysical() == nullptr) {
 					collectPartInformation(p);
 				}
@@ -438,15 +438,30 @@ void SerializationSessionPrototype::serializeWorld(const WorldPrototype& world,
 	}
 }
 
-void DeSerializationSessionPrototype::deserializeWorldLayer(WorldLayer& layer, std::istream& istream) {
+void DeSerializationSessionPrototype::deserializeWorldLayer(WorldLayer& layer, std::istream& istream, ThreadPool* threadPool) {
 	uint32_t extraPartsInLayer = deserializeBasicTypes<uint32_t>(istream);
+	std::vector<Part*> partsInLayer;
+	partsInLayer.reserve(extraPartsInLayer);
 	for(uint32_t i = 0; i < extraPartsInLayer; i++) {
 		GlobalCFrame cf = deserializeBasicTypes<GlobalCFrame>(istream);
-		layer.tree.add(deserializePartData(cf, &layer, istream));
+		partsInLayer.push_back(deserializePartData(cf, &layer, istream));
+	}
+	if(threadPool != nullptr) {
+		layer.tree.addAll(partsInLayer.begin(), partsInLayer.end(), *threadPool);
+	} else {
+		layer.tree.addAll(partsInLayer.begin(), partsInLayer.end());
 	}
 }
 
 void DeSerializationSessionPrototype::deserializeWorld(WorldPrototype& world, std::istream& istream) {
+	deserializeWorldWith(world, istream, nullptr);
+}
+
+void DeSerializationSessionPrototype::deserializeWorld(WorldPrototype& world, std::istream& istream, ThreadPool& threadPool) {
+	deserializeWorldWith(world, istream, &threadPool);
+}
+
+void DeSerializationSessionPrototype::deserializeWorldWith(WorldPrototype& world, std::istream& istream, ThreadPool* threadPool) {
 	this->deserializeAndCollectHeaderInformation(istream);
 
 	world.age = deserializeBasicTypes<uint64_t>(istream);
@@ -464,7 +479,7 @@ void DeSerializationSessionPrototype::deserializeWorld(WorldPrototype& world, st
 		}
 	}
 	for(ColissionLayer& layer : world.layers) {
-		deserializeWorldLayer(layer.subLayers[ColissionLayer::TERRAIN_PARTS_LAYER], istream);
+		deserializeWorldLayer(layer.subLayers[ColissionLayer::TERRAIN_PARTS_LAYER], istream, threadPool);
 	}
 
 	uint32_t numberOfPhysicals = deserializeBasicTypes<uint32_t>(istream);
@@ -472,6 +487,12 @@ void DeSerializationSessionPrototype::deserializeWorld(WorldPrototype& world, st
 	for(uint32_t i = 0; i < numberOfPhysicals; i++) {
 		world.addPhysicalWithExistingLayers(deserializeMotorizedPhysicalWithContext(world.layers, istream));
 	}
+	// parts were added one physical at a time, build the trees again in one go
+	if(threadPool != nullptr) {
+		world.optimizeLayers(*threadPool);
+	} else {
+		world.optimizeLayers();
+	}
 
 	std::uint32_t constraintCount = deserializeBasicTypes<std::uint32_t>(istream);
 	world.constraints.reserve(constraintCount);
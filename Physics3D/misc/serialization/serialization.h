@@ -105,7 +105,9 @@ private:
 	void deserializeConnectionsOfPhysicalWithContext(std::vector<ColissionLayer>& layers, Physical& physToPopulate, std::istream& istream);
 	RigidBody deserializeRigidBodyWithContext(const GlobalCFrame& cframeOfMain, std::vector<ColissionLayer>& layers, std::istream& istream);
 	PhysicalConstraint deserializeConstraintInContext(std::istream& istream);
-	void deserializeWorldLayer(WorldLayer& layer, std::istream& istream);
+	// the trees are built on the threadPool when one is given
+	void deserializeWorldLayer(WorldLayer& layer, std::istream& istream, ThreadPool* threadPool);
+	void deserializeWorldWith(WorldPrototype& world, std::istream& istream, ThreadPool* threadPool);
 protected:
 	ShapeDeserializer shapeDeserializer;
 	std::vector<Physical*> indexToPhysicalMap;
@@ -124,6 +126,8 @@ public:
 
 
 	void deserializeWorld(WorldPrototype& world, std::istream& istream);
+	// like deserializeWorld, but the trees of large layers are built in parallel on the given pool
+	void deserializeWorld(WorldPrototype& world, std::istream& istream, ThreadPool& threadPool);
 	std::vector<Part*> deserializeParts(std::istream& istream);
 };
 
@@ -189,6 +193,7 @@ public:
 	using DeSerializationSessionPrototype::DeSerializationSessionPrototype;
 
 	void deserializeWorld(World<ExtendedPartType>& world, std::istream& istream) { DeSerializationSessionPrototype::deserializeWorld(world, istream); }
+	void deserializeWorld(World<ExtendedPartType>& world, std::istream& istream, ThreadPool& threadPool) { DeSerializationSessionPrototype::deserializeWorld(world, istream, threadPool); }
 	std::vector<ExtendedPartType*> deserializeParts(std::istream& istream) {
 		return castVector<ExtendedPartType>(DeSerializationSessionPrototype::deserializeParts(istream));
 	}
@@ -149,8 +149,9 @@ class MotorizedPhysical;
 
 bool isMotorizedPhysicalValid(const MotorizedPhysical* mainPhys);
 
+// leavesMayBeEnlarged allows leaves to store bounds larger than those of their object, as is done for layers with fat bounds
 template<typename Boundable>
-inline bool isBoundsTreeValidRecursive(const TreeTrunk& curNode, int curNodeSize, int depth = 0) {
+inline bool isBoundsTreeValidRecursive(const TreeTrunk& curNode, int curNodeSize, bool leavesMayBeEnlarged = false, int depth = 0) {
 	for(int i = 0; i < curNodeSize; i++) {
 		const TreeNodeRef& subNode = curNode.subNodes[i];
 
@@ -167,13 +168,14 @@ inline bool isBoundsTreeValidRecursive(const TreeTrunk& curNode, int curNodeSize
 				return false;
 			}
 
-			if(!isBoundsTreeValidRecursive<Boundable>(subTrunk, subTrunkSize, depth + 1)) {
+			if(!isBoundsTreeValidRecursive<Boundable>(subTrunk, subTrunkSize, leavesMayBeEnlarged, depth + 1)) {
 				std::cout << "(" << i << "/" << curNodeSize << ")\n";
 				return false;
 			}
 		} else {
 			const Boundable* itemB = static_cast<const Boundable*>(subNode.asObject());
-			if(foundBounds != itemB->getBounds()) {
+			bool leafUpToDate = leavesMayBeEnlarged ? foundBounds.contains(itemB->getBounds()) : foundBounds == itemB->getBounds();
+			if(!leafUpToDate) {
 				std::cout << "(" << i << "/" << curNodeSize << ") Leaf not up to date\n";
 				return false;
 			}
@@ -183,19 +185,19 @@ inline bool isBoundsTreeValidRecursive(const TreeTrunk& curNode, int curNodeSize
 }
 
 template<typename Boundable>
-bool isBoundsTreeValid(const BoundsTreePrototype& tree) {
+bool isBoundsTreeValid(const BoundsTreePrototype& tree, bool leavesMayBeEnlarged = false) {
 	std::pair<const TreeTrunk&, int> baseTrunk = tree.getBaseTrunk();
-	return isBoundsTreeValidRecursive<Boundable>(baseTrunk.first, baseTrunk.second);
+	return isBoundsTreeValidRecursive<Boundable>(baseTrunk.first, baseTrunk.second, leavesMayBeEnlarged);
 }
 
 template<typename Boundable>
-bool isBoundsTreeValid(const BoundsTree<Boundable>& tree) {
-	return isBoundsTreeValid<Boundable>(tree.getPrototype());
+bool isBoundsTreeValid(const BoundsTree<Boundable>& tree, bool leavesMayBeEnlarged = false) {
+	return isBoundsTreeValid<Boundable>(tree.getPrototype(), leavesMayBeEnlarged);
 }
 
 template<typename Boundable>
-inline void treeValidCheck(const BoundsTree<Boundable>& tree) {
-	if(!isBoundsTreeValid(tree)) throw "tree invalid!";
+inline void treeValidCheck(const BoundsTree<Boundable>& tree, bool leavesMayBeEnlarged = false) {
+	if(!isBoundsTreeValid(tree, leavesMayBeEnlarged)) throw "tree invalid!";
 }
 
 };
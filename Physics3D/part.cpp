@@ -95,12 +95,10 @@ void Part::removeFromWorld() {
 	if(this->layer) this->layer->removePart(this);
 }
 
-PartIntersection Part::intersects(const Part& other) const {
-	CFrame relativeTransform = this->cframe.globalToLocal(other.cframe);
-	std::optional<Intersection> result = intersectsTransformed(this->hitbox, other.hitbox, relativeTransform);
+static PartIntersection toPartIntersection(const GlobalCFrame& cframe, const std::optional<Intersection>& result) {
 	if(result) {
-		Position intersection = this->cframe.localToGlobal(result.value().intersection);
-		Vec3 exitVector = this->cframe.localToRelative(result.value().exitVector);
+		Position intersection = cframe.localToGlobal(result.value().intersection);
+		Vec3 exitVector = cframe.localToRelative(result.value().exitVector);
 
 
 		catchable_assert(isVecValid(exitVector));
@@ -111,6 +109,16 @@ PartIntersection Part::intersects(const Part& other) const {
 	return PartIntersection();
 }
 
+PartIntersection Part::intersects(const Part& other) const {
+	CFrame relativeTransform = this->cframe.globalToLocal(other.cframe);
+	return toPartIntersection(this->cframe, intersectsTransformed(this->hitbox, other.hitbox, relativeTransform));
+}
+
+PartIntersection Part::intersects(const Part& other, Vec3f& searchDirection) const {
+	CFrame relativeTransform = this->cframe.globalToLocal(other.cframe);
+	return toPartIntersection(this->cframe, intersectsTransformed(this->hitbox, other.hitbox, relativeTransform, searchDirection));
+}
+
 BoundingBox Part::getLocalBounds() const {
 	Vec3 v = Vec3(this->hitbox.scale[0], this->hitbox.scale[1], this->hitbox.scale[2]);
 	return BoundingBox(-v, v);
@@ -141,6 +149,7 @@ void Part::setCFrame(const GlobalCFrame& newCFrame) {
 	Bounds oldBounds = this->getBounds();
 	Physical* partPhys = this->getPhysical();
 	if(partPhys) {
+		partPhys->mainPhysical->wakeUp();
 		partPhys->setPartCFrame(this, newCFrame);
 	} else {
 		this->cframe = newCFrame;
@@ -166,10 +175,12 @@ Motion Part::getMotion() const {
 }
 
 void Part::setVelocity(Vec3 velocity) {
+	this->getMainPhysical()->wakeUp();
 	Vec3 oldVel = this->getVelocity();
 	this->getMainPhysical()->motionOfCenterOfMass.translation.translation[0] += (velocity - oldVel);
 }
 void Part::setAngularVelocity(Vec3 angularVelocity) {
+	this->getMainPhysical()->wakeUp();
 	Vec3 oldAngularVel = this->getAngularVelocity();
 	this->getMainPhysical()->motionOfCenterOfMass.rotation.rotation[0] += (angularVelocity - oldAngularVel);
 }
@@ -78,6 +78,8 @@ public:
 	WorldPrototype* getWorld();
 
 	PartIntersection intersects(const Part& other) const;
+	// searchDirection seeds GJK and is updated for the next call, see intersectsTransformed
+	PartIntersection intersects(const Part& other, Vec3f& searchDirection) const;
 	void scale(double scaleX, double scaleY, double scaleZ);
 	void setScale(const DiagonalMat3& scale);
 	
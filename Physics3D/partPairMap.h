@@ -0,0 +1,82 @@
+#pragma once
+
+#include <unordered_map>
+#include <cstddef>
+#include <functional>
+
+namespace P3D {
+class Part;
+
+// an ordered pair of pointers, (a, b) and (b, a) are different keys
+template<typename T>
+struct PointerPair {
+	T* a;
+	T* b;
+	bool operator==(const PointerPair& other) const { return a == other.a && b == other.b; }
+};
+
+template<typename T>
+struct PointerPairHash {
+	std::size_t operator()(const PointerPair<T>& p) const {
+		std::size_t ha = std::hash<const void*>()(p.a);
+		std::size_t hb = std::hash<const void*>()(p.b);
+		return ha ^ (hb + 0x9e3779b9 + (ha << 6) + (ha >> 2));
+	}
+};
+
+using PartPairKey = PointerPair<const Part>;
+using PartPairKeyHash = PointerPairHash<const Part>;
+
+/*
+	A value for every part pair that was used recently
+
+	A pair is kept as long as it is used at least once between two calls of removeStaleEntries,
+	so pairs that stopped colliding are dropped after a single tick
+*/
+template<typename Value>
+class PartPairMap {
+	struct Entry {
+		Value value;
+		std::size_t lastUsedTick;
+	};
+
+	std::unordered_map<PartPairKey, Entry, PartPairKeyHash> entries;
+	std::size_t currentTick = 0;
+
+public:
+	/*
+		The value of the given pair, newValue is stored first if the pair is not in the map yet
+		The returned reference remains valid until the next removeStaleEntries or clear
+	*/
+	Value& getOrAdd(const Part* p1, const Part* p2, const Value& newValue) {
+		Entry& entry = entries.try_emplace(PartPairKey{p1, p2}, Entry{newValue, currentTick}).first->second;
+		entry.lastUsedTick = currentTick;
+		return entry.value;
+	}
+
+	// nullptr if the pair is not in the map, does not count as a use
+	const Value* find(const Part* p1, const Part* p2) const {
+		auto found = entries.find(PartPairKey{p1, p2});
+		if(found == entries.end()) return nullptr;
+		return &found->second.value;
+	}
+
+	// removes the pairs that were not used since the previous call, should be called once per tick
+	void removeStaleEntries() {
+		for(auto iter = entries.begin(); iter != entries.end();) {
+			if(iter->second.lastUsedTick != currentTick) {
+				iter = entries.erase(iter);
+			} else {
+				++iter;
+			}
+		}
+		currentTick++;
+	}
+
+	void clear() {
+		entries.clear();
+	}
+
+	std::size_t size() const { return entries.size(); }
+};
+};
@@ -548,6 +548,7 @@ void ConnectedPhysical::setCFrame(const GlobalCFrame& newCFrame) {
 }
 
 void MotorizedPhysical::setCFrame(const GlobalCFrame& newCFrame) {
+	wakeUp();
 	rigidBody.setCFrame(newCFrame);
 	for(ConnectedPhysical& conPhys : childPhysicals) {
 		conPhys.refreshCFrameRecursive();
@@ -583,6 +584,7 @@ void Physical::translateUnsafeRecursive(const Vec3Fix& translation) {
 	}
 }
 void MotorizedPhysical::translate(const Vec3& translation) {
+	wakeUp();
 	translateUnsafeRecursive(translation);
 }
 
@@ -624,7 +626,25 @@ void MotorizedPhysical::fullRefreshOfConnectedPhysicals() {
 
 #pragma region update
 
+// the layers only refit the groups that are marked as moved, this has to happen while the parts are still at their old position
+static void markGroupsDirtyInLayers(MotorizedPhysical& phys) {
+	Part* mainPart = phys.getMainPart();
+	WorldLayer* mainLayer = mainPart->layer;
+	bool allInMainLayer = true;
+	phys.forEachPartExceptMainPart([mainLayer, &allInMainLayer](Part& p) {
+		if(p.layer != mainLayer) allInMainLayer = false;
+	});
+	if(allInMainLayer) {
+		if(mainLayer != nullptr) mainLayer->markGroupDirty(mainPart);
+	} else {
+		for(const FoundLayerRepresentative& found : findAllLayersIn(&phys)) {
+			if(found.layer != nullptr) found.layer->markGroupDirty(found.part);
+		}
+	}
+}
+
 void MotorizedPhysical::update(double deltaT) {
+	markGroupsDirtyInLayers(*this);
 
 	Vec3 accel = forceResponse * totalForce * deltaT;
 	
@@ -660,6 +680,19 @@ void MotorizedPhysical::update(double deltaT) {
 	updateAttachedPhysicals();
 }
 
+void MotorizedPhysical::wakeUp() {
+	if(!isAsleep) return;
+	isAsleep = false;
+	restingTicks = 0;
+}
+
+void MotorizedPhysical::fallAsleep() {
+	isAsleep = true;
+	motionOfCenterOfMass = Motion();
+	totalForce = Vec3();
+	totalMoment = Vec3();
+}
+
 #pragma endregion
 
 /*
@@ -693,12 +726,14 @@ void MotorizedPhysical::applyMoment(Vec3 moment) {
 
 void MotorizedPhysical::applyImpulseAtCenterOfMass(Vec3 impulse) {
 	assert(isVecValid(impulse));
+	wakeUp();
 	Debug::logVector(getCenterOfMass(), impulse, Debug::IMPULSE);
 	motionOfCenterOfMass.translation.translation[0] += forceResponse * impulse;
 }
 void MotorizedPhysical::applyImpulse(Vec3Relative origin, Vec3Relative impulse) {
 	assert(isVecValid(origin));
 	assert(isVecValid(impulse));
+	wakeUp();
 	Debug::logVector(getCenterOfMass() + origin, impulse, Debug::IMPULSE);
 	motionOfCenterOfMass.translation.translation[0] += forceResponse * impulse;
 	Vec3 angularImpulse = origin % impulse;
@@ -706,6 +741,7 @@ void MotorizedPhysical::applyImpulse(Vec3Relative origin, Vec3Relative impulse)
 }
 void MotorizedPhysical::applyAngularImpulse(Vec3 angularImpulse) {
 	assert(isVecValid(angularImpulse));
+	wakeUp();
 	Debug::logVector(getCenterOfMass(), angularImpulse, Debug::ANGULAR_IMPULSE);
 	Vec3 localAngularImpulse = getCFrame().relativeToLocal(angularImpulse);
 	Vec3 localRotAcc = momentResponse * localAngularImpulse;
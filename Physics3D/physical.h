@@ -235,6 +235,14 @@ public:
 
 	Motion motionOfCenterOfMass;
 
+	// see WorldPrototype::setUsesSleeping, sleeping physicals are not integrated, and only collide with awake physicals
+	bool isAsleep = false;
+	// the number of ticks in a row this physical moved slower than the sleep thresholds
+	int restingTicks = 0;
+	// the external force and moment on this physical in the tick it fell asleep, a sleeping physical wakes up when these change
+	Vec3 restingForce = Vec3(0.0, 0.0, 0.0);
+	Vec3 restingMoment = Vec3(0.0, 0.0, 0.0);
+
 	explicit MotorizedPhysical(Part* mainPart);
 	explicit MotorizedPhysical(RigidBody&& rigidBody);
 	explicit MotorizedPhysical(Physical&& movedPhys);
@@ -289,6 +297,11 @@ public:
 
 	void update(double deltaT);
 
+	// does nothing for physicals that are awake, setting the cframe or velocity and applying impulses wake a physical up
+	void wakeUp();
+	// stops the physical, its forces are dropped
+	void fallAsleep();
+
 	void setCFrame(const GlobalCFrame& newCFrame);
 
 	void translate(const Vec3& translation);
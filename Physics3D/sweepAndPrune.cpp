@@ -0,0 +1,164 @@
+#include "sweepAndPrune.h"
+
+#include "physical.h"
+#include "layer.h"
+
+#include <algorithm>
+
+namespace P3D {
+// the sweep axis is only changed when another axis is this much better, so the list is not resorted back and forth
+static constexpr double SWEEP_AXIS_SWITCH_FACTOR = 1.5;
+
+// positions have no index operator
+static float getMinOnAxis(const BoundsTemplate<float>& bounds, int axis) {
+	return axis == 0 ? bounds.min.x : (axis == 1 ? bounds.min.y : bounds.min.z);
+}
+static float getMaxOnAxis(const BoundsTemplate<float>& bounds, int axis) {
+	return axis == 0 ? bounds.max.x : (axis == 1 ? bounds.max.y : bounds.max.z);
+}
+
+void SweepAndPrune::updateProxies(std::unordered_map<const Part*, SweepProxy>& proxyMap, const WorldLayer& parts, bool isTerrain) {
+	parts.forEach([&](Part& part) {
+		BoundsTemplate<float> bounds = part.getBounds();
+		auto found = proxyMap.find(&part);
+		if(found == proxyMap.end()) {
+			SweepProxy& newProxy = proxyMap.emplace(&part, SweepProxy{&part, bounds, updateCount, isTerrain}).first->second;
+			sortedProxies.push_back(&newProxy);
+		} else {
+			found->second.bounds = bounds;
+			found->second.lastSeenUpdate = updateCount;
+		}
+	});
+}
+
+void SweepAndPrune::removeLeftProxies(bool terrainWasUpdated) {
+	auto hasLeft = [this, terrainWasUpdated](const SweepProxy* proxy) {
+		if(proxy->isTerrain && !terrainWasUpdated) return false;
+		return proxy->lastSeenUpdate != updateCount;
+	};
+	std::size_t oldProxyCount = sortedProxies.size();
+	// keeps the order of the remaining proxies
+	sortedProxies.erase(std::remove_if(sortedProxies.begin(), sortedProxies.end(), hasLeft), sortedProxies.end());
+	if(sortedProxies.size() == oldProxyCount) return;
+
+	for(auto iter = proxies.begin(); iter != proxies.end();) {
+		if(hasLeft(&iter->second)) {
+			iter = proxies.erase(iter);
+		} else {
+			++iter;
+		}
+	}
+	if(terrainWasUpdated) {
+		for(auto iter = terrainProxies.begin(); iter != terrainProxies.end();) {
+			if(hasLeft(&iter->second)) {
+				iter = terrainProxies.erase(iter);
+			} else {
+				++iter;
+			}
+		}
+	}
+}
+
+// the axis along which the centers of the free parts have the largest variance
+int SweepAndPrune::computeBestSweepAxis() const {
+	if(proxies.size() < 2) return sweepAxis;
+
+	Vec3 sum(0.0, 0.0, 0.0);
+	Vec3 sumOfSquares(0.0, 0.0, 0.0);
+	for(const auto& entry : proxies) {
+		const BoundsTemplate<float>& bounds = entry.second.bounds;
+		for(int axis = 0; axis < 3; axis++) {
+			double center = (static_cast<double>(getMinOnAxis(bounds, axis)) + static_cast<double>(getMaxOnAxis(bounds, axis))) * 0.5;
+			sum[axis] += center;
+			sumOfSquares[axis] += center * center;
+		}
+	}
+	double count = static_cast<double>(proxies.size());
+	Vec3 variance;
+	for(int axis = 0; axis < 3; axis++) {
+		variance[axis] = sumOfSquares[axis] / count - (sum[axis] / count) * (sum[axis] / count);
+	}
+
+	int bestAxis = sweepAxis;
+	for(int axis = 0; axis < 3; axis++) {
+		if(variance[axis] > variance[bestAxis] * SWEEP_AXIS_SWITCH_FACTOR) {
+			bestAxis = axis;
+		}
+	}
+	return bestAxis;
+}
+
+// cheap for a nearly sorted list, which is the case when parts only moved a little since the last update
+void SweepAndPrune::insertionSort() {
+	lastSortSwapCount = 0;
+	for(std::size_t i = 1; i < sortedProxies.size(); i++) {
+		SweepProxy* proxy = sortedProxies[i];
+		float key = getMinOnAxis(proxy->bounds, sweepAxis);
+		std::size_t j = i;
+		while(j > 0 && getMinOnAxis(sortedProxies[j - 1]->bounds, sweepAxis) > key) {
+			sortedProxies[j] = sortedProxies[j - 1];
+			j--;
+		}
+		sortedProxies[j] = proxy;
+		lastSortSwapCount += i - j;
+	}
+}
+
+void SweepAndPrune::update(const WorldLayer& freeParts, const WorldLayer& terrainParts) {
+	updateCount++;
+
+	updateProxies(proxies, freeParts, false);
+
+	// terrain rarely changes, so it is only looked at after invalidateTerrain
+	bool terrainWasUpdated = terrainChanged;
+	if(terrainChanged) {
+		updateProxies(terrainProxies, terrainParts, true);
+		terrainChanged = false;
+	}
+
+	removeLeftProxies(terrainWasUpdated);
+
+	int bestAxis = computeBestSweepAxis();
+	if(bestAxis != sweepAxis) {
+		// the order along the old axis says nothing about the new one
+		sweepAxis = bestAxis;
+		std::sort(sortedProxies.begin(), sortedProxies.end(), [this](const SweepProxy* a, const SweepProxy* b) {
+			return getMinOnAxis(a->bounds, sweepAxis) < getMinOnAxis(b->bounds, sweepAxis);
+		});
+		lastSortSwapCount = sortedProxies.size();
+	} else {
+		insertionSort();
+	}
+}
+
+void SweepAndPrune::getColissions(ColissionBuffer& curColissions) const {
+	std::size_t proxyCount = sortedProxies.size();
+	for(std::size_t i = 0; i < proxyCount; i++) {
+		const SweepProxy* a = sortedProxies[i];
+		float aMax = getMaxOnAxis(a->bounds, sweepAxis);
+		for(std::size_t j = i + 1; j < proxyCount && getMinOnAxis(sortedProxies[j]->bounds, sweepAxis) <= aMax; j++) {
+			const SweepProxy* b = sortedProxies[j];
+			if(a->isTerrain && b->isTerrain) continue;
+			if(!intersects(a->bounds, b->bounds)) continue;
+
+			if(a->isTerrain) {
+				curColissions.freeTerrainColissions.push_back(Colission{b->part, a->part});
+			} else if(b->isTerrain) {
+				curColissions.freeTerrainColissions.push_back(Colission{a->part, b->part});
+			} else {
+				// parts of the same physical are in the same group of the tree, which never collides with itself
+				if(a->part->getMainPhysical() == b->part->getMainPhysical()) continue;
+				curColissions.freePartColissions.push_back(Colission{a->part, b->part});
+			}
+		}
+	}
+}
+
+void SweepAndPrune::clear() {
+	proxies.clear();
+	terrainProxies.clear();
+	sortedProxies.clear();
+	lastSortSwapCount = 0;
+	terrainChanged = true;
+}
+};
@@ -50,6 +50,9 @@ public:
 	}
 	ThreadPool() : ThreadPool(std::thread::hardware_concurrency()) {}
 
+	// the number of threads work is spread over, including the calling thread
+	unsigned int getNumberOfThreads() const { return static_cast<unsigned int>(threads.size()) + 1; }
+
 	// cleanup
 	~ThreadPool() {
 		shouldExit = true;
@@ -38,7 +38,7 @@ bool WorldPrototype::isValid() const {
 				DEBUGBREAK;
 				result = false;
 			} else {
-				if(!part.layer->tree.contains(&part)) {
+				if(!part.layer->contains(&part)) {
 					Debug::logError("Part not in tree!");
 					DEBUGBREAK;
 					result = false;
@@ -50,7 +50,7 @@ bool WorldPrototype::isValid() const {
 
 	for(const ColissionLayer& cl : layers) {
 		for(const WorldLayer& l : cl.subLayers) {
-			treeValidCheck(l.tree);
+			treeValidCheck(l.tree, l.usesFatBounds);
 			for(const Part& p : l.tree) {
 				if(p.layer != &l) {
 					Debug::logError("Part contained in layer, but it's layer field is not the layer");
@@ -164,6 +164,7 @@ void WorldPrototype::addPart(Part* part, int layerIndex) {
 		p.layer = worldLayer;
 	});
 	createNodeFor(worldLayer->tree, partPhys->mainPhysical);
+	worldLayer->notifyGroupChanged(part);
 
 
 	objectCount += partPhys->mainPhysical->getNumberOfPartsInThisAndChildren();
@@ -208,7 +209,9 @@ void WorldPrototype::addPhysicalWithExistingLayers(MotorizedPhysical* motorPhys)
 	std::vector<FoundLayerRepresentative> foundLayers = findAllLayersIn(motorPhys);
 
 	for(const FoundLayerRepresentative& l : foundLayers) {
+		l.layer->unfreeze();
 		createNewNodeFor(motorPhys, l.layer->tree, l.part);
+		l.layer->notifyGroupChanged(l.part);
 	}
 
 	ASSERT_VALID;
@@ -230,6 +233,14 @@ void WorldPrototype::addTerrainPart(Part* part, int layerIndex) {
 void WorldPrototype::removePart(Part* part) {
 	ASSERT_VALID;
 
+	if(sleepingEnabled) {
+		BoundsTemplate<float> bounds = part->getBounds();
+		for(ColissionLayer& layer : layers) {
+			layer.subLayers[ColissionLayer::FREE_PARTS_LAYER].tree.forEachOverlapping(bounds, [](Part* touchingPart) {
+				touchingPart->getMainPhysical()->wakeUp();
+			});
+		}
+	}
 	part->removeFromWorld();
 
 	ASSERT_VALID;
@@ -257,7 +268,12 @@ void WorldPrototype::clear() {
 		for(WorldLayer& layer : cl.subLayers) {
 			layer.tree.clear();
 		}
+		if(cl.pairCache != nullptr) cl.pairCache->clear();
+		if(cl.sweepAndPrune != nullptr) cl.sweepAndPrune->clear();
+		if(cl.frozenTerrain != nullptr) cl.frozenTerrain->clear();
 	}
+	if(this->gjkWarmStartCache != nullptr) this->gjkWarmStartCache->clear();
+	if(this->contactManifolds != nullptr) this->contactManifolds->clear();
 	for(Part* p : partsToDelete) {
 		this->onPartRemoved(p);
 		this->deletePart(p);
@@ -270,11 +286,52 @@ int WorldPrototype::getLayerCount() const {
 
 void WorldPrototype::optimizeLayers() {
 	for(ColissionLayer& layer : layers) {
-		layer.subLayers[ColissionLayer::TERRAIN_PARTS_LAYER].optimize();
+		for(WorldLayer& subLayer : layer.subLayers) {
+			subLayer.optimize();
+		}
+	}
+	ASSERT_VALID;
+}
+
+void WorldPrototype::optimizeLayers(ThreadPool& threadPool) {
+	for(ColissionLayer& layer : layers) {
+		for(WorldLayer& subLayer : layer.subLayers) {
+			subLayer.optimize(threadPool);
+		}
 	}
 	ASSERT_VALID;
 }
 
+void WorldPrototype::setUsesGJKWarmStart(bool usesGJKWarmStart) {
+	if(usesGJKWarmStart) {
+		if(gjkWarmStartCache == nullptr) gjkWarmStartCache = std::make_unique<GJKWarmStartCache>();
+	} else {
+		gjkWarmStartCache = nullptr;
+	}
+}
+
+void WorldPrototype::setUsesContactManifolds(bool usesContactManifolds) {
+	if(usesContactManifolds) {
+		if(contactManifolds == nullptr) contactManifolds = std::make_unique<ContactManifoldCache>();
+	} else {
+		contactManifolds = nullptr;
+	}
+}
+
+void WorldPrototype::setUsesSequentialImpulses(bool usesSequentialImpulses) {
+	if(usesSequentialImpulses) setUsesContactManifolds(true);
+	sequentialImpulsesEnabled = usesSequentialImpulses;
+}
+
+void WorldPrototype::setUsesSleeping(bool usesSleeping) {
+	if(!usesSleeping) {
+		for(MotorizedPhysical* phys : physicals) {
+			phys->wakeUp();
+		}
+	}
+	sleepingEnabled = usesSleeping;
+}
+
 static void assignLayersForPhysicalRecurse(const Physical& phys, std::vector<std::pair<WorldLayer*, std::vector<const Part*>>>& foundLayers) {
 	phys.rigidBody.forEachPart([&foundLayers](const Part& part) {
 		for(std::pair<WorldLayer*, std::vector<const Part*>>& knownLayer : foundLayers) {
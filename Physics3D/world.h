@@ -10,6 +10,10 @@
 #include "softlinks/softLink.h"
 #include "externalforces/externalForce.h"
 #include "colissionBuffer.h"
+#include "gjkWarmStartCache.h"
+#include "contactManifold.h"
+#include "contactSolver.h"
+#include "geometry/computationBuffer.h"
 
 namespace P3D {
 class Physical;
@@ -20,8 +24,20 @@ class WorldLayer;
 class ColissionLayer;
 class ThreadPool;
 
+// when a world uses sleeping, islands of physicals that have been resting this long stop being simulated, see updateSleepStates
+struct SleepSettings {
+	// physicals slower than both of these are resting
+	double maxLinearVelocity = 0.05;
+	double maxAngularVelocity = 0.05;
+	// an island falls asleep once every physical in it has been resting for this many ticks
+	int restingTicksUntilSleep = 60;
+};
+
 class WorldPrototype {
 private:
+	bool sleepingEnabled = false;
+	bool sequentialImpulsesEnabled = false;
+
 	friend class Physical;
 	friend class MotorizedPhysical;
 	friend class ConnectedPhysical;
@@ -63,6 +79,14 @@ public:
 	void addLink(SoftLink* link);
 
 	ColissionBuffer curColissions;
+	// optional, when set GJK is seeded with the last search direction of each pair
+	std::unique_ptr<GJKWarmStartCache> gjkWarmStartCache;
+	// optional, when set the contacts of each pair are kept across ticks, such that resting parts are supported at multiple points
+	std::unique_ptr<ContactManifoldCache> contactManifolds;
+	SleepSettings sleepSettings;
+	ContactSolverSettings contactSolverSettings;
+	// the EPA buffers of every thread of the pools this world is ticked on, kept across ticks and pools
+	EPAArenas epaArenas;
 	size_t age = 0;
 	size_t objectCount = 0;
 	double deltaT;
@@ -80,6 +104,7 @@ public:
 	void tick();
 
 	virtual void addPart(Part* part, int layerIndex = 0);
+	// physicals touching the removed part are woken up, such that sleeping parts don't stay floating in the air
 	virtual void removePart(Part* part);
 	void addTerrainPart(Part* part, int layerIndex = 0);
 
@@ -92,6 +117,25 @@ public:
 	void deleteLayer(int layerIndex, int layerToMoveTo);
 
 	void optimizeLayers();
+	// like optimizeLayers, but the trees of large layers are rebuilt in parallel on the given pool
+	void optimizeLayers(ThreadPool& threadPool);
+
+	void setUsesGJKWarmStart(bool usesGJKWarmStart);
+	bool usesGJKWarmStart() const { return gjkWarmStartCache != nullptr; }
+
+	void setUsesContactManifolds(bool usesContactManifolds);
+	bool usesContactManifolds() const { return contactManifolds != nullptr; }
+
+	/*
+		Resolves contacts with iterated, warm started impulses instead of depth forces, which stays stable at larger deltaT
+		Turning this on also turns on contact manifolds, these keep the impulses of the contact points across ticks
+	*/
+	void setUsesSequentialImpulses(bool usesSequentialImpulses);
+	bool usesSequentialImpulses() const { return sequentialImpulsesEnabled; }
+
+	// turning sleeping off wakes every physical
+	void setUsesSleeping(bool usesSleeping);
+	bool usesSleeping() const { return sleepingEnabled; }
 
 	// removes everything from this world, parts, physicals, forces, constraints
 	void clear();
@@ -2,6 +2,7 @@
 
 #include "world.h"
 #include "layer.h"
+#include "contactIslands.h"
 
 #include "math/mathUtil.h"
 #include "math/linalg/vec.h"
@@ -10,9 +11,16 @@
 #include "misc/debug.h"
 #include "misc/physicsProfiler.h"
 
+#include "geometry/intersection.h"
+#include "geometry/batchedIntersection.h"
+#include "geometry/builtinShapeClasses.h"
+#include "geometry/shapeClass.h"
+
 #include <vector>
 #include <cmath>
 #include <algorithm>
+#include <atomic>
+#include <optional>
 
 #define COLLISSION_DEPTH_FORCE_MULTIPLIER 2000
 
@@ -22,11 +30,21 @@ namespace P3D {
 */
 
 void handleCollision(Part& part1, Part& part2, Position collisionPoint, Vec3 exitVector) {
-	Debug::logPoint(collisionPoint, Debug::INTERSECTION);
-	
 	MotorizedPhysical& phys1 = *part1.getPhysical()->mainPhysical;
 	MotorizedPhysical& phys2 = *part2.getPhysical()->mainPhysical;
 
+	// a sleeping physical holds still like terrain, until updateSleepStates decides whether its island wakes up
+	if(phys1.isAsleep) {
+		handleTerrainCollision(part2, part1, collisionPoint, -exitVector);
+		return;
+	}
+	if(phys2.isAsleep) {
+		handleTerrainCollision(part1, part2, collisionPoint, exitVector);
+		return;
+	}
+
+	Debug::logPoint(collisionPoint, Debug::INTERSECTION);
+
 	double sizeOrder = std::min(part1.maxRadius, part2.maxRadius);
 	if(lengthSquared(exitVector) <= 1E-8 * sizeOrder * sizeOrder) {
 		return; // don't do anything for very small colissions
@@ -196,9 +214,14 @@ void tickWorldUnsynchronized(WorldPrototype& world, ThreadPool& threadPool) {
 
 	physicsMeasure.mark(PhysicsProcess::EXTERNALS);
 	applyExternalForces(world);
+	wakeOnChangedForces(world);
 
 	physicsMeasure.mark(PhysicsProcess::COLISSION_HANDLING);
-	handleColissions(world.curColissions);
+	if(world.usesSequentialImpulses()) {
+		solveContactsParallel(world, threadPool);
+	} else {
+		handleColissionsParallel(world.curColissions, world.contactManifolds.get(), world.constraints, threadPool);
+	}
 
 	physicsMeasure.mark(PhysicsProcess::OTHER);
 	intersectionStatistics.nextTally();
@@ -206,8 +229,14 @@ void tickWorldUnsynchronized(WorldPrototype& world, ThreadPool& threadPool) {
 	physicsMeasure.mark(PhysicsProcess::CONSTRAINTS);
 	handleConstraints(world);
 
+	physicsMeasure.mark(PhysicsProcess::COLISSION_OTHER);
+	handleContinuousColissions(world);
+
+	physicsMeasure.mark(PhysicsProcess::OTHER);
+	updateSleepStates(world);
+
 	physicsMeasure.mark(PhysicsProcess::UPDATING);
-	update(world);
+	update(world, threadPool);
 }
 
 void tickWorldSynchronized(WorldPrototype& world, ThreadPool& threadPool, UpgradeableMutex& worldMutex) {
@@ -219,9 +248,14 @@ void tickWorldSynchronized(WorldPrototype& world, ThreadPool& threadPool, Upgrad
 
 	physicsMeasure.mark(PhysicsProcess::EXTERNALS);
 	applyExternalForces(world);
+	wakeOnChangedForces(world);
 
 	physicsMeasure.mark(PhysicsProcess::COLISSION_HANDLING);
-	handleColissions(world.curColissions);
+	if(world.usesSequentialImpulses()) {
+		solveContactsParallel(world, threadPool);
+	} else {
+		handleColissionsParallel(world.curColissions, world.contactManifolds.get(), world.constraints, threadPool);
+	}
 
 	physicsMeasure.mark(PhysicsProcess::OTHER);
 	intersectionStatistics.nextTally();
@@ -229,11 +263,17 @@ void tickWorldSynchronized(WorldPrototype& world, ThreadPool& threadPool, Upgrad
 	physicsMeasure.mark(PhysicsProcess::CONSTRAINTS);
 	handleConstraints(world);
 
+	physicsMeasure.mark(PhysicsProcess::COLISSION_OTHER);
+	handleContinuousColissions(world);
+
+	physicsMeasure.mark(PhysicsProcess::OTHER);
+	updateSleepStates(world);
+
 	physicsMeasure.mark(PhysicsProcess::WAIT_FOR_LOCK);
 	worldMutex.upgrade();
 
 	physicsMeasure.mark(PhysicsProcess::UPDATING);
-	update(world);
+	update(world, threadPool);
 
 	physicsMeasure.mark(PhysicsProcess::WAIT_FOR_LOCK);
 	worldMutex.unlock();
@@ -245,10 +285,19 @@ void applyExternalForces(WorldPrototype& world) {
 	}
 }
 
+static PartIntersection intersectsWarmStarted(const Part& p1, const Part& p2, GJKWarmStartCache* warmStartCache) {
+	if(warmStartCache == nullptr) return p1.intersects(p2);
+	return p1.intersects(p2, warmStartCache->getSearchDirection(&p1, &p2));
+}
+
 PartIntersection safeIntersects(const Part& p1, const Part& p2) {
+	return safeIntersects(p1, p2, nullptr);
+}
+
+PartIntersection safeIntersects(const Part& p1, const Part& p2, GJKWarmStartCache* warmStartCache) {
 #ifdef CATCH_INTERSECTION_ERRORS
 	try {
-		return p1.intersects(p2);
+		return intersectsWarmStarted(p1, p2, warmStartCache);
 	} catch(const std::exception& err) {
 		Debug::logError("Error occurred during intersection: %s", err.what());
 
@@ -263,16 +312,91 @@ PartIntersection safeIntersects(const Part& p1, const Part& p2) {
 		throw "exit";
 	}
 #else
-	return p1.intersects(p2);
+	return intersectsWarmStarted(p1, p2, warmStartCache);
 #endif
 }
 
 void refineColissions(std::vector<Colission>& colissions) {
+	refineColissions(colissions, nullptr);
+}
+
+// pairs are narrowphased in chunks of this size, such that the box pairs of a chunk can be intersected as one batch
+static constexpr std::size_t REFINE_CHUNK_SIZE = 64;
+
+static bool isBoxPair(const Colission& col) {
+	return col.p1->hitbox.baseShape->intersectionClassID == CUBE_CLASS_ID && col.p2->hitbox.baseShape->intersectionClassID == CUBE_CLASS_ID;
+}
+
+// intersects the box pairs collected by intersectChunk as one batch
+static void intersectBoxPairs(const Colission* colissions, const Shape* const* firstShapes, const Shape* const* secondShapes, const CFrame* relativeTransforms, const std::size_t* boxPairIndices, std::size_t boxPairCount, PartIntersection* results) {
+	std::optional<Intersection> boxResults[REFINE_CHUNK_SIZE];
+	intersectsTransformedBatch(firstShapes, secondShapes, relativeTransforms, boxPairCount, boxResults);
+	for(std::size_t k = 0; k < boxPairCount; k++) {
+		const GlobalCFrame& frameOfFirst = colissions[boxPairIndices[k]].p1->getCFrame();
+		if(boxResults[k]) {
+			results[boxPairIndices[k]] = PartIntersection(frameOfFirst.localToGlobal(boxResults[k]->intersection), frameOfFirst.localToRelative(boxResults[k]->exitVector));
+		} else {
+			results[boxPairIndices[k]] = PartIntersection();
+		}
+	}
+}
+
+/*
+	Computes the narrowphase results of the first count colissions, count may not exceed REFINE_CHUNK_SIZE
+	Box pairs go through intersectsTransformedBatch, the others through safeIntersects
+	With CATCH_INTERSECTION_ERRORS a failed batch is redone through safeIntersects, such that the failing pair is saved
+*/
+static void intersectChunk(const Colission* colissions, std::size_t count, GJKWarmStartCache* warmStartCache, PartIntersection* results) {
+	const Shape* firstShapes[REFINE_CHUNK_SIZE]{};
+	const Shape* secondShapes[REFINE_CHUNK_SIZE]{};
+	CFrame relativeTransforms[REFINE_CHUNK_SIZE];
+	std::size_t boxPairIndices[REFINE_CHUNK_SIZE];
+	std::size_t boxPairCount = 0;
+
+	for(std::size_t i = 0; i < count; i++) {
+		const Colission& col = colissions[i];
+		if(isBoxPair(col)) {
+			firstShapes[boxPairCount] = &col.p1->hitbox;
+			secondShapes[boxPairCount] = &col.p2->hitbox;
+			relativeTransforms[boxPairCount] = col.p1->getCFrame().globalToLocal(col.p2->getCFrame());
+			boxPairIndices[boxPairCount] = i;
+			boxPairCount++;
+		} else {
+			results[i] = safeIntersects(*col.p1, *col.p2, warmStartCache);
+		}
+	}
+
+	if(boxPairCount == 0) return;
+
+#ifdef CATCH_INTERSECTION_ERRORS
+	try {
+		intersectBoxPairs(colissions, firstShapes, secondShapes, relativeTransforms, boxPairIndices, boxPairCount, results);
+	} catch(...) {
+		// redo the box pairs one by one, such that the pair that failed is saved by safeIntersects before the error is passed on
+		Debug::logError("Error occurred during batched intersection, retrying the pairs separately");
+		for(std::size_t k = 0; k < boxPairCount; k++) {
+			const Colission& col = colissions[boxPairIndices[k]];
+			results[boxPairIndices[k]] = safeIntersects(*col.p1, *col.p2, warmStartCache);
+		}
+		throw;
+	}
+#else
+	intersectBoxPairs(colissions, firstShapes, secondShapes, relativeTransforms, boxPairIndices, boxPairCount, results);
+#endif
+}
+
+void refineColissions(std::vector<Colission>& colissions, GJKWarmStartCache* warmStartCache) {
+	std::vector<PartIntersection> results(colissions.size());
+	for(std::size_t chunkStart = 0; chunkStart < colissions.size(); chunkStart += REFINE_CHUNK_SIZE) {
+		std::size_t chunkSize = std::min(REFINE_CHUNK_SIZE, colissions.size() - chunkStart);
+		intersectChunk(colissions.data() + chunkStart, chunkSize, warmStartCache, results.data() + chunkStart);
+	}
+
 	for (size_t i = 0; i < colissions.size();) {
 
 		Colission& col = colissions[i];
 
-		PartIntersection result = safeIntersects(*col.p1, *col.p2);
+		PartIntersection& result = results[i];
 
 		if (result.intersects) {
 
@@ -290,60 +414,97 @@ void refineColissions(std::vector<Colission>& colissions) {
 
 			col = std::move(colissions.back());
 			colissions.pop_back();
+			result = results.back();
+			results.pop_back();
 
 		}
 	}
 }
 
 void parallelRefineColissions(ThreadPool& threadPool, std::vector<Colission>& colissions) {
+	parallelRefineColissions(threadPool, colissions, nullptr);
+}
+
+void parallelRefineColissions(ThreadPool& threadPool, std::vector<Colission>& colissions, GJKWarmStartCache* warmStartCache) {
+	parallelRefineColissions(threadPool, colissions, warmStartCache, nullptr);
+}
+
+void parallelRefineColissions(ThreadPool& threadPool, std::vector<Colission>& colissions, GJKWarmStartCache* warmStartCache, EPAArenas* arenas) {
 	std::vector<Colission> wantedColission;
 	const size_t workEnd = colissions.size();
 	size_t currIndex = 0;
 	std::mutex colissionMutex, statsMutex, indexMutex, vecMutex;
+	std::atomic<std::size_t> nextArenaSlot(0);
 
 	threadPool.doInParallel([&] {
+		std::optional<UseComputationBuffers> arena;
+		if(arenas != nullptr) {
+			std::size_t slot = nextArenaSlot++;
+			if(slot < arenas->getSlotCount()) arena.emplace(arenas->getSlot(slot));
+		}
+		PartIntersection results[REFINE_CHUNK_SIZE];
 		while(true) {
 
 			indexMutex.lock();
 			size_t claimedWork = currIndex;
-			currIndex++;
+			currIndex += REFINE_CHUNK_SIZE;
 			indexMutex.unlock();
 
 			if(claimedWork >= workEnd) {
 				break;
 			}
 
-			Colission col = colissions[claimedWork];
-			PartIntersection result = safeIntersects(*col.p1, *col.p2);
+			std::size_t chunkSize = std::min(REFINE_CHUNK_SIZE, workEnd - claimedWork);
+			intersectChunk(colissions.data() + claimedWork, chunkSize, warmStartCache, results);
 
-			if(result.intersects) {
+			for(std::size_t i = 0; i < chunkSize; i++) {
+				Colission col = colissions[claimedWork + i];
+				const PartIntersection& result = results[i];
 
-				statsMutex.lock();
-				intersectionStatistics.addToTally(IntersectionResult::COLISSION, 1);
-				statsMutex.unlock();
+				if(result.intersects) {
 
+					statsMutex.lock();
+					intersectionStatistics.addToTally(IntersectionResult::COLISSION, 1);
+					statsMutex.unlock();
 
-				// add extra information
-				col.intersection = result.intersection;
-				col.exitVector = result.exitVector;
 
+					// add extra information
+					col.intersection = result.intersection;
+					col.exitVector = result.exitVector;
 
-				vecMutex.lock();
-				wantedColission.push_back(col);
-				vecMutex.unlock();
-			} else {
 
-				statsMutex.lock();
-				intersectionStatistics.addToTally(IntersectionResult::GJK_REJECT, 1);
-				statsMutex.unlock();
+					vecMutex.lock();
+					wantedColission.push_back(col);
+					vecMutex.unlock();
+				} else {
 
+					statsMutex.lock();
+					intersectionStatistics.addToTally(IntersectionResult::GJK_REJECT, 1);
+					statsMutex.unlock();
 
+
+				}
 			}
 		}
 	});
 	colissions.swap(wantedColission);
 }
 
+static bool isAsleep(const Part* part) {
+	return part->getMainPhysical()->isAsleep;
+}
+
+void removeSleepingColissions(ColissionBuffer& curColissions) {
+	std::vector<Colission>& freePartColissions = curColissions.freePartColissions;
+	freePartColissions.erase(std::remove_if(freePartColissions.begin(), freePartColissions.end(), [](const Colission& c) {
+		return isAsleep(c.p1) && isAsleep(c.p2);
+	}), freePartColissions.end());
+	std::vector<Colission>& freeTerrainColissions = curColissions.freeTerrainColissions;
+	freeTerrainColissions.erase(std::remove_if(freeTerrainColissions.begin(), freeTerrainColissions.end(), [](const Colission& c) {
+		return isAsleep(c.p1);
+	}), freeTerrainColissions.end());
+}
+
 void findColissions(WorldPrototype& world, ColissionBuffer& curColissions) {
 	curColissions.clear();
 
@@ -357,25 +518,95 @@ void findColissions(WorldPrototype& world, ColissionBuffer& curColissions) {
 		getColissionsBetween(world.layers[collidingLayers.first], world.layers[collidingLayers.second], curColissions);
 	}
 
-	refineColissions(curColissions.freePartColissions);
-	refineColissions(curColissions.freeTerrainColissions);
+	removeSleepingColissions(curColissions);
+
+	world.epaArenas.reserveSlots(1);
+	UseComputationBuffers arena(world.epaArenas.getSlot(0));
+	refineColissions(curColissions.freePartColissions, world.gjkWarmStartCache.get());
+	refineColissions(curColissions.freeTerrainColissions, world.gjkWarmStartCache.get());
+	if(world.gjkWarmStartCache != nullptr) world.gjkWarmStartCache->removeStaleEntries();
+}
+
+/*
+	Runs func(i) for every i in [0, count), spread over the threads of the pool
+	Threads claim indices one by one, so this is best suited to a few large jobs
+*/
+template<typename Func>
+static void parallelForEachIndex(ThreadPool& threadPool, std::size_t count, const Func& func) {
+	std::atomic<std::size_t> nextIndex(0);
+	threadPool.doInParallel([&]() {
+		while(true) {
+			std::size_t claimedIndex = nextIndex++;
+			if(claimedIndex >= count) break;
+			func(claimedIndex);
+		}
+	});
+}
+
+/*
+	One colission query of the broadphase, firstLayer == secondLayer means the internal colissions of that layer
+	else it means the colissions between the two layers
+*/
+struct LayerColissionJob {
+	int firstLayer;
+	int secondLayer;
+};
+
+static std::vector<LayerColissionJob> getLayerColissionJobs(const WorldPrototype& world) {
+	std::vector<LayerColissionJob> jobs;
+	for(int i = 0; i < static_cast<int>(world.layers.size()); i++) {
+		if(world.layers[i].collidesInternally) {
+			jobs.push_back(LayerColissionJob{i, i});
+		}
+	}
+	for(std::pair<int, int> collidingLayers : world.colissionMask) {
+		jobs.push_back(LayerColissionJob{collidingLayers.first, collidingLayers.second});
+	}
+	return jobs;
+}
+
+static void appendColissions(ColissionBuffer& curColissions, const ColissionBuffer& newColissions) {
+	curColissions.freePartColissions.insert(curColissions.freePartColissions.end(), newColissions.freePartColissions.begin(), newColissions.freePartColissions.end());
+	curColissions.freeTerrainColissions.insert(curColissions.freeTerrainColissions.end(), newColissions.freeTerrainColissions.begin(), newColissions.freeTerrainColissions.end());
 }
 
 void findColissionsParallel(WorldPrototype& world, ColissionBuffer& curColissions, ThreadPool& threadPool) {
 	curColissions.clear();
 
-	for(const ColissionLayer& layer : world.layers) {
-		if(layer.collidesInternally) {
-			layer.getInternalColissions(curColissions);
+	std::vector<LayerColissionJob> jobs = getLayerColissionJobs(world);
+
+	if(jobs.size() >= threadPool.getNumberOfThreads()) {
+		// enough layer queries to keep every thread busy, each query runs on a single thread into its own buffer
+		std::vector<ColissionBuffer> jobColissions(jobs.size());
+		parallelForEachIndex(threadPool, jobs.size(), [&](std::size_t jobIndex) {
+			const LayerColissionJob& job = jobs[jobIndex];
+			if(job.firstLayer == job.secondLayer) {
+				world.layers[job.firstLayer].getInternalColissions(jobColissions[jobIndex]);
+			} else {
+				getColissionsBetween(world.layers[job.firstLayer], world.layers[job.secondLayer], jobColissions[jobIndex]);
+			}
+		});
+		// appended in job order, so the result is the same as that of findColissions
+		for(const ColissionBuffer& newColissions : jobColissions) {
+			appendColissions(curColissions, newColissions);
+		}
+	} else {
+		// too few layer queries, split the trees of each query over the threads instead
+		for(const LayerColissionJob& job : jobs) {
+			if(job.firstLayer == job.secondLayer) {
+				world.layers[job.firstLayer].getInternalColissionsParallel(curColissions, threadPool);
+			} else {
+				getColissionsBetweenParallel(world.layers[job.firstLayer], world.layers[job.secondLayer], curColissions, threadPool);
+			}
 		}
 	}
 
-	for(std::pair<int, int> collidingLayers : world.colissionMask) {
-		getColissionsBetween(world.layers[collidingLayers.first], world.layers[collidingLayers.second], curColissions);
-	}
+	removeSleepingColissions(curColissions);
 
-	parallelRefineColissions(threadPool, curColissions.freePartColissions);
-	parallelRefineColissions(threadPool, curColissions.freeTerrainColissions);
+	world.epaArenas.reserveSlots(threadPool.getNumberOfThreads());
+	parallelRefineColissions(threadPool, curColissions.freePartColissions, world.gjkWarmStartCache.get(), &world.epaArenas);
+	parallelRefineColissions(threadPool, curColissions.freeTerrainColissions, world.gjkWarmStartCache.get(), &world.epaArenas);
+	if(world.gjkWarmStartCache != nullptr) world.gjkWarmStartCache->removeStaleEntries();
 }
 
 void handleColissions(ColissionBuffer& curColissions) {
@@ -387,19 +618,358 @@ void handleColissions(ColissionBuffer& curColissions) {
 	}
 }
 
+/*
+	Every point of the manifold gets its share of the exitVector, such that the total depth force matches that of a single contact
+	The impulses only depend on the direction of the exitVector, so these are not affected
+*/
+void handleColissions(ColissionBuffer& curColissions, ContactManifoldCache* manifolds) {
+	if(manifolds == nullptr) {
+		handleColissions(curColissions);
+		return;
+	}
+	for(Colission c : curColissions.freePartColissions) {
+		const ContactManifold& manifold = manifolds->update(*c.p1, *c.p2, c.intersection, c.exitVector);
+		for(int i = 0; i < manifold.pointCount; i++) {
+			handleCollision(*c.p1, *c.p2, manifold.points[i].intersection, manifold.points[i].exitVector / manifold.pointCount);
+		}
+	}
+	for(Colission c : curColissions.freeTerrainColissions) {
+		const ContactManifold& manifold = manifolds->update(*c.p1, *c.p2, c.intersection, c.exitVector);
+		for(int i = 0; i < manifold.pointCount; i++) {
+			handleTerrainCollision(*c.p1, *c.p2, manifold.points[i].intersection, manifold.points[i].exitVector / manifold.pointCount);
+		}
+	}
+	manifolds->removeStaleEntries();
+}
+
+// islands with more contacts than this are split by colorIslandContacts, such that one large pile doesn't keep a single thread busy
+#define ISLAND_SPLIT_CONTACT_COUNT 256
+
+namespace {
+// one colission of this tick, manifold is nullptr when the world doesn't keep manifolds
+struct ContactJob {
+	const Colission* colission;
+	const ContactManifold* manifold;
+	bool isTerrain;
+};
+};
+
+static void resolveContact(const ContactJob& job) {
+	const Colission& c = *job.colission;
+	void(*handle)(Part&, Part&, Position, Vec3) = job.isTerrain ? handleTerrainCollision : handleCollision;
+	if(job.manifold == nullptr) {
+		handle(*c.p1, *c.p2, c.intersection, c.exitVector);
+		return;
+	}
+	const ContactManifold& manifold = *job.manifold;
+	for(int i = 0; i < manifold.pointCount; i++) {
+		handle(*c.p1, *c.p2, manifold.points[i].intersection, manifold.points[i].exitVector / manifold.pointCount);
+	}
+}
+
+void handleColissionsParallel(ColissionBuffer& curColissions, ContactManifoldCache* manifolds, const std::vector<ConstraintGroup>& constraints, ThreadPool& threadPool) {
+	if(threadPool.getNumberOfThreads() <= 1) {
+		handleColissions(curColissions, manifolds);
+		return;
+	}
+
+	// manifolds only depend on the cframes of the parts, which resolving contacts doesn't change, so they are all updated up front in the sequential order
+	std::size_t contactCount = curColissions.freePartColissions.size() + curColissions.freeTerrainColissions.size();
+	std::vector<ContactJob> jobs;
+	std::vector<IslandContact> contacts;
+	jobs.reserve(contactCount);
+	contacts.reserve(contactCount);
+	for(const Colission& c : curColissions.freePartColissions) {
+		const ContactManifold* manifold = (manifolds != nullptr) ? &manifolds->update(*c.p1, *c.p2, c.intersection, c.exitVector) : nullptr;
+		jobs.push_back(ContactJob{&c, manifold, false});
+		contacts.push_back(IslandContact{c.p1->getPhysical()->mainPhysical, c.p2->getPhysical()->mainPhysical});
+	}
+	for(const Colission& c : curColissions.freeTerrainColissions) {
+		const ContactManifold* manifold = (manifolds != nullptr) ? &manifolds->update(*c.p1, *c.p2, c.intersection, c.exitVector) : nullptr;
+		jobs.push_back(ContactJob{&c, manifold, true});
+		contacts.push_back(IslandContact{c.p1->getPhysical()->mainPhysical, nullptr});
+	}
+
+	std::vector<std::vector<std::size_t>> islands = findContactIslands(contacts, constraints);
+	std::vector<std::size_t> smallIslands;
+	std::vector<std::size_t> largeIslands;
+	for(std::size_t i = 0; i < islands.size(); i++) {
+		(islands[i].size() > ISLAND_SPLIT_CONTACT_COUNT ? largeIslands : smallIslands).push_back(i);
+	}
+
+	// every island is resolved in the sequential order, so the result doesn't depend on the number of threads
+	parallelForEachIndex(threadPool, smallIslands.size(), [&](std::size_t i) {
+		for(std::size_t contactIndex : islands[smallIslands[i]]) {
+			resolveContact(jobs[contactIndex]);
+		}
+	});
+	for(std::size_t islandIndex : largeIslands) {
+		for(const std::vector<std::size_t>& color : colorIslandContacts(contacts, islands[islandIndex])) {
+			parallelForEachIndex(threadPool, color.size(), [&](std::size_t i) {
+				resolveContact(jobs[color[i]]);
+			});
+		}
+	}
+
+	if(manifolds != nullptr) manifolds->removeStaleEntries();
+}
+
+static void integrateExternalForces(WorldPrototype& world) {
+	for(MotorizedPhysical* phys : world.physicals) {
+		if(phys->isAsleep) continue;
+		Vec3 localMoment = phys->getCFrame().relativeToLocal(phys->totalMoment);
+		phys->motionOfCenterOfMass.translation.translation[0] += phys->forceResponse * phys->totalForce * world.deltaT;
+		phys->motionOfCenterOfMass.rotation.rotation[0] += phys->getCFrame().localToRelative(phys->momentResponse * localMoment * world.deltaT);
+		phys->totalForce = Vec3();
+		phys->totalMoment = Vec3();
+	}
+}
+
+void solveContactsParallel(WorldPrototype& world, ThreadPool& threadPool) {
+	integrateExternalForces(world);
+
+	ColissionBuffer& curColissions = world.curColissions;
+	ContactManifoldCache* manifolds = world.contactManifolds.get();
+	std::size_t colissionCount = curColissions.freePartColissions.size() + curColissions.freeTerrainColissions.size();
+
+	// without manifolds every colission is a single contact point, which can't be warm started
+	std::vector<ContactPoint> singlePoints;
+	if(manifolds == nullptr) singlePoints.reserve(colissionCount);
+	auto getManifoldPoints = [&](const Colission& c, ContactPoint*& points, int& pointCount) {
+		if(manifolds != nullptr) {
+			ContactManifold& manifold = manifolds->update(*c.p1, *c.p2, c.intersection, c.exitVector);
+			points = manifold.points;
+			pointCount = manifold.pointCount;
+		} else {
+			singlePoints.push_back(ContactPoint{Vec3(), Vec3(), c.intersection, c.exitVector});
+			points = &singlePoints.back();
+			pointCount = 1;
+		}
+	};
+
+	// the solver contacts are created on the threads, the manifolds are updated up front in the sequential order
+	struct SolverJob {
+		const Colission* colission;
+		ContactPoint* point;
+		bool isTerrain;
+	};
+	std::vector<SolverJob> jobs;
+	std::vector<IslandContact> contacts;
+	jobs.reserve(colissionCount);
+	contacts.reserve(colissionCount);
+	auto addJobs = [&](const Colission& c, bool isTerrain) {
+		ContactPoint* points;
+		int pointCount;
+		getManifoldPoints(c, points, pointCount);
+		for(int i = 0; i < pointCount; i++) {
+			if(lengthSquared(points[i].exitVector) == 0.0) continue;
+			jobs.push_back(SolverJob{&c, &points[i], isTerrain});
+			contacts.push_back(IslandContact{c.p1->getMainPhysical(), isTerrain ? nullptr : c.p2->getMainPhysical()});
+		}
+	};
+	for(const Colission& c : curColissions.freePartColissions) addJobs(c, false);
+	for(const Colission& c : curColissions.freeTerrainColissions) addJobs(c, true);
+
+	std::vector<SolverContact> solverContacts(jobs.size());
+	std::vector<std::vector<std::size_t>> islands = findContactIslands(contacts, world.constraints);
+	parallelForEachIndex(threadPool, islands.size(), [&](std::size_t islandIndex) {
+		for(std::size_t contactIndex : islands[islandIndex]) {
+			const SolverJob& job = jobs[contactIndex];
+			solverContacts[contactIndex] = createSolverContact(*job.colission->p1, *job.colission->p2, job.isTerrain, *job.point, world.contactSolverSettings, world.deltaT);
+		}
+		solveContactIsland(solverContacts, islands[islandIndex], world.contactSolverSettings);
+	});
+
+	if(manifolds != nullptr) manifolds->removeStaleEntries();
+}
+
+// parts that move less than this fraction of their smallest half extent in a tick can't pass through anything unnoticed
+#define CONTINUOUS_COLISSION_MIN_MOTION 0.5
+// the gap at which a part is considered to have reached the terrain, relative to its smallest half extent
+#define CONTINUOUS_COLISSION_TOLERANCE 0.05
+/*
+	MotorizedPhysical::update adds the velocity change of the tick before moving, and then moves another half of it on top
+	so a part moves by (velocity + 1.5 * velocityChange) * deltaT in a tick
+*/
+#define CONTINUOUS_COLISSION_VELOCITY_CHANGE_FACTOR 1.5
+
+struct ContinuousColissionHit {
+	double timeOfImpact;
+	// global, pointing from the part towards the terrain
+	Vec3 normal;
+	Vec3 displacement;
+};
+
+static void sweepAgainstTerrain(const Part& part, const Vec3& displacement, const WorldLayer& terrain, ContinuousColissionHit& earliestHit, bool& hasHit) {
+	double smallestHalfExtent = std::min(part.hitbox.scale[0], std::min(part.hitbox.scale[1], part.hitbox.scale[2]));
+	BoundsTemplate<float> startBounds = part.getBounds();
+	BoundsTemplate<float> endBounds(startBounds.min + Vec3f(displacement), startBounds.max + Vec3f(displacement));
+	Vec3 localDisplacement = part.getCFrame().relativeToLocal(displacement);
+
+	terrain.forEachOverlapping(unionOfBounds(startBounds, endBounds), [&](const Part* obstacle) {
+		CFrame relativeTransform = part.getCFrame().globalToLocal(obstacle->getCFrame());
+		Vec3 localNormal;
+		std::optional<double> timeOfImpact = timeOfImpactTransformed(part.hitbox, obstacle->hitbox, relativeTransform, localDisplacement, smallestHalfExtent * CONTINUOUS_COLISSION_TOLERANCE, localNormal);
+		if(timeOfImpact && (!hasHit || *timeOfImpact < earliestHit.timeOfImpact)) {
+			earliestHit = ContinuousColissionHit{*timeOfImpact, part.getCFrame().localToRelative(localNormal), displacement};
+			hasHit = true;
+		}
+	});
+}
+
+void handleContinuousColissions(WorldPrototype& world) {
+	std::vector<std::pair<MotorizedPhysical*, ContinuousColissionHit>> hits;
+
+	for(int layerIndex = 0; layerIndex < static_cast<int>(world.layers.size()); layerIndex++) {
+		const ColissionLayer& layer = world.layers[layerIndex];
+		if(!layer.usesContinuousColission) continue;
+
+		// the terrain layers this layer collides with, the same as those used by findColissions
+		std::vector<const WorldLayer*> terrainLayers;
+		if(layer.collidesInternally) terrainLayers.push_back(&layer.subLayers[ColissionLayer::TERRAIN_PARTS_LAYER]);
+		for(std::pair<int, int> collidingLayers : world.colissionMask) {
+			if(collidingLayers.first == layerIndex) terrainLayers.push_back(&world.layers[collidingLayers.second].subLayers[ColissionLayer::TERRAIN_PARTS_LAYER]);
+			if(collidingLayers.second == layerIndex) terrainLayers.push_back(&world.layers[collidingLayers.first].subLayers[ColissionLayer::TERRAIN_PARTS_LAYER]);
+		}
+
+		layer.subLayers[ColissionLayer::FREE_PARTS_LAYER].forEach([&](Part& part) {
+			MotorizedPhysical* phys = part.getPhysical()->mainPhysical;
+			if(phys->isAsleep) return;
+			// the same displacement update will give the part, ignoring rotation
+			Vec3 velocityChange = phys->forceResponse * phys->totalForce * world.deltaT;
+			Vec3 displacement = (part.getVelocity() + velocityChange * CONTINUOUS_COLISSION_VELOCITY_CHANGE_FACTOR) * world.deltaT;
+			double smallestHalfExtent = std::min(part.hitbox.scale[0], std::min(part.hitbox.scale[1], part.hitbox.scale[2]));
+			if(!isLongerThan(displacement, smallestHalfExtent * CONTINUOUS_COLISSION_MIN_MOTION)) return;
+
+			ContinuousColissionHit hit;
+			bool hasHit = false;
+			for(const WorldLayer* terrain : terrainLayers) {
+				sweepAgainstTerrain(part, displacement, *terrain, hit, hasHit);
+			}
+			if(hasHit) hits.push_back(std::make_pair(phys, hit));
+		});
+	}
+
+	// only the earliest hit of every physical is handled
+	std::sort(hits.begin(), hits.end(), [](const std::pair<MotorizedPhysical*, ContinuousColissionHit>& a, const std::pair<MotorizedPhysical*, ContinuousColissionHit>& b) {
+		if(a.first != b.first) return a.first < b.first;
+		return a.second.timeOfImpact < b.second.timeOfImpact;
+	});
+	for(std::size_t i = 0; i < hits.size(); i++) {
+		if(i != 0 && hits[i].first == hits[i - 1].first) continue;
+		MotorizedPhysical& phys = *hits[i].first;
+		const ContinuousColissionHit& hit = hits[i].second;
+
+		// slow the physical down along the normal, such that this tick ends where it reaches the terrain, the discrete colissions take over from there
+		double normalDisplacement = hit.displacement * hit.normal;
+		if(normalDisplacement <= 0.0) continue;
+		double excessSpeed = normalDisplacement * (1.0 - hit.timeOfImpact) / world.deltaT;
+		phys.applyImpulseAtCenterOfMass(hit.normal * (-excessSpeed * phys.totalMass));
+	}
+}
+
+/*
+	A change in external force that would speed a physical up past the sleep thresholds within restingTicksUntilSleep ticks wakes it up
+	Constant forces like gravity are balanced by the contacts that hold the physical up, and keep it asleep
+*/
+void wakeOnChangedForces(WorldPrototype& world) {
+	if(!world.usesSleeping()) return;
+	double sleepTime = world.sleepSettings.restingTicksUntilSleep * world.deltaT;
+	for(MotorizedPhysical* phys : world.physicals) {
+		if(!phys->isAsleep) {
+			phys->restingForce = phys->totalForce;
+			phys->restingMoment = phys->totalMoment;
+			continue;
+		}
+		Vec3 linearAcceleration = phys->forceResponse * (phys->totalForce - phys->restingForce);
+		Vec3 angularAcceleration = phys->momentResponse * phys->getCFrame().relativeToLocal(phys->totalMoment - phys->restingMoment);
+		if(isLongerThan(linearAcceleration * sleepTime, world.sleepSettings.maxLinearVelocity) || isLongerThan(angularAcceleration * sleepTime, world.sleepSettings.maxAngularVelocity)) {
+			phys->wakeUp();
+		} else {
+			// sleeping physicals are not updated, which would otherwise reset the forces for the next tick
+			phys->totalForce = Vec3();
+			phys->totalMoment = Vec3();
+		}
+	}
+}
+
+void updateSleepStates(WorldPrototype& world) {
+	long long asleepCount = 0;
+	if(world.usesSleeping()) {
+		const SleepSettings& settings = world.sleepSettings;
+		for(MotorizedPhysical* phys : world.physicals) {
+			if(phys->isAsleep) continue;
+			Motion motion = phys->getMotionOfCenterOfMass();
+			bool isResting = !isLongerThan(motion.getVelocity(), settings.maxLinearVelocity) && !isLongerThan(motion.getAngularVelocity(), settings.maxAngularVelocity);
+			phys->restingTicks = isResting ? phys->restingTicks + 1 : 0;
+		}
+
+		std::vector<IslandContact> contacts;
+		contacts.reserve(world.curColissions.freePartColissions.size() + world.curColissions.freeTerrainColissions.size());
+		for(const Colission& c : world.curColissions.freePartColissions) {
+			contacts.push_back(IslandContact{c.p1->getMainPhysical(), c.p2->getMainPhysical()});
+		}
+		for(const Colission& c : world.curColissions.freeTerrainColissions) {
+			contacts.push_back(IslandContact{c.p1->getMainPhysical(), nullptr});
+		}
+
+		// sleeping physicals only show up in the colissions with awake ones, so an island that keeps moving wakes its sleeping neighbours
+		for(const std::vector<MotorizedPhysical*>& island : findPhysicalIslands(world.physicals, contacts, world.constraints)) {
+			bool islandIsResting = std::all_of(island.begin(), island.end(), [&settings](const MotorizedPhysical* phys) {
+				return phys->restingTicks >= settings.restingTicksUntilSleep;
+			});
+			for(MotorizedPhysical* phys : island) {
+				if(islandIsResting) {
+					phys->fallAsleep();
+				} else {
+					phys->wakeUp();
+				}
+			}
+			if(islandIsResting) asleepCount += island.size();
+		}
+	}
+	sleepStatistics.addToTally(SleepState::AWAKE, static_cast<long long>(world.physicals.size()) - asleepCount);
+	sleepStatistics.addToTally(SleepState::ASLEEP, asleepCount);
+	sleepStatistics.nextTally();
+}
+
+// constrained physicals share an island, so they are asleep together
+static bool isAsleep(const ConstraintGroup& group) {
+	return std::all_of(group.constraints.begin(), group.constraints.end(), [](const PhysicalConstraint& constraint) {
+		return constraint.physA->mainPhysical->isAsleep && constraint.physB->mainPhysical->isAsleep;
+	});
+}
+
 void handleConstraints(WorldPrototype& world) {
 	for(const ConstraintGroup& group : world.constraints) {
+		if(isAsleep(group)) continue;
 		group.apply();
 	}
 }
-void update(WorldPrototype& world) {
+// the layers are independent, with a threadPool each is refreshed on a single thread, without one they are all refreshed on the calling thread
+static void updateWorld(WorldPrototype& world, ThreadPool* threadPool) {
 	for(MotorizedPhysical* physical : world.physicals) {
+		// not marked dirty either, so the bounds of sleeping parts are not refit
+		if(physical->isAsleep) continue;
 		physical->update(world.deltaT);
 	}
 
-	for(ColissionLayer& layer : world.layers) {
-		layer.refresh();
-	}
+	bool refreshInParallel = threadPool != nullptr && threadPool->getNumberOfThreads() > 1 && world.layers.size() > 1;
+	auto forEachLayer = [&world, threadPool, refreshInParallel](const auto& refreshStep) {
+		if(refreshInParallel) {
+			parallelForEachIndex(*threadPool, world.layers.size(), [&world, &refreshStep](std::size_t layerIndex) {
+				refreshStep(world.layers[layerIndex]);
+			});
+		} else {
+			for(ColissionLayer& layer : world.layers) {
+				refreshStep(layer);
+			}
+		}
+	};
+	physicsMeasure.mark(PhysicsProcess::UPDATE_TREE_BOUNDS);
+	forEachLayer([](ColissionLayer& layer) {layer.refreshBounds(); });
+	physicsMeasure.mark(PhysicsProcess::UPDATE_TREE_STRUCTURE);
+	forEachLayer([](ColissionLayer& layer) {layer.refreshStructure(); });
 	world.age++;
 
 	for(SoftLink* springLink : world.softLinks) {
@@ -407,6 +977,13 @@ void update(WorldPrototype& world) {
 	}
 }
 
+void update(WorldPrototype& world) {
+	updateWorld(world, nullptr);
+}
+void update(WorldPrototype& world, ThreadPool& threadPool) {
+	updateWorld(world, &threadPool);
+}
+
 double WorldPrototype::getTotalKineticEnergy() const {
 	double total = 0.0;
 	for(const MotorizedPhysical* p : this->physicals) {
@@ -12,14 +12,50 @@ namespace P3D {
 void handleCollision(Part& part1, Part& part2, Position collisionPoint, Vec3 exitVector);
 void handleTerrainCollision(Part& part1, Part& part2, Position collisionPoint, Vec3 exitVector);
 PartIntersection safeIntersects(const Part& p1, const Part& p2);
+PartIntersection safeIntersects(const Part& p1, const Part& p2, GJKWarmStartCache* warmStartCache);
 void refineColissions(std::vector<Colission>& colissions);
 void parallelRefineColissions(ThreadPool& threadPool, std::vector<Colission>& colissions);
+// the GJK searches of every pair are seeded from and stored into warmStartCache, which may be nullptr
+void refineColissions(std::vector<Colission>& colissions, GJKWarmStartCache* warmStartCache);
+void parallelRefineColissions(ThreadPool& threadPool, std::vector<Colission>& colissions, GJKWarmStartCache* warmStartCache);
+// every thread of the pool runs EPA in its own slot of arenas, which may be nullptr, arenas must have a slot for every thread
+void parallelRefineColissions(ThreadPool& threadPool, std::vector<Colission>& colissions, GJKWarmStartCache* warmStartCache, EPAArenas* arenas);
+// removes the pairs in which no physical is awake, these need no narrowphase
+void removeSleepingColissions(ColissionBuffer& curColissions);
 void findColissions(WorldPrototype& world, ColissionBuffer& curColissions);
 void findColissionsParallel(WorldPrototype& world, ColissionBuffer& curColissions, ThreadPool& threadPool);
 void applyExternalForces(WorldPrototype& world);
 void handleColissions(ColissionBuffer& curColissions);
+// colissions are first added to their manifold, and handled at every point of it, manifolds may be nullptr
+void handleColissions(ColissionBuffer& curColissions, ContactManifoldCache* manifolds);
+/*
+	Same result as handleColissions, contacts are grouped into islands of physicals joined by contacts or constraints, which are resolved on the threads of the pool
+	Islands with many contacts are split into colors of contacts that share no physical
+*/
+void handleColissionsParallel(ColissionBuffer& curColissions, ContactManifoldCache* manifolds, const std::vector<ConstraintGroup>& constraints, ThreadPool& threadPool);
+/*
+	Resolves the colissions of the world with sequential impulses, used instead of handleColissionsParallel when the world usesSequentialImpulses
+	The external forces are turned into velocity first, such that contacts cancel the gravity of this tick
+	Islands are solved on the threads of the pool, each on a single thread, so the result doesn't depend on the number of threads
+*/
+void solveContactsParallel(WorldPrototype& world, ThreadPool& threadPool);
 void handleConstraints(WorldPrototype& world);
+// wakes the sleeping physicals whose external forces changed since they fell asleep, to be called right after applyExternalForces
+void wakeOnChangedForces(WorldPrototype& world);
+/*
+	Islands of physicals, joined by this tick's colissions and by constraints, fall asleep once all their physicals have been resting for long enough
+	Islands with a physical that is not resting are woken up, such that a moving physical wakes the sleeping physicals it touches
+	Also tallies the awake and asleep physicals in sleepStatistics
+*/
+void updateSleepStates(WorldPrototype& world);
+/*
+	sweeps the fast parts of layers with usesContinuousColission against terrain, parts that would reach it this tick are slowed down to stop at it
+	Free parts are not swept against eachother, layers without usesContinuousColission are skipped
+*/
+void handleContinuousColissions(WorldPrototype& world);
 void update(WorldPrototype& world);
+// refreshes the layers on the threads of the pool
+void update(WorldPrototype& world, ThreadPool& threadPool);
 
 void tickWorldUnsynchronized(WorldPrototype& world, ThreadPool& threadPool);
 void tickWorldSynchronized(WorldPrototype& world, ThreadPool& threadPool, UpgradeableMutex& worldMutex);
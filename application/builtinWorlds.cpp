@@ -382,9 +382,7 @@ void buildShowcaseWorld(Screen& screen, PlayerWorld& world) {
 		world.constraints.push_back(std::move(group));
 	}
 
-	Shape torusShape = polyhedronShape(ShapeLibrary::createTorus(1.0f, 0.6f, 80, 80));
-	Graphics::MeshRegistry::registerShapeClass(torusShape.baseShape.get(), Graphics::ExtendedTriangleMesh::generateSmoothNormalsShape(torusShape.baseShape->asPolyhedron()));
-	world.addPart(new ExtendedPart(torusShape, Position(-10.0, 3.0, 0.0), basicProperties, "Torus"));
+	WorldBuilder::buildConvexDecomposition(ShapeLibrary::createTorus(1.0f, 0.6f, 80, 80), GlobalCFrame(-10.0, 3.0, 0.0), basicProperties, "Torus");
 
 
 	Vec2f toyPoints[]{{0.2f, 0.2f},{0.3f, 0.4f},{0.2f, 0.6f},{0.3f, 0.8f},{0.4f,0.7f},{0.5f,0.4f},{0.6f,0.2f},{0.75f,0.1f},{0.9f,0.015f}};
@@ -15,6 +15,7 @@
 #include <Physics3D/externalforces/directionalGravity.h>
 #include <Physics3D/misc/toString.h>
 #include <Physics3D/misc/serialization/serialization.h>
+#include <Physics3D/threading/threadPool.h>
 
 #include <fstream>
 #include <sstream>
@@ -164,7 +165,8 @@ void WorldImportExport::loadWorld(const char* fileName, PlayerWorld& world) {
 	}
 
 	Deserializer deserializer;
-	deserializer.deserializeWorld(world, file);
+	ThreadPool threadPool;
+	deserializer.deserializeWorld(world, file, threadPool);
 
 	assert(world.isValid());
 
@@ -73,6 +73,9 @@ void DebugOverlay::onRender(Engine::Registry64& registry) {
 	addDebugField(screen->dimension, GUI::font, "Screen", str(screen->dimension) + ", [" + std::to_string(screen->camera.aspect) + ":1]", "");
 	addDebugField(screen->dimension, GUI::font, "Position", str(screen->camera.cframe.position), "");
 	addDebugField(screen->dimension, GUI::font, "Objects", objectCount, "");
+	ParallelArray<long long, 2> sleepCounts = sleepStatistics.history.avg();
+	addDebugField(screen->dimension, GUI::font, "Awake Physicals", sleepCounts[static_cast<std::size_t>(SleepState::AWAKE)], "");
+	addDebugField(screen->dimension, GUI::font, "Asleep Physicals", sleepCounts[static_cast<std::size_t>(SleepState::ASLEEP)], "");
 	//addDebugField(screen->dimension, GUI::font, "Intersections", getTheoreticalNumberOfIntersections(objectCount), "");
 	addDebugField(screen->dimension, GUI::font, "AVG Collide GJK Iterations", gjkCollideIterStats.avg(), "");
 	addDebugField(screen->dimension, GUI::font, "AVG No Collide GJK Iterations", gjkNoCollideIterStats.avg(), "");
@@ -13,6 +13,7 @@
 #include "../util/resource/resourceManager.h"
 #include "../graphics/resource/textureResource.h"
 #include <Physics3D/math/constants.h>
+#include <Physics3D/threading/threadPool.h>
 #include "view/screen.h"
 #include "ecs/components.h"
 
@@ -117,6 +118,26 @@ void SpiderFactory::buildSpider(const GlobalCFrame& spiderPosition, int folder)
 }
 
 
+ExtendedPart* buildConvexDecomposition(const TriangleMesh& mesh, const GlobalCFrame& cframe, const PartProperties& properties, const std::string& name, int folder) {
+	static ConvexDecompositionCache cache("../res/cache/decompositions");
+	std::vector<ConvexPiece> pieces = createConvexPieces(cache.getDecomposition(mesh));
+
+	auto compoundID = screen.registry.create();
+	screen.registry.add<Comp::Name>(compoundID, name);
+
+	if(folder != 0)
+		screen.registry.setParent(compoundID, folder);
+
+	ExtendedPart* mainPart = new ExtendedPart(pieces[0].shape, cframe.localToGlobal(pieces[0].offset), properties, name + " 0", compoundID);
+	world.addPart(mainPart);
+
+	for(std::size_t i = 1; i < pieces.size(); i++) {
+		ExtendedPart* piece = new ExtendedPart(pieces[i].shape, GlobalCFrame(), properties, name + " " + std::to_string(i), compoundID);
+		mainPart->attach(piece, pieces[0].offset.globalToLocal(pieces[i].offset));
+	}
+	return mainPart;
+}
+
 HollowBoxParts buildHollowBox(Bounds box, double wallThickness) {
 	double width = static_cast<double>(box.getWidth());
 	double height = static_cast<double>(box.getHeight());
@@ -285,7 +306,8 @@ void buildTerrain(double width, double depth, int folder) {
 	}
 	
 	Log::info("Optimizing terrain! (This will take around 1.5x the time it took to build the world)");
-	world.optimizeLayers();
+	ThreadPool threadPool;
+	world.optimizeLayers(threadPool);
 }
 
 void buildCar(const GlobalCFrame& location, int folder) {
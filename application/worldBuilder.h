@@ -7,6 +7,7 @@
 #include <Physics3D/geometry/shape.h>
 #include <Physics3D/geometry/shapeLibrary.h>
 #include <Physics3D/geometry/convexShapeBuilder.h>
+#include <Physics3D/geometry/convexDecomposition.h>
 
 #include <array>
 
@@ -46,6 +47,9 @@ struct HollowBoxParts {
 
 HollowBoxParts buildHollowBox(Bounds box, double wallThickness);
 
+// a concave mesh as one rigid body of convex pieces, the decomposition is cached in ../res/cache/decompositions
+ExtendedPart* buildConvexDecomposition(const TriangleMesh& mesh, const GlobalCFrame& cframe, const PartProperties& properties, const std::string& name, int folder = 0);
+
 struct SpiderFactory {
 	Shape bodyShape;
 	double spiderSize;
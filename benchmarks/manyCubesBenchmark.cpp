@@ -5,13 +5,18 @@
 #include "worldBenchmark.h"
 #include <Physics3D/math/linalg/commonMatrices.h>
 #include <Physics3D/math/linalg/trigonometry.h>
+#include <Physics3D/layer.h>
 
 namespace P3D {
 class ManyCubesBenchmark : public WorldBenchmark {
+	BroadphaseBackend backend;
+	// builtin boxes instead of box shaped polyhedra, these are narrowphased in batches
+	bool usesBoxShapes;
 public:
-	ManyCubesBenchmark() : WorldBenchmark("manyCubes", 10000) {}
+	ManyCubesBenchmark(const char* name, BroadphaseBackend backend, bool usesBoxShapes = false) : WorldBenchmark(name, 10000), backend(backend), usesBoxShapes(usesBoxShapes) {}
 
 	void init() {
+		world.layers[0].setBroadphaseBackend(backend);
 		createFloor(50, 50, 10);
 
 		int minX = -5;
@@ -29,11 +34,16 @@ public:
 		for(double x = minX; x < maxX; x += 1.01) {
 			for(double y = minY; y < maxY; y += 1.01) {
 				for(double z = minZ; z < maxZ; z += 1.01) {
-					Part* newCube = new Part(polyhedronShape(ShapeLibrary::createBox(1.0, 1.0, 1.0)), ref.localToGlobal(CFrame(x, y, z)), {1.0, 0.2, 0.5});
+					Shape cubeShape = usesBoxShapes ? boxShape(1.0, 1.0, 1.0) : polyhedronShape(ShapeLibrary::createBox(1.0, 1.0, 1.0));
+					Part* newCube = new Part(cubeShape, ref.localToGlobal(CFrame(x, y, z)), {1.0, 0.2, 0.5});
 					world.addPart(newCube);
 				}
 			}
 		}
 	}
-} manyCubesBench;
+};
+ManyCubesBenchmark manyCubesBench("manyCubes", BroadphaseBackend::BOUNDS_TREE);
+// same scene with the sweep and prune broadphase, to compare against the tree
+ManyCubesBenchmark manyCubesSAPBench("manyCubesSAP", BroadphaseBackend::SWEEP_AND_PRUNE);
+ManyCubesBenchmark manyBoxShapesBench("manyBoxShapes", BroadphaseBackend::BOUNDS_TREE, true);
 };
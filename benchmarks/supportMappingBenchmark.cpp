@@ -0,0 +1,76 @@
+#include "benchmark.h"
+
+#include <Physics3D/geometry/polyhedron.h>
+#include <Physics3D/geometry/shapeLibrary.h>
+#include <Physics3D/geometry/builtinShapeClasses.h>
+#include <Physics3D/math/linalg/trigonometry.h>
+
+#include <memory>
+
+namespace P3D {
+enum class SupportMapping {
+	SCAN,
+	HILL_CLIMB,
+	// passes the previous result as the start of the next walk
+	HILL_CLIMB_HINTED
+};
+
+/*
+	Compares scanning every vertex with hill climbing for support queries on spheres of increasing vertex counts
+	The directions rotate slowly, like those of consecutive GJK iterations
+	The crossover between SCAN and HILL_CLIMB, the one polyhedronShape gets, sets HILL_CLIMBING_MIN_VERTEX_COUNT
+*/
+class SupportMappingBenchmark : public Benchmark {
+	int sphereSteps;
+	SupportMapping mapping;
+	Polyhedron sphere;
+	std::unique_ptr<PolyhedronShapeClass> shapeClass;
+	float result = 0;
+public:
+	SupportMappingBenchmark(const char* name, int sphereSteps, SupportMapping mapping) : Benchmark(name), sphereSteps(sphereSteps), mapping(mapping) {}
+
+	void init() override {
+		sphere = ShapeLibrary::createSphere(1.0f, sphereSteps);
+		if(mapping == SupportMapping::SCAN) {
+			shapeClass = std::make_unique<PolyhedronShapeClassAVX>(Polyhedron(sphere));
+		} else {
+			shapeClass = std::make_unique<PolyhedronShapeClassHillClimbing>(Polyhedron(sphere));
+		}
+	}
+	void run() override {
+		Mat3f step = rotationMatrixfromEulerAngles(0.03f, 0.05f, 0.02f);
+		Vec3f direction(0.3f, 0.8f, -0.5f);
+		if(mapping == SupportMapping::HILL_CLIMB_HINTED) {
+			const PolyhedronShapeClassHillClimbing& hillClimbing = static_cast<const PolyhedronShapeClassHillClimbing&>(*shapeClass);
+			int previous = hillClimbing.furthestIndexInDirection(direction);
+			for(size_t i = 0; i < 1000000; i++) {
+				direction = step * direction;
+				previous = hillClimbing.furthestIndexInDirection(direction, previous);
+				result += sphere.getVertex(previous).x;
+			}
+		} else {
+			for(size_t i = 0; i < 1000000; i++) {
+				direction = step * direction;
+				result += shapeClass->furthestInDirection(direction).x;
+			}
+		}
+	}
+};
+
+// 12, 42, 162, 642 and 2562 vertices
+SupportMappingBenchmark supportScan12("supportScan12", 0, SupportMapping::SCAN);
+SupportMappingBenchmark supportHillClimb12("supportHillClimb12", 0, SupportMapping::HILL_CLIMB);
+SupportMappingBenchmark supportHillClimbHinted12("supportHillClimbHinted12", 0, SupportMapping::HILL_CLIMB_HINTED);
+SupportMappingBenchmark supportScan42("supportScan42", 1, SupportMapping::SCAN);
+SupportMappingBenchmark supportHillClimb42("supportHillClimb42", 1, SupportMapping::HILL_CLIMB);
+SupportMappingBenchmark supportHillClimbHinted42("supportHillClimbHinted42", 1, SupportMapping::HILL_CLIMB_HINTED);
+SupportMappingBenchmark supportScan162("supportScan162", 2, SupportMapping::SCAN);
+SupportMappingBenchmark supportHillClimb162("supportHillClimb162", 2, SupportMapping::HILL_CLIMB);
+SupportMappingBenchmark supportHillClimbHinted162("supportHillClimbHinted162", 2, SupportMapping::HILL_CLIMB_HINTED);
+SupportMappingBenchmark supportScan642("supportScan642", 3, SupportMapping::SCAN);
+SupportMappingBenchmark supportHillClimb642("supportHillClimb642", 3, SupportMapping::HILL_CLIMB);
+SupportMappingBenchmark supportHillClimbHinted642("supportHillClimbHinted642", 3, SupportMapping::HILL_CLIMB_HINTED);
+SupportMappingBenchmark supportScan2562("supportScan2562", 4, SupportMapping::SCAN);
+SupportMappingBenchmark supportHillClimb2562("supportHillClimb2562", 4, SupportMapping::HILL_CLIMB);
+SupportMappingBenchmark supportHillClimbHinted2562("supportHillClimbHinted2562", 4, SupportMapping::HILL_CLIMB_HINTED);
+};
@@ -1,6 +1,8 @@
 #include "testsMain.h"
 
 #include <Physics3D/boundstree/boundsTree.h>
+#include <Physics3D/boundstree/frozenBoundsTree.h>
+#include <Physics3D/threading/threadPool.h>
 
 #include "testsMain.h"
 
@@ -8,9 +10,11 @@
 #include "generators.h"
 #include <Physics3D/misc/toString.h>
 #include <Physics3D/misc/validityHelper.h>
+#include <Physics3D/misc/cpuid.h>
 
 #include <vector>
 #include <set>
+#include <algorithm>
 
 using namespace P3D;
 
@@ -105,6 +109,37 @@ TEST_CASE(testAddRemoveToBoundsTree) {
 	ASSERT_TRUE(isBoundsTreeValid(tree));
 }
 
+TEST_CASE(testTrunkAllocatorReuse) {
+	BoundsTree<BasicBounded> tree;
+	const TrunkAllocator& alloc = tree.getPrototype().getAllocator();
+
+	constexpr int itemCount = 1000;
+
+	std::vector<BasicBounded> itemsInTree = generateBoundsTreeItems(itemCount);
+
+	for(int round = 0; round < 3; round++) {
+		for(BasicBounded& item : itemsInTree) {
+			tree.add(&item);
+		}
+		ASSERT_TRUE(alloc.getLiveTrunkCount() > 0);
+		ASSERT_TRUE(alloc.getLiveTrunkCount() <= alloc.getTrunkCapacity());
+		for(BasicBounded& item : itemsInTree) {
+			tree.remove(&item);
+		}
+		ASSERT_STRICT(alloc.getLiveTrunkCount() == 0);
+	}
+	// removed trunks are reused, so the capacity does not need to grow beyond the peak usage
+	ASSERT_TRUE(alloc.getTrunkCapacity() < alloc.getPeakTrunkCount() + TrunkAllocator::TRUNKS_PER_SLAB);
+
+	for(BasicBounded& item : itemsInTree) {
+		tree.add(&item);
+	}
+	tree.clear();
+	ASSERT_STRICT(alloc.getLiveTrunkCount() == 0);
+	ASSERT_STRICT(alloc.getSlabCount() == 0);
+	ASSERT_TRUE(isBoundsTreeValid(tree));
+}
+
 // check all groups are distinct, but internally the same
 static bool groupsMatchTree(const std::vector<std::vector<BasicBounded*>>& groups, const BoundsTree<BasicBounded>& tree) {
 	for(const std::vector<BasicBounded*>& groupA : groups) {
@@ -422,6 +457,108 @@ TEST_CASE(testForEachColissionBetween) {
 	}
 }
 
+TEST_CASE(testSplitColissionTasks) {
+	BoundsTree<BasicBounded> tree1;
+	BoundsTree<BasicBounded> tree2;
+
+	constexpr int itemCount = 300;
+
+	std::vector<BasicBounded> allItems1 = generateBoundsTreeItems(itemCount);
+	std::vector<BasicBounded> allItems2 = generateBoundsTreeItems(itemCount);
+
+	createGroups(tree1, allItems1);
+	createGroups(tree2, allItems2);
+
+	std::vector<std::pair<BasicBounded*, BasicBounded*>> serialColissions;
+	tree1.forEachColission([&](BasicBounded* a, BasicBounded* b) {
+		serialColissions.emplace_back(a, b);
+	});
+	tree1.forEachColissionWith(tree2, [&](BasicBounded* a, BasicBounded* b) {
+		serialColissions.emplace_back(a, b);
+	});
+
+	std::vector<std::pair<BasicBounded*, BasicBounded*>> splitColissions;
+	auto addColission = [&](BasicBounded* a, BasicBounded* b) {
+		splitColissions.emplace_back(a, b);
+	};
+	std::vector<ColissionTask> tasks;
+	tree1.splitColissionTasks(tasks, 32, 3, addColission);
+	tree1.splitColissionTasksWith(tree2, tasks, 32, 3, addColission);
+	for(const ColissionTask& task : tasks) {
+		BoundsTree<BasicBounded>::runColissionTask(task, addColission);
+	}
+
+	ASSERT_STRICT(splitColissions.size() == serialColissions.size());
+	std::sort(serialColissions.begin(), serialColissions.end());
+	std::sort(splitColissions.begin(), splitColissions.end());
+	ASSERT_TRUE(splitColissions == serialColissions);
+}
+
+static void fillTrunkBounds(TreeTrunk& trunk) {
+	for(int i = 0; i < BRANCH_FACTOR; i++) {
+		trunk.setBoundsOfSubNode(i, generateBoundsTreeBounds());
+	}
+}
+
+static bool overlapMatricesEqual(const OverlapMatrix& a, const OverlapMatrix& b) {
+	for(int i = 0; i < BRANCH_FACTOR * BRANCH_FACTOR; i++) {
+		if(a.overlapData[i] != b.overlapData[i]) return false;
+	}
+	return true;
+}
+
+template<typename T>
+static bool firstElementsEqual(const std::array<T, BRANCH_FACTOR>& a, const std::array<T, BRANCH_FACTOR>& b, int count) {
+	for(int i = 0; i < count; i++) {
+		if(a[i] != b[i]) return false;
+	}
+	return true;
+}
+
+TEST_CASE(testTrunkSIMDVariantsMatchFallback) {
+	using Helper = TrunkSIMDHelperFallback;
+	bool hasAVX2 = CPUIDCheck::hasTechnology(CPUIDCheck::AVX | CPUIDCheck::AVX2);
+	bool hasAVX512 = CPUIDCheck::hasTechnology(CPUIDCheck::AVX512_F);
+
+	TreeTrunk trunkA;
+	TreeTrunk trunkB;
+	for(int iter = 0; iter < 1000; iter++) {
+		fillTrunkBounds(trunkA);
+		fillTrunkBounds(trunkB);
+		int sizeA = generateInt(BRANCH_FACTOR - 1) + 2;
+		int sizeB = generateInt(BRANCH_FACTOR - 1) + 2;
+		BoundsTemplate<float> bounds = generateBoundsTreeBounds();
+		// also test bounds that are exactly contained in one of the subnodes
+		BoundsTemplate<float> containedBounds = trunkA.getBoundsOfSubNode(generateInt(BRANCH_FACTOR));
+
+		if(hasAVX2) {
+			ASSERT_TRUE(Helper::getTotalBoundsAVX(trunkA, sizeA) == Helper::getTotalBoundsFallback(trunkA, sizeA));
+			BoundsArray<BRANCH_FACTOR> withoutAVX = Helper::getAllTotalBoundsWithoutAVX(trunkA, sizeA);
+			BoundsArray<BRANCH_FACTOR> withoutFallback = Helper::getAllTotalBoundsWithoutFallback(trunkA, sizeA);
+			for(int i = 0; i < sizeA; i++) {
+				ASSERT_TRUE(withoutAVX.getBounds(i) == withoutFallback.getBounds(i));
+				ASSERT_TRUE(withoutFallback.getBounds(i) == Helper::getTotalBoundsWithout(trunkA, sizeA, i));
+			}
+			ASSERT_TRUE(Helper::getAllContainsBoundsAVX(trunkA, bounds) == Helper::getAllContainsBoundsFallback(trunkA, bounds));
+			ASSERT_TRUE(Helper::getAllContainsBoundsAVX(trunkA, containedBounds) == Helper::getAllContainsBoundsFallback(trunkA, containedBounds));
+			ASSERT_TRUE(Helper::computeAllCostsAVX(trunkA) == Helper::computeAllCostsFallback(trunkA));
+			ASSERT_TRUE(Helper::computeAllCombinationCostsAVX(trunkA.subNodeBounds, bounds) == Helper::computeAllCombinationCostsFallback(trunkA.subNodeBounds, bounds));
+			ASSERT_STRICT(Helper::getLowestCombinationCostAVX(trunkA, bounds, sizeA) == Helper::getLowestCombinationCostFallback(trunkA, bounds, sizeA));
+			ASSERT_TRUE(firstElementsEqual(Helper::computeOverlapsWithAVX(trunkA, sizeA, bounds), Helper::computeOverlapsWithFallback(trunkA, sizeA, bounds), sizeA));
+			ASSERT_TRUE(overlapMatricesEqual(Helper::computeBoundsOverlapMatrixAVX(trunkA, sizeA, trunkB, sizeB), Helper::computeBoundsOverlapMatrixFallback(trunkA, sizeA, trunkB, sizeB)));
+			ASSERT_TRUE(overlapMatricesEqual(Helper::computeInternalBoundsOverlapMatrixAVX(trunkA, sizeA), Helper::computeInternalBoundsOverlapMatrixFallback(trunkA, sizeA)));
+			ASSERT_TRUE(firstElementsEqual(Helper::computeAllExtentionCostsAVX(trunkA, bounds), Helper::computeAllExtentionCostsFallback(trunkA, sizeA, bounds), sizeA));
+		}
+		if(hasAVX512) {
+			ASSERT_TRUE(Helper::getAllContainsBoundsAVX512(trunkA, bounds) == Helper::getAllContainsBoundsFallback(trunkA, bounds));
+			ASSERT_TRUE(Helper::getAllContainsBoundsAVX512(trunkA, containedBounds) == Helper::getAllContainsBoundsFallback(trunkA, containedBounds));
+			ASSERT_TRUE(firstElementsEqual(Helper::computeOverlapsWithAVX512(trunkA, sizeA, bounds), Helper::computeOverlapsWithFallback(trunkA, sizeA, bounds), sizeA));
+			ASSERT_TRUE(overlapMatricesEqual(Helper::computeBoundsOverlapMatrixAVX512(trunkA, sizeA, trunkB, sizeB), Helper::computeBoundsOverlapMatrixFallback(trunkA, sizeA, trunkB, sizeB)));
+			ASSERT_TRUE(overlapMatricesEqual(Helper::computeInternalBoundsOverlapMatrixAVX512(trunkA, sizeA), Helper::computeInternalBoundsOverlapMatrixFallback(trunkA, sizeA)));
+		}
+	}
+}
+
 TEST_CASE(testUpdatePartBounds) {
 	BoundsTree<BasicBounded> tree;
 
@@ -498,3 +635,157 @@ TEST_CASE(testImproveStructureValidity) {
 		}
 	}
 }
+
+TEST_CASE(testRefitDirtyGroups) {
+	BoundsTree<BasicBounded> tree;
+
+	constexpr int itemCount = 100;
+
+	std::vector<BasicBounded> allItems = generateBoundsTreeItems(itemCount);
+
+	std::vector<std::vector<BasicBounded*>> groups = createGroups(tree, allItems);
+
+	for(int iter = 0; iter < 10; iter++) {
+		// groups must all be marked before any of them moves
+		std::vector<std::vector<BasicBounded*>*> movingGroups;
+		for(int moveI = 0; moveI < 5; moveI++) {
+			std::vector<BasicBounded*>& selectedGroup = groups[generateSize_t(groups.size())];
+			tree.markGroupDirty(selectedGroup[0]);
+			movingGroups.push_back(&selectedGroup);
+		}
+		for(std::vector<BasicBounded*>* group : movingGroups) {
+			for(BasicBounded* item : *group) {
+				item->bounds = generateBoundsTreeBounds();
+			}
+		}
+		tree.refitDirty();
+
+		ASSERT_TRUE(groupsMatchTree(groups, tree));
+		ASSERT_TRUE(isBoundsTreeValid(tree));
+
+		for(int i = 0; i < 5; i++) {
+			tree.improveStructureBudgeted(10);
+			ASSERT_TRUE(groupsMatchTree(groups, tree));
+			ASSERT_TRUE(isBoundsTreeValid(tree));
+		}
+	}
+	ASSERT_STRICT(tree.size() == itemCount);
+}
+
+TEST_CASE(testRebuildKeepsGroups) {
+	BoundsTree<BasicBounded> tree;
+
+	constexpr int itemCount = 300;
+
+	std::vector<BasicBounded> allItems = generateBoundsTreeItems(itemCount);
+
+	std::vector<std::vector<BasicBounded*>> groups = createGroups(tree, allItems);
+
+	size_t colissionCountBefore = 0;
+	tree.forEachColission([&](BasicBounded* a, BasicBounded* b) {colissionCountBefore++; });
+
+	tree.rebuild();
+
+	ASSERT_STRICT(tree.size() == itemCount);
+	ASSERT_TRUE(groupsMatchTree(groups, tree));
+	ASSERT_TRUE(isBoundsTreeValid(tree));
+
+	size_t colissionCountAfter = 0;
+	tree.forEachColission([&](BasicBounded* a, BasicBounded* b) {colissionCountAfter++; });
+	ASSERT_STRICT(colissionCountBefore == colissionCountAfter);
+}
+
+TEST_CASE(testAddAllToBoundsTree) {
+	BoundsTree<BasicBounded> tree;
+
+	// large enough to be built in parallel
+	constexpr int itemCount = 10000;
+
+	std::vector<BasicBounded> allItems = generateBoundsTreeItems(itemCount);
+	tree.add(&allItems[0]);
+
+	std::vector<BasicBounded*> itemsToAdd;
+	for(int i = 1; i < itemCount; i++) {
+		itemsToAdd.push_back(&allItems[i]);
+	}
+	ThreadPool threadPool(4);
+	tree.addAll(itemsToAdd.begin(), itemsToAdd.end(), threadPool);
+
+	ASSERT_STRICT(tree.size() == itemCount);
+	ASSERT_TRUE(isBoundsTreeValid(tree));
+	for(BasicBounded& item : allItems) {
+		ASSERT_TRUE(tree.contains(&item));
+	}
+	ASSERT_STRICT(tree.getPrototype().getAllocator().getLiveTrunkCount() <= itemCount);
+}
+
+TEST_CASE(testFrozenBoundsTreeMatchesBoundsTree) {
+	BoundsTree<BasicBounded> staticTree;
+	BoundsTree<BasicBounded> dynamicTree;
+
+	constexpr int itemCount = 500;
+
+	std::vector<BasicBounded> staticItems = generateBoundsTreeItems(itemCount);
+	std::vector<BasicBounded> dynamicItems = generateBoundsTreeItems(itemCount);
+	for(BasicBounded& item : staticItems) staticTree.add(&item);
+	createGroups(dynamicTree, dynamicItems);
+
+	FrozenBoundsTree<BasicBounded> frozenTree;
+	ASSERT_FALSE(frozenTree.isBuilt());
+	frozenTree.build(staticTree);
+	ASSERT_TRUE(frozenTree.isBuilt());
+	ASSERT_STRICT(frozenTree.size() == itemCount);
+	ASSERT_TRUE(frozenTree.getPrototype().getTrunkCount() == staticTree.getPrototype().getAllocator().getLiveTrunkCount() + 1);
+
+	std::set<std::pair<BasicBounded*, BasicBounded*>> expectedColissions;
+	dynamicTree.forEachColissionWith(staticTree, [&](BasicBounded* a, BasicBounded* b) {
+		expectedColissions.emplace(a, b);
+	});
+	std::set<std::pair<BasicBounded*, BasicBounded*>> frozenColissions;
+	frozenTree.forEachColissionWith(dynamicTree, [&](BasicBounded* a, BasicBounded* b) {
+		ASSERT_FALSE(frozenColissions.find(std::make_pair(a, b)) != frozenColissions.end()); // no duplicate colissions
+		frozenColissions.emplace(a, b);
+	});
+	ASSERT_TRUE(frozenColissions == expectedColissions);
+
+	std::set<std::pair<BasicBounded*, BasicBounded*>> taskColissions;
+	std::vector<FrozenColissionTask> tasks;
+	frozenTree.splitColissionTasksWith(dynamicTree, tasks, 16, 3, [&](BasicBounded* a, BasicBounded* b) {taskColissions.emplace(a, b); });
+	for(const FrozenColissionTask& task : tasks) {
+		frozenTree.runColissionTask(task, [&](BasicBounded* a, BasicBounded* b) {taskColissions.emplace(a, b); });
+	}
+	ASSERT_TRUE(taskColissions == expectedColissions);
+
+	for(int i = 0; i < 50; i++) {
+		BoundsTemplate<float> bounds = generateBoundsTreeBounds();
+		std::set<BasicBounded*> expectedOverlaps;
+		staticTree.forEachOverlapping(bounds, [&](BasicBounded* found) {expectedOverlaps.insert(found); });
+		std::set<BasicBounded*> frozenOverlaps;
+		frozenTree.forEachOverlapping(bounds, [&](BasicBounded* found) {frozenOverlaps.insert(found); });
+		ASSERT_TRUE(frozenOverlaps == expectedOverlaps);
+	}
+
+	frozenTree.clear();
+	ASSERT_FALSE(frozenTree.isBuilt());
+	ASSERT_STRICT(frozenTree.size() == 0);
+}
+
+TEST_CASE(testFrozenBoundsTreeRestoresGroups) {
+	BoundsTree<BasicBounded> sourceTree;
+
+	constexpr int itemCount = 300;
+
+	std::vector<BasicBounded> allItems = generateBoundsTreeItems(itemCount);
+	std::vector<std::vector<BasicBounded*>> groups = createGroups(sourceTree, allItems);
+
+	FrozenBoundsTree<BasicBounded> frozenTree;
+	frozenTree.build(sourceTree);
+	ASSERT_STRICT(frozenTree.getPrototype().getGroupCount() == groups.size());
+
+	BoundsTree<BasicBounded> restoredTree;
+	frozenTree.addAllTo(restoredTree);
+
+	ASSERT_STRICT(restoredTree.size() == itemCount);
+	ASSERT_TRUE(isBoundsTreeValid(restoredTree));
+	ASSERT_TRUE(groupsMatchTree(groups, restoredTree));
+}
@@ -19,6 +19,15 @@
 
 #include <Physics3D/misc/cpuid.h>
 #include <Physics3D/geometry/builtinShapeClasses.h>
+#include <Physics3D/geometry/specializedIntersection.h>
+#include <Physics3D/geometry/batchedIntersection.h>
+#include <Physics3D/geometry/computationBuffer.h>
+#include <Physics3D/geometry/convexDecomposition.h>
+#include <Physics3D/geometry/shapeCreation.h>
+#include <Physics3D/geometry/intersection.h>
+
+#include <filesystem>
+#include <algorithm>
 
 using namespace P3D;
 #define ASSERT(condition) ASSERT_TOLERANT(condition, 0.00001)
@@ -293,3 +302,333 @@ TEST_CASE(testTriangleMeshOptimizedFurthestInDirection) {
 	}
 }
 
+
+TEST_CASE(testSpecializedIntersectionsMatchGJK) {
+	Shape shapes[]{boxShape(2.0, 1.0, 3.0), sphereShape(0.7), cylinderShape(0.6, 1.5), boxShape(1.0, 1.0, 1.0), sphereShape(1.2)};
+	std::size_t boxClassID = shapes[0].baseShape->intersectionClassID;
+
+	int comparedColissions = 0;
+	for(int iter = 0; iter < 2000; iter++) {
+		const Shape& first = shapes[generateInt(5)];
+		const Shape& second = shapes[generateInt(5)];
+		IntersectionFunction specialized = getSpecializedIntersection(first.baseShape->intersectionClassID, second.baseShape->intersectionClassID);
+		if(specialized == nullptr) continue;
+
+		CFrame relativeTransform(generateVec3() * 0.8, generateRotation());
+		std::optional<Intersection> fast = specialized(*first.baseShape, *second.baseShape, relativeTransform, first.scale, second.scale);
+		std::optional<Intersection> generic = intersectsTransformed(*first.baseShape, *second.baseShape, relativeTransform, first.scale, second.scale);
+
+		if(!fast) {
+			// GJK may report grazing contacts the exact routines do not
+			ASSERT_TRUE(!generic || length(generic->exitVector) < 0.01);
+			continue;
+		}
+		// EPA gives up on some deep sphere-sphere pairs, the exact routine does not
+		if(!generic) continue;
+
+		// box-box prefers face axes, so its depth may exceed the true minimum slightly
+		// EPA only approximates curved surfaces, so the directions are not compared directly
+		double fastDepth = length(fast->exitVector);
+		double genericDepth = length(generic->exitVector);
+		ASSERT_TRUE(fastDepth >= genericDepth - 0.01);
+		ASSERT_TRUE(fastDepth <= genericDepth * 1.06 + 0.01);
+
+		// moving second along the exitVector must separate the shapes
+		CFrame separated(relativeTransform.position + fast->exitVector * 1.01 + normalize(fast->exitVector) * 0.001, relativeTransform.rotation);
+		ASSERT_FALSE(intersectsTransformed(*first.baseShape, *second.baseShape, separated, first.scale, second.scale).has_value());
+
+		// both contact points must lie halfway into the overlap, box-box contacts can be anywhere on the touching faces so only their depth is compared
+		if(normalize(fast->exitVector) * normalize(generic->exitVector) > 0.99) {
+			ASSERT_TRUE(std::abs((fast->intersection - generic->intersection) * normalize(fast->exitVector)) <= fastDepth * 0.5 + 0.01);
+		}
+		if(first.baseShape->intersectionClassID != boxClassID || second.baseShape->intersectionClassID != boxClassID) {
+			ASSERT_TRUE(length(fast->intersection - generic->intersection) < 0.15);
+		}
+		comparedColissions++;
+	}
+	ASSERT_TRUE(comparedColissions > 100);
+
+	// concentric spheres, the exact routine must not divide by zero
+	Shape sphere = sphereShape(1.0);
+	std::optional<Intersection> concentric = intersectsTransformed(sphere, sphere, CFrame());
+	ASSERT_TRUE(concentric.has_value());
+	ASSERT_TOLERANT(length(concentric->exitVector) == 2.0, 0.00001);
+}
+
+TEST_CASE(testBatchedIntersectionMatchesSingle) {
+	std::vector<Shape> firstShapes;
+	std::vector<Shape> secondShapes;
+	std::vector<CFrame> relativeTransforms;
+	// not a multiple of the lane count, so the last batch is partially filled
+	for(int i = 0; i < 203; i++) {
+		firstShapes.push_back(boxShape(generateDouble(0.2, 2.0), generateDouble(0.2, 2.0), generateDouble(0.2, 2.0)));
+		secondShapes.push_back(boxShape(generateDouble(0.2, 2.0), generateDouble(0.2, 2.0), generateDouble(0.2, 2.0)));
+		relativeTransforms.push_back(CFrame(generateVec3() * 1.2, generateRotation()));
+	}
+	std::vector<const Shape*> first;
+	std::vector<const Shape*> second;
+	for(std::size_t i = 0; i < firstShapes.size(); i++) {
+		first.push_back(&firstShapes[i]);
+		second.push_back(&secondShapes[i]);
+	}
+
+	std::vector<std::optional<Intersection>> batched(first.size());
+	intersectsTransformedBatch(first.data(), second.data(), relativeTransforms.data(), first.size(), batched.data());
+
+	int separatedCount = 0;
+	for(std::size_t i = 0; i < first.size(); i++) {
+		std::optional<Intersection> single = intersectsTransformed(*first[i], *second[i], relativeTransforms[i]);
+		ASSERT_STRICT(batched[i].has_value() == single.has_value());
+		if(single) {
+			ASSERT_STRICT(batched[i]->exitVector == single->exitVector);
+			ASSERT_STRICT(batched[i]->intersection == single->intersection);
+		} else {
+			separatedCount++;
+		}
+	}
+	ASSERT_TRUE(separatedCount > 0 && separatedCount < int(first.size()));
+
+	if(CPUIDCheck::hasTechnology(CPUIDCheck::AVX | CPUIDCheck::AVX2)) {
+		for(std::size_t batchStart = 0; batchStart + INTERSECTION_BATCH_LANES <= first.size(); batchStart += INTERSECTION_BATCH_LANES) {
+			BoxPairBatch batch;
+			for(std::size_t lane = 0; lane < INTERSECTION_BATCH_LANES; lane++) {
+				std::size_t i = batchStart + lane;
+				batch.setLane(lane, relativeTransforms[i], first[i]->scale, second[i]->scale);
+			}
+			ASSERT_STRICT(findSeparatedBoxPairsAVX(batch) == findSeparatedBoxPairsFallback(batch));
+		}
+	}
+}
+
+TEST_CASE(testHillClimbingMatchesScan) {
+	Polyhedron polys[]{ShapeLibrary::createSphere(1.0f, 3), generateConvexPolyhedron(), ShapeLibrary::createBox(1.0f, 2.0f, 3.0f)};
+	for(const Polyhedron& poly : polys) {
+		PolyhedronShapeClassHillClimbing hillClimbing{Polyhedron(poly)};
+		for(int i = 0; i < 500; i++) {
+			// alternate between similar and unrelated directions, to test both short and long walks
+			Vec3f direction = (i % 2 == 0) ? generateVec3f() : generateVec3f() * 0.01f + Vec3f(1.0f, 0.3f, 0.2f);
+			float best = poly.furthestInDirection(direction) * direction;
+			ASSERT_TOLERANT(hillClimbing.furthestInDirection(direction) * direction == best, 0.00001f);
+		}
+	}
+}
+
+TEST_CASE(testHillClimbingOnUnweldedMesh) {
+	Polyhedron welded = ShapeLibrary::createSphere(1.0f, 2);
+	// every triangle gets its own copy of its vertices, like meshes exported with per face normals
+	std::vector<Vec3f> vertices;
+	std::vector<Triangle> triangles;
+	for(int i = 0; i < welded.triangleCount; i++) {
+		Triangle t = welded.getTriangle(i);
+		int first = static_cast<int>(vertices.size());
+		for(int side = 0; side < 3; side++) {
+			vertices.push_back(welded.getVertex(t[side]));
+		}
+		triangles.push_back(Triangle{first, first + 1, first + 2});
+	}
+	Polyhedron unwelded(vertices.data(), triangles.data(), static_cast<int>(vertices.size()), static_cast<int>(triangles.size()));
+	// with one triangle missing the mesh is no longer closed, even after welding
+	Polyhedron open(vertices.data(), triangles.data() + 1, static_cast<int>(vertices.size()), static_cast<int>(triangles.size()) - 1);
+
+	for(const Polyhedron* poly : {&unwelded, &open}) {
+		PolyhedronShapeClassHillClimbing hillClimbing{Polyhedron(*poly)};
+		for(int i = 0; i < 500; i++) {
+			Vec3f direction = (i % 2 == 0) ? generateVec3f() : generateVec3f() * 0.01f + Vec3f(1.0f, 0.3f, 0.2f);
+			float best = welded.furthestInDirection(direction) * direction;
+			ASSERT_TOLERANT(hillClimbing.furthestInDirection(direction) * direction == best, 0.00001f);
+		}
+	}
+}
+
+TEST_CASE(testHillClimbingOnlyOnConvexShapes) {
+	Polyhedron sphere = ShapeLibrary::createSphere(1.0f, 4);
+	// every spike is a local maximum, a walk would stop at the first one it reaches
+	Polyhedron spikeBall = ShapeLibrary::createSpikeBall(0.5f, 1.0f, 4, 1);
+	ASSERT_TRUE(spikeBall.vertexCount >= HILL_CLIMBING_MIN_VERTEX_COUNT);
+	ASSERT_TRUE(sphere.isConvex());
+	ASSERT_FALSE(spikeBall.isConvex());
+
+	Shape sphereShape = polyhedronShape(sphere);
+	Shape spikeShape = polyhedronShape(spikeBall);
+	ASSERT_TRUE(dynamic_cast<const PolyhedronShapeClassHillClimbing*>(sphereShape.baseShape.get()) != nullptr);
+	ASSERT_TRUE(dynamic_cast<const PolyhedronShapeClassHillClimbing*>(spikeShape.baseShape.get()) == nullptr);
+
+	PolyhedronShapeClassHillClimbing hillClimbing{Polyhedron(spikeBall)};
+	for(int i = 0; i < 500; i++) {
+		Vec3f direction = generateVec3f();
+		float best = spikeBall.furthestInDirection(direction) * direction;
+		ASSERT_TOLERANT(hillClimbing.furthestInDirection(direction) * direction == best, 0.00001f);
+	}
+}
+
+TEST_CASE(testHillClimbingIsDeterministic) {
+	Polyhedron sphere = ShapeLibrary::createSphere(1.0f, 3);
+	PolyhedronShapeClassHillClimbing hillClimbing{Polyhedron(sphere)};
+	Vec3f direction(0.3f, 0.8f, -0.5f);
+	int first = hillClimbing.furthestIndexInDirection(direction);
+	int previous = first;
+	for(int i = 0; i < 100; i++) {
+		Vec3f otherDirection = generateVec3f();
+		// a caller holding on to its previous result walks from there, without changing the walks of others
+		previous = hillClimbing.furthestIndexInDirection(otherDirection, previous);
+		ASSERT_TOLERANT(sphere.getVertex(previous) * otherDirection == sphere.furthestInDirection(otherDirection) * otherDirection, 0.00001f);
+	}
+	ASSERT_STRICT(hillClimbing.furthestIndexInDirection(direction) == first);
+	// invalid hints start from the default vertex
+	ASSERT_STRICT(hillClimbing.furthestIndexInDirection(direction, -1) == first);
+	ASSERT_STRICT(hillClimbing.furthestIndexInDirection(direction, sphere.vertexCount) == first);
+}
+
+TEST_CASE(testEPAArenasGrowAndRespectLimit) {
+	// no specialized routine exists for cylinder pairs, so these always go through GJK and EPA
+	Shape cylinder = cylinderShape(0.8, 2.0);
+	CFrame relativeTransform(Vec3(0.3, 0.5, 0.9), Rotation::fromEulerAngles(0.3, 0.7, 0.1));
+	std::optional<Intersection> reference = intersectsTransformed(*cylinder.baseShape, *cylinder.baseShape, relativeTransform, cylinder.scale, cylinder.scale);
+	ASSERT_TRUE(reference.has_value());
+
+	// starts out too small, so the arena must grow during the run without changing the result
+	EPAArenas arenas(4, 4);
+	arenas.reserveSlots(2);
+	{
+		UseComputationBuffers arena(arenas.getSlot(1));
+		std::optional<Intersection> grown = intersectsTransformed(*cylinder.baseShape, *cylinder.baseShape, relativeTransform, cylinder.scale, cylinder.scale);
+		ASSERT_TRUE(grown.has_value());
+		ASSERT_STRICT(grown->exitVector == reference->exitVector);
+	}
+	EPAStatistics stats = arenas.getStatistics();
+	ASSERT_TRUE(stats.growthCount > 0);
+	ASSERT_TRUE(stats.highestVertexCount > 4);
+	ASSERT_STRICT(stats.limitReachedCount == 0);
+	long long runs = 0;
+	for(long long count : stats.iterationHistogram) runs += count;
+	ASSERT_STRICT(runs == 1);
+
+	// capped below what the run needs, it must stop early with a usable estimate
+	arenas.resetStatistics();
+	arenas.setCapacityLimit(6, 8);
+	{
+		UseComputationBuffers arena(arenas.getSlot(0));
+		std::optional<Intersection> capped = intersectsTransformed(*cylinder.baseShape, *cylinder.baseShape, relativeTransform, cylinder.scale, cylinder.scale);
+		ASSERT_TRUE(capped.has_value());
+		ASSERT_TRUE(capped->exitVector * reference->exitVector > 0);
+	}
+	stats = arenas.getStatistics();
+	ASSERT_TRUE(stats.limitReachedCount > 0);
+	ASSERT_TRUE(stats.highestVertexCount <= 6);
+}
+
+TEST_CASE(testConvexDecompositionOfTorus) {
+	Polyhedron torus = ShapeLibrary::createTorus(1.0f, 0.3f, 24, 12);
+	std::vector<Vec3f> torusVertices;
+	for(int i = 0; i < torus.vertexCount; i++) torusVertices.push_back(torus.getVertex(i));
+	double hullVolume = convexHull(torusVertices.data(), torus.vertexCount, 1E-5f).getVolume();
+
+	ConvexDecompositionSettings settings;
+	std::vector<Polyhedron> pieces = decomposeConvex(torus, settings);
+	ASSERT_TRUE(pieces.size() > 1);
+	ASSERT_TRUE(static_cast<int>(pieces.size()) <= settings.maxPieces);
+
+	// the pieces cover the torus without overlapping much, so together they are far smaller than its hull
+	double totalVolume = 0.0;
+	for(const Polyhedron& piece : pieces) {
+		totalVolume += piece.getVolume();
+		ASSERT_TRUE(piece.getVolume() > 0.0);
+	}
+	ASSERT_TRUE(totalVolume > torus.getVolume() * 0.99);
+	ASSERT_TRUE(totalVolume < torus.getVolume() + (hullVolume - torus.getVolume()) * 0.5);
+
+	// a convex mesh stays in one piece
+	std::vector<Polyhedron> cube = decomposeConvex(ShapeLibrary::createCube(1.0f), settings);
+	ASSERT_STRICT(cube.size() == 1);
+	ASSERT_TOLERANT(cube[0].getVolume() == 1.0, 0.001);
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "physics3DConvexDecompositionTest";
+	std::filesystem::remove_all(directory);
+	ConvexDecompositionCache cache(directory.string());
+	std::vector<Polyhedron> computed = cache.getDecomposition(torus, settings);
+	ASSERT_TRUE(std::filesystem::exists(cache.getCacheFile(hashConvexDecomposition(torus, settings))));
+	std::vector<Polyhedron> loaded = cache.getDecomposition(torus, settings);
+	ASSERT_STRICT(loaded.size() == computed.size());
+	for(std::size_t i = 0; i < loaded.size(); i++) {
+		ASSERT_STRICT(loaded[i].vertexCount == computed[i].vertexCount);
+		ASSERT_STRICT(loaded[i].getVertex(0) == computed[i].getVertex(0));
+	}
+	std::filesystem::remove_all(directory);
+}
+
+// a V shaped valley along z, y = |x| for x in -4..4
+static TriangleMesh createValley(int cells) {
+	std::vector<Vec3f> vertices;
+	std::vector<Triangle> triangles;
+	for(int i = 0; i <= cells; i++) {
+		for(int j = 0; j <= cells; j++) {
+			float x = -4.0f + 8.0f * i / cells;
+			vertices.push_back(Vec3f(x, std::abs(x), -4.0f + 8.0f * j / cells));
+		}
+	}
+	for(int i = 0; i < cells; i++) {
+		for(int j = 0; j < cells; j++) {
+			int a = i * (cells + 1) + j;
+			int b = a + cells + 1;
+			// both triangles face up
+			triangles.push_back(Triangle{{{a, a + 1, b}}});
+			triangles.push_back(Triangle{{{b, a + 1, b + 1}}});
+		}
+	}
+	return TriangleMesh(static_cast<int>(vertices.size()), static_cast<int>(triangles.size()), vertices.data(), triangles.data());
+}
+
+TEST_CASE(testTriangleMeshTerrain) {
+	TriangleMesh valley = createValley(16);
+	for(int i = 0; i < valley.triangleCount; i++) {
+		Triangle t = valley.getTriangle(i);
+		ASSERT_TRUE(((valley.getVertex(t.secondIndex) - valley.getVertex(t.firstIndex)) % (valley.getVertex(t.thirdIndex) - valley.getVertex(t.firstIndex))).y > 0.0f);
+	}
+
+	// the BVH finds exactly the triangles a brute force search finds
+	TriangleBVH bvh(valley);
+	for(int iter = 0; iter < 50; iter++) {
+		Vec3f center(generateFloat(-4.0f, 4.0f), generateFloat(0.0f, 4.0f), generateFloat(-4.0f, 4.0f));
+		BoundingBoxTemplate<float> box(center - Vec3f(0.5f, 0.5f, 0.5f), center + Vec3f(0.5f, 0.5f, 0.5f));
+		std::vector<int> found;
+		bvh.forEachOverlapping(box, [&](int triangle) { found.push_back(triangle); });
+		std::vector<int> expected;
+		for(int i = 0; i < valley.triangleCount; i++) {
+			Triangle t = valley.getTriangle(i);
+			BoundingBoxTemplate<float> bounds = BoundingBoxTemplate<float>(valley.getVertex(t.firstIndex), valley.getVertex(t.firstIndex)).expanded(valley.getVertex(t.secondIndex)).expanded(valley.getVertex(t.thirdIndex));
+			if(bounds.intersects(box)) expected.push_back(i);
+		}
+		std::sort(found.begin(), found.end());
+		ASSERT_TRUE(found == expected);
+	}
+
+	Shape terrain = triangleMeshShape(valley);
+	Vec3 terrainCenter(0.0, 2.0, 0.0);
+	Shape box = boxShape(1.0, 1.0, 1.0);
+
+	// floating in the valley, inside the convex hull of the mesh but clear of the surface
+	ASSERT_FALSE(intersectsTransformed(terrain, box, CFrame(Vec3(0.0, 2.0, 0.0) - terrainCenter)));
+
+	// sunk into the slope at x = 2, pushed out of the front of the slope
+	std::optional<Intersection> sunk = intersectsTransformed(terrain, box, CFrame(Vec3(2.0, 2.2, 0.0) - terrainCenter));
+	ASSERT_TRUE(sunk);
+	ASSERT_TRUE(sunk->exitVector.y > 0.0f);
+	ASSERT_TRUE(sunk->exitVector.x < 0.0f);
+	// swapped, the part has to move down into the slope to get out of it
+	std::optional<Intersection> swapped = intersectsTransformed(box, terrain, CFrame(terrainCenter - Vec3(2.0, 2.2, 0.0)));
+	ASSERT_TRUE(swapped);
+	ASSERT_TOLERANT(swapped->exitVector == -sunk->exitVector, 0.001);
+
+	// dropped through the thin floor of the valley, only the first triangle it meets stops it
+	Vec3 normal;
+	std::optional<double> impact = timeOfImpactTransformed(box, terrain, CFrame(terrainCenter - Vec3(0.0, 3.0, 0.0)), Vec3(0.0, -6.0, 0.0), 0.001, normal);
+	ASSERT_TRUE(impact);
+	ASSERT_TOLERANT(*impact * 6.0 == 3.0 - 0.5 - 0.5, 0.05);
+	ASSERT_TRUE(normal.y < 0.0);
+	// swapped, the terrain moving up into the box meets it at the same time
+	Vec3 swappedNormal;
+	std::optional<double> swappedImpact = timeOfImpactTransformed(terrain, box, CFrame(Vec3(0.0, 3.0, 0.0) - terrainCenter), Vec3(0.0, 6.0, 0.0), 0.001, swappedNormal);
+	ASSERT_TRUE(swappedImpact);
+	ASSERT_TOLERANT(*swappedImpact == *impact, 0.001);
+	ASSERT_TOLERANT(swappedNormal == -normal, 0.001);
+}
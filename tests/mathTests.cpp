@@ -11,6 +11,7 @@
 #include <Physics3D/math/linalg/trigonometry.h>
 #include <Physics3D/math/linalg/largeMatrix.h>
 #include <Physics3D/math/linalg/largeMatrixAlgorithms.h>
+#include <Physics3D/math/linalg/sparseBlockMatrix.h>
 #include <Physics3D/math/linalg/eigen.h>
 #include <Physics3D/math/mathUtil.h>
 #include <Physics3D/math/taylorExpansion.h>
@@ -235,6 +236,53 @@ TEST_CASE(largeMatrixVectorSolve) {
 	ASSERT(solutionVector == vec);
 }
 
+TEST_CASE(sparseBlockMatrixSolveMatchesDense) {
+	// a chain, a cycle that causes fill in, and a star, with blocks of different sizes
+	std::vector<std::size_t> blockSizes{3, 5, 1, 3, 5, 3, 1, 3};
+	std::vector<std::pair<std::size_t, std::size_t>> nonZeroBlocks{{0, 1}, {1, 2}, {2, 3}, {3, 4}, {4, 1}, {5, 6}, {5, 7}, {5, 0}};
+	SparseBlockMatrix sparse;
+	sparse.setPattern(blockSizes, nonZeroBlocks);
+	std::size_t size = sparse.size();
+	ASSERT_STRICT(size == 24);
+
+	LargeMatrix<double> dense(size, size);
+	for(double& d : dense) d = 0.0;
+	auto fillBlock = [&](std::size_t row, std::size_t col) {
+		double* block = sparse.getBlock(row, col);
+		for(std::size_t r = 0; r < blockSizes[row]; r++) {
+			for(std::size_t c = 0; c < blockSizes[col]; c++) {
+				double value = fRand(-1.0, 1.0);
+				// diagonally dominant, such that no pivoting between blocks is needed
+				if(row == col && r == c) value += 10.0;
+				block[r * blockSizes[col] + c] = value;
+				dense(sparse.getBlockOffset(row) + r, sparse.getBlockOffset(col) + c) = value;
+			}
+		}
+	};
+	sparse.clearValues();
+	for(std::size_t i = 0; i < blockSizes.size(); i++) fillBlock(i, i);
+	for(const std::pair<std::size_t, std::size_t>& pair : nonZeroBlocks) {
+		fillBlock(pair.first, pair.second);
+		fillBlock(pair.second, pair.first);
+	}
+
+	LargeMatrix<double> solution(2, size);
+	for(double& d : solution) d = fRand(-1.0, 1.0);
+	std::vector<double> rhs(size * 2, 0.0);
+	for(std::size_t r = 0; r < size; r++) {
+		for(std::size_t c = 0; c < 2; c++) {
+			for(std::size_t i = 0; i < size; i++) rhs[r * 2 + c] += dense(r, i) * solution(i, c);
+		}
+	}
+
+	sparse.factorize();
+	sparse.solve(rhs.data(), 2);
+	for(std::size_t r = 0; r < size; r++) {
+		ASSERT(rhs[r * 2] == solution(r, 0));
+		ASSERT(rhs[r * 2 + 1] == solution(r, 1));
+	}
+}
+
 TEST_CASE(testTaylorExpansion) {
 	FullTaylorExpansion<double, 5> testTaylor{2.0, 5.0, 2.0, 3.0, -0.7};
 
@@ -6,6 +6,12 @@
 #include "generators.h"
 
 #include <Physics3D/world.h>
+#include <Physics3D/worldPhysics.h>
+#include <Physics3D/contactIslands.h>
+#include <Physics3D/misc/validityHelper.h>
+#include <Physics3D/misc/physicsProfiler.h>
+#include <Physics3D/misc/cpuid.h>
+#include <Physics3D/colissionPreTests.h>
 #include <Physics3D/inertia.h>
 #include <Physics3D/math/linalg/trigonometry.h>
 #include <Physics3D/math/linalg/eigen.h>
@@ -17,8 +23,11 @@
 #include <Physics3D/hardconstraints/motorConstraint.h>
 #include <Physics3D/hardconstraints/sinusoidalPistonConstraint.h>
 #include <Physics3D/hardconstraints/fixedConstraint.h>
+#include <Physics3D/constraints/ballConstraint.h>
 #include "../util/log.h"
 
+#include <set>
+
 
 using namespace P3D;
 #define REMAINS_CONSTANT(v) REMAINS_CONSTANT_TOLERANT(v, 0.0005)
@@ -1032,3 +1041,687 @@ TEST_CASE(setVelocity) {
 		}
 	}
 }
+
+static std::set<std::pair<Part*, Part*>> colissionPairSet(const std::vector<Colission>& colissions) {
+	std::set<std::pair<Part*, Part*>> result;
+	for(const Colission& c : colissions) {
+		result.emplace(std::min(c.p1, c.p2), std::max(c.p1, c.p2));
+	}
+	return result;
+}
+
+// adds gravity and partCount small boxes thrown in random directions above the terrain, the boxes are spread over all layers of the world
+static void buildFallingBoxWorld(WorldPrototype& world, std::vector<Part>& parts, int partCount, double maxHeight) {
+	world.addExternalForce(new DirectionalGravity(Vec3(0, -10, 0)));
+	parts.reserve(partCount);
+	for(int i = 0; i < partCount; i++) {
+		GlobalCFrame cf(generateDouble(-4.0, 4.0), generateDouble(0.5, maxHeight), generateDouble(-4.0, 4.0), Rotation::fromEulerAngles(generateDouble(), generateDouble(), generateDouble()));
+		parts.emplace_back(boxShape(0.6, 0.6, 0.6), cf, basicProperties);
+	}
+	int layerCount = static_cast<int>(world.layers.size());
+	for(int i = 0; i < partCount; i++) {
+		world.addPart(&parts[i], i % layerCount);
+		parts[i].setVelocity(generateVec3());
+	}
+}
+
+// the pre tests every broadphase path applies to the pairs it finds, run on a single lane
+static bool passesPreTests(const Part& p1, const Part& p2) {
+	if(!intersects(p1.getBounds(), p2.getBounds())) return false;
+	ColissionPreTestBatch batch;
+	batch.setLane(0, p1, p2);
+	PreTestBatchResult result = runColissionPreTestBatch(batch);
+	return (result.distanceRejects & 1) == 0 && (result.boundsRejects & 1) == 0;
+}
+
+// the colissions of the layer found by plainly traversing its trees, before the pre tests
+static ColissionBuffer unfilteredTreeTraversalColissions(const ColissionLayer& layer) {
+	ColissionBuffer result;
+	layer.subLayers[ColissionLayer::FREE_PARTS_LAYER].tree.forEachColission([&](Part* a, Part* b) {
+		result.freePartColissions.push_back(Colission{a, b});
+	});
+	layer.subLayers[ColissionLayer::FREE_PARTS_LAYER].tree.forEachColissionWith(layer.subLayers[ColissionLayer::TERRAIN_PARTS_LAYER].tree, [&](Part* a, Part* b) {
+		result.freeTerrainColissions.push_back(Colission{a, b});
+	});
+	return result;
+}
+
+static std::vector<Colission> passingPreTests(const std::vector<Colission>& colissions) {
+	std::vector<Colission> result;
+	for(const Colission& c : colissions) {
+		if(passesPreTests(*c.p1, *c.p2)) result.push_back(c);
+	}
+	return result;
+}
+
+// the colissions of the layer found by plainly traversing its trees, which the other broadphase paths are compared against
+static ColissionBuffer treeTraversalColissions(const ColissionLayer& layer) {
+	ColissionBuffer unfiltered = unfilteredTreeTraversalColissions(layer);
+	ColissionBuffer result;
+	result.freePartColissions = passingPreTests(unfiltered.freePartColissions);
+	result.freeTerrainColissions = passingPreTests(unfiltered.freeTerrainColissions);
+	return result;
+}
+
+TEST_CASE(pairCacheMatchesTreeTraversal) {
+	WorldPrototype world(DELTA_T);
+	std::vector<Part> parts;
+	Part floor(boxShape(20.0, 0.3, 20.0), GlobalCFrame(0.0, 0.0, 0.0), basicProperties);
+	world.addTerrainPart(&floor);
+	buildFallingBoxWorld(world, parts, 60, 8.0);
+
+	// overlapping parts attached to eachother don't collide, until they are detached
+	for(int i = 0; i < 10; i++) {
+		parts[2 * i].attach(&parts[2 * i + 1], CFrame(0.5, 0.0, 0.0));
+	}
+
+	ColissionLayer& layer = world.layers[0];
+	layer.setUsesPairCache(true);
+
+	for(int iter = 0; iter < 50; iter++) {
+		// parts leaving and entering the layer and physicals being split must be picked up
+		if(iter == 10) {
+			for(int i = 0; i < 10; i++) parts[2 * i + 1].detach();
+		}
+		if(iter == 20) {
+			for(int i = 20; i < 30; i++) world.removePart(&parts[i]);
+		}
+		if(iter == 30) {
+			for(int i = 20; i < 25; i++) world.addPart(&parts[i]);
+		}
+		world.tick();
+
+		ColissionBuffer cached;
+		layer.getInternalColissions(cached);
+
+		ColissionBuffer expected = treeTraversalColissions(layer);
+
+		ASSERT_STRICT(cached.freePartColissions.size() == expected.freePartColissions.size());
+		ASSERT_STRICT(cached.freeTerrainColissions.size() == expected.freeTerrainColissions.size());
+		ASSERT_TRUE(colissionPairSet(cached.freePartColissions) == colissionPairSet(expected.freePartColissions));
+		ASSERT_TRUE(colissionPairSet(cached.freeTerrainColissions) == colissionPairSet(expected.freeTerrainColissions));
+	}
+}
+
+TEST_CASE(preTestsRunOnDefaultLayer) {
+	WorldPrototype world(DELTA_T);
+	std::vector<Part> parts;
+	Part floor(boxShape(20.0, 0.3, 20.0), GlobalCFrame(0.0, 0.0, 0.0), basicProperties);
+	world.addTerrainPart(&floor);
+	buildFallingBoxWorld(world, parts, 60, 4.0);
+
+	ColissionLayer& layer = world.layers[0];
+	ASSERT_FALSE(layer.usesFatBounds());
+	ASSERT_FALSE(layer.usesPairCache());
+	ASSERT_TRUE(layer.getBroadphaseBackend() == BroadphaseBackend::BOUNDS_TREE);
+
+	long long totalDistanceRejects = 0;
+	long long totalBoundsRejects = 0;
+	for(int iter = 0; iter < 30; iter++) {
+		world.tick();
+
+		intersectionStatistics.clearCurrentTally();
+		ColissionBuffer found;
+		layer.getInternalColissions(found);
+		intersectionStatistics.nextTally();
+		// the history only holds the last tally
+		ParallelArray<long long, static_cast<std::size_t>(IntersectionResult::COUNT)> tally = intersectionStatistics.history.sum();
+		long long distanceRejects = tally[static_cast<std::size_t>(IntersectionResult::PART_DISTANCE_REJECT)];
+		long long boundsRejects = tally[static_cast<std::size_t>(IntersectionResult::PART_BOUNDS_REJECT)];
+
+		// every pair the tree reports is either rejected and tallied, or passed on
+		ColissionBuffer unfiltered = unfilteredTreeTraversalColissions(layer);
+		std::size_t foundCount = found.freePartColissions.size() + found.freeTerrainColissions.size();
+		std::size_t unfilteredCount = unfiltered.freePartColissions.size() + unfiltered.freeTerrainColissions.size();
+		ASSERT_STRICT(foundCount + distanceRejects + boundsRejects == unfilteredCount);
+
+		ColissionBuffer expected = treeTraversalColissions(layer);
+		ASSERT_TRUE(colissionPairSet(found.freePartColissions) == colissionPairSet(expected.freePartColissions));
+		ASSERT_TRUE(colissionPairSet(found.freeTerrainColissions) == colissionPairSet(expected.freeTerrainColissions));
+
+		totalDistanceRejects += distanceRejects;
+		totalBoundsRejects += boundsRejects;
+	}
+	ASSERT_TRUE(totalDistanceRejects > 0);
+	ASSERT_TRUE(totalBoundsRejects > 0);
+}
+
+TEST_CASE(fatBoundsKeepAllColissions) {
+	WorldPrototype world(DELTA_T);
+	std::vector<Part> parts;
+	Part floor(boxShape(20.0, 0.3, 20.0), GlobalCFrame(0.0, 0.0, 0.0), basicProperties);
+	world.addTerrainPart(&floor);
+	buildFallingBoxWorld(world, parts, 60, 8.0);
+
+	ColissionLayer& layer = world.layers[0];
+	layer.setUsesFatBounds(true);
+
+	for(int iter = 0; iter < 50; iter++) {
+		world.tick();
+		ASSERT_TRUE(isBoundsTreeValid(layer.subLayers[ColissionLayer::FREE_PARTS_LAYER].tree, true));
+
+		ColissionBuffer found;
+		layer.getInternalColissions(found);
+		std::set<std::pair<Part*, Part*>> foundPairs = colissionPairSet(found.freePartColissions);
+		std::set<std::pair<Part*, Part*>> foundTerrainPairs = colissionPairSet(found.freeTerrainColissions);
+
+		for(std::size_t i = 0; i < parts.size(); i++) {
+			Part* a = &parts[i];
+			for(std::size_t j = i + 1; j < parts.size(); j++) {
+				Part* b = &parts[j];
+				std::pair<Part*, Part*> pair(std::min(a, b), std::max(a, b));
+				bool boundsOverlap = intersects(a->getBounds(), b->getBounds());
+				if(!boundsOverlap) {
+					ASSERT_TRUE(foundPairs.count(pair) == 0);
+				} else if(safeIntersects(*a, *b).intersects) {
+					ASSERT_TRUE(foundPairs.count(pair) != 0);
+				}
+			}
+			std::pair<Part*, Part*> terrainPair(std::min(a, &floor), std::max(a, &floor));
+			if(!intersects(a->getBounds(), floor.getBounds())) {
+				ASSERT_TRUE(foundTerrainPairs.count(terrainPair) == 0);
+			} else if(safeIntersects(*a, floor).intersects) {
+				ASSERT_TRUE(foundTerrainPairs.count(terrainPair) != 0);
+			}
+		}
+	}
+}
+
+TEST_CASE(parallelLayerColissionsMatchSequential) {
+	WorldPrototype world(DELTA_T);
+	for(int i = 0; i < 6; i++) {
+		world.createLayer(i % 2 == 0, true);
+	}
+	std::vector<Part> parts;
+	Part floor(boxShape(20.0, 0.3, 20.0), GlobalCFrame(0.0, 0.0, 0.0), basicProperties);
+	world.addTerrainPart(&floor);
+	buildFallingBoxWorld(world, parts, 80, 8.0);
+
+	ThreadPool threadPool(4);
+	for(int iter = 0; iter < 30; iter++) {
+		world.tick(threadPool);
+		for(const ColissionLayer& layer : world.layers) {
+			ASSERT_TRUE(isBoundsTreeValid(layer.subLayers[ColissionLayer::FREE_PARTS_LAYER].tree));
+		}
+
+		ColissionBuffer sequential;
+		findColissions(world, sequential);
+		ColissionBuffer parallel;
+		findColissionsParallel(world, parallel, threadPool);
+
+		ASSERT_STRICT(sequential.freePartColissions.size() == parallel.freePartColissions.size());
+		ASSERT_STRICT(sequential.freeTerrainColissions.size() == parallel.freeTerrainColissions.size());
+		ASSERT_TRUE(colissionPairSet(sequential.freePartColissions) == colissionPairSet(parallel.freePartColissions));
+		ASSERT_TRUE(colissionPairSet(sequential.freeTerrainColissions) == colissionPairSet(parallel.freeTerrainColissions));
+	}
+}
+
+TEST_CASE(parallelOptimizeLayersKeepsAllParts) {
+	WorldPrototype world(DELTA_T);
+	// enough terrain for the tree to be built in parallel
+	std::vector<Part> terrain;
+	terrain.reserve(80 * 80);
+	for(int x = 0; x < 80; x++) {
+		for(int z = 0; z < 80; z++) {
+			terrain.emplace_back(boxShape(1.0, 0.3, 1.0), GlobalCFrame(x - 40.0, generateDouble(-0.1, 0.1), z - 40.0), basicProperties);
+		}
+	}
+	for(Part& p : terrain) world.addTerrainPart(&p);
+	std::vector<Part> parts;
+	buildFallingBoxWorld(world, parts, 60, 4.0);
+
+	ThreadPool threadPool(4);
+	world.optimizeLayers(threadPool);
+
+	WorldLayer& terrainLayer = world.layers[0].subLayers[ColissionLayer::TERRAIN_PARTS_LAYER];
+	WorldLayer& freeLayer = world.layers[0].subLayers[ColissionLayer::FREE_PARTS_LAYER];
+	ASSERT_TRUE(isBoundsTreeValid(terrainLayer.tree));
+	ASSERT_TRUE(isBoundsTreeValid(freeLayer.tree));
+	ASSERT_STRICT(terrainLayer.tree.size() == terrain.size());
+	ASSERT_STRICT(freeLayer.tree.size() == parts.size());
+	for(Part& p : terrain) {
+		ASSERT_TRUE(terrainLayer.tree.contains(&p));
+	}
+	for(Part& p : parts) {
+		ASSERT_TRUE(freeLayer.tree.contains(&p));
+	}
+	ASSERT_TRUE(world.isValid());
+}
+
+TEST_CASE(sweepAndPruneMatchesTreeTraversal) {
+	WorldPrototype world(DELTA_T);
+	std::vector<Part> parts;
+	Part floor(boxShape(20.0, 0.3, 20.0), GlobalCFrame(0.0, 0.0, 0.0), basicProperties);
+	Part wall(boxShape(0.3, 5.0, 20.0), GlobalCFrame(4.0, 2.5, 0.0), basicProperties);
+	world.addTerrainPart(&floor);
+	buildFallingBoxWorld(world, parts, 80, 4.0);
+
+	ColissionLayer& layer = world.layers[0];
+	layer.setBroadphaseBackend(BroadphaseBackend::SWEEP_AND_PRUNE);
+	ASSERT_TRUE(layer.getBroadphaseBackend() == BroadphaseBackend::SWEEP_AND_PRUNE);
+
+	std::size_t partsInLayer = parts.size() + 1;
+	for(int iter = 0; iter < 50; iter++) {
+		// parts and terrain leaving and entering the layer must be picked up
+		if(iter == 20) {
+			for(int i = 0; i < 10; i++) world.removePart(&parts[i]);
+			world.addTerrainPart(&wall);
+			partsInLayer += 1 - 10;
+		}
+		world.tick();
+
+		ColissionBuffer swept;
+		layer.getInternalColissions(swept);
+
+		ColissionBuffer expected = treeTraversalColissions(layer);
+
+		ASSERT_STRICT(layer.sweepAndPrune->getProxyCount() == partsInLayer);
+		ASSERT_STRICT(swept.freePartColissions.size() == expected.freePartColissions.size());
+		ASSERT_STRICT(swept.freeTerrainColissions.size() == expected.freeTerrainColissions.size());
+		ASSERT_TRUE(colissionPairSet(swept.freePartColissions) == colissionPairSet(expected.freePartColissions));
+		ASSERT_TRUE(colissionPairSet(swept.freeTerrainColissions) == colissionPairSet(expected.freeTerrainColissions));
+	}
+}
+
+TEST_CASE(frozenTerrainMatchesTreeTraversal) {
+	WorldPrototype world(DELTA_T);
+	std::vector<Part> terrain;
+	terrain.reserve(101);
+	for(int x = 0; x < 10; x++) {
+		for(int z = 0; z < 10; z++) {
+			terrain.emplace_back(boxShape(1.0, 0.3, 1.0), GlobalCFrame(x - 5.0, generateDouble(-0.1, 0.1), z - 5.0), basicProperties);
+		}
+	}
+	for(Part& p : terrain) world.addTerrainPart(&p);
+	std::vector<Part> parts;
+	buildFallingBoxWorld(world, parts, 60, 3.0);
+
+	ColissionLayer& layer = world.layers[0];
+	WorldLayer& terrainLayer = layer.subLayers[ColissionLayer::TERRAIN_PARTS_LAYER];
+	layer.setUsesFrozenTerrain(true);
+	ASSERT_TRUE(layer.getFrozenTerrain() != nullptr);
+
+	// the terrain tree is released while frozen, so the expected pairs are found using a separate tree
+	BoundsTree<Part> referenceTerrain;
+	for(Part& p : terrain) referenceTerrain.add(&p);
+
+	ThreadPool threadPool(4);
+	for(int iter = 0; iter < 30; iter++) {
+		if(iter == 10) {
+			terrain.emplace_back(boxShape(10.0, 0.3, 10.0), GlobalCFrame(0.0, 1.0, 0.0), basicProperties);
+			world.addTerrainPart(&terrain.back());
+			referenceTerrain.add(&terrain.back());
+			// stale until the next refresh, the terrain tree is rebuilt to add the part
+			ASSERT_TRUE(layer.getFrozenTerrain() == nullptr);
+			ASSERT_STRICT(terrainLayer.tree.size() == terrain.size());
+		}
+		world.tick();
+		ASSERT_TRUE(layer.getFrozenTerrain() != nullptr);
+		ASSERT_STRICT(layer.getFrozenTerrain()->size() == terrain.size());
+		ASSERT_STRICT(terrainLayer.tree.size() == 0);
+		ASSERT_STRICT(terrainLayer.tree.getPrototype().getAllocator().getSlabCount() == 0);
+		for(Part& p : terrain) {
+			ASSERT_TRUE(terrainLayer.contains(&p));
+		}
+
+		ColissionBuffer found;
+		layer.getInternalColissions(found);
+		ColissionBuffer foundParallel;
+		layer.getInternalColissionsParallel(foundParallel, threadPool);
+
+		std::vector<Colission> unfiltered;
+		layer.subLayers[ColissionLayer::FREE_PARTS_LAYER].tree.forEachColissionWith(referenceTerrain, [&](Part* a, Part* b) {
+			unfiltered.push_back(Colission{a, b});
+		});
+		std::vector<Colission> expected = passingPreTests(unfiltered);
+
+		ASSERT_STRICT(found.freeTerrainColissions.size() == expected.size());
+		ASSERT_TRUE(colissionPairSet(found.freeTerrainColissions) == colissionPairSet(expected));
+		ASSERT_TRUE(colissionPairSet(foundParallel.freeTerrainColissions) == colissionPairSet(expected));
+	}
+
+	// the terrain tree is rebuilt with all terrain when the terrain is no longer frozen
+	layer.setUsesFrozenTerrain(false);
+	ASSERT_STRICT(terrainLayer.tree.size() == terrain.size());
+	ASSERT_TRUE(isBoundsTreeValid(terrainLayer.tree));
+	for(Part& p : terrain) {
+		ASSERT_TRUE(terrainLayer.tree.contains(&p));
+		ASSERT_TRUE(p.layer == &terrainLayer);
+	}
+}
+
+static long long totalGJKIterationsOfLastTally() {
+	GJKCollidesIterationStatistics.nextTally();
+	GJKNoCollidesIterationStatistics.nextTally();
+	ParallelArray<long long, 17> collides = GJKCollidesIterationStatistics.history.sum();
+	ParallelArray<long long, 17> noCollides = GJKNoCollidesIterationStatistics.history.sum();
+	long long total = 0;
+	for(int i = 0; i < 17; i++) {
+		total += (collides[i] + noCollides[i]) * i;
+	}
+	return total;
+}
+
+// 0 if the pair passes, 1 for a distance reject, 2 for a bounds reject, in the order the pair by pair pre tests ran them
+static int preTestRejectCategory(const Part& p1, const Part& p2) {
+	if(isLongerThan(Vec3(p1.getPosition() - p2.getPosition()), p1.maxRadius + p2.maxRadius)) return 1;
+	Vec3 secondInFirst = p1.getCFrame().globalToLocal(p2.getPosition());
+	Vec3 firstInSecond = p2.getCFrame().globalToLocal(p1.getPosition());
+	for(int i = 0; i < 3; i++) {
+		if(std::abs(secondInFirst[i]) > p1.hitbox.scale[i] + p2.maxRadius) return 2;
+		if(std::abs(firstInSecond[i]) > p2.hitbox.scale[i] + p1.maxRadius) return 2;
+	}
+	return 0;
+}
+
+TEST_CASE(preTestBatchMatchesPairTests) {
+	std::vector<Part> parts;
+	parts.reserve(80);
+	for(int i = 0; i < 80; i++) {
+		GlobalCFrame cf(generateDouble(-3.0, 3.0), generateDouble(-3.0, 3.0), generateDouble(-3.0, 3.0), generateRotation());
+		if(i % 2 == 0) {
+			parts.emplace_back(boxShape(generateDouble(0.1, 3.0), generateDouble(0.1, 3.0), generateDouble(0.1, 3.0)), cf, basicProperties);
+		} else {
+			parts.emplace_back(sphereShape(generateDouble(0.1, 1.5)), cf, basicProperties);
+		}
+	}
+
+	int categoryCounts[3]{0, 0, 0};
+	for(std::size_t batchStart = 0; batchStart + 1 < parts.size(); batchStart += PRE_TEST_BATCH_LANES) {
+		ColissionPreTestBatch batch;
+		std::size_t lanesUsed = std::min(PRE_TEST_BATCH_LANES, parts.size() - 1 - batchStart);
+		for(std::size_t lane = 0; lane < lanesUsed; lane++) {
+			batch.setLane(lane, parts[batchStart + lane], parts[batchStart + lane + 1]);
+		}
+		PreTestBatchResult fallback = runColissionPreTestBatchFallback(batch);
+		if(CPUIDCheck::hasTechnology(CPUIDCheck::AVX | CPUIDCheck::AVX2)) {
+			PreTestBatchResult avx = runColissionPreTestBatchAVX(batch);
+			ASSERT_STRICT(avx.distanceRejects == fallback.distanceRejects);
+			ASSERT_STRICT(avx.boundsRejects == fallback.boundsRejects);
+		}
+		ASSERT_STRICT((fallback.distanceRejects & fallback.boundsRejects) == 0);
+		ASSERT_STRICT((fallback.distanceRejects >> lanesUsed) == 0);
+		ASSERT_STRICT((fallback.boundsRejects >> lanesUsed) == 0);
+		for(std::size_t lane = 0; lane < lanesUsed; lane++) {
+			int expected = preTestRejectCategory(parts[batchStart + lane], parts[batchStart + lane + 1]);
+			int found = ((fallback.distanceRejects >> lane) & 1) ? 1 : ((fallback.boundsRejects >> lane) & 1) ? 2 : 0;
+			ASSERT_STRICT(found == expected);
+			categoryCounts[expected]++;
+		}
+	}
+	// the generated pairs must exercise every outcome
+	ASSERT_TRUE(categoryCounts[0] > 0 && categoryCounts[1] > 0 && categoryCounts[2] > 0);
+}
+
+TEST_CASE(gjkWarmStartReducesIterations) {
+	// cylinder-box pairs have no specialized routine, so these all go through GJK
+	std::vector<Part> parts;
+	parts.reserve(400);
+	std::vector<Colission> pairs;
+	for(int i = 0; i < 200; i++) {
+		GlobalCFrame cylinderFrame(generateDouble(-1.0, 1.0), generateDouble(-1.0, 1.0), generateDouble(-1.0, 1.0), generateRotation());
+		parts.emplace_back(cylinderShape(0.5, 1.0), cylinderFrame, basicProperties);
+		Part& cylinder = parts.back();
+		parts.emplace_back(boxShape(0.8, 0.8, 0.8), cylinderFrame.localToGlobal(CFrame(generateVec3() * 0.6, generateRotation())), basicProperties);
+		pairs.push_back(Colission{&cylinder, &parts.back()});
+	}
+
+	std::vector<Colission> coldResult = pairs;
+	totalGJKIterationsOfLastTally();
+	refineColissions(coldResult, nullptr);
+	long long coldIterations = totalGJKIterationsOfLastTally();
+
+	GJKWarmStartCache cache;
+	std::vector<Colission> warmingResult = pairs;
+	refineColissions(warmingResult, &cache);
+	cache.removeStaleEntries();
+	ASSERT_STRICT(cache.size() == pairs.size());
+
+	std::vector<Colission> warmResult = pairs;
+	totalGJKIterationsOfLastTally();
+	refineColissions(warmResult, &cache);
+	long long warmIterations = totalGJKIterationsOfLastTally();
+
+	ASSERT_TRUE(warmIterations < coldIterations);
+	ASSERT_TRUE(colissionPairSet(warmResult) == colissionPairSet(coldResult));
+
+	// pairs that are no longer queried are dropped
+	cache.removeStaleEntries();
+	cache.removeStaleEntries();
+	ASSERT_STRICT(cache.size() == 0);
+}
+
+// the average angular speed of a box dropped onto a floor, measured after it had time to settle
+static double restingBoxAngularSpeed(bool usesContactManifolds, int& manifoldPointCount) {
+	WorldPrototype world(DELTA_T);
+	world.addExternalForce(new DirectionalGravity(Vec3(0, -10, 0)));
+	world.setUsesContactManifolds(usesContactManifolds);
+
+	Part floor(boxShape(10.0, 1.0, 10.0), GlobalCFrame(0.0, 0.0, 0.0), basicProperties);
+	Part box(boxShape(1.0, 1.0, 1.0), GlobalCFrame(0.3, 1.2, 0.1, Rotation::fromEulerAngles(0.1, 0.2, 0.05)), basicProperties);
+	world.addTerrainPart(&floor);
+	world.addPart(&box);
+
+	double totalAngularSpeed = 0.0;
+	for(int i = 0; i < 1000; i++) {
+		world.tick();
+		if(i >= 500) totalAngularSpeed += length(box.getAngularVelocity());
+	}
+	const ContactManifold* manifold = usesContactManifolds ? world.contactManifolds->getManifold(&box, &floor) : nullptr;
+	manifoldPointCount = (manifold != nullptr) ? manifold->pointCount : 0;
+	return totalAngularSpeed / 500;
+}
+
+TEST_CASE(contactManifoldsLetRestingBoxSettle) {
+	int manifoldPointCount;
+	double withoutManifolds = restingBoxAngularSpeed(false, manifoldPointCount);
+	double withManifolds = restingBoxAngularSpeed(true, manifoldPointCount);
+
+	ASSERT_STRICT(manifoldPointCount == ContactManifold::MAX_POINTS);
+	ASSERT_TRUE(withManifolds < 0.001);
+	ASSERT_TRUE(withManifolds < withoutManifolds);
+}
+
+// the x coordinate of a small box shot at a thin wall, after it had time to reach it
+static double bulletPositionAfterHittingWall(bool usesContinuousColission) {
+	WorldPrototype world(DELTA_T);
+	world.layers[0].usesContinuousColission = usesContinuousColission;
+
+	Part wall(boxShape(0.1, 4.0, 4.0), GlobalCFrame(5.0, 0.0, 0.0), basicProperties);
+	Part bullet(boxShape(0.2, 0.2, 0.2), GlobalCFrame(0.0, 0.3, -0.2, Rotation::fromEulerAngles(0.3, 0.2, 0.1)), basicProperties);
+	world.addTerrainPart(&wall);
+	world.addPart(&bullet);
+	// moves 1.5 per tick, far more than the combined thickness of the wall and the bullet
+	bullet.setVelocity(Vec3(150.0, 0.0, 0.0));
+
+	for(int i = 0; i < 20; i++) {
+		world.tick();
+	}
+	return Vec3(bullet.getPosition() - Position(0.0, 0.0, 0.0)).x;
+}
+
+TEST_CASE(continuousColissionStopsTunneling) {
+	ASSERT_TRUE(bulletPositionAfterHittingWall(false) > 5.0);
+	ASSERT_TRUE(bulletPositionAfterHittingWall(true) < 5.0);
+}
+
+// a tight pile of boxes, which forms one island with many contacts, and a few boxes lying apart on the floor
+static void buildIslandWorld(WorldPrototype& world, std::vector<Part>& parts, Part& floor) {
+	world.addExternalForce(new DirectionalGravity(Vec3(0, -10, 0)));
+	world.setUsesContactManifolds(true);
+	world.addTerrainPart(&floor);
+	parts.reserve(330);
+	for(int x = 0; x < 8; x++) {
+		for(int y = 0; y < 5; y++) {
+			for(int z = 0; z < 8; z++) {
+				parts.emplace_back(boxShape(0.5, 0.5, 0.5), GlobalCFrame(x * 0.48 - 2.0, y * 0.48 + 0.4, z * 0.48 - 2.0), basicProperties);
+			}
+		}
+	}
+	for(int i = 0; i < 10; i++) {
+		parts.emplace_back(boxShape(0.5, 0.5, 0.5), GlobalCFrame(6.0 + i, 0.35, 6.0, Rotation::fromEulerAngles(0.1 * i, 0.0, 0.0)), basicProperties);
+	}
+	for(Part& p : parts) world.addPart(&p);
+}
+
+TEST_CASE(parallelColissionHandlingMatchesSequential) {
+	WorldPrototype sequentialWorld(DELTA_T);
+	WorldPrototype parallelWorld(DELTA_T);
+	std::vector<Part> sequentialParts;
+	std::vector<Part> parallelParts;
+	Part sequentialFloor(boxShape(30.0, 0.3, 30.0), GlobalCFrame(0.0, 0.0, 0.0), basicProperties);
+	Part parallelFloor(boxShape(30.0, 0.3, 30.0), GlobalCFrame(0.0, 0.0, 0.0), basicProperties);
+	buildIslandWorld(sequentialWorld, sequentialParts, sequentialFloor);
+	buildIslandWorld(parallelWorld, parallelParts, parallelFloor);
+
+	ThreadPool threadPool(4);
+	std::size_t largestIsland = 0;
+	for(int iter = 0; iter < 10; iter++) {
+		findColissions(sequentialWorld, sequentialWorld.curColissions);
+		findColissions(parallelWorld, parallelWorld.curColissions);
+		applyExternalForces(sequentialWorld);
+		applyExternalForces(parallelWorld);
+
+		std::vector<IslandContact> contacts;
+		for(const Colission& c : parallelWorld.curColissions.freePartColissions) contacts.push_back(IslandContact{c.p1->getPhysical()->mainPhysical, c.p2->getPhysical()->mainPhysical});
+		for(const Colission& c : parallelWorld.curColissions.freeTerrainColissions) contacts.push_back(IslandContact{c.p1->getPhysical()->mainPhysical, nullptr});
+		for(const std::vector<std::size_t>& island : findContactIslands(contacts, parallelWorld.constraints)) {
+			largestIsland = std::max(largestIsland, island.size());
+		}
+
+		handleColissions(sequentialWorld.curColissions, sequentialWorld.contactManifolds.get());
+		handleColissionsParallel(parallelWorld.curColissions, parallelWorld.contactManifolds.get(), parallelWorld.constraints, threadPool);
+		update(sequentialWorld);
+		update(parallelWorld);
+
+		// bitwise the same
+		for(std::size_t i = 0; i < sequentialParts.size(); i++) {
+			ASSERT_TRUE(sequentialParts[i].getPosition() == parallelParts[i].getPosition());
+			ASSERT_TRUE(sequentialParts[i].getVelocity() == parallelParts[i].getVelocity());
+			ASSERT_TRUE(sequentialParts[i].getAngularVelocity() == parallelParts[i].getAngularVelocity());
+		}
+	}
+	// the pile was large enough to be split by coloring
+	ASSERT_TRUE(largestIsland > 256);
+}
+
+static int countSleeping(const std::vector<Part>& parts) {
+	int count = 0;
+	for(const Part& p : parts) {
+		if(p.getMainPhysical()->isAsleep) count++;
+	}
+	return count;
+}
+
+TEST_CASE(restingIslandsFallAsleepAndWakeUp) {
+	WorldPrototype world(DELTA_T);
+	world.addExternalForce(new DirectionalGravity(Vec3(0, -10, 0)));
+	world.setUsesContactManifolds(true);
+	world.setUsesSleeping(true);
+	Part floor(boxShape(30.0, 0.3, 30.0), GlobalCFrame(0.0, 0.0, 0.0), basicProperties);
+	world.addTerrainPart(&floor);
+	std::vector<Part> parts;
+	parts.reserve(4);
+	// a stack of two boxes, a box lying apart, and a box held high up until it is dropped onto the stack
+	parts.emplace_back(boxShape(0.5, 0.5, 0.5), GlobalCFrame(0.0, 0.4, 0.0), basicProperties);
+	parts.emplace_back(boxShape(0.5, 0.5, 0.5), GlobalCFrame(0.0, 0.9, 0.0), basicProperties);
+	parts.emplace_back(boxShape(0.5, 0.5, 0.5), GlobalCFrame(5.0, 0.4, 0.0), basicProperties);
+	for(Part& p : parts) world.addPart(&p);
+
+	for(int i = 0; i < 1000 && countSleeping(parts) < 3; i++) world.tick();
+	ASSERT_STRICT(countSleeping(parts) == 3);
+	ASSERT_STRICT(sleepStatistics.history.avg()[static_cast<std::size_t>(SleepState::ASLEEP)] == 3);
+	Position sleepingPosition = parts[1].getPosition();
+	for(int i = 0; i < 100; i++) world.tick();
+	ASSERT_TRUE(parts[1].getPosition() == sleepingPosition);
+
+	// an API edit wakes only the physical it changes
+	parts[2].setVelocity(Vec3(1.0, 0.0, 0.0));
+	ASSERT_FALSE(parts[2].getMainPhysical()->isAsleep);
+	ASSERT_STRICT(countSleeping(parts) == 2);
+
+	// a falling box wakes the stack it lands on
+	Part dropped(boxShape(0.5, 0.5, 0.5), GlobalCFrame(0.0, 3.0, 0.0), basicProperties);
+	world.addPart(&dropped);
+	bool stackWokeUp = false;
+	for(int i = 0; i < 200; i++) {
+		world.tick();
+		if(!parts[0].getMainPhysical()->isAsleep && !parts[1].getMainPhysical()->isAsleep) stackWokeUp = true;
+	}
+	ASSERT_TRUE(stackWokeUp);
+
+	for(int i = 0; i < 1000 && countSleeping(parts) < 3; i++) world.tick();
+	ASSERT_STRICT(countSleeping(parts) == 3);
+
+	// removing the floor wakes the boxes that rested on it, the next tick wakes the rest of their island
+	world.removePart(&floor);
+	ASSERT_FALSE(parts[0].getMainPhysical()->isAsleep);
+	ASSERT_FALSE(parts[2].getMainPhysical()->isAsleep);
+	world.tick();
+	ASSERT_STRICT(countSleeping(parts) == 0);
+	ASSERT_TRUE(parts[0].getVelocity().y < 0.0);
+}
+
+TEST_CASE(sequentialImpulsesKeepStackStableAtLargeDeltaT) {
+	// four times the usual deltaT, at which depth forces make this stack explode
+	WorldPrototype world(DELTA_T * 4);
+	world.addExternalForce(new DirectionalGravity(Vec3(0, -10, 0)));
+	world.setUsesSequentialImpulses(true);
+	ASSERT_TRUE(world.usesContactManifolds());
+	Part floor(boxShape(30.0, 2.0, 30.0), GlobalCFrame(0.0, -0.85, 0.0), basicProperties);
+	world.addTerrainPart(&floor);
+	std::vector<Part> stack;
+	stack.reserve(5);
+	for(int i = 0; i < 5; i++) {
+		stack.emplace_back(boxShape(0.5, 0.5, 0.5), GlobalCFrame(0.0, 0.4 + 0.5 * i, 0.0), basicProperties);
+	}
+	for(Part& p : stack) world.addPart(&p);
+
+	for(int i = 0; i < 125; i++) world.tick();
+
+	for(int i = 0; i < 5; i++) {
+		Vec3 offset = stack[i].getPosition() - Position(0.0, 0.4 + 0.5 * i, 0.0);
+		ASSERT_TOLERANT(offset == Vec3(0.0, 0.0, 0.0), 0.1);
+		ASSERT_TOLERANT(stack[i].getVelocity() == Vec3(0.0, 0.0, 0.0), 0.001);
+	}
+	// the impulses that held the stack up are kept in the manifolds to warm start the next tick
+	const ContactManifold* bottomContact = world.contactManifolds->getManifold(&stack[0], &floor);
+	ASSERT_TRUE(bottomContact != nullptr && bottomContact->pointCount > 0);
+	ASSERT_TRUE(bottomContact->points[0].normalImpulse > 0.0);
+}
+
+TEST_CASE(constraintGroupPatternFollowsAddedConstraints) {
+	// two copies of the same chain, one solved by a group that already solved a shorter chain
+	std::vector<Part> cachedChain;
+	std::vector<Part> freshChain;
+	cachedChain.reserve(3);
+	freshChain.reserve(3);
+	for(int i = 0; i < 3; i++) {
+		cachedChain.emplace_back(boxShape(1.0, 0.2, 0.2), GlobalCFrame(1.1 * i, 0.05 * i, 0.0), basicProperties);
+		freshChain.emplace_back(boxShape(1.0, 0.2, 0.2), GlobalCFrame(1.1 * i, 0.05 * i, 0.0), basicProperties);
+	}
+	for(std::vector<Part>* chain : {&cachedChain, &freshChain}) {
+		(*chain)[2].ensureHasPhysical()->mainPhysical->motionOfCenterOfMass.translation.translation[0] = Vec3(0.0, 1.0, 0.5);
+	}
+
+	ConstraintGroup cachedGroup;
+	cachedGroup.add(&cachedChain[0], &cachedChain[1], new BallConstraint(Vec3(0.55, 0.0, 0.0), Vec3(-0.55, 0.0, 0.0)));
+	cachedGroup.apply();
+	cachedGroup.add(&cachedChain[1], &cachedChain[2], new BallConstraint(Vec3(0.55, 0.0, 0.0), Vec3(-0.55, 0.0, 0.0)));
+	cachedGroup.apply();
+
+	ConstraintGroup firstFreshGroup;
+	firstFreshGroup.add(&freshChain[0], &freshChain[1], new BallConstraint(Vec3(0.55, 0.0, 0.0), Vec3(-0.55, 0.0, 0.0)));
+	firstFreshGroup.apply();
+	ConstraintGroup secondFreshGroup;
+	secondFreshGroup.add(&freshChain[0], &freshChain[1], new BallConstraint(Vec3(0.55, 0.0, 0.0), Vec3(-0.55, 0.0, 0.0)));
+	secondFreshGroup.add(&freshChain[1], &freshChain[2], new BallConstraint(Vec3(0.55, 0.0, 0.0), Vec3(-0.55, 0.0, 0.0)));
+	secondFreshGroup.apply();
+
+	for(int i = 0; i < 3; i++) {
+		ASSERT_TOLERANT(cachedChain[i].getCFrame() == freshChain[i].getCFrame(), 1e-9);
+		ASSERT_TOLERANT(cachedChain[i].getMotion() == freshChain[i].getMotion(), 1e-9);
+	}
+	// the error of the second constraint was nonzero, so it has been corrected
+	ASSERT_FALSE(cachedChain[2].getPosition() == Position(2.2, 0.1, 0.0));
+}